@@ -0,0 +1,79 @@
+// 深分页测试：ZRANGE/LINDEX在不同偏移处的单次耗时，偏移从0增长到接近集合大小
+// 用法: range_bench [元素个数，默认1000000]
+#include "../src/data_structures/zset.h"
+#include "../src/data_structures/list.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 每个偏移重复执行的次数，取平均值
+const int k_rounds = 2000;
+// 每次ZRANGE取出的元素个数
+const int k_page = 10;
+
+static double now_ns()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<long> offsets_for(long n)
+{
+    std::vector<long> offs;
+    for (long off = 0; off < n - k_page; off = off == 0 ? 1000 : off * 10)
+        offs.push_back(off);
+    offs.push_back(n / 2);
+    offs.push_back(n - k_page);
+    return offs;
+}
+
+static void bench_zrange(HMap &db, long n)
+{
+    std::vector<std::pair<std::string, double>> items;
+    items.reserve(n);
+    for (long i = 0; i < n; i++)
+        items.emplace_back("m" + std::to_string(i), (double)i);
+    Value *val = Zset("z").create(db);
+    ZsetEntry::zbuild(val, items);
+
+    ZsetEntry entry("");
+    std::printf("ZRANGE key off off+%d (n=%ld)\n", k_page - 1, n);
+    for (long off : offsets_for(n))
+    {
+        size_t sink = 0;
+        double start = now_ns();
+        for (int r = 0; r < k_rounds; r++)
+            sink += entry.zrange(val, (int)off + 1, (int)off + k_page).size();
+        double per = (now_ns() - start) / k_rounds;
+        std::printf("  offset %9ld  %8.0f ns/op  (%zu)\n", off, per, sink / k_rounds);
+    }
+}
+
+static void bench_lindex(HMap &db, long n)
+{
+    ListNode *l = List("l").create(db);
+    for (long i = 0; i < n; i++)
+        l->ql.ql_push_back("e" + std::to_string(i));
+
+    std::printf("LINDEX key off (n=%ld, %u nodes)\n", n, l->ql.ql_nodes());
+    for (long off : offsets_for(n))
+    {
+        size_t sink = 0;
+        std::string_view elem;
+        double start = now_ns();
+        for (int r = 0; r < k_rounds; r++)
+            sink += l->ql.ql_index(off, elem) ? elem.size() : 0;
+        double per = (now_ns() - start) / k_rounds;
+        std::printf("  offset %9ld  %8.0f ns/op  (%zu)\n", off, per, sink / k_rounds);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? std::atol(argv[1]) : 1000000;
+    HMap db;
+    bench_zrange(db, n);
+    bench_lindex(db, n);
+    return 0;
+}
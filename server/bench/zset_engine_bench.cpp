@@ -0,0 +1,100 @@
+// 有序集合排序索引引擎对比：ZADD、ZRANK、ZRANGE、按分数定位在大集合上的单次耗时
+// 引擎由编译选项决定，分别以 -DZSET_USE_BTREE=OFF/ON 构建后运行，比较两次的输出
+// 用法: zset_engine_bench [元素个数，默认1000000]
+#include "../src/data_structures/zset.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// 查询类操作的执行次数
+const int k_queries = 1000000;
+
+static double now_ns()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char *name, double start, long ops, size_t sink)
+{
+    std::printf("  %-22s %8.0f ns/op  (%zu)\n", name, (now_ns() - start) / ops, sink);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? std::atol(argv[1]) : 1000000;
+#ifdef ZSET_USE_BTREE
+    std::printf("engine: B+tree, n=%ld\n", n);
+#else
+    std::printf("engine: AVL, n=%ld\n", n);
+#endif
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> score_dist(0, (double)n);
+    std::vector<double> scores(n);
+    for (long i = 0; i < n; i++)
+        scores[i] = score_dist(rng);
+
+    HMap db;
+    Value *val = Zset("z").create(db);
+    size_t sink = 0;
+
+    // 逐个插入，分数随机，包含紧凑编码转换以及索引的分裂/旋转
+    double start = now_ns();
+    for (long i = 0; i < n; i++)
+    {
+        ZsetEntry entry(scores[i], "m" + std::to_string(i));
+        sink += entry.zadd(val);
+    }
+    report("ZADD", start, n, sink);
+
+    std::uniform_int_distribution<long> member_dist(0, n - 1);
+    sink = 0;
+    start = now_ns();
+    for (int q = 0; q < k_queries; q++)
+    {
+        bool ok = false;
+        ZsetEntry entry("m" + std::to_string(member_dist(rng)));
+        sink += entry.zrank(val, ok);
+    }
+    report("ZRANK", start, k_queries, sink);
+
+    ZsetEntry entry("");
+    std::uniform_int_distribution<int> rank_dist(1, (int)n - 1000);
+    sink = 0;
+    start = now_ns();
+    for (int q = 0; q < k_queries; q++)
+    {
+        int rank = rank_dist(rng);
+        sink += entry.zrange(val, rank, rank + 9).size();
+    }
+    report("ZRANGE 10", start, k_queries, sink);
+
+    // 长范围扫描，体现沿索引顺序访问元素的缓存友好程度
+    sink = 0;
+    start = now_ns();
+    for (int q = 0; q < k_queries / 100; q++)
+    {
+        int rank = rank_dist(rng);
+        sink += entry.zrange(val, rank, rank + 999).size();
+    }
+    report("ZRANGE 1000", start, k_queries / 100, sink);
+
+    sink = 0;
+    start = now_ns();
+    for (int q = 0; q < k_queries; q++)
+        sink += entry.zseek(val, score_dist(rng), false);
+    report("seek by score", start, k_queries, sink);
+
+    sink = 0;
+    start = now_ns();
+    for (int q = 0; q < k_queries / 10; q++)
+    {
+        double lo = score_dist(rng);
+        sink += entry.zrangebyscore(val, lo, lo + 10).size();
+    }
+    report("ZRANGEBYSCORE ~10", start, k_queries / 10, sink);
+    return 0;
+}
@@ -3,13 +3,31 @@
 #include "../data_structures/global/globals.h"
 #include "../data_structures/string.h"
 #include "../data_structures/zset.h"
+#include "../data_structures/hash.h"
+#include "../data_structures/list.h"
+#include "../data_structures/set.h"
+#include "../data_structures/bloom.h"
+#include "../data_structures/cuckoo.h"
+#include "../data_structures/stream.h"
+#include "../utils/utils.h"
+#include "../network/pubsub.h"
+#include "../utils/match/match.h"
+#include "../utils/latency/latency.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
 
 CommandDispatcher::CommandDispatcher()
 {
     // 注册所有命令
     register_commands();
-    Logger::debug("CommandDispatcher()  注册所有命令成功");
+    LOG_DEBUG("CommandDispatcher()  注册所有命令成功");
+    // 启动时完成计时时钟的校准，避免第一次查询统计时阻塞
+    cycles_per_us();
 }
 
 void CommandDispatcher::register_commands()
@@ -19,16 +37,79 @@ void CommandDispatcher::register_commands()
     regiser_command(Command("GET", CommandType::GET, 2, 2, "GET key", &CommandDispatcher::handle_get));
 
     // set
-    regiser_command(Command("SET", CommandType::SET, 3, 3, "SET key value", &CommandDispatcher::handle_set));
+    regiser_command(Command("SET", CommandType::SET, 3, 3, "SET key value", &CommandDispatcher::handle_set, {1, 1}));
 
     // del
-    regiser_command(Command("DEL", CommandType::DEL, 2, 2, "DEL key", &CommandDispatcher::handle_del));
+    regiser_command(Command("DEL", CommandType::DEL, 2, 2, "DEL key", &CommandDispatcher::handle_del, {1, 1}));
+
+    // incr
+    regiser_command(Command("INCR", CommandType::INCR, 2, 2, "INCR key", &CommandDispatcher::handle_incr, {1, 1}));
+
+    // decr
+    regiser_command(Command("DECR", CommandType::DECR, 2, 2, "DECR key", &CommandDispatcher::handle_decr, {1, 1}));
+
+    // incrby
+    regiser_command(Command("INCRBY", CommandType::INCRBY, 3, 3, "INCRBY key increment", &CommandDispatcher::handle_incrby, {1, 1}));
+
+    // decrby
+    regiser_command(Command("DECRBY", CommandType::DECRBY, 3, 3, "DECRBY key decrement", &CommandDispatcher::handle_decrby, {1, 1}));
+
+    // incrbyfloat
+    regiser_command(Command("INCRBYFLOAT", CommandType::INCRBYFLOAT, 3, 3, "INCRBYFLOAT key increment", &CommandDispatcher::handle_incrbyfloat, {1, 1}));
+
+    // mget
+    regiser_command(Command("MGET", CommandType::MGET, 2, -1, "MGET key [key ...]", &CommandDispatcher::handle_mget));
+
+    // mset
+    regiser_command(Command("MSET", CommandType::MSET, 3, -1, "MSET key value [key value ...]", &CommandDispatcher::handle_mset, {1, -1, 2}));
+
+    // msetnx
+    regiser_command(Command("MSETNX", CommandType::MSETNX, 3, -1, "MSETNX key value [key value ...]", &CommandDispatcher::handle_msetnx));
+
+    // append
+    regiser_command(Command("APPEND", CommandType::APPEND, 3, 3, "APPEND key value", &CommandDispatcher::handle_append, {1, 1}));
+
+    // getrange
+    regiser_command(Command("GETRANGE", CommandType::GETRANGE, 4, 4, "GETRANGE key start end", &CommandDispatcher::handle_getrange));
+
+    // setrange
+    regiser_command(Command("SETRANGE", CommandType::SETRANGE, 4, 4, "SETRANGE key offset value", &CommandDispatcher::handle_setrange, {1, 1}));
+
+    // strlen
+    regiser_command(Command("STRLEN", CommandType::STRLEN, 2, 2, "STRLEN key", &CommandDispatcher::handle_strlen));
+
+    // getdel
+    regiser_command(Command("GETDEL", CommandType::GETDEL, 2, 2, "GETDEL key", &CommandDispatcher::handle_getdel, {1, 1}));
+
+    // setbit
+    regiser_command(Command("SETBIT", CommandType::SETBIT, 4, 4, "SETBIT key offset value", &CommandDispatcher::handle_setbit, {1, 1}));
+
+    // getbit
+    regiser_command(Command("GETBIT", CommandType::GETBIT, 3, 3, "GETBIT key offset", &CommandDispatcher::handle_getbit));
+
+    // bitcount
+    regiser_command(Command("BITCOUNT", CommandType::BITCOUNT, 2, 5, "BITCOUNT key [start end [BYTE|BIT]]", &CommandDispatcher::handle_bitcount));
+
+    // bitpos
+    regiser_command(Command("BITPOS", CommandType::BITPOS, 3, 6, "BITPOS key bit [start [end [BYTE|BIT]]]", &CommandDispatcher::handle_bitpos));
+
+    // bitop
+    regiser_command(Command("BITOP", CommandType::BITOP, 4, -1, "BITOP AND|OR|XOR|NOT destkey key [key ...]", &CommandDispatcher::handle_bitop, {2, 2}));
+
+    // pfadd
+    regiser_command(Command("PFADD", CommandType::PFADD, 2, -1, "PFADD key [element ...]", &CommandDispatcher::handle_pfadd, {1, 1}));
+
+    // pfcount
+    regiser_command(Command("PFCOUNT", CommandType::PFCOUNT, 2, -1, "PFCOUNT key [key ...]", &CommandDispatcher::handle_pfcount));
+
+    // pfmerge
+    regiser_command(Command("PFMERGE", CommandType::PFMERGE, 2, -1, "PFMERGE destkey [sourcekey ...]", &CommandDispatcher::handle_pfmerge, {1, 1}));
 
     // zadd
-    regiser_command(Command("ZADD", CommandType::ZADD, 4, 4, "ZADD key score member", &CommandDispatcher::handle_zadd));
+    regiser_command(Command("ZADD", CommandType::ZADD, 4, -1, "ZADD key [NX|XX] [GT|LT] [CH] [INCR] score member [score member ...]", &CommandDispatcher::handle_zadd, {1, 1}));
 
     // zrem
-    regiser_command(Command("ZREM", CommandType::ZREM, 3, 3, "ZREM key member", &CommandDispatcher::handle_zrem));
+    regiser_command(Command("ZREM", CommandType::ZREM, 3, 3, "ZREM key member", &CommandDispatcher::handle_zrem, {1, 1}));
 
     // zscore
     regiser_command(Command("ZSCORE", CommandType::ZSCORE, 3, 3, "ZSCORE key member", &CommandDispatcher::handle_zscore));
@@ -42,11 +123,218 @@ void CommandDispatcher::register_commands()
     // zrange
     regiser_command(Command("ZRANGE", CommandType::ZRANGE, 4, 4, "ZRANGE key min max", &CommandDispatcher::handle_zrange));
 
+    // zrevrange
+    regiser_command(Command("ZREVRANGE", CommandType::ZREVRANGE, 4, 4, "ZREVRANGE key min max", &CommandDispatcher::handle_zrevrange));
+
+    // zrangebyscore
+    regiser_command(Command("ZRANGEBYSCORE", CommandType::ZRANGEBYSCORE, 4, 4, "ZRANGEBYSCORE key min max", &CommandDispatcher::handle_zrangebyscore));
+
     // zall
     regiser_command(Command("ZALL", CommandType::ZALL, 2, 2, "ZALL key", &CommandDispatcher::handle_zall));
 
     //zdel
-    regiser_command(Command("ZDEL", CommandType::ZDEL, 2, 2, "ZDEL key", &CommandDispatcher::handle_zdel));
+    regiser_command(Command("ZDEL", CommandType::ZDEL, 2, 2, "ZDEL key", &CommandDispatcher::handle_zdel, {1, 1}));
+
+    // zincrby
+    regiser_command(Command("ZINCRBY", CommandType::ZINCRBY, 4, 4, "ZINCRBY key increment member", &CommandDispatcher::handle_zincrby, {1, 1}));
+
+    // zmscore
+    regiser_command(Command("ZMSCORE", CommandType::ZMSCORE, 3, -1, "ZMSCORE key member [member ...]", &CommandDispatcher::handle_zmscore));
+
+    // zunionstore
+    regiser_command(Command("ZUNIONSTORE", CommandType::ZUNIONSTORE, 4, -1, "ZUNIONSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]", &CommandDispatcher::handle_zunionstore, {1, 1}));
+
+    // zinterstore
+    regiser_command(Command("ZINTERSTORE", CommandType::ZINTERSTORE, 4, -1, "ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]", &CommandDispatcher::handle_zinterstore, {1, 1}));
+
+    // zdiffstore
+    regiser_command(Command("ZDIFFSTORE", CommandType::ZDIFFSTORE, 4, -1, "ZDIFFSTORE destination numkeys key [key ...]", &CommandDispatcher::handle_zdiffstore, {1, 1}));
+
+    // hset
+    regiser_command(Command("HSET", CommandType::HSET, 4, -1, "HSET key field value [field value ...]", &CommandDispatcher::handle_hset, {1, 1}));
+
+    // hget
+    regiser_command(Command("HGET", CommandType::HGET, 3, 3, "HGET key field", &CommandDispatcher::handle_hget));
+
+    // hmget
+    regiser_command(Command("HMGET", CommandType::HMGET, 3, -1, "HMGET key field [field ...]", &CommandDispatcher::handle_hmget));
+
+    // hdel
+    regiser_command(Command("HDEL", CommandType::HDEL, 3, -1, "HDEL key field [field ...]", &CommandDispatcher::handle_hdel, {1, 1}));
+
+    // hlen
+    regiser_command(Command("HLEN", CommandType::HLEN, 2, 2, "HLEN key", &CommandDispatcher::handle_hlen));
+
+    // hgetall
+    regiser_command(Command("HGETALL", CommandType::HGETALL, 2, 2, "HGETALL key", &CommandDispatcher::handle_hgetall));
+
+    // hincrby
+    regiser_command(Command("HINCRBY", CommandType::HINCRBY, 4, 4, "HINCRBY key field increment", &CommandDispatcher::handle_hincrby, {1, 1}));
+
+    // hscan
+    regiser_command(Command("HSCAN", CommandType::HSCAN, 3, 7, "HSCAN key cursor [MATCH pattern] [COUNT count]", &CommandDispatcher::handle_hscan));
+
+    // lpush
+    regiser_command(Command("LPUSH", CommandType::LPUSH, 3, -1, "LPUSH key element [element ...]", &CommandDispatcher::handle_lpush, {1, 1}));
+
+    // rpush
+    regiser_command(Command("RPUSH", CommandType::RPUSH, 3, -1, "RPUSH key element [element ...]", &CommandDispatcher::handle_rpush, {1, 1}));
+
+    // lpop
+    regiser_command(Command("LPOP", CommandType::LPOP, 2, 3, "LPOP key [count]", &CommandDispatcher::handle_lpop, {1, 1}));
+
+    // rpop
+    regiser_command(Command("RPOP", CommandType::RPOP, 2, 3, "RPOP key [count]", &CommandDispatcher::handle_rpop, {1, 1}));
+
+    // lrange
+    regiser_command(Command("LRANGE", CommandType::LRANGE, 4, 4, "LRANGE key start stop", &CommandDispatcher::handle_lrange));
+
+    // llen
+    regiser_command(Command("LLEN", CommandType::LLEN, 2, 2, "LLEN key", &CommandDispatcher::handle_llen));
+
+    // lindex
+    regiser_command(Command("LINDEX", CommandType::LINDEX, 3, 3, "LINDEX key index", &CommandDispatcher::handle_lindex));
+
+    // ltrim
+    regiser_command(Command("LTRIM", CommandType::LTRIM, 4, 4, "LTRIM key start stop", &CommandDispatcher::handle_ltrim, {1, 1}));
+
+    // blpop
+    regiser_command(Command("BLPOP", CommandType::BLPOP, 3, -1, "BLPOP key [key ...] timeout", &CommandDispatcher::handle_blpop, {1, -2}));
+
+    // brpop
+    regiser_command(Command("BRPOP", CommandType::BRPOP, 3, -1, "BRPOP key [key ...] timeout", &CommandDispatcher::handle_brpop, {1, -2}));
+
+    // blmove
+    regiser_command(Command("BLMOVE", CommandType::BLMOVE, 6, 6, "BLMOVE source destination LEFT|RIGHT LEFT|RIGHT timeout", &CommandDispatcher::handle_blmove, {1, 2}));
+
+    // sadd
+    regiser_command(Command("SADD", CommandType::SADD, 3, -1, "SADD key member [member ...]", &CommandDispatcher::handle_sadd, {1, 1}));
+
+    // srem
+    regiser_command(Command("SREM", CommandType::SREM, 3, -1, "SREM key member [member ...]", &CommandDispatcher::handle_srem, {1, 1}));
+
+    // sismember
+    regiser_command(Command("SISMEMBER", CommandType::SISMEMBER, 3, 3, "SISMEMBER key member", &CommandDispatcher::handle_sismember));
+
+    // smembers
+    regiser_command(Command("SMEMBERS", CommandType::SMEMBERS, 2, 2, "SMEMBERS key", &CommandDispatcher::handle_smembers));
+
+    // scard
+    regiser_command(Command("SCARD", CommandType::SCARD, 2, 2, "SCARD key", &CommandDispatcher::handle_scard));
+
+    // sinter
+    regiser_command(Command("SINTER", CommandType::SINTER, 2, -1, "SINTER key [key ...]", &CommandDispatcher::handle_sinter));
+
+    // sunion
+    regiser_command(Command("SUNION", CommandType::SUNION, 2, -1, "SUNION key [key ...]", &CommandDispatcher::handle_sunion));
+
+    // sdiff
+    regiser_command(Command("SDIFF", CommandType::SDIFF, 2, -1, "SDIFF key [key ...]", &CommandDispatcher::handle_sdiff));
+
+    // bf.reserve
+    regiser_command(Command("BF.RESERVE", CommandType::BF_RESERVE, 4, 4, "BF.RESERVE key error_rate capacity", &CommandDispatcher::handle_bf_reserve, {1, 1}));
+
+    // bf.add
+    regiser_command(Command("BF.ADD", CommandType::BF_ADD, 3, 3, "BF.ADD key item", &CommandDispatcher::handle_bf_add, {1, 1}));
+
+    // bf.madd
+    regiser_command(Command("BF.MADD", CommandType::BF_MADD, 3, -1, "BF.MADD key item [item ...]", &CommandDispatcher::handle_bf_madd, {1, 1}));
+
+    // bf.exists
+    regiser_command(Command("BF.EXISTS", CommandType::BF_EXISTS, 3, 3, "BF.EXISTS key item", &CommandDispatcher::handle_bf_exists));
+
+    // bf.mexists
+    regiser_command(Command("BF.MEXISTS", CommandType::BF_MEXISTS, 3, -1, "BF.MEXISTS key item [item ...]", &CommandDispatcher::handle_bf_mexists));
+
+    // cf.reserve
+    regiser_command(Command("CF.RESERVE", CommandType::CF_RESERVE, 3, 3, "CF.RESERVE key capacity", &CommandDispatcher::handle_cf_reserve, {1, 1}));
+
+    // cf.add
+    regiser_command(Command("CF.ADD", CommandType::CF_ADD, 3, 3, "CF.ADD key item", &CommandDispatcher::handle_cf_add, {1, 1}));
+
+    // cf.addnx
+    regiser_command(Command("CF.ADDNX", CommandType::CF_ADDNX, 3, 3, "CF.ADDNX key item", &CommandDispatcher::handle_cf_addnx, {1, 1}));
+
+    // cf.exists
+    regiser_command(Command("CF.EXISTS", CommandType::CF_EXISTS, 3, 3, "CF.EXISTS key item", &CommandDispatcher::handle_cf_exists));
+
+    // cf.mexists
+    regiser_command(Command("CF.MEXISTS", CommandType::CF_MEXISTS, 3, -1, "CF.MEXISTS key item [item ...]", &CommandDispatcher::handle_cf_mexists));
+
+    // cf.del
+    regiser_command(Command("CF.DEL", CommandType::CF_DEL, 3, 3, "CF.DEL key item", &CommandDispatcher::handle_cf_del, {1, 1}));
+
+    // xadd
+    regiser_command(Command("XADD", CommandType::XADD, 5, -1, "XADD key [MAXLEN [=|~] threshold] *|id field value [field value ...]", &CommandDispatcher::handle_xadd, {1, 1}));
+
+    // xrange
+    regiser_command(Command("XRANGE", CommandType::XRANGE, 4, 6, "XRANGE key start end [COUNT count]", &CommandDispatcher::handle_xrange));
+
+    // xrevrange
+    regiser_command(Command("XREVRANGE", CommandType::XREVRANGE, 4, 6, "XREVRANGE key end start [COUNT count]", &CommandDispatcher::handle_xrevrange));
+
+    // xlen
+    regiser_command(Command("XLEN", CommandType::XLEN, 2, 2, "XLEN key", &CommandDispatcher::handle_xlen));
+
+    // xtrim
+    regiser_command(Command("XTRIM", CommandType::XTRIM, 4, 5, "XTRIM key MAXLEN [=|~] threshold", &CommandDispatcher::handle_xtrim, {1, 1}));
+
+    // xread
+    regiser_command(Command("XREAD", CommandType::XREAD, 4, -1, "XREAD [COUNT count] [BLOCK milliseconds] STREAMS key [key ...] id [id ...]", &CommandDispatcher::handle_xread));
+
+    // subscribe
+    regiser_command(Command("SUBSCRIBE", CommandType::SUBSCRIBE, 2, -1, "SUBSCRIBE channel [channel ...]", &CommandDispatcher::handle_subscribe));
+
+    // unsubscribe
+    regiser_command(Command("UNSUBSCRIBE", CommandType::UNSUBSCRIBE, 1, -1, "UNSUBSCRIBE [channel ...]", &CommandDispatcher::handle_unsubscribe));
+
+    // psubscribe
+    regiser_command(Command("PSUBSCRIBE", CommandType::PSUBSCRIBE, 2, -1, "PSUBSCRIBE pattern [pattern ...]", &CommandDispatcher::handle_psubscribe));
+
+    // punsubscribe
+    regiser_command(Command("PUNSUBSCRIBE", CommandType::PUNSUBSCRIBE, 1, -1, "PUNSUBSCRIBE [pattern ...]", &CommandDispatcher::handle_punsubscribe));
+
+    // publish
+    regiser_command(Command("PUBLISH", CommandType::PUBLISH, 3, 3, "PUBLISH channel message", &CommandDispatcher::handle_publish));
+
+    // multi
+    regiser_command(Command("MULTI", CommandType::MULTI, 1, 1, "MULTI", &CommandDispatcher::handle_multi));
+
+    // exec
+    regiser_command(Command("EXEC", CommandType::EXEC, 1, 1, "EXEC", &CommandDispatcher::handle_exec));
+
+    // discard
+    regiser_command(Command("DISCARD", CommandType::DISCARD, 1, 1, "DISCARD", &CommandDispatcher::handle_discard));
+
+    // watch
+    regiser_command(Command("WATCH", CommandType::WATCH, 2, -1, "WATCH key [key ...]", &CommandDispatcher::handle_watch));
+
+    // unwatch
+    regiser_command(Command("UNWATCH", CommandType::UNWATCH, 1, 1, "UNWATCH", &CommandDispatcher::handle_unwatch));
+
+    // eval
+    regiser_command(Command("EVAL", CommandType::EVAL, 3, -1, "EVAL script numkeys [key ...] [arg ...]", [this](const std::vector<std::string> &args)
+                            { return handle_eval(args); }));
+
+    // evalsha
+    regiser_command(Command("EVALSHA", CommandType::EVALSHA, 3, -1, "EVALSHA sha1 numkeys [key ...] [arg ...]", [this](const std::vector<std::string> &args)
+                            { return handle_evalsha(args); }));
+
+    // script
+    regiser_command(Command("SCRIPT", CommandType::SCRIPT, 2, -1, "SCRIPT LOAD script | SCRIPT EXISTS sha1 [sha1 ...] | SCRIPT FLUSH", [this](const std::vector<std::string> &args)
+                            { return handle_script(args); }));
+
+    // info
+    regiser_command(Command("INFO", CommandType::INFO, 1, -1, "INFO [section ...]", [this](const std::vector<std::string> &args)
+                            { return handle_info(args); }));
+
+    // slowlog
+    regiser_command(Command("SLOWLOG", CommandType::SLOWLOG, 2, 3, "SLOWLOG GET [count] | SLOWLOG LEN | SLOWLOG RESET", [this](const std::vector<std::string> &args)
+                            { return handle_slowlog(args); }));
+
+    // latency
+    regiser_command(Command("LATENCY", CommandType::LATENCY, 2, -1, "LATENCY HISTOGRAM [command ...] | LATENCY LATEST | LATENCY HISTORY event | LATENCY RESET [event ...] | LATENCY DOCTOR", [this](const std::vector<std::string> &args)
+                            { return handle_latency(args); }));
 }
 
 void CommandDispatcher::regiser_command(const Command &cmd)
@@ -54,13 +342,13 @@ void CommandDispatcher::regiser_command(const Command &cmd)
     registry_[cmd.name] = cmd;
 }
 
-Response CommandDispatcher::execute_command(const std::vector<std::string> &args)
+Response CommandDispatcher::execute_command(const std::vector<std::string> &args, int client_id)
 {
     const std::string &name = args[0];
     auto it = registry_.find(name);
     if (it == registry_.end())
     {
-        Logger::error("execute_command() 未知命令:" + name);
+        LOG_ERROR("execute_command() 未知命令:" + name);
         return make_error_response("未知命令 '" + name + "'");
     }
 
@@ -68,25 +356,126 @@ Response CommandDispatcher::execute_command(const std::vector<std::string> &args
     validationResult res = validate_args(cmd, args);
     if (!res.isvalid)
     {
-        Logger::error("execute_command() 命令参数数量不对 '" + name + "'");
+        LOG_ERROR("execute_command() 命令参数数量不对 '" + name + "'");
+        cmd.stats.rejected_calls++;
         return make_error_response(res.error_msg);
     }
 
+    uint64_t elapsed = 0;
     try
     {
-        return cmd.handler(args);
+        Response resp = run_command(cmd, args, &elapsed);
+        log_if_slow(args, elapsed, client_id);
+        return resp;
     }
     catch (const std::exception &e)
     {
-        Logger::error("execute_command() 命令执行出错 '" + name + "':" + e.what());
+        log_if_slow(args, elapsed, client_id);
+        LOG_ERROR("execute_command() 命令执行出错 '" + name + "':" + e.what());
         return make_error_response(e.what());
     }
 }
 
+/// @brief 耗时用cycles_now()计时(RDTSC只需几纳秒)，只做计数与直方图累加，换算为微秒留到查询时
+Response CommandDispatcher::run_command(const Command &cmd, const std::vector<std::string> &args, uint64_t *elapsed) const
+{
+    uint64_t start = cycles_now();
+    Response resp;
+    try
+    {
+        resp = cmd.handler(args);
+    }
+    catch (...)
+    {
+        uint64_t cycles = cycles_now() - start;
+        cmd.stats.failed_calls++;
+        cmd.stats.record(cycles);
+        if (elapsed)
+            *elapsed = cycles;
+        // 多键写命令可能在改动了部分键之后才出错，同样要让WATCH这些键的事务失效
+        if (watching_clients > 0 && cmd.write_keys.first > 0)
+            touch_write_keys(cmd, args);
+        throw;
+    }
+    uint64_t cycles = cycles_now() - start;
+    cmd.stats.record(cycles);
+    if (elapsed)
+        *elapsed = cycles;
+    if (watching_clients > 0 && cmd.write_keys.first > 0 && resp.type != ResponseType::BLOCKED)
+        touch_write_keys(cmd, args);
+    return resp;
+}
+
+void CommandDispatcher::log_if_slow(const std::vector<std::string> &args, uint64_t elapsed, int client_id)
+{
+    latency_sample("command", elapsed);
+    if (slowlog_.is_slow(elapsed))
+        slowlog_.record(args, (uint64_t)(elapsed / cycles_per_us()), client_id);
+}
+
+/// @brief 没有连接在WATCH时不需要维护版本号，之后的WATCH记录的是那时的版本号，不受之前的写入影响
+void CommandDispatcher::touch_write_keys(const Command &cmd, const std::vector<std::string> &args) const
+{
+    const KeySpec &spec = cmd.write_keys;
+    int last = spec.last < 0 ? (int)args.size() + spec.last : spec.last;
+    for (int i = spec.first; i <= last && i < (int)args.size(); i += spec.step)
+        obj_touch(HMap_string, args[i]);
+}
+
+bool CommandDispatcher::check_command(const std::vector<std::string> &args, Response &err) const
+{
+    auto it = registry_.find(args[0]);
+    if (it == registry_.end())
+    {
+        err = make_error_response("未知命令 '" + args[0] + "'");
+        return false;
+    }
+    validationResult res = validate_args(it->second, args);
+    if (!res.isvalid)
+    {
+        err = make_error_response(res.error_msg);
+        return false;
+    }
+    return true;
+}
+
+// 将响应中对存储的引用替换为拷贝
+static void own_views(Response &resp)
+{
+    if (!resp.bulk_view.empty())
+    {
+        resp.bulk_string.assign(resp.bulk_view.data(), resp.bulk_view.size());
+        resp.bulk_view = std::string_view();
+    }
+    for (Response &item : resp.array)
+        own_views(item);
+}
+
+/// @brief 事务中后面的命令可能修改或删除前面的命令引用的数据，每条命令执行后立刻拷贝其响应中引用的数据；
+///        阻塞命令在事务中不阻塞，没有数据时直接回复空值
+Response CommandDispatcher::execute_transaction(const std::vector<std::vector<std::string>> &cmds, int client_id)
+{
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.reserve(cmds.size());
+    for (const std::vector<std::string> &args : cmds)
+    {
+        Response r = execute_command(args, client_id);
+        if (r.type == ResponseType::BLOCKED)
+        {
+            r = Response();
+            r.type = ResponseType::NULL_BULK_STRING;
+        }
+        own_views(r);
+        resp.array.push_back(std::move(r));
+    }
+    return resp;
+}
+
 validationResult CommandDispatcher::validate_args(const Command &cmd, const std::vector<std::string> &args) const
 {
     int32_t cmd_num = args.size();
-    if (cmd_num < cmd.min_args || cmd_num > cmd.max_args)
+    if (cmd_num < cmd.min_args || (cmd.max_args >= 0 && cmd_num > cmd.max_args))
         return {false, "'" + cmd.name + "'命令参数数量不对"};
     return {true, ""};
 }
@@ -99,14 +488,26 @@ Response CommandDispatcher::make_error_response(const std::string &error_msg) co
     return resp;
 }
 
+// 字符串条目的值写入批量字符串响应：RAW编码与共享的小整数直接引用，不做拷贝
+static void bulk_value(Response &resp, const Entry_str *found)
+{
+    if (found->encoding == StrEncoding::RAW)
+        resp.bulk_view = found->value;
+    else if (const std::string *shared = shared_integer(found->ival))
+        resp.bulk_view = *shared;
+    else
+        resp.bulk_string = int64_to_str(found->ival);
+}
+
 Response CommandDispatcher::handle_get(const std::vector<std::string> &args)
 {
     StringEntry _entry(args[1]);
-    const std::string &value = _entry.get(HMap_string);
-    // std::cout << value << std::endl;
+    Entry_str *found = _entry.find(HMap_string);
     Response resp;
     resp.type = ResponseType::BULK_STRING;
-    resp.bulk_string = value;
+    if (!found)
+        return resp;
+    bulk_value(resp, found);
     return resp;
 }
 
@@ -129,140 +530,551 @@ Response CommandDispatcher::handle_del(const std::vector<std::string> &args)
     resp.integer = success ? 1 : -1;
     return resp;
 }
-// ZADD key score member
-Response CommandDispatcher::handle_zadd(const std::vector<std::string> &args)
+// INCR key
+Response CommandDispatcher::handle_incr(const std::vector<std::string> &args)
 {
-    // 首先获取顶级哈希表中的集合对象节点值指针
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
+    return incr_generic(args[1], 1);
+}
 
-    ZsetEntry _entry(std::stod(args[2]), args[3]);
-    bool success = _entry.zadd(value);
+// DECR key
+Response CommandDispatcher::handle_decr(const std::vector<std::string> &args)
+{
+    return incr_generic(args[1], -1);
+}
 
-    Response resp;
-    resp.type = ResponseType::INTEGER;
-    resp.integer = success ? 1 : -1;
+// INCRBY key increment
+Response CommandDispatcher::handle_incrby(const std::vector<std::string> &args)
+{
+    int64_t delta;
+    if (!str_to_int64(args[2], delta))
+        throw std::invalid_argument("增量不是整数或超出范围");
+    return incr_generic(args[1], delta);
+}
 
-    return resp;
+// DECRBY key decrement
+Response CommandDispatcher::handle_decrby(const std::vector<std::string> &args)
+{
+    int64_t delta;
+    if (!str_to_int64(args[2], delta) || delta == INT64_MIN)
+        throw std::invalid_argument("减量不是整数或超出范围");
+    return incr_generic(args[1], -delta);
 }
-// ZREM key member
-Response CommandDispatcher::handle_zrem(const std::vector<std::string> &args)
+
+// INCRBYFLOAT key increment
+Response CommandDispatcher::handle_incrbyfloat(const std::vector<std::string> &args)
 {
-    // 首先获取顶级哈希表中的集合对象节点值指针
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
-    ZsetEntry _entry(args[2]);
-    bool success = _entry.zrem(value);
+    const std::string &arg = args[2];
+    char *end = nullptr;
+    long double delta = arg.empty() || isspace((unsigned char)arg[0]) ? NAN : strtold(arg.c_str(), &end);
+    if (std::isnan(delta) || std::isinf(delta) || end != arg.c_str() + arg.size())
+        throw std::invalid_argument("增量不是合法的浮点数");
 
+    StringEntry _entry(args[1]);
     Response resp;
-    resp.type = ResponseType::INTEGER;
-    resp.integer = success ? 1 : -1;
+    resp.type = ResponseType::BULK_STRING;
+    resp.bulk_string = _entry.incrbyfloat(HMap_string, delta);
+    return resp;
+}
 
+Response CommandDispatcher::incr_generic(const std::string &key, int64_t delta)
+{
+    StringEntry _entry(key);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.incrby(HMap_string, delta);
     return resp;
 }
-// ZSCORE key member
-Response CommandDispatcher::handle_zscore(const std::vector<std::string> &args)
+
+std::vector<StringEntry> CommandDispatcher::prefetch_entries(const std::vector<std::string> &args, size_t first, size_t step)
 {
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
+    std::vector<StringEntry> entries;
+    entries.reserve((args.size() - first + step - 1) / step);
+    for (size_t i = first; i < args.size(); i += step)
+        entries.emplace_back(args[i], step > 1 ? args[i + 1] : "");
 
-    ZsetEntry _entry(args[2]);
-    bool success = false;
-    double score = _entry.zscore(value, success);
+    // 先对所有键发出预取，再逐个查找，避免每个键的缓存缺失串行等待
+    std::vector<HNode *> nodes;
+    nodes.reserve(entries.size());
+    for (auto &e : entries)
+        nodes.push_back(e.node());
+    HMap_string.hm_prefetch(nodes.data(), nodes.size());
+    return entries;
+}
 
-    Response resp;
+// MGET key [key ...]
+Response CommandDispatcher::handle_mget(const std::vector<std::string> &args)
+{
+    std::vector<StringEntry> entries = prefetch_entries(args, 1, 1);
 
-    if (success)
-    {
-        resp.type = ResponseType::SIMPLE_STRING;
-        resp.simple_string = std::to_string(score);
-    }
-    else
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
     {
-        resp.type = ResponseType::ERROR;
-        resp.simple_string = "nil()";
+        // 不是字符串的键与不存在的键一样回复空值
+        Entry_str *found = entries[i].find_string(HMap_string);
+        if (found)
+        {
+            resp.array[i].type = ResponseType::BULK_STRING;
+            bulk_value(resp.array[i], found);
+        }
+        else
+            resp.array[i].type = ResponseType::NULL_BULK_STRING;
     }
-
     return resp;
 }
-// ZRANK key member
-Response CommandDispatcher::handle_zrank(const std::vector<std::string> &args)
+
+// MSET key value [key value ...]
+Response CommandDispatcher::handle_mset(const std::vector<std::string> &args)
 {
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
+    if (args.size() % 2 == 0)
+        throw std::invalid_argument("MSET 参数必须为键值对");
 
-    ZsetEntry _entry(args[2]);
-    bool success = false;
-    int rank = _entry.zrank(value, success);
+    std::vector<StringEntry> entries = prefetch_entries(args, 1, 2);
+    for (auto &e : entries)
+        e.set(HMap_string);
 
     Response resp;
-
-    if (success)
-    {
-        resp.type = ResponseType::INTEGER;
-        resp.integer = rank;
-    }
-    else
-    {
-        resp.type = ResponseType::ERROR;
-        resp.simple_string = "nil()";
-    }
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = "OK";
     return resp;
 }
-// ZCARD key
-Response CommandDispatcher::handle_zcard(const std::vector<std::string> &args)
-{
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
 
-    ZsetEntry _entry("");
-    int num = _entry.zcard(value);
+// MSETNX key value [key value ...]
+Response CommandDispatcher::handle_msetnx(const std::vector<std::string> &args)
+{
+    if (args.size() % 2 == 0)
+        throw std::invalid_argument("MSETNX 参数必须为键值对");
 
+    std::vector<StringEntry> entries = prefetch_entries(args, 1, 2);
     Response resp;
     resp.type = ResponseType::INTEGER;
-    resp.integer = num;
+    resp.integer = 0;
+    // 任一键已存在(任意类型)则不做任何设置
+    for (auto &e : entries)
+        if (e.exists(HMap_string))
+            return resp;
+    for (auto &e : entries)
+        e.set(HMap_string);
+    // 没有声明写入的键，只在真正写入时更新版本号，返回0时不让WATCH这些键的事务失效
+    if (watching_clients > 0)
+        for (size_t i = 1; i < args.size(); i += 2)
+            obj_touch(HMap_string, args[i]);
+    resp.integer = 1;
     return resp;
 }
-// ZRANGE key min max
-Response CommandDispatcher::handle_zrange(const std::vector<std::string> &args)
+
+// APPEND key value
+Response CommandDispatcher::handle_append(const std::vector<std::string> &args)
 {
-    Zset node(args[1]);
-    Value *value = node.exsit(HMap_string);
-    if (!value)
-        value = node.create(HMap_string);
+    StringEntry _entry(args[1], args[2]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.append(HMap_string);
+    return resp;
+}
 
-    ZsetEntry _entry("");
-    std::vector<std::pair<std::string, double>> result = _entry.zrange(value, std::stoi(args[2]), std::stoi(args[3]));
-    // std::cout << "-------" << std::endl;
-    std::vector<Response> resp_result;
-    Response resp_name, resp_score;
-    for (auto &item : result)
-    {
-        resp_name.type = ResponseType::BULK_STRING;
-        resp_name.bulk_string = item.first;
-        resp_result.push_back(resp_name);
+// GETRANGE key start end
+Response CommandDispatcher::handle_getrange(const std::vector<std::string> &args)
+{
+    int64_t start, end;
+    if (!str_to_int64(args[2], start) || !str_to_int64(args[3], end))
+        throw std::invalid_argument("下标不是整数或超出范围");
 
-        resp_score.type = ResponseType::SIMPLE_STRING;
-        resp_score.simple_string = std::to_string(item.second);
-        resp_result.push_back(resp_score);
-    }
+    StringEntry _entry(args[1]);
+    Entry_str *found = _entry.find(HMap_string);
     Response resp;
-    resp.type = ResponseType::ARRAY;
-    resp.array = resp_result;
+    resp.type = ResponseType::BULK_STRING;
+    if (!found)
+        return resp;
+    // 只引用请求的片段，序列化时直接写入输出，不拷贝整个值
+    if (found->encoding == StrEncoding::INT)
+        resp.bulk_string = std::string(str_range(int64_to_str(found->ival), start, end));
+    else
+        resp.bulk_view = str_range(found->value, start, end);
     return resp;
 }
 
-Response CommandDispatcher::handle_zall(const std::vector<std::string> &args)
+// SETRANGE key offset value
+Response CommandDispatcher::handle_setrange(const std::vector<std::string> &args)
+{
+    int64_t offset;
+    if (!str_to_int64(args[2], offset) || offset < 0)
+        throw std::invalid_argument("偏移量不是整数或超出范围");
+
+    StringEntry _entry(args[1], args[3]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.setrange(HMap_string, offset);
+    return resp;
+}
+
+// STRLEN key
+Response CommandDispatcher::handle_strlen(const std::vector<std::string> &args)
+{
+    StringEntry _entry(args[1]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.strlen(HMap_string);
+    return resp;
+}
+
+// GETDEL key
+Response CommandDispatcher::handle_getdel(const std::vector<std::string> &args)
+{
+    StringEntry _entry(args[1]);
+    Response resp;
+    if (_entry.getdel(HMap_string, resp.bulk_string))
+        resp.type = ResponseType::BULK_STRING;
+    else
+        resp.type = ResponseType::NULL_BULK_STRING;
+    return resp;
+}
+
+// SETBIT key offset value
+Response CommandDispatcher::handle_setbit(const std::vector<std::string> &args)
+{
+    int64_t offset;
+    if (!str_to_int64(args[2], offset) || offset < 0)
+        throw std::invalid_argument("位偏移量不是整数或超出范围");
+    if (args[3] != "0" && args[3] != "1")
+        throw std::invalid_argument("位的值必须为0或1");
+
+    StringEntry _entry(args[1]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.setbit(HMap_string, offset, args[3][0] - '0');
+    return resp;
+}
+
+// GETBIT key offset
+Response CommandDispatcher::handle_getbit(const std::vector<std::string> &args)
+{
+    int64_t offset;
+    if (!str_to_int64(args[2], offset) || offset < 0)
+        throw std::invalid_argument("位偏移量不是整数或超出范围");
+
+    StringEntry _entry(args[1]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.getbit(HMap_string, offset);
+    return resp;
+}
+
+bool CommandDispatcher::parse_bit_unit(const std::string &arg)
+{
+    if (arg == "BIT")
+        return true;
+    if (arg == "BYTE")
+        return false;
+    throw std::invalid_argument("语法错误");
+}
+
+// BITCOUNT key [start end [BYTE|BIT]]
+Response CommandDispatcher::handle_bitcount(const std::vector<std::string> &args)
+{
+    int64_t start = 0, end = -1;
+    bool bit_unit = false;
+    if (args.size() == 3)
+        throw std::invalid_argument("语法错误");
+    if (args.size() >= 4 && (!str_to_int64(args[2], start) || !str_to_int64(args[3], end)))
+        throw std::invalid_argument("下标不是整数或超出范围");
+    if (args.size() == 5)
+        bit_unit = parse_bit_unit(args[4]);
+
+    StringEntry _entry(args[1]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.bitcount(HMap_string, start, end, bit_unit);
+    return resp;
+}
+
+// BITPOS key bit [start [end [BYTE|BIT]]]
+Response CommandDispatcher::handle_bitpos(const std::vector<std::string> &args)
+{
+    if (args[2] != "0" && args[2] != "1")
+        throw std::invalid_argument("位的值必须为0或1");
+    int64_t start = 0, end = -1;
+    bool has_end = args.size() >= 5;
+    bool bit_unit = false;
+    if (args.size() >= 4 && !str_to_int64(args[3], start))
+        throw std::invalid_argument("下标不是整数或超出范围");
+    if (has_end && !str_to_int64(args[4], end))
+        throw std::invalid_argument("下标不是整数或超出范围");
+    if (args.size() == 6)
+        bit_unit = parse_bit_unit(args[5]);
+
+    StringEntry _entry(args[1]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = _entry.bitpos(HMap_string, args[2][0] - '0', start, end, has_end, bit_unit);
+    return resp;
+}
+
+// BITOP AND|OR|XOR|NOT destkey key [key ...]
+Response CommandDispatcher::handle_bitop(const std::vector<std::string> &args)
+{
+    BitOp op;
+    if (args[1] == "AND")
+        op = BitOp::AND;
+    else if (args[1] == "OR")
+        op = BitOp::OR;
+    else if (args[1] == "XOR")
+        op = BitOp::XOR;
+    else if (args[1] == "NOT")
+        op = BitOp::NOT;
+    else
+        throw std::invalid_argument("BITOP只支持AND、OR、XOR、NOT");
+    if (op == BitOp::NOT && args.size() != 4)
+        throw std::invalid_argument("BITOP NOT只能有一个源键");
+
+    std::vector<std::string> srcs(args.begin() + 3, args.end());
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = StringEntry::bitop(HMap_string, op, args[2], srcs);
+    return resp;
+}
+
+Entry_str *CommandDispatcher::find_hll(const std::string &key)
+{
+    Entry_str *found = StringEntry(key).find(HMap_string);
+    if (found && (found->encoding != StrEncoding::RAW || !hll_valid(found->value)))
+        throw std::invalid_argument("WRONGTYPE 键对应的值不是合法的HyperLogLog");
+    return found;
+}
+
+// PFADD key [element ...]
+Response CommandDispatcher::handle_pfadd(const std::vector<std::string> &args)
+{
+    Entry_str *found = find_hll(args[1]);
+    bool updated = false;
+    if (!found)
+    {
+        StringEntry(args[1], hll_create()).set(HMap_string);
+        found = StringEntry(args[1]).find(HMap_string);
+        updated = true;
+    }
+    for (size_t i = 2; i < args.size(); i++)
+        updated |= hll_add(found->value, args[i]);
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = updated ? 1 : 0;
+    return resp;
+}
+
+// PFCOUNT key [key ...]
+Response CommandDispatcher::handle_pfcount(const std::vector<std::string> &args)
+{
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    if (args.size() == 2)
+    {
+        Entry_str *found = find_hll(args[1]);
+        resp.integer = found ? hll_count(found->value) : 0;
+        return resp;
+    }
+
+    // 多个键时直接在栈上的寄存器中合并，不创建临时键
+    uint8_t regs[k_hll_registers] = {0};
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        Entry_str *found = find_hll(args[i]);
+        if (found)
+            hll_merge_into(found->value, regs);
+    }
+    resp.integer = hll_estimate(regs);
+    return resp;
+}
+
+// PFMERGE destkey [sourcekey ...]
+Response CommandDispatcher::handle_pfmerge(const std::vector<std::string> &args)
+{
+    // 先检查全部的键，destkey自身的寄存器也参与合并
+    uint8_t regs[k_hll_registers] = {0};
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        Entry_str *found = find_hll(args[i]);
+        if (found)
+            hll_merge_into(found->value, regs);
+    }
+    StringEntry(args[1], hll_from_registers(regs)).set(HMap_string);
+
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = "OK";
+    return resp;
+}
+
+// ZADD key [NX|XX] [GT|LT] [CH] [INCR] score member [score member ...]
+Response CommandDispatcher::handle_zadd(const std::vector<std::string> &args)
+{
+    // 解析标志
+    uint32_t flags = ZADD_NONE;
+    size_t i = 2;
+    for (; i < args.size(); i++)
+    {
+        const std::string &opt = args[i];
+        if (opt == "NX")
+            flags |= ZADD_NX;
+        else if (opt == "XX")
+            flags |= ZADD_XX;
+        else if (opt == "GT")
+            flags |= ZADD_GT;
+        else if (opt == "LT")
+            flags |= ZADD_LT;
+        else if (opt == "CH")
+            flags |= ZADD_CH;
+        else if (opt == "INCR")
+            flags |= ZADD_INCR;
+        else
+            break;
+    }
+
+    size_t npairs = (args.size() - i) / 2;
+    if (npairs == 0 || (args.size() - i) % 2 != 0)
+        throw std::invalid_argument("ZADD语法错误");
+    if ((flags & ZADD_NX) && (flags & ZADD_XX))
+        throw std::invalid_argument("ZADD的NX与XX不能同时使用");
+    if (((flags & ZADD_GT) && (flags & ZADD_LT)) || ((flags & ZADD_NX) && (flags & (ZADD_GT | ZADD_LT))))
+        throw std::invalid_argument("ZADD的GT、LT与NX不能同时使用");
+    if ((flags & ZADD_INCR) && npairs != 1)
+        throw std::invalid_argument("ZADD的INCR只支持一个分数-成员对");
+
+    // 先解析全部分数，任一分数非法则整条命令不生效
+    std::vector<std::pair<std::string, double>> items;
+    items.reserve(npairs);
+    for (size_t k = i; k < args.size(); k += 2)
+    {
+        double score = std::stod(args[k]);
+        if (std::isnan(score))
+            throw std::invalid_argument("分数不是数字");
+        items.emplace_back(args[k + 1], score);
+    }
+
+    // 顶级哈希表只查找一次：create在集合已存在时直接返回
+    Zset node(args[1]);
+    Value *value = (flags & ZADD_XX) ? node.exsit(HMap_string) : node.create(HMap_string);
+
+    Response resp;
+    if (flags & ZADD_INCR)
+    {
+        double newscore = 0;
+        ZaddResult res = ZaddResult::NOP;
+        if (value)
+        {
+            ZsetEntry _entry(items[0].second, items[0].first);
+            res = _entry.zadd(value, flags, newscore);
+        }
+        // 被NX/XX/GT/LT拒绝时返回nil
+        if (res == ZaddResult::NOP && (!value || (flags & (ZADD_NX | ZADD_XX | ZADD_GT | ZADD_LT))))
+        {
+            resp.type = ResponseType::ERROR;
+            resp.simple_string = "nil()";
+            return resp;
+        }
+        resp.type = ResponseType::SIMPLE_STRING;
+        resp.simple_string = std::to_string(newscore);
+        return resp;
+    }
+
+    int changed = 0;
+    if (value)
+    {
+        ZsetEntry counter("");
+        // 紧凑编码的空集合且无条件标志时批量构建；已转为哈希表编码后被删空的集合逐个添加
+        if (npairs > 1 && !(flags & (ZADD_NX | ZADD_XX | ZADD_GT | ZADD_LT)) && value->encoding == ZsetEncoding::LISTPACK &&
+            counter.zcard(value) == 0)
+            changed = ZsetEntry::zbuild(value, items);
+        else
+        {
+            for (auto &item : items)
+            {
+                ZsetEntry _entry(item.second, item.first);
+                double newscore = 0;
+                ZaddResult res = _entry.zadd(value, flags, newscore);
+                if (res == ZaddResult::ADDED || (res == ZaddResult::UPDATED && (flags & ZADD_CH)))
+                    changed++;
+            }
+        }
+    }
+
+    resp.type = ResponseType::INTEGER;
+    resp.integer = changed;
+    return resp;
+}
+// ZREM key member
+Response CommandDispatcher::handle_zrem(const std::vector<std::string> &args)
+{
+    // 首先获取顶级哈希表中的集合对象节点值指针
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+    if (!value)
+        value = node.create(HMap_string);
+    ZsetEntry _entry(args[2]);
+    bool success = _entry.zrem(value);
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = success ? 1 : -1;
+
+    return resp;
+}
+// ZSCORE key member
+Response CommandDispatcher::handle_zscore(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+    if (!value)
+        value = node.create(HMap_string);
+
+    ZsetEntry _entry(args[2]);
+    bool success = false;
+    double score = _entry.zscore(value, success);
+
+    Response resp;
+
+    if (success)
+    {
+        resp.type = ResponseType::SIMPLE_STRING;
+        resp.simple_string = std::to_string(score);
+    }
+    else
+    {
+        resp.type = ResponseType::ERROR;
+        resp.simple_string = "nil()";
+    }
+
+    return resp;
+}
+// ZRANK key member
+Response CommandDispatcher::handle_zrank(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+    if (!value)
+        value = node.create(HMap_string);
+
+    ZsetEntry _entry(args[2]);
+    bool success = false;
+    int rank = _entry.zrank(value, success);
+
+    Response resp;
+
+    if (success)
+    {
+        resp.type = ResponseType::INTEGER;
+        resp.integer = rank;
+    }
+    else
+    {
+        resp.type = ResponseType::ERROR;
+        resp.simple_string = "nil()";
+    }
+    return resp;
+}
+// ZCARD key
+Response CommandDispatcher::handle_zcard(const std::vector<std::string> &args)
 {
     Zset node(args[1]);
     Value *value = node.exsit(HMap_string);
@@ -270,7 +1082,24 @@ Response CommandDispatcher::handle_zall(const std::vector<std::string> &args)
         value = node.create(HMap_string);
 
     ZsetEntry _entry("");
-    std::vector<std::pair<std::string, double>> result = _entry.zall(value);
+    int num = _entry.zcard(value);
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = num;
+    return resp;
+}
+// ZRANGE key min max
+Response CommandDispatcher::handle_zrange(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+    if (!value)
+        value = node.create(HMap_string);
+
+    ZsetEntry _entry("");
+    std::vector<std::pair<std::string, double>> result = _entry.zrange(value, std::stoi(args[2]), std::stoi(args[3]));
+    // std::cout << "-------" << std::endl;
     std::vector<Response> resp_result;
     Response resp_name, resp_score;
     for (auto &item : result)
@@ -289,21 +1118,1851 @@ Response CommandDispatcher::handle_zall(const std::vector<std::string> &args)
     return resp;
 }
 
-Response CommandDispatcher::handle_zdel(const std::vector<std::string> &args)
+// ZREVRANGE key min max
+Response CommandDispatcher::handle_zrevrange(const std::vector<std::string> &args)
 {
     Zset node(args[1]);
-    bool success = node.zdel(HMap_string);
+    Value *value = node.exsit(HMap_string);
+
+    std::vector<std::pair<std::string, double>> result;
+    if (value)
+    {
+        ZsetEntry _entry("");
+        result = _entry.zrevrange(value, std::stoi(args[2]), std::stoi(args[3]));
+    }
+    std::vector<Response> resp_result;
+    resp_result.reserve(result.size() * 2);
+    Response resp_name, resp_score;
+    for (auto &item : result)
+    {
+        resp_name.type = ResponseType::BULK_STRING;
+        resp_name.bulk_string = item.first;
+        resp_result.push_back(resp_name);
+
+        resp_score.type = ResponseType::SIMPLE_STRING;
+        resp_score.simple_string = std::to_string(item.second);
+        resp_result.push_back(resp_score);
+    }
     Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array = resp_result;
+    return resp;
+}
 
-    if (success)
+// ZRANGEBYSCORE key min max
+/// @brief 闭区间，min/max可以是-inf/+inf；先按分数定位两端排名，不逐个比较范围外的元素
+Response CommandDispatcher::handle_zrangebyscore(const std::vector<std::string> &args)
+{
+    double min_score = std::stod(args[2]);
+    double max_score = std::stod(args[3]);
+    if (std::isnan(min_score) || std::isnan(max_score))
+        throw std::invalid_argument("分数不是数字");
+
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+
+    std::vector<std::pair<std::string, double>> result;
+    if (value)
     {
-        resp.type = ResponseType::SIMPLE_STRING;
-        resp.simple_string = "成功";
+        ZsetEntry _entry("");
+        result = _entry.zrangebyscore(value, min_score, max_score);
     }
-    else
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.reserve(result.size() * 2);
+    for (auto &item : result)
     {
-        resp.type = ResponseType::ERROR;
-        resp.simple_string = "nil()";
+        Response resp_name, resp_score;
+        resp_name.type = ResponseType::BULK_STRING;
+        resp_name.bulk_string = std::move(item.first);
+        resp.array.push_back(std::move(resp_name));
+
+        resp_score.type = ResponseType::SIMPLE_STRING;
+        resp_score.simple_string = std::to_string(item.second);
+        resp.array.push_back(std::move(resp_score));
     }
     return resp;
 }
+
+Response CommandDispatcher::handle_zall(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+    if (!value)
+        value = node.create(HMap_string);
+
+    ZsetEntry _entry("");
+    std::vector<std::pair<std::string, double>> result = _entry.zall(value);
+    std::vector<Response> resp_result;
+    Response resp_name, resp_score;
+    for (auto &item : result)
+    {
+        resp_name.type = ResponseType::BULK_STRING;
+        resp_name.bulk_string = item.first;
+        resp_result.push_back(resp_name);
+
+        resp_score.type = ResponseType::SIMPLE_STRING;
+        resp_score.simple_string = std::to_string(item.second);
+        resp_result.push_back(resp_score);
+    }
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array = resp_result;
+    return resp;
+}
+
+// ZINCRBY key increment member
+Response CommandDispatcher::handle_zincrby(const std::vector<std::string> &args)
+{
+    double incr = std::stod(args[2]);
+    if (std::isnan(incr))
+        throw std::invalid_argument("增量不是数字");
+
+    Zset node(args[1]);
+    Value *value = node.create(HMap_string);
+
+    ZsetEntry _entry(incr, args[3]);
+    double newscore = 0;
+    _entry.zadd(value, ZADD_INCR, newscore);
+
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = std::to_string(newscore);
+    return resp;
+}
+
+// ZMSCORE key member [member ...]
+Response CommandDispatcher::handle_zmscore(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    Value *value = node.exsit(HMap_string);
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.reserve(args.size() - 2);
+    for (size_t i = 2; i < args.size(); i++)
+    {
+        Response item;
+        bool success = false;
+        double score = 0;
+        if (value)
+        {
+            ZsetEntry _entry(args[i]);
+            score = _entry.zscore(value, success);
+        }
+        if (success)
+        {
+            item.type = ResponseType::SIMPLE_STRING;
+            item.simple_string = std::to_string(score);
+        }
+        else
+            item.type = ResponseType::NULL_BULK_STRING;
+        resp.array.push_back(item);
+    }
+    return resp;
+}
+
+// ZUNIONSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+Response CommandDispatcher::handle_zunionstore(const std::vector<std::string> &args)
+{
+    return zsetop_store(args, ZsetSetOp::UNION);
+}
+
+// ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+Response CommandDispatcher::handle_zinterstore(const std::vector<std::string> &args)
+{
+    return zsetop_store(args, ZsetSetOp::INTER);
+}
+
+// ZDIFFSTORE destination numkeys key [key ...]
+Response CommandDispatcher::handle_zdiffstore(const std::vector<std::string> &args)
+{
+    return zsetop_store(args, ZsetSetOp::DIFF);
+}
+
+Response CommandDispatcher::zsetop_store(const std::vector<std::string> &args, ZsetSetOp op)
+{
+    int numkeys = std::stoi(args[2]);
+    if (numkeys < 1 || (size_t)numkeys > args.size() - 3)
+        throw std::invalid_argument("numkeys参数错误");
+
+    // 解析WEIGHTS与AGGREGATE，差集不支持这两个选项
+    std::vector<double> weights(numkeys, 1.0);
+    ZsetAggregate agg = ZsetAggregate::SUM;
+    for (size_t i = 3 + numkeys; i < args.size();)
+    {
+        if (op != ZsetSetOp::DIFF && args[i] == "WEIGHTS" && i + numkeys < args.size())
+        {
+            for (int k = 0; k < numkeys; k++)
+            {
+                weights[k] = std::stod(args[i + 1 + k]);
+                if (std::isnan(weights[k]))
+                    throw std::invalid_argument("权重不是数字");
+            }
+            i += 1 + numkeys;
+        }
+        else if (op != ZsetSetOp::DIFF && args[i] == "AGGREGATE" && i + 1 < args.size())
+        {
+            if (args[i + 1] == "SUM")
+                agg = ZsetAggregate::SUM;
+            else if (args[i + 1] == "MIN")
+                agg = ZsetAggregate::MIN;
+            else if (args[i + 1] == "MAX")
+                agg = ZsetAggregate::MAX;
+            else
+                throw std::invalid_argument("AGGREGATE只支持SUM、MIN、MAX");
+            i += 2;
+        }
+        else
+            throw std::invalid_argument("'" + args[0] + "'语法错误");
+    }
+
+    std::vector<Value *> srcs;
+    srcs.reserve(numkeys);
+    for (int k = 0; k < numkeys; k++)
+    {
+        Zset node(args[3 + k]);
+        srcs.push_back(node.exsit(HMap_string));
+    }
+    std::vector<std::pair<std::string, double>> result = ZsetEntry::zsetop(srcs, weights, agg, op);
+
+    // 结果计算完成后再覆盖目标集合，目标集合可能同时是输入集合
+    Zset dest(args[1]);
+    obj_delete(HMap_string, args[1]);
+    int num = 0;
+    if (!result.empty())
+    {
+        Value *value = dest.create(HMap_string);
+        num = ZsetEntry::zbuild(value, result);
+    }
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = num;
+    return resp;
+}
+
+Response CommandDispatcher::handle_zdel(const std::vector<std::string> &args)
+{
+    Zset node(args[1]);
+    bool success = node.zdel(HMap_string);
+    Response resp;
+
+    if (success)
+    {
+        resp.type = ResponseType::SIMPLE_STRING;
+        resp.simple_string = "成功";
+    }
+    else
+    {
+        resp.type = ResponseType::ERROR;
+        resp.simple_string = "nil()";
+    }
+    return resp;
+}
+
+// 字段与值交替放入数组响应，直接引用哈希中的数据
+static void append_field_values(Response &resp, const std::vector<std::pair<std::string_view, std::string_view>> &items)
+{
+    resp.array.reserve(resp.array.size() + items.size() * 2);
+    for (auto &[field, value] : items)
+    {
+        Response f, v;
+        f.type = ResponseType::BULK_STRING;
+        f.bulk_view = field;
+        v.type = ResponseType::BULK_STRING;
+        v.bulk_view = value;
+        resp.array.push_back(std::move(f));
+        resp.array.push_back(std::move(v));
+    }
+}
+
+// HSET key field value [field value ...]
+Response CommandDispatcher::handle_hset(const std::vector<std::string> &args)
+{
+    if (args.size() % 2 != 0)
+        throw std::invalid_argument("HSET 参数必须为字段值对");
+
+    Hash hash(args[1]);
+    HashNode *h = hash.create(HMap_string);
+    int added = 0;
+    for (size_t i = 2; i < args.size(); i += 2)
+    {
+        HashEntry _entry(args[i], args[i + 1]);
+        if (_entry.hset(h))
+            added++;
+    }
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = added;
+    return resp;
+}
+
+// HGET key field
+Response CommandDispatcher::handle_hget(const std::vector<std::string> &args)
+{
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::NULL_BULK_STRING;
+    std::string_view value;
+    if (h && HashEntry(args[2]).hget(h, value))
+    {
+        resp.type = ResponseType::BULK_STRING;
+        resp.bulk_view = value;
+    }
+    return resp;
+}
+
+// HMGET key field [field ...]
+Response CommandDispatcher::handle_hmget(const std::vector<std::string> &args)
+{
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(args.size() - 2);
+    for (size_t i = 2; i < args.size(); i++)
+    {
+        Response &item = resp.array[i - 2];
+        item.type = ResponseType::NULL_BULK_STRING;
+        std::string_view value;
+        if (h && HashEntry(args[i]).hget(h, value))
+        {
+            item.type = ResponseType::BULK_STRING;
+            item.bulk_view = value;
+        }
+    }
+    return resp;
+}
+
+// HDEL key field [field ...]
+Response CommandDispatcher::handle_hdel(const std::vector<std::string> &args)
+{
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    int removed = 0;
+    if (h)
+    {
+        for (size_t i = 2; i < args.size(); i++)
+        {
+            HashEntry _entry(args[i]);
+            if (_entry.hdel(h))
+                removed++;
+        }
+        hash.del_if_empty(HMap_string, h);
+    }
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = removed;
+    return resp;
+}
+
+// HLEN key
+Response CommandDispatcher::handle_hlen(const std::vector<std::string> &args)
+{
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = h ? HashEntry::hlen(h) : 0;
+    return resp;
+}
+
+// HGETALL key
+Response CommandDispatcher::handle_hgetall(const std::vector<std::string> &args)
+{
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    if (h)
+    {
+        std::vector<std::pair<std::string_view, std::string_view>> items;
+        HashEntry::hgetall(h, items);
+        append_field_values(resp, items);
+    }
+    return resp;
+}
+
+// HINCRBY key field increment
+Response CommandDispatcher::handle_hincrby(const std::vector<std::string> &args)
+{
+    int64_t delta;
+    if (!str_to_int64(args[3], delta))
+        throw std::invalid_argument("增量不是整数或超出范围");
+
+    Hash hash(args[1]);
+    HashNode *h = hash.create(HMap_string);
+    HashEntry _entry(args[2]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    try
+    {
+        resp.integer = _entry.hincrby(h, delta);
+    }
+    catch (...)
+    {
+        // 新建的哈希在出错时不能留下空键
+        hash.del_if_empty(HMap_string, h);
+        throw;
+    }
+    return resp;
+}
+
+// HSCAN key cursor [MATCH pattern] [COUNT count]
+Response CommandDispatcher::handle_hscan(const std::vector<std::string> &args)
+{
+    const std::string &cur = args[2];
+    char *end = nullptr;
+    uint64_t cursor = cur.empty() || !isdigit((unsigned char)cur[0]) ? 0 : strtoull(cur.c_str(), &end, 10);
+    if (end != cur.c_str() + cur.size())
+        throw std::invalid_argument("游标不合法");
+
+    const std::string *pattern = nullptr;
+    int64_t count = 10;
+    for (size_t i = 3; i < args.size(); i += 2)
+    {
+        if (i + 1 >= args.size())
+            throw std::invalid_argument("语法错误");
+        if (args[i] == "MATCH")
+            pattern = &args[i + 1];
+        else if (args[i] == "COUNT")
+        {
+            if (!str_to_int64(args[i + 1], count) || count < 1)
+                throw std::invalid_argument("COUNT 必须为正整数");
+        }
+        else
+            throw std::invalid_argument("语法错误");
+    }
+
+    Hash hash(args[1]);
+    HashNode *h = hash.find(HMap_string);
+    std::vector<std::pair<std::string_view, std::string_view>> items;
+    uint64_t next = 0;
+    if (h)
+        next = HashEntry::hscan(h, cursor, count > UINT32_MAX ? UINT32_MAX : count, items);
+    if (pattern)
+    {
+        GlobPattern matcher(*pattern);
+        size_t keep = 0;
+        for (auto &item : items)
+            if (matcher.match(item.first))
+                items[keep++] = item;
+        items.resize(keep);
+    }
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(2);
+    resp.array[0].type = ResponseType::BULK_STRING;
+    resp.array[0].bulk_string = std::to_string(next);
+    resp.array[1].type = ResponseType::ARRAY;
+    append_field_values(resp.array[1], items);
+    return resp;
+}
+
+// LPUSH key element [element ...]
+Response CommandDispatcher::handle_lpush(const std::vector<std::string> &args)
+{
+    return list_push(args, true);
+}
+
+// RPUSH key element [element ...]
+Response CommandDispatcher::handle_rpush(const std::vector<std::string> &args)
+{
+    return list_push(args, false);
+}
+
+// LPOP key [count]
+Response CommandDispatcher::handle_lpop(const std::vector<std::string> &args)
+{
+    return list_pop(args, true);
+}
+
+// RPOP key [count]
+Response CommandDispatcher::handle_rpop(const std::vector<std::string> &args)
+{
+    return list_pop(args, false);
+}
+
+Response CommandDispatcher::list_push(const std::vector<std::string> &args, bool front)
+{
+    List list(args[1]);
+    ListNode *l = list.create(HMap_string);
+    for (size_t i = 2; i < args.size(); i++)
+    {
+        if (front)
+            l->ql.ql_push_front(args[i]);
+        else
+            l->ql.ql_push_back(args[i]);
+    }
+    signal_key_ready(args[1]);
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = l->ql.ql_size();
+    return resp;
+}
+
+Response CommandDispatcher::list_pop(const std::vector<std::string> &args, bool front)
+{
+    int64_t count = 1;
+    bool has_count = args.size() > 2;
+    if (has_count && (!str_to_int64(args[2], count) || count < 0))
+        throw std::invalid_argument("count 必须为非负整数");
+
+    List list(args[1]);
+    ListNode *l = list.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::NULL_BULK_STRING;
+    if (!l)
+        return resp;
+
+    if (!has_count)
+    {
+        resp.type = ResponseType::BULK_STRING;
+        front ? l->ql.ql_pop_front(resp.bulk_string) : l->ql.ql_pop_back(resp.bulk_string);
+    }
+    else
+    {
+        resp.type = ResponseType::ARRAY;
+        uint64_t n = std::min<uint64_t>(count, l->ql.ql_size());
+        resp.array.resize(n);
+        for (uint64_t i = 0; i < n; i++)
+        {
+            resp.array[i].type = ResponseType::BULK_STRING;
+            front ? l->ql.ql_pop_front(resp.array[i].bulk_string) : l->ql.ql_pop_back(resp.array[i].bulk_string);
+        }
+    }
+    list.del_if_empty(HMap_string, l);
+    return resp;
+}
+
+// LRANGE key start stop
+Response CommandDispatcher::handle_lrange(const std::vector<std::string> &args)
+{
+    int64_t start, stop;
+    if (!str_to_int64(args[2], start) || !str_to_int64(args[3], stop))
+        throw std::invalid_argument("下标不是整数或超出范围");
+
+    List list(args[1]);
+    ListNode *l = list.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    if (!l)
+        return resp;
+
+    // 元素直接引用节点中的连续内存，序列化时顺序拷贝
+    std::vector<std::string_view> items;
+    l->ql.ql_range(start, stop, items);
+    resp.array.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        resp.array[i].type = ResponseType::BULK_STRING;
+        resp.array[i].bulk_view = items[i];
+    }
+    return resp;
+}
+
+// LLEN key
+Response CommandDispatcher::handle_llen(const std::vector<std::string> &args)
+{
+    List list(args[1]);
+    ListNode *l = list.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = l ? l->ql.ql_size() : 0;
+    return resp;
+}
+
+// LINDEX key index
+Response CommandDispatcher::handle_lindex(const std::vector<std::string> &args)
+{
+    int64_t idx;
+    if (!str_to_int64(args[2], idx))
+        throw std::invalid_argument("下标不是整数或超出范围");
+
+    List list(args[1]);
+    ListNode *l = list.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::NULL_BULK_STRING;
+    std::string_view elem;
+    if (l && l->ql.ql_index(idx, elem))
+    {
+        resp.type = ResponseType::BULK_STRING;
+        resp.bulk_view = elem;
+    }
+    return resp;
+}
+
+// LTRIM key start stop
+Response CommandDispatcher::handle_ltrim(const std::vector<std::string> &args)
+{
+    int64_t start, stop;
+    if (!str_to_int64(args[2], start) || !str_to_int64(args[3], stop))
+        throw std::invalid_argument("下标不是整数或超出范围");
+
+    List list(args[1]);
+    ListNode *l = list.find(HMap_string);
+    if (l)
+    {
+        l->ql.ql_trim(start, stop);
+        list.del_if_empty(HMap_string, l);
+    }
+
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = "OK";
+    return resp;
+}
+
+int64_t CommandDispatcher::parse_timeout(const std::string &arg)
+{
+    char *end = nullptr;
+    double sec = arg.empty() || isspace((unsigned char)arg[0]) ? NAN : strtod(arg.c_str(), &end);
+    if (std::isnan(sec) || end != arg.c_str() + arg.size())
+        throw std::invalid_argument("超时时间不是合法的数字");
+    if (sec < 0)
+        throw std::invalid_argument("超时时间不能为负数");
+    if (sec > 1e12)
+        throw std::invalid_argument("超时时间超出范围");
+    int64_t ms = (int64_t)std::ceil(sec * 1000);
+    return ms;
+}
+
+// 阻塞响应：记录等待的键与超时，由连接挂起并在键上有数据或超时后重新执行命令
+static Response make_blocked_response(std::vector<std::string>::const_iterator first, std::vector<std::string>::const_iterator last, int64_t timeout_ms)
+{
+    Response resp;
+    resp.type = ResponseType::BLOCKED;
+    resp.integer = timeout_ms;
+    for (; first != last; ++first)
+    {
+        Response key;
+        key.type = ResponseType::BULK_STRING;
+        key.bulk_string = *first;
+        resp.array.push_back(std::move(key));
+    }
+    return resp;
+}
+
+// BLPOP key [key ...] timeout
+Response CommandDispatcher::handle_blpop(const std::vector<std::string> &args)
+{
+    return list_bpop(args, true);
+}
+
+// BRPOP key [key ...] timeout
+Response CommandDispatcher::handle_brpop(const std::vector<std::string> &args)
+{
+    return list_bpop(args, false);
+}
+
+Response CommandDispatcher::list_bpop(const std::vector<std::string> &args, bool front)
+{
+    int64_t timeout = parse_timeout(args.back());
+
+    // 按参数顺序从第一个非空列表中弹出
+    for (size_t i = 1; i + 1 < args.size(); i++)
+    {
+        List list(args[i]);
+        ListNode *l = list.find(HMap_string);
+        if (!l)
+            continue;
+        Response resp;
+        resp.type = ResponseType::ARRAY;
+        resp.array.resize(2);
+        resp.array[0].type = ResponseType::BULK_STRING;
+        resp.array[0].bulk_string = args[i];
+        resp.array[1].type = ResponseType::BULK_STRING;
+        front ? l->ql.ql_pop_front(resp.array[1].bulk_string) : l->ql.ql_pop_back(resp.array[1].bulk_string);
+        list.del_if_empty(HMap_string, l);
+        return resp;
+    }
+    return make_blocked_response(args.begin() + 1, args.end() - 1, timeout);
+}
+
+// BLMOVE source destination LEFT|RIGHT LEFT|RIGHT timeout
+Response CommandDispatcher::handle_blmove(const std::vector<std::string> &args)
+{
+    auto parse_side = [](const std::string &arg)
+    {
+        if (arg == "LEFT")
+            return true;
+        if (arg == "RIGHT")
+            return false;
+        throw std::invalid_argument("方向必须为LEFT或RIGHT");
+    };
+    bool from_left = parse_side(args[3]);
+    bool to_left = parse_side(args[4]);
+    int64_t timeout = parse_timeout(args[5]);
+
+    List src(args[1]);
+    ListNode *s = src.find(HMap_string);
+    if (!s)
+        return make_blocked_response(args.begin() + 1, args.begin() + 2, timeout);
+
+    // 先检查目标类型，出错时源列表保持不变
+    List dst(args[2]);
+    dst.find(HMap_string);
+
+    Response resp;
+    resp.type = ResponseType::BULK_STRING;
+    from_left ? s->ql.ql_pop_front(resp.bulk_string) : s->ql.ql_pop_back(resp.bulk_string);
+    src.del_if_empty(HMap_string, s);
+
+    ListNode *d = dst.create(HMap_string);
+    to_left ? d->ql.ql_push_front(resp.bulk_string) : d->ql.ql_push_back(resp.bulk_string);
+    signal_key_ready(args[2]);
+    return resp;
+}
+
+// SADD key member [member ...]
+Response CommandDispatcher::handle_sadd(const std::vector<std::string> &args)
+{
+    Set set(args[1]);
+    SetNode *s = set.create(HMap_string);
+    int64_t added = 0;
+    for (size_t i = 2; i < args.size(); i++)
+    {
+        SetEntry _entry(args[i]);
+        if (_entry.sadd(s))
+            added++;
+    }
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = added;
+    return resp;
+}
+
+// SREM key member [member ...]
+Response CommandDispatcher::handle_srem(const std::vector<std::string> &args)
+{
+    Set set(args[1]);
+    SetNode *s = set.find(HMap_string);
+    int64_t removed = 0;
+    if (s)
+    {
+        for (size_t i = 2; i < args.size(); i++)
+        {
+            SetEntry _entry(args[i]);
+            if (_entry.srem(s))
+                removed++;
+        }
+        set.del_if_empty(HMap_string, s);
+    }
+
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = removed;
+    return resp;
+}
+
+// SISMEMBER key member
+Response CommandDispatcher::handle_sismember(const std::vector<std::string> &args)
+{
+    Set set(args[1]);
+    SetNode *s = set.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = s && SetEntry(args[2]).sismember(s) ? 1 : 0;
+    return resp;
+}
+
+// SMEMBERS key
+Response CommandDispatcher::handle_smembers(const std::vector<std::string> &args)
+{
+    Set set(args[1]);
+    SetNode *s = set.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    if (!s)
+        return resp;
+
+    std::vector<std::string> members;
+    SetEntry::smembers(s, members);
+    resp.array.resize(members.size());
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        resp.array[i].type = ResponseType::BULK_STRING;
+        resp.array[i].bulk_string.swap(members[i]);
+    }
+    return resp;
+}
+
+// SCARD key
+Response CommandDispatcher::handle_scard(const std::vector<std::string> &args)
+{
+    Set set(args[1]);
+    SetNode *s = set.find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = s ? SetEntry::scard(s) : 0;
+    return resp;
+}
+
+// SINTER key [key ...]
+Response CommandDispatcher::handle_sinter(const std::vector<std::string> &args)
+{
+    return set_op(args, SetOp::INTER);
+}
+
+// SUNION key [key ...]
+Response CommandDispatcher::handle_sunion(const std::vector<std::string> &args)
+{
+    return set_op(args, SetOp::UNION);
+}
+
+// SDIFF key [key ...]
+Response CommandDispatcher::handle_sdiff(const std::vector<std::string> &args)
+{
+    return set_op(args, SetOp::DIFF);
+}
+
+Response CommandDispatcher::set_op(const std::vector<std::string> &args, SetOp op)
+{
+    // 先查找全部的键，类型不匹配时在运算前报错
+    std::vector<SetNode *> sets;
+    sets.reserve(args.size() - 1);
+    for (size_t i = 1; i < args.size(); i++)
+        sets.push_back(Set(args[i]).find(HMap_string));
+
+    std::vector<std::string> members;
+    SetEntry::setop(sets, op, members);
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(members.size());
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        resp.array[i].type = ResponseType::BULK_STRING;
+        resp.array[i].bulk_string.swap(members[i]);
+    }
+    return resp;
+}
+
+// 过滤器容量的上限，避免一次分配过多内存
+static const int64_t k_max_filter_capacity = 1LL << 32;
+
+uint64_t CommandDispatcher::parse_capacity(const std::string &arg)
+{
+    int64_t capacity;
+    if (!str_to_int64(arg, capacity) || capacity <= 0 || capacity > k_max_filter_capacity)
+        throw std::invalid_argument("容量必须为正整数且不超过2^32");
+    return capacity;
+}
+
+// BF.RESERVE key error_rate capacity
+Response CommandDispatcher::handle_bf_reserve(const std::vector<std::string> &args)
+{
+    char *end = nullptr;
+    double error_rate = strtod(args[2].c_str(), &end);
+    if (args[2].empty() || end != args[2].c_str() + args[2].size() || !(error_rate >= k_bloom_min_error_rate && error_rate < 1))
+        throw std::invalid_argument("误判率必须在1e-15与1之间");
+    uint64_t capacity = parse_capacity(args[3]);
+
+    Bloom(args[1]).create(HMap_string, capacity, error_rate);
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = "OK";
+    return resp;
+}
+
+// BF.ADD key item
+Response CommandDispatcher::handle_bf_add(const std::vector<std::string> &args)
+{
+    BloomNode *b = Bloom(args[1]).find_or_create(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = b->bf.bf_add(BloomFilter::bf_hash(args[2])) ? 1 : 0;
+    return resp;
+}
+
+// BF.MADD key item [item ...]
+Response CommandDispatcher::handle_bf_madd(const std::vector<std::string> &args)
+{
+    BloomNode *b = Bloom(args[1]).find_or_create(HMap_string);
+    // 先计算全部的哈希并预取对应的块，再逐个写入
+    std::vector<uint64_t> hashes(args.size() - 2);
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        hashes[i] = BloomFilter::bf_hash(args[i + 2]);
+        b->bf.bf_prefetch(hashes[i]);
+    }
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(hashes.size());
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        resp.array[i].type = ResponseType::INTEGER;
+        resp.array[i].integer = b->bf.bf_add(hashes[i]) ? 1 : 0;
+    }
+    return resp;
+}
+
+// BF.EXISTS key item
+Response CommandDispatcher::handle_bf_exists(const std::vector<std::string> &args)
+{
+    BloomNode *b = Bloom(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = b && b->bf.bf_exists(BloomFilter::bf_hash(args[2])) ? 1 : 0;
+    return resp;
+}
+
+// BF.MEXISTS key item [item ...]
+Response CommandDispatcher::handle_bf_mexists(const std::vector<std::string> &args)
+{
+    BloomNode *b = Bloom(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(args.size() - 2);
+    for (auto &item : resp.array)
+        item.type = ResponseType::INTEGER;
+    if (!b)
+        return resp;
+
+    std::vector<uint64_t> hashes(args.size() - 2);
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        hashes[i] = BloomFilter::bf_hash(args[i + 2]);
+        b->bf.bf_prefetch(hashes[i]);
+    }
+    for (size_t i = 0; i < hashes.size(); i++)
+        resp.array[i].integer = b->bf.bf_exists(hashes[i]) ? 1 : 0;
+    return resp;
+}
+
+// CF.RESERVE key capacity
+Response CommandDispatcher::handle_cf_reserve(const std::vector<std::string> &args)
+{
+    uint64_t capacity = parse_capacity(args[2]);
+    Cuckoo(args[1]).create(HMap_string, capacity);
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = "OK";
+    return resp;
+}
+
+// CF.ADD key item
+Response CommandDispatcher::handle_cf_add(const std::vector<std::string> &args)
+{
+    CuckooNode *c = Cuckoo(args[1]).find_or_create(HMap_string);
+    if (!c->cf.cf_add(CuckooFilter::cf_hash(args[2])))
+        throw std::invalid_argument("过滤器已满");
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = 1;
+    return resp;
+}
+
+// CF.ADDNX key item
+Response CommandDispatcher::handle_cf_addnx(const std::vector<std::string> &args)
+{
+    CuckooNode *c = Cuckoo(args[1]).find_or_create(HMap_string);
+    uint64_t h = CuckooFilter::cf_hash(args[2]);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = 0;
+    if (c->cf.cf_exists(h))
+        return resp;
+    if (!c->cf.cf_add(h))
+        throw std::invalid_argument("过滤器已满");
+    resp.integer = 1;
+    return resp;
+}
+
+// CF.EXISTS key item
+Response CommandDispatcher::handle_cf_exists(const std::vector<std::string> &args)
+{
+    CuckooNode *c = Cuckoo(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = c && c->cf.cf_exists(CuckooFilter::cf_hash(args[2])) ? 1 : 0;
+    return resp;
+}
+
+// CF.MEXISTS key item [item ...]
+Response CommandDispatcher::handle_cf_mexists(const std::vector<std::string> &args)
+{
+    CuckooNode *c = Cuckoo(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(args.size() - 2);
+    for (auto &item : resp.array)
+        item.type = ResponseType::INTEGER;
+    if (!c)
+        return resp;
+
+    std::vector<uint64_t> hashes(args.size() - 2);
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        hashes[i] = CuckooFilter::cf_hash(args[i + 2]);
+        c->cf.cf_prefetch(hashes[i]);
+    }
+    for (size_t i = 0; i < hashes.size(); i++)
+        resp.array[i].integer = c->cf.cf_exists(hashes[i]) ? 1 : 0;
+    return resp;
+}
+
+// CF.DEL key item
+Response CommandDispatcher::handle_cf_del(const std::vector<std::string> &args)
+{
+    CuckooNode *c = Cuckoo(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = c && c->cf.cf_del(CuckooFilter::cf_hash(args[2])) ? 1 : 0;
+    return resp;
+}
+
+// 条目按 [id, [field, value, ...]] 的形式回复，字段与值直接引用节点中的数据
+static void append_stream_entries(Response &resp, const std::vector<StreamEntryView> &entries)
+{
+    resp.type = ResponseType::ARRAY;
+    resp.array.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        Response &item = resp.array[i];
+        item.type = ResponseType::ARRAY;
+        item.array.resize(2);
+        item.array[0].type = ResponseType::BULK_STRING;
+        item.array[0].bulk_string = stream_id_str(entries[i].id);
+        item.array[1].type = ResponseType::ARRAY;
+        item.array[1].array.resize(entries[i].fields.size());
+        for (size_t j = 0; j < entries[i].fields.size(); j++)
+        {
+            item.array[1].array[j].type = ResponseType::BULK_STRING;
+            item.array[1].array[j].bulk_view = entries[i].fields[j];
+        }
+    }
+}
+
+// 下一个/上一个ID，溢出时返回false
+static bool stream_id_incr(StreamID &id)
+{
+    if (id.seq != UINT64_MAX)
+        id.seq++;
+    else if (id.ms != UINT64_MAX)
+        id = StreamID{id.ms + 1, 0};
+    else
+        return false;
+    return true;
+}
+
+static bool stream_id_decr(StreamID &id)
+{
+    if (id.seq != 0)
+        id.seq--;
+    else if (id.ms != 0)
+        id = StreamID{id.ms - 1, UINT64_MAX};
+    else
+        return false;
+    return true;
+}
+
+// 解析范围的端点：- 与 + 为最小与最大ID，(前缀表示不包含该ID，省略序号时起点取0、终点取最大值
+// 不包含的端点已经越界时返回false，范围为空
+static bool parse_range_id(const std::string &arg, StreamID &id, bool is_start)
+{
+    if (arg == "-")
+    {
+        id = k_stream_id_min;
+        return true;
+    }
+    if (arg == "+")
+    {
+        id = k_stream_id_max;
+        return true;
+    }
+    bool exclusive = !arg.empty() && arg[0] == '(';
+    if (!stream_parse_id(exclusive ? arg.substr(1) : arg, id, is_start ? 0 : UINT64_MAX))
+        throw std::invalid_argument("流ID不合法");
+    if (!exclusive)
+        return true;
+    return is_start ? stream_id_incr(id) : stream_id_decr(id);
+}
+
+void CommandDispatcher::parse_maxlen(const std::vector<std::string> &args, size_t &i, uint64_t &maxlen, bool &approx)
+{
+    i++;
+    approx = false;
+    if (i < args.size() && (args[i] == "=" || args[i] == "~"))
+    {
+        approx = args[i] == "~";
+        i++;
+    }
+    int64_t n;
+    if (i >= args.size() || !str_to_int64(args[i], n) || n < 0)
+        throw std::invalid_argument("MAXLEN 必须为非负整数");
+    maxlen = n;
+    i++;
+}
+
+// XADD key [MAXLEN [=|~] threshold] *|id field value [field value ...]
+Response CommandDispatcher::handle_xadd(const std::vector<std::string> &args)
+{
+    size_t i = 2;
+    bool trim = false, approx = false;
+    uint64_t maxlen = 0;
+    if (args[i] == "MAXLEN")
+    {
+        parse_maxlen(args, i, maxlen, approx);
+        trim = true;
+    }
+    if (i >= args.size() || (args.size() - i - 1) < 2 || (args.size() - i - 1) % 2 != 0)
+        throw std::invalid_argument("XADD 参数必须为字段值对");
+
+    Stream stream(args[1]);
+    StreamNode *s = stream.find(HMap_string);
+    StreamID last = s ? s->log.sl_last_id() : k_stream_id_min;
+    StreamID id;
+    bool seq_auto = false;
+    if (args[i] == "*")
+    {
+        // 时钟回拨时沿用最后一个ID的时间戳，保证ID递增
+        id.ms = std::max(get_realtime_ms(), last.ms);
+        seq_auto = true;
+    }
+    else if (!stream_parse_id(args[i], id, 0, &seq_auto))
+        throw std::invalid_argument("流ID不合法");
+    if (seq_auto && id.ms == last.ms)
+    {
+        id = last;
+        if (!stream_id_incr(id))
+            throw std::invalid_argument("流ID已达到最大值");
+    }
+    if (id == k_stream_id_min)
+        throw std::invalid_argument("流ID必须大于0-0");
+    if (id <= last)
+        throw std::invalid_argument("流ID必须大于流中最后一个条目的ID");
+
+    s = stream.create(HMap_string);
+    s->log.sl_append(id, args, i + 1);
+    if (trim)
+        s->log.sl_trim(maxlen, approx);
+    signal_key_ready(args[1]);
+
+    Response resp;
+    resp.type = ResponseType::BULK_STRING;
+    resp.bulk_string = stream_id_str(id);
+    return resp;
+}
+
+// XRANGE key start end [COUNT count]
+Response CommandDispatcher::handle_xrange(const std::vector<std::string> &args)
+{
+    return stream_range(args, false);
+}
+
+// XREVRANGE key end start [COUNT count]
+Response CommandDispatcher::handle_xrevrange(const std::vector<std::string> &args)
+{
+    return stream_range(args, true);
+}
+
+Response CommandDispatcher::stream_range(const std::vector<std::string> &args, bool rev)
+{
+    int64_t count = 0;
+    bool has_count = args.size() > 4;
+    if (has_count && (args.size() != 6 || args[4] != "COUNT"))
+        throw std::invalid_argument("语法错误");
+    if (has_count && (!str_to_int64(args[5], count) || count < 0))
+        throw std::invalid_argument("count 必须为非负整数");
+
+    StreamID start, end;
+    bool valid = parse_range_id(args[rev ? 3 : 2], start, true);
+    valid &= parse_range_id(args[rev ? 2 : 3], end, false);
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    StreamNode *s = Stream(args[1]).find(HMap_string);
+    if (!s || !valid || (has_count && count == 0))
+        return resp;
+
+    std::vector<StreamEntryView> entries;
+    if (rev)
+        s->log.sl_rev_range(start, end, count, entries);
+    else
+        s->log.sl_range(start, end, count, entries);
+    append_stream_entries(resp, entries);
+    return resp;
+}
+
+// XLEN key
+Response CommandDispatcher::handle_xlen(const std::vector<std::string> &args)
+{
+    StreamNode *s = Stream(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = s ? s->log.sl_size() : 0;
+    return resp;
+}
+
+// XTRIM key MAXLEN [=|~] threshold
+Response CommandDispatcher::handle_xtrim(const std::vector<std::string> &args)
+{
+    if (args[2] != "MAXLEN")
+        throw std::invalid_argument("XTRIM只支持MAXLEN");
+    size_t i = 2;
+    uint64_t maxlen;
+    bool approx;
+    parse_maxlen(args, i, maxlen, approx);
+    if (i != args.size())
+        throw std::invalid_argument("语法错误");
+
+    StreamNode *s = Stream(args[1]).find(HMap_string);
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = s ? s->log.sl_trim(maxlen, approx) : 0;
+    return resp;
+}
+
+// XREAD [COUNT count] [BLOCK milliseconds] STREAMS key [key ...] id [id ...]
+Response CommandDispatcher::handle_xread(const std::vector<std::string> &args)
+{
+    int64_t count = 0, block_ms = -1;
+    size_t i = 1;
+    for (; i < args.size() && args[i] != "STREAMS"; i += 2)
+    {
+        if (i + 1 >= args.size())
+            throw std::invalid_argument("语法错误");
+        if (args[i] == "COUNT")
+        {
+            if (!str_to_int64(args[i + 1], count) || count < 0)
+                throw std::invalid_argument("count 必须为非负整数");
+        }
+        else if (args[i] == "BLOCK")
+        {
+            if (!str_to_int64(args[i + 1], block_ms) || block_ms < 0)
+                throw std::invalid_argument("超时时间必须为非负整数");
+        }
+        else
+            throw std::invalid_argument("语法错误");
+    }
+    size_t first = i + 1;
+    size_t nkeys = (args.size() - first) / 2;
+    if (i >= args.size() || nkeys == 0 || (args.size() - first) % 2 != 0)
+        throw std::invalid_argument("STREAMS 后的键与ID个数必须相同");
+
+    // 先解析全部的ID，$为当前流中最大的ID
+    std::vector<StreamNode *> streams(nkeys);
+    std::vector<StreamID> ids(nkeys);
+    bool has_dollar = false;
+    for (size_t k = 0; k < nkeys; k++)
+    {
+        streams[k] = Stream(args[first + k]).find(HMap_string);
+        const std::string &arg = args[first + nkeys + k];
+        if (arg == "$")
+        {
+            ids[k] = streams[k] ? streams[k]->log.sl_last_id() : k_stream_id_min;
+            has_dollar = true;
+        }
+        else if (!stream_parse_id(arg, ids[k], 0))
+            throw std::invalid_argument("流ID不合法");
+    }
+
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    for (size_t k = 0; k < nkeys; k++)
+    {
+        StreamID start = ids[k];
+        if (!streams[k] || !stream_id_incr(start))
+            continue;
+        std::vector<StreamEntryView> entries;
+        streams[k]->log.sl_range(start, k_stream_id_max, count, entries);
+        if (entries.empty())
+            continue;
+        Response item;
+        item.type = ResponseType::ARRAY;
+        item.array.resize(2);
+        item.array[0].type = ResponseType::BULK_STRING;
+        item.array[0].bulk_string = args[first + k];
+        append_stream_entries(item.array[1], entries);
+        resp.array.push_back(std::move(item));
+    }
+    if (!resp.array.empty())
+        return resp;
+
+    if (block_ms < 0)
+    {
+        resp.type = ResponseType::NULL_BULK_STRING;
+        return resp;
+    }
+    Response blocked = make_blocked_response(args.begin() + first, args.begin() + first + nkeys, block_ms);
+    // $在挂起时固定为当前的最大ID，唤醒后只读取挂起之后添加的条目
+    if (has_dollar)
+    {
+        blocked.blocked_args = args;
+        for (size_t k = 0; k < nkeys; k++)
+            if (args[first + nkeys + k] == "$")
+                blocked.blocked_args[first + nkeys + k] = stream_id_str(ids[k]);
+    }
+    return blocked;
+}
+
+// 修改连接状态的命令(订阅、事务)的响应：由连接根据命令名与参数处理并回复
+static Response make_conn_response(ResponseType type, const std::vector<std::string> &args)
+{
+    Response resp;
+    resp.type = type;
+    resp.simple_string = args[0];
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        Response item;
+        item.type = ResponseType::BULK_STRING;
+        item.bulk_string = args[i];
+        resp.array.push_back(std::move(item));
+    }
+    return resp;
+}
+
+// SUBSCRIBE channel [channel ...]
+Response CommandDispatcher::handle_subscribe(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::PUBSUB, args);
+}
+
+// UNSUBSCRIBE [channel ...]
+Response CommandDispatcher::handle_unsubscribe(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::PUBSUB, args);
+}
+
+// PSUBSCRIBE pattern [pattern ...]
+Response CommandDispatcher::handle_psubscribe(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::PUBSUB, args);
+}
+
+// PUNSUBSCRIBE [pattern ...]
+Response CommandDispatcher::handle_punsubscribe(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::PUBSUB, args);
+}
+
+// PUBLISH channel message
+Response CommandDispatcher::handle_publish(const std::vector<std::string> &args)
+{
+    Response resp;
+    resp.type = ResponseType::INTEGER;
+    resp.integer = pubsub.publish(args[1], args[2]);
+    return resp;
+}
+
+// MULTI
+Response CommandDispatcher::handle_multi(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::TRANSACTION, args);
+}
+
+// EXEC
+Response CommandDispatcher::handle_exec(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::TRANSACTION, args);
+}
+
+// DISCARD
+Response CommandDispatcher::handle_discard(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::TRANSACTION, args);
+}
+
+// WATCH key [key ...]
+Response CommandDispatcher::handle_watch(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::TRANSACTION, args);
+}
+
+// UNWATCH
+Response CommandDispatcher::handle_unwatch(const std::vector<std::string> &args)
+{
+    return make_conn_response(ResponseType::TRANSACTION, args);
+}
+
+/// @brief 与事务中一样，阻塞命令不阻塞，没有数据时返回空值；需要修改连接状态的命令与脚本命令不能在脚本中执行
+Response CommandDispatcher::call_from_script(const std::vector<std::string> &args) const
+{
+    auto it = registry_.find(args[0]);
+    if (it == registry_.end())
+        throw std::invalid_argument("未知命令 '" + args[0] + "'");
+    const Command &cmd = it->second;
+    validationResult res = validate_args(cmd, args);
+    if (!res.isvalid)
+        throw std::invalid_argument(res.error_msg);
+    if (cmd.type == CommandType::EVAL || cmd.type == CommandType::EVALSHA || cmd.type == CommandType::SCRIPT)
+        throw std::invalid_argument("脚本中不能执行'" + cmd.name + "'");
+
+    Response resp = run_command(cmd, args);
+    if (resp.type == ResponseType::PUBSUB || resp.type == ResponseType::TRANSACTION)
+        throw std::invalid_argument("脚本中不能执行'" + cmd.name + "'");
+    if (resp.type == ResponseType::BLOCKED)
+    {
+        resp = Response();
+        resp.type = ResponseType::NULL_BULK_STRING;
+    }
+    return resp;
+}
+
+Response CommandDispatcher::run_script(const ScriptProgram &prog, const std::vector<std::string> &args)
+{
+    int64_t numkeys;
+    if (!str_to_int64(args[2], numkeys) || numkeys < 0)
+        throw std::invalid_argument("numkeys 必须为非负整数");
+    if ((size_t)numkeys > args.size() - 3)
+        throw std::invalid_argument("numkeys 大于键的个数");
+    std::vector<std::string> keys(args.begin() + 3, args.begin() + 3 + numkeys);
+    std::vector<std::string> argv(args.begin() + 3 + numkeys, args.end());
+    return script_run(prog, keys, argv, [this](const std::vector<std::string> &cmd)
+                      { return call_from_script(cmd); }, script_config.max_instructions);
+}
+
+// EVAL script numkeys [key ...] [arg ...]
+Response CommandDispatcher::handle_eval(const std::vector<std::string> &args)
+{
+    std::shared_ptr<ScriptProgram> prog;
+    scripts_.load(args[1], &prog);
+    return run_script(*prog, args);
+}
+
+// EVALSHA sha1 numkeys [key ...] [arg ...]
+Response CommandDispatcher::handle_evalsha(const std::vector<std::string> &args)
+{
+    std::shared_ptr<ScriptProgram> prog = scripts_.find(args[1]);
+    if (!prog)
+        throw std::invalid_argument("NOSCRIPT 没有匹配的脚本，请使用EVAL");
+    return run_script(*prog, args);
+}
+
+// SCRIPT LOAD script | SCRIPT EXISTS sha1 [sha1 ...] | SCRIPT FLUSH
+Response CommandDispatcher::handle_script(const std::vector<std::string> &args)
+{
+    const std::string &sub = args[1];
+    Response resp;
+    if (sub == "LOAD" && args.size() == 3)
+    {
+        resp.type = ResponseType::BULK_STRING;
+        resp.bulk_string = scripts_.load(args[2]);
+    }
+    else if (sub == "EXISTS" && args.size() >= 3)
+    {
+        resp.type = ResponseType::ARRAY;
+        for (size_t i = 2; i < args.size(); i++)
+        {
+            Response item;
+            item.type = ResponseType::INTEGER;
+            item.integer = scripts_.find(args[i]) != nullptr;
+            resp.array.push_back(std::move(item));
+        }
+    }
+    else if (sub == "FLUSH" && args.size() == 2)
+    {
+        scripts_.flush();
+        resp.type = ResponseType::SIMPLE_STRING;
+        resp.simple_string = "OK";
+    }
+    else
+        throw std::invalid_argument("语法错误");
+    return resp;
+}
+
+// 按名称排序的命令，统计输出的顺序固定
+static std::vector<const Command *> sorted_commands(const CommandRegistry &registry)
+{
+    std::vector<const Command *> cmds;
+    cmds.reserve(registry.size());
+    for (const auto &kv : registry)
+        cmds.push_back(&kv.second);
+    std::sort(cmds.begin(), cmds.end(), [](const Command *a, const Command *b)
+              { return a->name < b->name; });
+    return cmds;
+}
+
+static std::string lower(std::string s)
+{
+    for (char &c : s)
+        c = tolower((unsigned char)c);
+    return s;
+}
+
+static std::string format_double(double v, int precision)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", precision, v);
+    return buf;
+}
+
+std::string CommandDispatcher::info_commandstats() const
+{
+    double per_us = cycles_per_us();
+    std::string out = "# Commandstats\r\n";
+    for (const Command *cmd : sorted_commands(registry_))
+    {
+        const CommandStats &st = cmd->stats;
+        if (st.calls == 0 && st.rejected_calls == 0)
+            continue;
+        double usec = st.cycles / per_us;
+        out += "cmdstat_" + lower(cmd->name) + ":calls=" + std::to_string(st.calls) +
+               ",usec=" + std::to_string((uint64_t)usec) +
+               ",usec_per_call=" + format_double(st.calls ? usec / st.calls : 0, 2) +
+               ",rejected_calls=" + std::to_string(st.rejected_calls) +
+               ",failed_calls=" + std::to_string(st.failed_calls) + "\r\n";
+    }
+    return out;
+}
+
+std::string CommandDispatcher::info_latencystats() const
+{
+    double per_us = cycles_per_us();
+    std::string out = "# Latencystats\r\n";
+    for (const Command *cmd : sorted_commands(registry_))
+    {
+        const LatencyHistogram &h = cmd->stats.latency;
+        if (h.count() == 0)
+            continue;
+        out += "latency_percentiles_usec_" + lower(cmd->name) +
+               ":p50=" + format_double(h.percentile(50) / per_us, 3) +
+               ",p99=" + format_double(h.percentile(99) / per_us, 3) +
+               ",p99.9=" + format_double(h.percentile(99.9) / per_us, 3) + "\r\n";
+    }
+    return out;
+}
+
+std::vector<const Command *> CommandDispatcher::commands() const
+{
+    return sorted_commands(registry_);
+}
+
+uint64_t CommandDispatcher::total_calls() const
+{
+    uint64_t total = 0;
+    for (const auto &kv : registry_)
+        total += kv.second.stats.calls;
+    return total;
+}
+
+// 字节数的可读形式，如1.50M
+static std::string bytes_to_human(uint64_t n)
+{
+    const char *units = "BKMGTP";
+    double v = (double)n;
+    int u = 0;
+    while (v >= 1024 && u < 5)
+    {
+        v /= 1024;
+        u++;
+    }
+    return u == 0 ? std::to_string(n) + "B" : format_double(v, 2) + units[u];
+}
+
+std::string CommandDispatcher::info_server() const
+{
+    uint64_t uptime = (get_monotonic_ms() - server_stats.start_ms) / 1000;
+    return "# Server\r\n"
+           "multiplexing_api:poll\r\n"
+           "process_id:" + std::to_string(getpid()) + "\r\n"
+           "tcp_port:" + std::to_string(server_stats.tcp_port) + "\r\n"
+           "uptime_in_seconds:" + std::to_string(uptime) + "\r\n"
+           "uptime_in_days:" + std::to_string(uptime / 86400) + "\r\n"
+           "hz:" + std::to_string(1000 / k_cron_interval_ms) + "\r\n";
+}
+
+std::string CommandDispatcher::info_clients() const
+{
+    return "# Clients\r\n"
+           "connected_clients:" + std::to_string(server_stats.connected_clients) + "\r\n"
+           "blocked_clients:" + std::to_string(server_stats.blocked_clients) + "\r\n"
+           "watching_clients:" + std::to_string(watching_clients) + "\r\n";
+}
+
+std::string CommandDispatcher::info_memory() const
+{
+    uint64_t used = used_memory();
+    uint64_t rss = rss_memory();
+    uint64_t peak = std::max<uint64_t>(server_stats.peak_memory, used);
+    return "# Memory\r\n"
+           "used_memory:" + std::to_string(used) + "\r\n"
+           "used_memory_human:" + bytes_to_human(used) + "\r\n"
+           "used_memory_rss:" + std::to_string(rss) + "\r\n"
+           "used_memory_rss_human:" + bytes_to_human(rss) + "\r\n"
+           "used_memory_peak:" + std::to_string(peak) + "\r\n"
+           "used_memory_peak_human:" + bytes_to_human(peak) + "\r\n"
+           "mem_fragmentation_ratio:" + format_double(used ? (double)rss / used : 0, 2) + "\r\n";
+}
+
+std::string CommandDispatcher::info_stats() const
+{
+    return "# Stats\r\n"
+           "total_connections_received:" + std::to_string(server_stats.total_connections) + "\r\n"
+           "total_commands_processed:" + std::to_string(total_calls()) + "\r\n"
+           "instantaneous_ops_per_sec:" + std::to_string((uint64_t)server_stats.ops.rate()) + "\r\n"
+           "total_net_input_bytes:" + std::to_string(server_stats.net_input_bytes) + "\r\n"
+           "total_net_output_bytes:" + std::to_string(server_stats.net_output_bytes) + "\r\n"
+           "instantaneous_input_kbps:" + format_double(server_stats.input.rate() / 1024, 2) + "\r\n"
+           "instantaneous_output_kbps:" + format_double(server_stats.output.rate() / 1024, 2) + "\r\n"
+           "pubsub_channels:" + std::to_string(pubsub.channel_count()) + "\r\n"
+           "pubsub_patterns:" + std::to_string(pubsub.pattern_count()) + "\r\n";
+}
+
+/// @brief 只有一个数据库，没有过期；附带顶级哈希表的槽位数与是否正在重哈希
+std::string CommandDispatcher::info_keyspace() const
+{
+    std::string out = "# Keyspace\r\n";
+    uint64_t keys = HMap_string.hm_size();
+    if (keys > 0)
+        out += "db0:keys=" + std::to_string(keys) + ",expires=0,avg_ttl=0,slots=" + std::to_string(HMap_string.hm_slots()) +
+               ",rehashing=" + std::to_string(HMap_string.hm_rehashing()) + "\r\n";
+    return out;
+}
+
+/// @brief 不带参数或为default时输出默认的部分，all/everything时再加上命令统计，部分名不区分大小写，未知的部分忽略
+Response CommandDispatcher::handle_info(const std::vector<std::string> &args)
+{
+    struct Section
+    {
+        const char *name;
+        std::string (CommandDispatcher::*render)() const;
+        bool in_default;
+    };
+    static const Section sections[] = {
+        {"server", &CommandDispatcher::info_server, true},
+        {"clients", &CommandDispatcher::info_clients, true},
+        {"memory", &CommandDispatcher::info_memory, true},
+        {"stats", &CommandDispatcher::info_stats, true},
+        {"keyspace", &CommandDispatcher::info_keyspace, true},
+        {"commandstats", &CommandDispatcher::info_commandstats, false},
+        {"latencystats", &CommandDispatcher::info_latencystats, false},
+    };
+    const size_t n = sizeof(sections) / sizeof(sections[0]);
+
+    std::vector<bool> wanted(n, false);
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        std::string name = lower(args[i]);
+        for (size_t j = 0; j < n; j++)
+            if (name == "all" || name == "everything" || name == sections[j].name || (name == "default" && sections[j].in_default))
+                wanted[j] = true;
+    }
+    if (args.size() == 1)
+        for (size_t j = 0; j < n; j++)
+            wanted[j] = sections[j].in_default;
+
+    std::string out;
+    for (size_t j = 0; j < n; j++)
+    {
+        if (!wanted[j])
+            continue;
+        if (!out.empty())
+            out += "\r\n";
+        // 先取出表项再调用：GCC 12 的 -fsanitize=bounds 对 (this->*arr[j].pmf)() 中的下标插桩有误，会读到错误的下标
+        const Section &sec = sections[j];
+        out += (this->*sec.render)();
+    }
+
+    Response resp;
+    resp.type = ResponseType::BULK_STRING;
+    resp.bulk_string = std::move(out);
+    return resp;
+}
+
+// 直方图中的一个命令：[calls, n, p50, x, p99, x, p999, x, histogram_usec, [上界, 累计次数, ...]]
+static Response latency_histogram_entry(const CommandStats &st, double per_us)
+{
+    auto bulk = [](const std::string &s)
+    {
+        Response r;
+        r.type = ResponseType::BULK_STRING;
+        r.bulk_string = s;
+        return r;
+    };
+    auto integer = [](int64_t v)
+    {
+        Response r;
+        r.type = ResponseType::INTEGER;
+        r.integer = v;
+        return r;
+    };
+
+    Response entry;
+    entry.type = ResponseType::ARRAY;
+    entry.array.push_back(bulk("calls"));
+    entry.array.push_back(integer(st.calls));
+    const std::pair<const char *, double> percentiles[] = {{"p50", 50}, {"p99", 99}, {"p999", 99.9}};
+    for (const auto &p : percentiles)
+    {
+        entry.array.push_back(bulk(p.first));
+        entry.array.push_back(bulk(format_double(st.latency.percentile(p.second) / per_us, 3)));
+    }
+    entry.array.push_back(bulk("histogram_usec"));
+    Response buckets;
+    buckets.type = ResponseType::ARRAY;
+    for (const auto &b : st.latency.cumulative(1.0 / per_us))
+    {
+        buckets.array.push_back(integer(b.first));
+        buckets.array.push_back(integer(b.second));
+    }
+    entry.array.push_back(std::move(buckets));
+    return entry;
+}
+
+static Response latency_integer(int64_t v)
+{
+    Response r;
+    r.type = ResponseType::INTEGER;
+    r.integer = v;
+    return r;
+}
+
+/// @brief 不指定命令时输出所有执行过的命令，指定的命令不存在或没有执行过时跳过
+Response CommandDispatcher::latency_histogram(const std::vector<std::string> &args) const
+{
+    std::vector<const Command *> cmds;
+    if (args.size() == 2)
+        cmds = sorted_commands(registry_);
+    else
+        for (size_t i = 2; i < args.size(); i++)
+        {
+            auto it = registry_.find(args[i]);
+            if (it != registry_.end())
+                cmds.push_back(&it->second);
+        }
+
+    double per_us = cycles_per_us();
+    Response resp;
+    resp.type = ResponseType::ARRAY;
+    for (const Command *cmd : cmds)
+    {
+        if (cmd->stats.calls == 0)
+            continue;
+        Response name;
+        name.type = ResponseType::BULK_STRING;
+        name.bulk_string = lower(cmd->name);
+        resp.array.push_back(std::move(name));
+        resp.array.push_back(latency_histogram_entry(cmd->stats, per_us));
+    }
+    return resp;
+}
+
+// LATENCY HISTOGRAM [command ...] | LATENCY LATEST | LATENCY HISTORY event | LATENCY RESET [event ...] | LATENCY DOCTOR
+// LATEST返回每类事件的[事件名, 最近一次的时间戳, 最近一次的毫秒数, 最大毫秒数]，HISTORY返回[[时间戳, 毫秒数], ...]
+Response CommandDispatcher::handle_latency(const std::vector<std::string> &args)
+{
+    const std::string &sub = args[1];
+    Response resp;
+    if (sub == "HISTOGRAM")
+        return latency_histogram(args);
+    else if (sub == "LATEST" && args.size() == 2)
+    {
+        std::vector<std::string> names;
+        for (const auto &kv : latency_monitor.all())
+            names.push_back(kv.first);
+        std::sort(names.begin(), names.end());
+        resp.type = ResponseType::ARRAY;
+        for (const std::string &name : names)
+        {
+            const LatencySeries *ts = latency_monitor.find(name);
+            Response entry;
+            entry.type = ResponseType::ARRAY;
+            Response event;
+            event.type = ResponseType::BULK_STRING;
+            event.bulk_string = name;
+            entry.array.push_back(std::move(event));
+            entry.array.push_back(latency_integer(ts->latest().time));
+            entry.array.push_back(latency_integer(ts->latest().latency));
+            entry.array.push_back(latency_integer(ts->max));
+            resp.array.push_back(std::move(entry));
+        }
+    }
+    else if (sub == "HISTORY" && args.size() == 3)
+    {
+        resp.type = ResponseType::ARRAY;
+        const LatencySeries *ts = latency_monitor.find(args[2]);
+        if (ts)
+            for (const LatencySample &s : ts->history())
+            {
+                Response entry;
+                entry.type = ResponseType::ARRAY;
+                entry.array.push_back(latency_integer(s.time));
+                entry.array.push_back(latency_integer(s.latency));
+                resp.array.push_back(std::move(entry));
+            }
+    }
+    else if (sub == "RESET")
+    {
+        resp.type = ResponseType::INTEGER;
+        resp.integer = latency_monitor.reset(std::vector<std::string>(args.begin() + 2, args.end()));
+    }
+    else if (sub == "DOCTOR" && args.size() == 2)
+    {
+        resp.type = ResponseType::BULK_STRING;
+        resp.bulk_string = latency_monitor.doctor();
+    }
+    else
+        throw std::invalid_argument("语法错误");
+    return resp;
+}
+
+// SLOWLOG GET [count] | SLOWLOG LEN | SLOWLOG RESET
+// GET返回的每个条目为[id, 时间戳, 耗时(微秒), [参数...], 连接id]，count默认为10，负数返回全部
+Response CommandDispatcher::handle_slowlog(const std::vector<std::string> &args)
+{
+    const std::string &sub = args[1];
+    Response resp;
+    if (sub == "GET")
+    {
+        size_t count = 10;
+        if (args.size() == 3)
+        {
+            int64_t n;
+            if (!str_to_int64(args[2], n))
+                throw std::invalid_argument("count不是整数或超出范围");
+            count = n < 0 ? SIZE_MAX : (size_t)n;
+        }
+        resp.type = ResponseType::ARRAY;
+        for (const SlowlogEntry *e : slowlog_.latest(count))
+        {
+            Response entry;
+            entry.type = ResponseType::ARRAY;
+            for (int64_t v : {(int64_t)e->id, (int64_t)e->timestamp, (int64_t)e->duration_us})
+            {
+                Response num;
+                num.type = ResponseType::INTEGER;
+                num.integer = v;
+                entry.array.push_back(std::move(num));
+            }
+            Response argv;
+            argv.type = ResponseType::ARRAY;
+            for (const std::string &a : e->args)
+            {
+                Response item;
+                item.type = ResponseType::BULK_STRING;
+                item.bulk_string = a;
+                argv.array.push_back(std::move(item));
+            }
+            entry.array.push_back(std::move(argv));
+            Response client;
+            client.type = ResponseType::INTEGER;
+            client.integer = e->client_id;
+            entry.array.push_back(std::move(client));
+            resp.array.push_back(std::move(entry));
+        }
+    }
+    else if (sub == "LEN" && args.size() == 2)
+    {
+        resp.type = ResponseType::INTEGER;
+        resp.integer = slowlog_.size();
+    }
+    else if (sub == "RESET" && args.size() == 2)
+    {
+        slowlog_.reset();
+        resp.type = ResponseType::SIMPLE_STRING;
+        resp.simple_string = "OK";
+    }
+    else
+        throw std::invalid_argument("语法错误");
+    return resp;
+}
@@ -1,6 +1,17 @@
 #pragma once
 #include "commands.h"
 #include "../protocol/serializer.h"
+#include "../data_structures/string.h"
+#include "../data_structures/hyperloglog.h"
+#include "../data_structures/zset.h"
+#include "../data_structures/hash.h"
+#include "../data_structures/list.h"
+#include "../data_structures/set.h"
+#include "../data_structures/bloom.h"
+#include "../data_structures/cuckoo.h"
+#include "../data_structures/stream.h"
+#include "../script/script.h"
+#include "slowlog.h"
 
 struct validationResult
 {
@@ -12,12 +23,26 @@ class CommandDispatcher
 {
 private:
     CommandRegistry registry_;
+    ScriptCache scripts_; // 编译好的脚本
+    Slowlog slowlog_;     // 执行耗时超过阈值的命令
 
 public:
     CommandDispatcher();
 
-    // 命令执行
-    Response execute_command(const std::vector<std::string> &args);
+    // 命令执行，client_id为发出命令的连接，记入慢日志
+    Response execute_command(const std::vector<std::string> &args, int client_id = 0);
+
+    // 检查命令是否存在及参数个数，不通过时通过err带回错误响应，用于MULTI中排队前的检查
+    bool check_command(const std::vector<std::string> &args, Response &err) const;
+
+    // 依次执行事务中排队的命令，中间不会穿插其他连接的命令，返回每条命令的响应组成的数组
+    Response execute_transaction(const std::vector<std::vector<std::string>> &cmds, int client_id = 0);
+
+    // 所有命令的累计执行次数
+    uint64_t total_calls() const;
+
+    // 按名称排序的所有命令，指针在命令表的生命周期内有效
+    std::vector<const Command *> commands() const;
 
 protected:
     // 命令注册管理
@@ -29,10 +54,80 @@ protected:
     // 错误响应生成
     Response make_error_response(const std::string &error_msg) const;
 
+    // 写命令执行后更新写入的键的版本号
+    void touch_write_keys(const Command &cmd, const std::vector<std::string> &args) const;
+
+    // 调用处理函数并维护写入的键的版本号与执行统计，通过elapsed带回耗时(出错时也带回)，出错时抛出异常
+    Response run_command(const Command &cmd, const std::vector<std::string> &args, uint64_t *elapsed = nullptr) const;
+
+    // 耗时超过阈值时记入慢日志与延迟监控
+    void log_if_slow(const std::vector<std::string> &args, uint64_t elapsed, int client_id);
+
+    // 脚本中的call()，直接调用处理函数，出错时抛出异常中止脚本
+    Response call_from_script(const std::vector<std::string> &args) const;
+
+    // 脚本命令需要访问脚本缓存与命令表，不是静态函数，注册时绑定this
+    Response handle_eval(const std::vector<std::string> &args);
+    Response handle_evalsha(const std::vector<std::string> &args);
+    Response handle_script(const std::vector<std::string> &args);
+
+    // 统计命令需要遍历命令表
+    Response handle_info(const std::vector<std::string> &args);
+    Response handle_latency(const std::vector<std::string> &args);
+    Response handle_slowlog(const std::vector<std::string> &args);
+
+    // INFO的各个部分，每部分以"# 名称"开头，每行一项
+    std::string info_server() const;
+    std::string info_clients() const;
+    std::string info_memory() const;
+    std::string info_stats() const;
+    std::string info_keyspace() const;
+    std::string info_commandstats() const;
+    std::string info_latencystats() const;
+
+    // LATENCY HISTOGRAM：各命令的耗时分布
+    Response latency_histogram(const std::vector<std::string> &args) const;
+
+    // EVAL/EVALSHA的公共部分：解析numkeys、拆分KEYS与ARGV并执行
+    Response run_script(const ScriptProgram &prog, const std::vector<std::string> &args);
+
     // 命令处理器
     static Response handle_get(const std::vector<std::string> &args);
     static Response handle_set(const std::vector<std::string> &args);
     static Response handle_del(const std::vector<std::string> &args);
+    static Response handle_incr(const std::vector<std::string> &args);
+    static Response handle_decr(const std::vector<std::string> &args);
+    static Response handle_incrby(const std::vector<std::string> &args);
+    static Response handle_decrby(const std::vector<std::string> &args);
+    static Response handle_incrbyfloat(const std::vector<std::string> &args);
+    static Response handle_mget(const std::vector<std::string> &args);
+    static Response handle_mset(const std::vector<std::string> &args);
+    static Response handle_msetnx(const std::vector<std::string> &args);
+    static Response handle_append(const std::vector<std::string> &args);
+    static Response handle_getrange(const std::vector<std::string> &args);
+    static Response handle_setrange(const std::vector<std::string> &args);
+    static Response handle_strlen(const std::vector<std::string> &args);
+    static Response handle_getdel(const std::vector<std::string> &args);
+    static Response handle_setbit(const std::vector<std::string> &args);
+    static Response handle_getbit(const std::vector<std::string> &args);
+    static Response handle_bitcount(const std::vector<std::string> &args);
+    static Response handle_bitpos(const std::vector<std::string> &args);
+    static Response handle_bitop(const std::vector<std::string> &args);
+    static Response handle_pfadd(const std::vector<std::string> &args);
+    static Response handle_pfcount(const std::vector<std::string> &args);
+    static Response handle_pfmerge(const std::vector<std::string> &args);
+
+    // 解析BITCOUNT/BITPOS的可选范围单位BYTE|BIT，返回是否以位为单位
+    static bool parse_bit_unit(const std::string &arg);
+
+    // 查找存放HyperLogLog的字符串条目，不存在返回nullptr，值不是合法的HyperLogLog时抛出异常
+    static Entry_str *find_hll(const std::string &key);
+
+    // INCR/DECR/INCRBY/DECRBY的公共部分
+    static Response incr_generic(const std::string &key, int64_t delta);
+
+    // 为args中从first开始、间隔为step的键构造条目，并预取它们在哈希表中的位置
+    static std::vector<StringEntry> prefetch_entries(const std::vector<std::string> &args, size_t first, size_t step);
 
     static Response handle_zadd(const std::vector<std::string> &args);
     static Response handle_zrem(const std::vector<std::string> &args);
@@ -40,6 +135,97 @@ protected:
     static Response handle_zrank(const std::vector<std::string> &args);
     static Response handle_zcard(const std::vector<std::string> &args);
     static Response handle_zrange(const std::vector<std::string> &args);
+    static Response handle_zrevrange(const std::vector<std::string> &args);
+    static Response handle_zrangebyscore(const std::vector<std::string> &args);
     static Response handle_zall(const std::vector<std::string> &args);
     static Response handle_zdel(const std::vector<std::string> &args);
+    static Response handle_zincrby(const std::vector<std::string> &args);
+    static Response handle_zmscore(const std::vector<std::string> &args);
+    static Response handle_zunionstore(const std::vector<std::string> &args);
+    static Response handle_zinterstore(const std::vector<std::string> &args);
+    static Response handle_zdiffstore(const std::vector<std::string> &args);
+
+    static Response handle_hset(const std::vector<std::string> &args);
+    static Response handle_hget(const std::vector<std::string> &args);
+    static Response handle_hmget(const std::vector<std::string> &args);
+    static Response handle_hdel(const std::vector<std::string> &args);
+    static Response handle_hlen(const std::vector<std::string> &args);
+    static Response handle_hgetall(const std::vector<std::string> &args);
+    static Response handle_hincrby(const std::vector<std::string> &args);
+    static Response handle_hscan(const std::vector<std::string> &args);
+
+    static Response handle_lpush(const std::vector<std::string> &args);
+    static Response handle_rpush(const std::vector<std::string> &args);
+    static Response handle_lpop(const std::vector<std::string> &args);
+    static Response handle_rpop(const std::vector<std::string> &args);
+    static Response handle_lrange(const std::vector<std::string> &args);
+    static Response handle_llen(const std::vector<std::string> &args);
+    static Response handle_lindex(const std::vector<std::string> &args);
+    static Response handle_ltrim(const std::vector<std::string> &args);
+    static Response handle_blpop(const std::vector<std::string> &args);
+    static Response handle_brpop(const std::vector<std::string> &args);
+    static Response handle_blmove(const std::vector<std::string> &args);
+
+    static Response handle_sadd(const std::vector<std::string> &args);
+    static Response handle_srem(const std::vector<std::string> &args);
+    static Response handle_sismember(const std::vector<std::string> &args);
+    static Response handle_smembers(const std::vector<std::string> &args);
+    static Response handle_scard(const std::vector<std::string> &args);
+    static Response handle_sinter(const std::vector<std::string> &args);
+    static Response handle_sunion(const std::vector<std::string> &args);
+    static Response handle_sdiff(const std::vector<std::string> &args);
+
+    static Response handle_bf_reserve(const std::vector<std::string> &args);
+    static Response handle_bf_add(const std::vector<std::string> &args);
+    static Response handle_bf_madd(const std::vector<std::string> &args);
+    static Response handle_bf_exists(const std::vector<std::string> &args);
+    static Response handle_bf_mexists(const std::vector<std::string> &args);
+    static Response handle_cf_reserve(const std::vector<std::string> &args);
+    static Response handle_cf_add(const std::vector<std::string> &args);
+    static Response handle_cf_addnx(const std::vector<std::string> &args);
+    static Response handle_cf_exists(const std::vector<std::string> &args);
+    static Response handle_cf_mexists(const std::vector<std::string> &args);
+    static Response handle_cf_del(const std::vector<std::string> &args);
+
+    static Response handle_xadd(const std::vector<std::string> &args);
+    static Response handle_xrange(const std::vector<std::string> &args);
+    static Response handle_xrevrange(const std::vector<std::string> &args);
+    static Response handle_xlen(const std::vector<std::string> &args);
+    static Response handle_xtrim(const std::vector<std::string> &args);
+    static Response handle_xread(const std::vector<std::string> &args);
+
+    static Response handle_subscribe(const std::vector<std::string> &args);
+    static Response handle_unsubscribe(const std::vector<std::string> &args);
+    static Response handle_psubscribe(const std::vector<std::string> &args);
+    static Response handle_punsubscribe(const std::vector<std::string> &args);
+    static Response handle_publish(const std::vector<std::string> &args);
+
+    static Response handle_multi(const std::vector<std::string> &args);
+    static Response handle_exec(const std::vector<std::string> &args);
+    static Response handle_discard(const std::vector<std::string> &args);
+    static Response handle_watch(const std::vector<std::string> &args);
+    static Response handle_unwatch(const std::vector<std::string> &args);
+
+    // LPUSH/RPUSH、LPOP/RPOP的公共部分
+    static Response list_push(const std::vector<std::string> &args, bool front);
+    static Response list_pop(const std::vector<std::string> &args, bool front);
+    static Response list_bpop(const std::vector<std::string> &args, bool front);
+
+    // 解析阻塞命令的超时(秒，可为小数)，返回毫秒数，0表示一直阻塞
+    static int64_t parse_timeout(const std::string &arg);
+
+    // SINTER/SUNION/SDIFF的公共部分
+    static Response set_op(const std::vector<std::string> &args, SetOp op);
+
+    // XRANGE/XREVRANGE的公共部分
+    static Response stream_range(const std::vector<std::string> &args, bool rev);
+
+    // 解析 MAXLEN [=|~] threshold，i指向MAXLEN，返回后指向下一个参数
+    static void parse_maxlen(const std::vector<std::string> &args, size_t &i, uint64_t &maxlen, bool &approx);
+
+    // 解析过滤器的容量
+    static uint64_t parse_capacity(const std::string &arg);
+
+    // ZUNIONSTORE/ZINTERSTORE/ZDIFFSTORE的公共部分
+    static Response zsetop_store(const std::vector<std::string> &args, ZsetSetOp op);
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <functional>
 #include <unordered_map>
 #include "../protocol/serializer.h"
+#include "../utils/histogram/histogram.h"
 
 using CommandHandler = std::function<Response(const std::vector<std::string> &)>;
 
@@ -13,6 +14,27 @@ enum class CommandType
     GET,
     SET,
     DEL,
+    INCR,
+    DECR,
+    INCRBY,
+    DECRBY,
+    INCRBYFLOAT,
+    MGET,   // 批量获取
+    MSET,   // 批量设置
+    MSETNX, // 所有键都不存在时才批量设置
+    APPEND,
+    GETRANGE, // 获取子串
+    SETRANGE, // 覆盖写入子串
+    STRLEN,
+    GETDEL, // 获取并删除
+    SETBIT,
+    GETBIT,
+    BITCOUNT, // 统计置1的位数
+    BITPOS,   // 查找第一个0或1的位
+    BITOP,    // 多个位图的逐位运算
+    PFADD,    // 向HyperLogLog添加元素
+    PFCOUNT,  // 估计一个或多个HyperLogLog并集的基数
+    PFMERGE,  // 合并多个HyperLogLog
     // Zset
     ZADD,
     ZREM,
@@ -20,8 +42,117 @@ enum class CommandType
     ZRANK,  // 获取指定元素排名
     ZCARD,  // 获取集合元素个数
     ZRANGE,  // 获取指定排名范围内的元素
+    ZREVRANGE, // 逆序获取指定排名范围内的元素
+    ZRANGEBYSCORE, // 获取指定分数范围内的元素
     ZALL,
-    ZDEL
+    ZDEL,
+    ZINCRBY, // 为元素分数加上增量
+    ZMSCORE, // 批量获取元素分数
+    ZUNIONSTORE, // 并集存储到目标集合
+    ZINTERSTORE, // 交集存储到目标集合
+    ZDIFFSTORE,  // 差集存储到目标集合
+    // Hash
+    HSET,
+    HGET,
+    HMGET, // 批量获取字段
+    HDEL,
+    HLEN,
+    HGETALL,
+    HINCRBY, // 为字段的整数值加上增量
+    HSCAN,   // 游标迭代字段
+    // List
+    LPUSH,
+    RPUSH,
+    LPOP,
+    RPOP,
+    LRANGE, // 获取指定下标范围内的元素
+    LLEN,
+    LINDEX, // 获取指定下标的元素
+    LTRIM,  // 只保留指定下标范围内的元素
+    BLPOP,  // 阻塞式LPOP
+    BRPOP,  // 阻塞式RPOP
+    BLMOVE, // 阻塞式地从一个列表弹出并推入另一个列表
+
+    // Set
+    SADD,
+    SREM,
+    SISMEMBER,
+    SMEMBERS,
+    SCARD,
+    SINTER, // 交集
+    SUNION, // 并集
+    SDIFF,  // 差集
+
+    // 概率过滤器
+    BF_RESERVE, // 按误判率与容量创建布隆过滤器
+    BF_ADD,
+    BF_MADD,
+    BF_EXISTS,
+    BF_MEXISTS,
+    CF_RESERVE, // 按容量创建布谷鸟过滤器
+    CF_ADD,
+    CF_ADDNX, // 不存在时才添加
+    CF_EXISTS,
+    CF_MEXISTS,
+    CF_DEL,
+
+    // Stream
+    XADD,
+    XRANGE,    // 按ID范围正序读取
+    XREVRANGE, // 按ID范围逆序读取
+    XLEN,
+    XTRIM, // 只保留最新的若干条目
+    XREAD, // 读取一个或多个流中大于指定ID的条目，可阻塞等待
+
+    // 发布订阅
+    SUBSCRIBE,
+    UNSUBSCRIBE,
+    PSUBSCRIBE,   // 按glob模式订阅
+    PUNSUBSCRIBE,
+    PUBLISH,
+
+    // 事务
+    MULTI,
+    EXEC,
+    DISCARD,
+    WATCH,  // 乐观锁：EXEC时被WATCH的键有改动则放弃执行
+    UNWATCH,
+
+    // 脚本
+    EVAL,
+    EVALSHA, // 按SHA-1执行已缓存的脚本
+    SCRIPT,  // LOAD/EXISTS/FLUSH
+
+    // 统计
+    INFO,
+    LATENCY, // 命令耗时分布与延迟监控
+    SLOWLOG  // 执行耗时超过阈值的命令
+};
+
+// 写命令写入的键在参数中的位置：从first到last每隔step个，last为负数时从末尾倒数(-1为最后一个参数)
+// first为0表示不是写命令
+struct KeySpec
+{
+    int first = 0;
+    int last = 0;
+    int step = 1;
+};
+
+// 命令的执行统计，耗时以cycles_now()的计数为单位，输出时再换算为微秒
+struct CommandStats
+{
+    uint64_t calls = 0;          // 处理函数执行次数
+    uint64_t cycles = 0;         // 累计耗时
+    uint64_t rejected_calls = 0; // 参数个数不对，没有执行
+    uint64_t failed_calls = 0;   // 执行时出错
+    LatencyHistogram latency;    // 每次执行耗时的分布
+
+    void record(uint64_t elapsed)
+    {
+        calls++;
+        cycles += elapsed;
+        latency.record(elapsed);
+    }
 };
 
 struct Command
@@ -32,10 +163,12 @@ struct Command
     int max_args;           // 最大参数个数（-1表示不限）
     std::string syntax;     // 语法说明
     CommandHandler handler; // 处理函数
+    KeySpec write_keys;     // 写入的键
+    mutable CommandStats stats; // 执行统计，执行命令时更新
 
     Command() : name(""), type(CommandType::GET), min_args(0), max_args(0), syntax(""), handler(nullptr) {}
 
-    Command(const std::string &name, CommandType type, int min, int max, const std::string &syntax, CommandHandler handler) : name(name), type(type), min_args(min), max_args(max), syntax(syntax), handler(handler) {}
+    Command(const std::string &name, CommandType type, int min, int max, const std::string &syntax, CommandHandler handler, KeySpec write_keys = {}) : name(name), type(type), min_args(min), max_args(max), syntax(syntax), handler(handler), write_keys(write_keys) {}
 };
 
 // 命令注册表类型
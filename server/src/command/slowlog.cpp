@@ -0,0 +1,81 @@
+#include "slowlog.h"
+#include "../utils/utils.h"
+#include <algorithm>
+
+SlowlogConfig slowlog_config;
+
+bool Slowlog::is_slow(uint64_t elapsed) const
+{
+    int64_t threshold = slowlog_config.log_slower_than_us;
+    return threshold >= 0 && elapsed >= threshold * cycles_per_us();
+}
+
+/// @brief 最大条目数调整过时先把环转正再丢弃多出的最旧条目；参数截断的方式与Redis相同，
+///        最后一个位置用"... (N more arguments)"说明省略的参数个数
+void Slowlog::record(const std::vector<std::string> &args, uint64_t duration_us, int client_id)
+{
+    size_t max_len = slowlog_config.max_len;
+    if (head != 0 && ring.size() != max_len)
+    {
+        std::rotate(ring.begin(), ring.begin() + head, ring.end());
+        head = 0;
+    }
+    if (ring.size() > max_len)
+        ring.erase(ring.begin(), ring.begin() + (ring.size() - max_len));
+    if (max_len == 0)
+        return;
+
+    SlowlogEntry *e;
+    if (ring.size() < max_len)
+    {
+        ring.emplace_back();
+        e = &ring.back();
+    }
+    else
+    {
+        e = &ring[head];
+        head = (head + 1) % max_len;
+    }
+
+    e->id = next_id++;
+    e->timestamp = get_realtime_ms() / 1000;
+    e->duration_us = duration_us;
+    e->client_id = client_id;
+
+    size_t max_args = std::max<size_t>(slowlog_config.max_args, 1);
+    size_t n = std::min(args.size(), max_args);
+    e->args.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        std::string &dst = e->args[i];
+        if (n < args.size() && i == n - 1)
+        {
+            dst = "... (" + std::to_string(args.size() - n + 1) + " more arguments)";
+            break;
+        }
+        const std::string &src = args[i];
+        if (src.size() > slowlog_config.max_arg_len)
+        {
+            dst.assign(src, 0, slowlog_config.max_arg_len);
+            dst += "... (" + std::to_string(src.size() - slowlog_config.max_arg_len) + " more bytes)";
+        }
+        else
+            dst.assign(src);
+    }
+}
+
+std::vector<const SlowlogEntry *> Slowlog::latest(size_t count) const
+{
+    std::vector<const SlowlogEntry *> out;
+    size_t n = std::min(count, ring.size());
+    out.reserve(n);
+    for (size_t k = 0; k < n; k++)
+        out.push_back(&ring[(head + ring.size() - 1 - k) % ring.size()]);
+    return out;
+}
+
+void Slowlog::reset()
+{
+    ring.clear();
+    head = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SlowlogConfig
+{
+    int64_t log_slower_than_us = 10000; // 执行耗时达到该值(微秒)的命令记入慢日志，0记录所有命令，负数关闭
+    size_t max_len = 128;               // 最多保留的条目数，写满后覆盖最旧的条目
+    size_t max_args = 32;               // 每个条目最多保存的参数个数
+    size_t max_arg_len = 128;           // 每个参数最多保存的字节数
+};
+
+extern SlowlogConfig slowlog_config;
+
+struct SlowlogEntry
+{
+    uint64_t id = 0;               // 递增的唯一编号
+    uint64_t timestamp = 0;        // 记录时的unix时间(秒)
+    uint64_t duration_us = 0;      // 执行耗时
+    std::vector<std::string> args; // 截断后的参数
+    int client_id = 0;             // 执行命令的连接
+};
+
+/*慢日志：固定容量的环形缓冲区，写满后新条目复用最旧条目的存储*/
+class Slowlog
+{
+private:
+    std::vector<SlowlogEntry> ring;
+    size_t head = 0; // 写满后为最旧条目的下标，未写满时为0
+    uint64_t next_id = 0;
+
+public:
+    // 按耗时(cycles_now()的计数)判断是否需要记录，只做比较，不需要记录的命令没有任何分配
+    bool is_slow(uint64_t elapsed) const;
+
+    // 记录一条命令，参数超出个数或长度限制时截断
+    void record(const std::vector<std::string> &args, uint64_t duration_us, int client_id);
+
+    size_t size() const { return ring.size(); }
+
+    // 最新的count个条目，从新到旧
+    std::vector<const SlowlogEntry *> latest(size_t count) const;
+
+    void reset();
+};
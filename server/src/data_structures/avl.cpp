@@ -180,16 +180,83 @@ int AVLTree::avl_rank(AVLNode *node)
     return rank;
 }
 
+/// @brief 根据排名定位节点，从根节点出发借助avl_offset按子树节点数下降，时间复杂度O(logN)
+/// @param rank 排名(从1开始)
+/// @return 排名为rank的节点，超出范围返回nullptr
+AVLNode *AVLTree::avl_at_rank(int rank)
+{
+    if (!root || rank < 1 || rank > (int)avl_cnt(root))
+        return nullptr;
+    return avl_offset(root, rank - (int)(avl_cnt(root->left) + 1));
+}
+
+/// @brief 从根节点下降，满足pred时左子树与自身都计入并转向右子树，否则转向左子树，时间复杂度O(logN)
+uint32_t AVLTree::avl_count_prefix(bool (*pred)(AVLNode *node, const void *arg), const void *arg)
+{
+    uint32_t count = 0;
+    AVLNode *cur = root;
+    while (cur)
+    {
+        if (pred(cur, arg))
+        {
+            count += avl_cnt(cur->left) + 1;
+            cur = cur->right;
+        }
+        else
+            cur = cur->left;
+    }
+    return count;
+}
+
 /// @brief 获取排名在[min_rank,max_rank]中的所有元素
+/// 先O(logN)定位起始节点，再沿中序后继迭代k个节点，总复杂度O(logN + k)
 /// @param min_rank
 /// @param max_rank
 /// @param results 结果集数组
 void AVLTree::avl_range_by_rank(int min_rank, int max_rank, std::vector<AVLNode *> &results)
 {
-    if (min_rank > max_rank || !root)
+    if (!root)
+        return;
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > (int)avl_cnt(root))
+        max_rank = avl_cnt(root);
+    if (min_rank > max_rank)
         return;
-    int curr_rank = 1;
-    collect_in_range(root, curr_rank, min_rank, max_rank, results);
+
+    results.reserve(results.size() + (max_rank - min_rank + 1));
+    AVLNode *cur = avl_at_rank(min_rank);
+    for (int rank = min_rank; cur && rank <= max_rank; rank++)
+    {
+        results.push_back(cur);
+        cur = avl_next(cur);
+    }
+}
+
+/// @brief 逆序获取排名在[min_rank,max_rank]中的所有元素，排名从分数最大的元素开始计为1
+/// @param min_rank
+/// @param max_rank
+/// @param results 结果集数组
+void AVLTree::avl_rev_range_by_rank(int min_rank, int max_rank, std::vector<AVLNode *> &results)
+{
+    if (!root)
+        return;
+    int n = avl_cnt(root);
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > n)
+        max_rank = n;
+    if (min_rank > max_rank)
+        return;
+
+    results.reserve(results.size() + (max_rank - min_rank + 1));
+    // 逆序排名r对应正序排名n-r+1
+    AVLNode *cur = avl_at_rank(n - min_rank + 1);
+    for (int rank = min_rank; cur && rank <= max_rank; rank++)
+    {
+        results.push_back(cur);
+        cur = avl_prev(cur);
+    }
 }
 
 void AVLTree::avl_inorder(std::vector<AVLNode *> &results)
@@ -197,6 +264,13 @@ void AVLTree::avl_inorder(std::vector<AVLNode *> &results)
     inorder(root, results);
 }
 
+/// @brief 批量构建，避免逐个插入时的O(NlogN)比较与旋转
+/// @param sorted 按中序排列的节点
+void AVLTree::avl_build(std::vector<AVLNode *> &sorted)
+{
+    root = build(sorted, 0, (int)sorted.size(), nullptr);
+}
+
 void AVLTree::avl_clean_up()
 {
     root = nullptr;
@@ -378,27 +452,59 @@ void AVLTree::inorder(AVLNode *node, std::vector<AVLNode *> &results)
     inorder(node->right, results);
 }
 
-void AVLTree::collect_in_range(AVLNode *node, int &current_rank, int min_rank, int max_rank, std::vector<AVLNode *> &result)
+/// @brief 以中点为根，左右两半分别构建子树，左右子树节点数最多相差1，高度差不超过1
+/// @return 子树根节点
+AVLNode *AVLTree::build(std::vector<AVLNode *> &sorted, int lo, int hi, AVLNode *parent)
 {
-    if (!node || current_rank > max_rank)
-        return;
+    if (lo >= hi)
+        return nullptr;
+    int mid = lo + (hi - lo) / 2;
+    AVLNode *node = sorted[mid];
+    node->parent = parent;
+    node->left = build(sorted, lo, mid, node);
+    node->right = build(sorted, mid + 1, hi, node);
+    avl_update(node);
+    return node;
+}
 
-    // 遍历左子树
-    if (node->left)
+/// @brief 中序后继：有右子树则取右子树最小节点，否则向上回溯到第一个从左子树上来的祖先
+/// @param node
+/// @return 后继节点，node为最大节点时返回nullptr
+AVLNode *AVLTree::avl_next(AVLNode *node)
+{
+    if (node->right)
     {
-        collect_in_range(node->left, current_rank, min_rank, max_rank, result);
+        node = node->right;
+        while (node->left)
+            node = node->left;
+        return node;
     }
-
-    // 处理当前节点
-    if (current_rank >= min_rank && current_rank <= max_rank)
+    AVLNode *parent = node->parent;
+    while (parent && parent->right == node)
     {
-        result.push_back(node);
+        node = parent;
+        parent = parent->parent;
     }
-    current_rank++;
+    return parent;
+}
 
-    // 遍历右子树
-    if (current_rank <= max_rank && node->right)
+/// @brief 中序前驱，与avl_next对称
+/// @param node
+/// @return 前驱节点，node为最小节点时返回nullptr
+AVLNode *AVLTree::avl_prev(AVLNode *node)
+{
+    if (node->left)
+    {
+        node = node->left;
+        while (node->right)
+            node = node->right;
+        return node;
+    }
+    AVLNode *parent = node->parent;
+    while (parent && parent->left == node)
     {
-        collect_in_range(node->right, current_rank, min_rank, max_rank, result);
+        node = parent;
+        parent = parent->parent;
     }
+    return parent;
 }
@@ -64,9 +64,14 @@ protected:
 
     void inorder(AVLNode *node,std::vector<AVLNode*>&results);
 
-    // 递归收集排名范围内的所有节点
-    void
-    collect_in_range(AVLNode *node, int &current_rank, int min_rank, int max_rank, std::vector<AVLNode *> &result);
+    // 递归地以[lo, hi)的中点为根构建平衡子树
+    AVLNode *build(std::vector<AVLNode *> &sorted, int lo, int hi, AVLNode *parent);
+
+    // 中序遍历的后继节点
+    AVLNode *avl_next(AVLNode *node);
+
+    // 中序遍历的前驱节点
+    AVLNode *avl_prev(AVLNode *node);
 
 public:
     AVLTree();
@@ -89,9 +94,21 @@ public:
     // 返回node节点在avl中的中序遍历名次
     int avl_rank(AVLNode *node);
 
+    // 返回排名为rank(从1开始)的节点，超出范围返回nullptr
+    AVLNode *avl_at_rank(int rank);
+
+    // 中序的前若干个节点满足pred、其余都不满足时，返回满足pred的节点数，用于按分数定位排名
+    uint32_t avl_count_prefix(bool (*pred)(AVLNode *node, const void *arg), const void *arg);
+
     void avl_range_by_rank(int min_rank, int max_rank, std::vector<AVLNode *> &results);
 
+    // 逆序获取排名范围内的节点，排名从最大元素开始计为1
+    void avl_rev_range_by_rank(int min_rank, int max_rank, std::vector<AVLNode *> &results);
+
     void avl_inorder(std::vector<AVLNode *> &results);
 
+    // 由已排序的节点批量构建平衡树，要求当前树为空，复杂度O(N)
+    void avl_build(std::vector<AVLNode *> &sorted);
+
     void avl_clean_up();
 };
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "bitops.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITOPS_HAVE_X86 1
+#endif
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store64(uint8_t *p, uint64_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static uint64_t popcount_generic(const uint8_t *p, size_t n)
+{
+    uint64_t cnt = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        cnt += __builtin_popcountll(load64(p + i));
+    for (; i < n; i++)
+        cnt += __builtin_popcount(p[i]);
+    return cnt;
+}
+
+static void combine_generic(BitOp op, uint8_t *dst, const uint8_t *src, size_t n, size_t i)
+{
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t a = load64(dst + i), b = load64(src + i);
+        store64(dst + i, op == BitOp::AND ? a & b : op == BitOp::OR ? a | b
+                                                                    : a ^ b);
+    }
+    for (; i < n; i++)
+        dst[i] = op == BitOp::AND ? dst[i] & src[i] : op == BitOp::OR ? dst[i] | src[i]
+                                                                      : dst[i] ^ src[i];
+}
+
+static void not_generic(uint8_t *dst, size_t n, size_t i)
+{
+    for (; i + 8 <= n; i += 8)
+        store64(dst + i, ~load64(dst + i));
+    for (; i < n; i++)
+        dst[i] = ~dst[i];
+}
+
+#ifdef BITOPS_HAVE_X86
+/// @brief 4个独立的累加器，避免popcnt指令之间的依赖链
+__attribute__((target("popcnt"))) static uint64_t popcount_popcnt(const uint8_t *p, size_t n)
+{
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        c0 += __builtin_popcountll(load64(p + i));
+        c1 += __builtin_popcountll(load64(p + i + 8));
+        c2 += __builtin_popcountll(load64(p + i + 16));
+        c3 += __builtin_popcountll(load64(p + i + 24));
+    }
+    for (; i + 8 <= n; i += 8)
+        c0 += __builtin_popcountll(load64(p + i));
+    for (; i < n; i++)
+        c0 += __builtin_popcount(p[i]);
+    return c0 + c1 + c2 + c3;
+}
+
+/// @brief 高低4位分别查表(vpshufb)得到每个字节的计数，按字节累加，
+///        每个字节计数不超过8，累加不超过31轮后用vpsadbw横向求和到64位
+__attribute__((target("avx2"))) static uint64_t popcount_avx2(const uint8_t *p, size_t n)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 32 <= n)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        for (int round = 0; round < 31 && i + 32 <= n; round++, i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+            __m256i lo = _mm256_and_si256(v, low_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+            acc = _mm256_add_epi8(acc, _mm256_shuffle_epi8(lookup, lo));
+            acc = _mm256_add_epi8(acc, _mm256_shuffle_epi8(lookup, hi));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+    }
+    uint64_t cnt = (uint64_t)_mm256_extract_epi64(total, 0) + (uint64_t)_mm256_extract_epi64(total, 1) +
+                   (uint64_t)_mm256_extract_epi64(total, 2) + (uint64_t)_mm256_extract_epi64(total, 3);
+    return cnt + popcount_popcnt(p + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void combine_avx2(BitOp op, uint8_t *dst, const uint8_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i r = op == BitOp::AND ? _mm256_and_si256(a, b) : op == BitOp::OR ? _mm256_or_si256(a, b)
+                                                                                : _mm256_xor_si256(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), r);
+    }
+    combine_generic(op, dst, src, n, i);
+}
+
+__attribute__((target("avx2"))) static void not_avx2(uint8_t *dst, size_t n)
+{
+    const __m256i ones = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(a, ones));
+    }
+    not_generic(dst, n, i);
+}
+
+__attribute__((target("avx2"))) static size_t find_byte_avx2(const uint8_t *p, size_t n, uint8_t skip)
+{
+    const __m256i vs = _mm256_set1_epi8((char)skip);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vs));
+        if (eq != 0xFFFFFFFFu)
+            return i + __builtin_ctz(~eq);
+    }
+    for (; i < n; i++)
+        if (p[i] != skip)
+            return i;
+    return n;
+}
+
+static bool cpu_has_avx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+static bool cpu_has_popcnt()
+{
+    static const bool has = __builtin_cpu_supports("popcnt");
+    return has;
+}
+#endif
+
+uint64_t bit_popcount(const uint8_t *p, size_t n)
+{
+#ifdef BITOPS_HAVE_X86
+    if (cpu_has_avx2())
+        return popcount_avx2(p, n);
+    if (cpu_has_popcnt())
+        return popcount_popcnt(p, n);
+#endif
+    return popcount_generic(p, n);
+}
+
+void bit_combine(BitOp op, uint8_t *dst, const uint8_t *src, size_t n)
+{
+#ifdef BITOPS_HAVE_X86
+    if (cpu_has_avx2())
+        return combine_avx2(op, dst, src, n);
+#endif
+    combine_generic(op, dst, src, n, 0);
+}
+
+void bit_not(uint8_t *dst, size_t n)
+{
+#ifdef BITOPS_HAVE_X86
+    if (cpu_has_avx2())
+        return not_avx2(dst, n);
+#endif
+    not_generic(dst, n, 0);
+}
+
+size_t bit_find_byte(const uint8_t *p, size_t n, uint8_t skip)
+{
+#ifdef BITOPS_HAVE_X86
+    if (cpu_has_avx2())
+        return find_byte_avx2(p, n, skip);
+#endif
+    size_t i = 0;
+    uint64_t word = skip * 0x0101010101010101ULL;
+    for (; i + 8 <= n; i += 8)
+        if (load64(p + i) != word)
+            break;
+    for (; i < n; i++)
+        if (p[i] != skip)
+            return i;
+    return n;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*位图运算的底层实现，位图按字节存放在字符串中，每个字节的最高位为该字节的第0位*/
+
+// BITOP的运算类型
+enum class BitOp
+{
+    AND,
+    OR,
+    XOR,
+    NOT
+};
+
+// 统计n字节中置1的位数
+// 支持AVX2时使用查表的向量化实现，支持POPCNT时逐8字节计数，否则使用通用实现(均为运行时检测)
+uint64_t bit_popcount(const uint8_t *p, size_t n);
+
+// dst = dst op src，op不能为NOT
+void bit_combine(BitOp op, uint8_t *dst, const uint8_t *src, size_t n);
+
+// dst = ~dst
+void bit_not(uint8_t *dst, size_t n);
+
+// 第一个不等于skip的字节的下标，全部等于skip时返回n
+// 查找1时skip为0x00，查找0时skip为0xFF
+size_t bit_find_byte(const uint8_t *p, size_t n, uint8_t skip);
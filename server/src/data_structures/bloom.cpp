@@ -0,0 +1,169 @@
+#include "bloom.h"
+#include "../utils/utils.h"
+#include <math.h>
+#include <stdexcept>
+#include <algorithm>
+
+BloomConfig bloom_config;
+
+// 每个64位的哈希值可以切出的块内位置数(每个位置9位)
+static const uint32_t k_bloom_pos_per_word = 7;
+
+// splitmix64的混合函数，用于从同一个哈希值派生出新的哈希值
+static inline uint64_t bloom_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/// @brief 块内的第i个位置：从派生的哈希值中依次切出9位，用完后再次混合
+///        若用a + i*b的双重哈希，块内只有约13万种不同的位组合，低误判率时会成为瓶颈
+static inline uint32_t bloom_pos(uint64_t &x, uint32_t i)
+{
+    uint32_t slot = i % k_bloom_pos_per_word;
+    if (i && slot == 0)
+        x = bloom_mix(x);
+    return (x >> (9 * slot)) & (k_bloom_block_bits - 1);
+}
+
+/// @brief 分块布隆过滤器的误判率：每块的元素数服从均值为per_block的泊松分布，
+///        块内有i个元素时的误判率为 (1 - (1 - 1/512)^(k*i))^k，按分布加权求和
+static double blocked_fpr(double per_block, uint32_t k)
+{
+    double fpr = 0, prob = exp(-per_block);
+    int upper = (int)(per_block + 10 * sqrt(per_block) + 20);
+    for (int i = 0; i < upper; i++)
+    {
+        fpr += prob * pow(1 - pow(1 - 1.0 / k_bloom_block_bits, (double)k * i), k);
+        prob *= per_block / (i + 1);
+    }
+    return fpr;
+}
+
+/// @brief 块内元素数不均匀，误判率明显高于同样大小的标准布隆过滤器，
+///        从标准的最优位数出发逐步增加空间，直到按分块模型估计的误判率不超过目标；
+///        位数与k都有上限，误判率过低时按上限构建(调用者应先拒绝低于k_bloom_min_error_rate的误判率)
+void BloomFilter::bf_init(uint64_t capacity_, double error_rate_)
+{
+    capacity = capacity_;
+    error_rate = error_rate_;
+    // 标准布隆过滤器每个元素的最优位数为 -ln(p)/ln2^2
+    double bits_per_item = std::min(-log(error_rate) / (M_LN2 * M_LN2), k_bloom_max_bits_per_item);
+    for (;;)
+    {
+        double per_block = k_bloom_block_bits / bits_per_item;
+        uint32_t best = std::min<uint32_t>(k_bloom_max_hashes, std::max(1.0, round(bits_per_item * M_LN2)));
+        double best_fpr = blocked_fpr(per_block, best);
+        // 最优的k比标准情况略小
+        for (uint32_t cand = best - 1; cand >= 1; cand--)
+        {
+            double f = blocked_fpr(per_block, cand);
+            if (f >= best_fpr)
+                break;
+            best = cand;
+            best_fpr = f;
+        }
+        k = best;
+        if (best_fpr <= error_rate || bits_per_item >= k_bloom_max_bits_per_item)
+            break;
+        bits_per_item = std::min(bits_per_item * 1.02, k_bloom_max_bits_per_item);
+    }
+    // 先用浮点数检查块数，避免转换为整数时溢出
+    double nblocks = ceil((double)capacity * bits_per_item / k_bloom_block_bits);
+    if (!(nblocks < (double)blocks.max_size()))
+        throw std::invalid_argument("布隆过滤器所需空间过大");
+    blocks.assign(std::max<uint64_t>((uint64_t)nblocks, 1), BloomBlock{});
+    count = 0;
+}
+
+// 用哈希值的高位(乘法取高64位)选择块，不要求块数为2的幂
+uint64_t BloomFilter::bf_index(uint64_t h) const
+{
+    return (uint64_t)(((unsigned __int128)h * blocks.size()) >> 64);
+}
+
+bool BloomFilter::bf_add(uint64_t h)
+{
+    BloomBlock &block = blocks[bf_index(h)];
+    uint64_t x = bloom_mix(h);
+    bool changed = false;
+    for (uint32_t i = 0; i < k; i++)
+    {
+        uint32_t pos = bloom_pos(x, i);
+        uint64_t mask = 1ULL << (pos & 63);
+        uint64_t &w = block.words[pos >> 6];
+        changed |= !(w & mask);
+        w |= mask;
+    }
+    if (changed)
+        count++;
+    return changed;
+}
+
+bool BloomFilter::bf_exists(uint64_t h) const
+{
+    const BloomBlock &block = blocks[bf_index(h)];
+    uint64_t x = bloom_mix(h);
+    for (uint32_t i = 0; i < k; i++)
+    {
+        uint32_t pos = bloom_pos(x, i);
+        if (!(block.words[pos >> 6] & (1ULL << (pos & 63))))
+            return false;
+    }
+    return true;
+}
+
+void BloomFilter::bf_prefetch(uint64_t h) const
+{
+    __builtin_prefetch(&blocks[bf_index(h)]);
+}
+
+uint64_t BloomFilter::bf_hash(std::string_view item)
+{
+    return hash64(item.data(), item.size());
+}
+
+void bloom_free(BloomNode *b)
+{
+    delete b;
+}
+
+Bloom::Bloom(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+BloomNode *Bloom::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::BLOOM);
+    return obj ? container_of(obj, BloomNode, obj) : nullptr;
+}
+
+BloomNode *Bloom::create(HMap &hmap, uint64_t capacity, double error_rate)
+{
+    if (hmap.hm_lookup(&probe_.node, &obj_equals))
+        throw std::invalid_argument("键已存在");
+    BloomNode *b = new BloomNode();
+    try
+    {
+        b->bf.bf_init(capacity, error_rate);
+    }
+    catch (...)
+    {
+        delete b;
+        throw;
+    }
+    obj_insert(hmap, &b->obj, &probe_);
+    return b;
+}
+
+BloomNode *Bloom::find_or_create(HMap &hmap)
+{
+    BloomNode *b = find(hmap);
+    return b ? b : create(hmap, bloom_config.capacity, bloom_config.error_rate);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include "./hashTable.h"
+#include "./object.h"
+
+/*分块布隆过滤器：每个元素的全部k位都落在同一个64字节(一条缓存行)的块中，查询只访问一次内存*/
+// 块下标与块内的k个位置均由同一个64位哈希导出
+
+// 一个块，按缓存行对齐
+struct alignas(64) BloomBlock
+{
+    uint64_t words[8];
+};
+
+const uint32_t k_bloom_block_bits = sizeof(BloomBlock) * 8;
+
+// 支持的最小误判率：1e-15时每个元素约需318位、k为32，更低时所需的位数急剧增长，按分块模型求解也越来越慢
+const double k_bloom_min_error_rate = 1e-15;
+// 每个元素最多设置的位数
+const uint32_t k_bloom_max_hashes = 64;
+// 每个元素最多占用的位数(一个元素独占一个块)
+const double k_bloom_max_bits_per_item = k_bloom_block_bits;
+
+// 未指定参数时(BF.ADD/BF.MADD自动创建)使用的误判率与容量
+struct BloomConfig
+{
+    double error_rate = 0.01;
+    uint64_t capacity = 100000;
+};
+
+extern BloomConfig bloom_config;
+
+class BloomFilter
+{
+private:
+    std::vector<BloomBlock> blocks;
+    uint32_t k = 0;         // 每个元素设置的位数
+    uint64_t capacity = 0;  // 创建时指定的容量
+    double error_rate = 0;  // 创建时指定的误判率
+    uint64_t count = 0;     // 添加成功(至少一位由0变为1)的元素个数
+
+protected:
+    // 哈希值对应的块的下标
+    uint64_t bf_index(uint64_t h) const;
+
+public:
+    // 按容量与误判率确定块数与k，容量与误判率此后不再改变；所需空间超出可分配的范围时抛出异常
+    void bf_init(uint64_t capacity, double error_rate);
+
+    // 添加元素的哈希值，有位由0变为1时返回true
+    bool bf_add(uint64_t h);
+
+    // 元素可能存在时返回true
+    bool bf_exists(uint64_t h) const;
+
+    // 预取哈希值对应的块，批量查询时先全部预取再逐个检查
+    void bf_prefetch(uint64_t h) const;
+
+    uint64_t bf_capacity() const { return capacity; }
+    double bf_error_rate() const { return error_rate; }
+    uint64_t bf_count() const { return count; }
+    size_t bf_bytes() const { return blocks.size() * sizeof(BloomBlock); }
+
+    // 元素的64位哈希
+    static uint64_t bf_hash(std::string_view item);
+};
+
+// 顶级哈希表中的布隆过滤器对象
+struct BloomNode
+{
+    Object obj{ObjType::BLOOM};
+    BloomFilter bf;
+};
+
+void bloom_free(BloomNode *b);
+
+// 管理顶级哈希表中的BloomNode
+class Bloom
+{
+private:
+    Object probe_{ObjType::BLOOM};
+
+public:
+    Bloom(const std::string &key);
+
+    // 查找过滤器，不存在返回nullptr，键存在但不是布隆过滤器时抛出异常
+    BloomNode *find(HMap &hmap);
+
+    // 创建过滤器，键已存在时抛出异常
+    BloomNode *create(HMap &hmap, uint64_t capacity, double error_rate);
+
+    // 查找过滤器，不存在时按默认参数创建
+    BloomNode *find_or_create(HMap &hmap);
+};
@@ -0,0 +1,595 @@
+#include "btree.h"
+
+// (score, name)比较，与avl树的less保持一致：分数相同时按成员名排序
+static bool key_less(double s1, const std::string *n1, double s2, const std::string *n2)
+{
+    if (s1 == s2)
+        return *n1 < *n2;
+    return s1 < s2;
+}
+
+static bool key_equal(double s1, const std::string *n1, double s2, const std::string *n2)
+{
+    return s1 == s2 && *n1 == *n2;
+}
+
+static BTLeaf *new_leaf()
+{
+    BTLeaf *leaf = new BTLeaf();
+    leaf->hdr.leaf = true;
+    leaf->hdr.n = 0;
+    leaf->prev = nullptr;
+    leaf->next = nullptr;
+    return leaf;
+}
+
+static BTInner *new_inner()
+{
+    BTInner *inner = new BTInner();
+    inner->hdr.leaf = false;
+    inner->hdr.n = 0;
+    return inner;
+}
+
+// 在叶子的pos处插入一个元素
+static void leaf_insert_at(BTLeaf *leaf, uint32_t pos, double score, const std::string *name, void *val)
+{
+    for (uint32_t i = leaf->hdr.n; i > pos; i--)
+    {
+        leaf->scores[i] = leaf->scores[i - 1];
+        leaf->names[i] = leaf->names[i - 1];
+        leaf->vals[i] = leaf->vals[i - 1];
+    }
+    leaf->scores[pos] = score;
+    leaf->names[pos] = name;
+    leaf->vals[pos] = val;
+    leaf->hdr.n++;
+}
+
+static void leaf_remove_at(BTLeaf *leaf, uint32_t pos)
+{
+    for (uint32_t i = pos + 1; i < leaf->hdr.n; i++)
+    {
+        leaf->scores[i - 1] = leaf->scores[i];
+        leaf->names[i - 1] = leaf->names[i];
+        leaf->vals[i - 1] = leaf->vals[i];
+    }
+    leaf->hdr.n--;
+}
+
+// 将src中[from, src.n)的元素追加到dst末尾
+static void leaf_move_tail(BTLeaf *dst, BTLeaf *src, uint32_t from)
+{
+    for (uint32_t i = from; i < src->hdr.n; i++)
+    {
+        dst->scores[dst->hdr.n] = src->scores[i];
+        dst->names[dst->hdr.n] = src->names[i];
+        dst->vals[dst->hdr.n] = src->vals[i];
+        dst->hdr.n++;
+    }
+    src->hdr.n = from;
+}
+
+static void inner_remove_at(BTInner *inner, uint32_t pos)
+{
+    for (uint32_t i = pos + 1; i < inner->hdr.n; i++)
+    {
+        inner->scores[i - 1] = inner->scores[i];
+        inner->names[i - 1] = inner->names[i];
+        inner->cnt[i - 1] = inner->cnt[i];
+        inner->child[i - 1] = inner->child[i];
+    }
+    inner->hdr.n--;
+}
+
+static void inner_move_tail(BTInner *dst, BTInner *src, uint32_t from)
+{
+    for (uint32_t i = from; i < src->hdr.n; i++)
+    {
+        dst->scores[dst->hdr.n] = src->scores[i];
+        dst->names[dst->hdr.n] = src->names[i];
+        dst->cnt[dst->hdr.n] = src->cnt[i];
+        dst->child[dst->hdr.n] = src->child[i];
+        dst->hdr.n++;
+    }
+    src->hdr.n = from;
+}
+
+BPTree::BPTree()
+{
+    root = nullptr;
+    size = 0;
+}
+
+BPTree::~BPTree()
+{
+    bt_clean_up();
+}
+
+void BPTree::bt_insert(double score, const std::string *name, void *val)
+{
+    if (!root)
+        root = &new_leaf()->hdr;
+
+    BTNode *right = bt_insert_rec(root, score, name, val);
+    // 根节点分裂，树高加一
+    if (right)
+    {
+        BTInner *new_root = new_inner();
+        new_root->hdr.n = 2;
+        new_root->child[0] = root;
+        new_root->child[1] = right;
+        new_root->cnt[0] = bt_cnt(root);
+        new_root->cnt[1] = bt_cnt(right);
+        bt_refresh_key(new_root, 0);
+        bt_refresh_key(new_root, 1);
+        root = &new_root->hdr;
+    }
+    size++;
+}
+
+bool BPTree::bt_delete(double score, const std::string *name)
+{
+    if (!root || !bt_delete_rec(root, score, name))
+        return false;
+    size--;
+
+    // 根节点为空叶子或只剩一个孩子时降低树高
+    if (root->leaf && root->n == 0)
+    {
+        delete reinterpret_cast<BTLeaf *>(root);
+        root = nullptr;
+    }
+    else if (!root->leaf && root->n == 1)
+    {
+        BTInner *old_root = reinterpret_cast<BTInner *>(root);
+        root = old_root->child[0];
+        delete old_root;
+    }
+    return true;
+}
+
+/// @brief 自上而下累加目标所在孩子之前所有孩子的子树元素数
+/// @return 元素排名(从1开始)，不存在返回0
+int BPTree::bt_rank(double score, const std::string *name)
+{
+    BTNode *node = root;
+    if (!node)
+        return 0;
+    int rank = 0;
+    while (!node->leaf)
+    {
+        BTInner *inner = reinterpret_cast<BTInner *>(node);
+        uint32_t i = bt_upper(inner->scores, inner->names, inner->hdr.n, score, name);
+        i = i ? i - 1 : 0;
+        for (uint32_t k = 0; k < i; k++)
+            rank += inner->cnt[k];
+        node = inner->child[i];
+    }
+    BTLeaf *leaf = reinterpret_cast<BTLeaf *>(node);
+    uint32_t pos = bt_upper(leaf->scores, leaf->names, leaf->hdr.n, score, name);
+    if (pos == 0 || !key_equal(leaf->scores[pos - 1], leaf->names[pos - 1], score, name))
+        return 0;
+    return rank + pos;
+}
+
+/// @brief 内部节点中孩子i+1的最小分数满足条件时，孩子i整棵子树都满足，直接累加子树计数
+uint32_t BPTree::bt_count_below(double score, bool inclusive)
+{
+    auto below = [score, inclusive](double s)
+    { return inclusive ? s <= score : s < score; };
+    BTNode *node = root;
+    if (!node)
+        return 0;
+    uint32_t count = 0;
+    while (!node->leaf)
+    {
+        BTInner *inner = reinterpret_cast<BTInner *>(node);
+        uint32_t i = 0;
+        while (i + 1 < inner->hdr.n && below(inner->scores[i + 1]))
+            count += inner->cnt[i++];
+        node = inner->child[i];
+    }
+    BTLeaf *leaf = reinterpret_cast<BTLeaf *>(node);
+    for (uint32_t i = 0; i < leaf->hdr.n && below(leaf->scores[i]); i++)
+        count++;
+    return count;
+}
+
+/// @brief 获取排名在[min_rank,max_rank]中的所有元素
+/// 先按子树计数O(logN)定位起始叶子，再沿叶子链表顺序扫描
+void BPTree::bt_range_by_rank(int min_rank, int max_rank, std::vector<void *> &results)
+{
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > (int)size)
+        max_rank = size;
+    if (!root || min_rank > max_rank)
+        return;
+
+    results.reserve(results.size() + (max_rank - min_rank + 1));
+    uint32_t idx = 0;
+    BTLeaf *leaf = bt_locate(min_rank, idx);
+    for (int rank = min_rank; leaf && rank <= max_rank; rank++)
+    {
+        results.push_back(leaf->vals[idx]);
+        if (++idx == leaf->hdr.n)
+        {
+            leaf = leaf->next;
+            idx = 0;
+        }
+    }
+}
+
+void BPTree::bt_rev_range_by_rank(int min_rank, int max_rank, std::vector<void *> &results)
+{
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > (int)size)
+        max_rank = size;
+    if (!root || min_rank > max_rank)
+        return;
+
+    results.reserve(results.size() + (max_rank - min_rank + 1));
+    uint32_t idx = 0;
+    // 逆序排名r对应正序排名size-r+1
+    BTLeaf *leaf = bt_locate(size - min_rank + 1, idx);
+    for (int rank = min_rank; leaf && rank <= max_rank; rank++)
+    {
+        results.push_back(leaf->vals[idx]);
+        if (idx == 0)
+        {
+            leaf = leaf->prev;
+            idx = leaf ? leaf->hdr.n - 1 : 0;
+        }
+        else
+            idx--;
+    }
+}
+
+void BPTree::bt_inorder(std::vector<void *> &results)
+{
+    BTNode *node = root;
+    if (!node)
+        return;
+    while (!node->leaf)
+        node = reinterpret_cast<BTInner *>(node)->child[0];
+
+    results.reserve(results.size() + size);
+    for (BTLeaf *leaf = reinterpret_cast<BTLeaf *>(node); leaf; leaf = leaf->next)
+        results.insert(results.end(), leaf->vals, leaf->vals + leaf->hdr.n);
+}
+
+/// @brief 先将元素均匀铺满叶子，再逐层向上均匀分组生成内部节点
+/// 每层节点数取最少所需个数，均分后非根节点的填充量不低于k_bt_min
+void BPTree::bt_build(const std::vector<BTItem> &sorted)
+{
+    if (sorted.empty())
+        return;
+
+    std::vector<BTNode *> level;
+    uint32_t total = sorted.size();
+    uint32_t nodes = (total + k_bt_cap - 1) / k_bt_cap;
+    uint32_t pos = 0;
+    BTLeaf *prev = nullptr;
+    for (uint32_t i = 0; i < nodes; i++)
+    {
+        BTLeaf *leaf = new_leaf();
+        // 前total%nodes个节点多分一个
+        uint32_t take = total / nodes + (i < total % nodes ? 1 : 0);
+        for (uint32_t k = 0; k < take; k++, pos++)
+            leaf_insert_at(leaf, k, sorted[pos].score, sorted[pos].name, sorted[pos].val);
+        leaf->prev = prev;
+        if (prev)
+            prev->next = leaf;
+        prev = leaf;
+        level.push_back(&leaf->hdr);
+    }
+
+    while (level.size() > 1)
+    {
+        std::vector<BTNode *> upper;
+        uint32_t cnt = level.size();
+        nodes = (cnt + k_bt_cap - 1) / k_bt_cap;
+        pos = 0;
+        for (uint32_t i = 0; i < nodes; i++)
+        {
+            BTInner *inner = new_inner();
+            uint32_t take = cnt / nodes + (i < cnt % nodes ? 1 : 0);
+            for (uint32_t k = 0; k < take; k++, pos++)
+            {
+                inner->child[k] = level[pos];
+                inner->cnt[k] = bt_cnt(level[pos]);
+                inner->hdr.n++;
+                bt_refresh_key(inner, k);
+            }
+            upper.push_back(&inner->hdr);
+        }
+        level.swap(upper);
+    }
+    root = level[0];
+    size = total;
+}
+
+void BPTree::bt_clean_up()
+{
+    bt_free(root);
+    root = nullptr;
+    size = 0;
+}
+
+BTNode *BPTree::bt_insert_rec(BTNode *node, double score, const std::string *name, void *val)
+{
+    if (node->leaf)
+    {
+        BTLeaf *leaf = reinterpret_cast<BTLeaf *>(node);
+        uint32_t pos = bt_upper(leaf->scores, leaf->names, leaf->hdr.n, score, name);
+        if (leaf->hdr.n < k_bt_cap)
+        {
+            leaf_insert_at(leaf, pos, score, name, val);
+            return nullptr;
+        }
+
+        // 叶子已满，对半分裂并挂入叶子链表
+        BTLeaf *right = new_leaf();
+        leaf_move_tail(right, leaf, k_bt_cap / 2);
+        right->next = leaf->next;
+        if (right->next)
+            right->next->prev = right;
+        right->prev = leaf;
+        leaf->next = right;
+
+        if (pos <= leaf->hdr.n)
+            leaf_insert_at(leaf, pos, score, name, val);
+        else
+            leaf_insert_at(right, pos - leaf->hdr.n, score, name, val);
+        return &right->hdr;
+    }
+
+    BTInner *inner = reinterpret_cast<BTInner *>(node);
+    uint32_t i = bt_upper(inner->scores, inner->names, inner->hdr.n, score, name);
+    i = i ? i - 1 : 0;
+
+    BTNode *split = bt_insert_rec(inner->child[i], score, name, val);
+    inner->cnt[i]++;
+    bt_refresh_key(inner, i);
+    if (!split)
+        return nullptr;
+
+    // 孩子分裂，将新的右兄弟插入到i+1处
+    inner->cnt[i] = bt_cnt(inner->child[i]);
+    uint32_t split_cnt = bt_cnt(split);
+    BTInner *target = inner;
+    BTInner *right = nullptr;
+    uint32_t pos = i + 1;
+    if (inner->hdr.n == k_bt_cap)
+    {
+        right = new_inner();
+        inner_move_tail(right, inner, k_bt_cap / 2);
+        if (pos > inner->hdr.n)
+        {
+            target = right;
+            pos -= inner->hdr.n;
+        }
+    }
+    for (uint32_t k = target->hdr.n; k > pos; k--)
+    {
+        target->scores[k] = target->scores[k - 1];
+        target->names[k] = target->names[k - 1];
+        target->cnt[k] = target->cnt[k - 1];
+        target->child[k] = target->child[k - 1];
+    }
+    target->child[pos] = split;
+    target->cnt[pos] = split_cnt;
+    target->hdr.n++;
+    bt_refresh_key(target, pos);
+    return right ? &right->hdr : nullptr;
+}
+
+bool BPTree::bt_delete_rec(BTNode *node, double score, const std::string *name)
+{
+    if (node->leaf)
+    {
+        BTLeaf *leaf = reinterpret_cast<BTLeaf *>(node);
+        uint32_t pos = bt_upper(leaf->scores, leaf->names, leaf->hdr.n, score, name);
+        if (pos == 0 || !key_equal(leaf->scores[pos - 1], leaf->names[pos - 1], score, name))
+            return false;
+        leaf_remove_at(leaf, pos - 1);
+        return true;
+    }
+
+    BTInner *inner = reinterpret_cast<BTInner *>(node);
+    uint32_t i = bt_upper(inner->scores, inner->names, inner->hdr.n, score, name);
+    i = i ? i - 1 : 0;
+    if (!bt_delete_rec(inner->child[i], score, name))
+        return false;
+
+    inner->cnt[i]--;
+    if (inner->child[i]->n < k_bt_min)
+        bt_fix_child(inner, i);
+    else
+        bt_refresh_key(inner, i);
+    return true;
+}
+
+void BPTree::bt_fix_child(BTInner *node, uint32_t i)
+{
+    BTNode *cur = node->child[i];
+    BTNode *left = i > 0 ? node->child[i - 1] : nullptr;
+    BTNode *right = i + 1 < node->hdr.n ? node->child[i + 1] : nullptr;
+
+    if (cur->leaf)
+    {
+        BTLeaf *c = reinterpret_cast<BTLeaf *>(cur);
+        BTLeaf *l = reinterpret_cast<BTLeaf *>(left);
+        BTLeaf *r = reinterpret_cast<BTLeaf *>(right);
+        if (l && l->hdr.n > k_bt_min)
+        {
+            // 向左兄弟借最后一个元素
+            uint32_t last = l->hdr.n - 1;
+            leaf_insert_at(c, 0, l->scores[last], l->names[last], l->vals[last]);
+            l->hdr.n--;
+            node->cnt[i - 1]--;
+            node->cnt[i]++;
+        }
+        else if (r && r->hdr.n > k_bt_min)
+        {
+            // 向右兄弟借第一个元素
+            leaf_insert_at(c, c->hdr.n, r->scores[0], r->names[0], r->vals[0]);
+            leaf_remove_at(r, 0);
+            node->cnt[i + 1]--;
+            node->cnt[i]++;
+            bt_refresh_key(node, i + 1);
+        }
+        else
+        {
+            // 与兄弟合并，统一合并到左边的节点
+            uint32_t li = l ? i - 1 : i;
+            BTLeaf *dst = l ? l : c;
+            BTLeaf *src = l ? c : r;
+            if (!src)
+                return;
+            leaf_move_tail(dst, src, 0);
+            dst->next = src->next;
+            if (dst->next)
+                dst->next->prev = dst;
+            node->cnt[li] += node->cnt[li + 1];
+            inner_remove_at(node, li + 1);
+            delete src;
+            bt_refresh_key(node, li);
+            return;
+        }
+        bt_refresh_key(node, i);
+        return;
+    }
+
+    BTInner *c = reinterpret_cast<BTInner *>(cur);
+    BTInner *l = reinterpret_cast<BTInner *>(left);
+    BTInner *r = reinterpret_cast<BTInner *>(right);
+    if (l && l->hdr.n > k_bt_min)
+    {
+        uint32_t last = l->hdr.n - 1;
+        uint32_t moved = l->cnt[last];
+        for (uint32_t k = c->hdr.n; k > 0; k--)
+        {
+            c->scores[k] = c->scores[k - 1];
+            c->names[k] = c->names[k - 1];
+            c->cnt[k] = c->cnt[k - 1];
+            c->child[k] = c->child[k - 1];
+        }
+        c->scores[0] = l->scores[last];
+        c->names[0] = l->names[last];
+        c->cnt[0] = moved;
+        c->child[0] = l->child[last];
+        c->hdr.n++;
+        l->hdr.n--;
+        node->cnt[i - 1] -= moved;
+        node->cnt[i] += moved;
+    }
+    else if (r && r->hdr.n > k_bt_min)
+    {
+        uint32_t moved = r->cnt[0];
+        c->scores[c->hdr.n] = r->scores[0];
+        c->names[c->hdr.n] = r->names[0];
+        c->cnt[c->hdr.n] = moved;
+        c->child[c->hdr.n] = r->child[0];
+        c->hdr.n++;
+        inner_remove_at(r, 0);
+        node->cnt[i + 1] -= moved;
+        node->cnt[i] += moved;
+        bt_refresh_key(node, i + 1);
+    }
+    else
+    {
+        uint32_t li = l ? i - 1 : i;
+        BTInner *dst = l ? l : c;
+        BTInner *src = l ? c : r;
+        if (!src)
+            return;
+        inner_move_tail(dst, src, 0);
+        node->cnt[li] += node->cnt[li + 1];
+        inner_remove_at(node, li + 1);
+        delete src;
+        bt_refresh_key(node, li);
+        return;
+    }
+    bt_refresh_key(node, i);
+}
+
+/// @brief 根据排名定位叶子
+/// @param rank 排名(从1开始)，调用者保证在范围内
+/// @param idx 返回元素在叶子中的下标
+BTLeaf *BPTree::bt_locate(uint32_t rank, uint32_t &idx)
+{
+    BTNode *node = root;
+    uint32_t remain = rank - 1;
+    while (!node->leaf)
+    {
+        BTInner *inner = reinterpret_cast<BTInner *>(node);
+        uint32_t i = 0;
+        while (i + 1 < inner->hdr.n && remain >= inner->cnt[i])
+            remain -= inner->cnt[i++];
+        node = inner->child[i];
+    }
+    idx = remain;
+    return reinterpret_cast<BTLeaf *>(node);
+}
+
+uint32_t BPTree::bt_cnt(BTNode *node)
+{
+    if (!node)
+        return 0;
+    if (node->leaf)
+        return node->n;
+    BTInner *inner = reinterpret_cast<BTInner *>(node);
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < inner->hdr.n; i++)
+        total += inner->cnt[i];
+    return total;
+}
+
+void BPTree::bt_refresh_key(BTInner *node, uint32_t i)
+{
+    BTNode *c = node->child[i];
+    if (c->leaf)
+    {
+        node->scores[i] = reinterpret_cast<BTLeaf *>(c)->scores[0];
+        node->names[i] = reinterpret_cast<BTLeaf *>(c)->names[0];
+    }
+    else
+    {
+        node->scores[i] = reinterpret_cast<BTInner *>(c)->scores[0];
+        node->names[i] = reinterpret_cast<BTInner *>(c)->names[0];
+    }
+}
+
+/// @brief 二分查找，分数连续存放，只有分数相同时才访问成员名
+/// @return 第一个大于(score, name)的下标
+uint32_t BPTree::bt_upper(const double *scores, const std::string *const *names, uint32_t n, double score, const std::string *name)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (key_less(score, name, scores[mid], names[mid]))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+void BPTree::bt_free(BTNode *node)
+{
+    if (!node)
+        return;
+    if (node->leaf)
+    {
+        delete reinterpret_cast<BTLeaf *>(node);
+        return;
+    }
+    BTInner *inner = reinterpret_cast<BTInner *>(node);
+    for (uint32_t i = 0; i < inner->hdr.n; i++)
+        bt_free(inner->child[i]);
+    delete inner;
+}
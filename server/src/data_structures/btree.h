@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 每个节点最多容纳的元素数(叶子)或孩子数(内部节点)
+const uint32_t k_bt_cap = 32;
+// 非根节点的最少元素数/孩子数，低于该值时向兄弟借或与兄弟合并
+const uint32_t k_bt_min = k_bt_cap / 2;
+
+// B+树节点公共部分
+struct BTNode
+{
+    bool leaf;  // 是否为叶子节点
+    uint32_t n; // 叶子：元素数  内部节点：孩子数
+};
+
+// 叶子节点：分数连续存放，顺序扫描时不需要逐个追指针
+struct BTLeaf
+{
+    BTNode hdr;
+    double scores[k_bt_cap];
+    const std::string *names[k_bt_cap]; // 分数相同时用于比较的成员名，指向实际数据结构中的字段
+    void *vals[k_bt_cap];               // 实际数据结构指针
+    BTLeaf *prev;
+    BTLeaf *next;
+};
+
+// 内部节点：scores[i]/names[i]为孩子i子树中的最小键，cnt[i]为孩子i子树元素数
+struct BTInner
+{
+    BTNode hdr;
+    double scores[k_bt_cap];
+    const std::string *names[k_bt_cap];
+    uint32_t cnt[k_bt_cap];
+    BTNode *child[k_bt_cap];
+};
+
+// 批量构建时的元素
+struct BTItem
+{
+    double score;
+    const std::string *name;
+    void *val;
+};
+
+// 带子树计数的B+树(顺序统计树)，按(score, name)排序
+// 与AVLTree不同，树中只保存指向实际数据的指针，节点由树自己管理
+class BPTree
+{
+private:
+    BTNode *root;
+    uint32_t size;
+
+protected:
+    // 递归插入，节点分裂时返回新的右兄弟，否则返回nullptr
+    BTNode *bt_insert_rec(BTNode *node, double score, const std::string *name, void *val);
+
+    // 递归删除，返回是否删除成功
+    bool bt_delete_rec(BTNode *node, double score, const std::string *name);
+
+    // 孩子i元素不足时，向兄弟借元素或与兄弟合并
+    void bt_fix_child(BTInner *node, uint32_t i);
+
+    // 根据排名定位叶子及其中的下标
+    BTLeaf *bt_locate(uint32_t rank, uint32_t &idx);
+
+    // 子树元素数
+    static uint32_t bt_cnt(BTNode *node);
+
+    // 刷新内部节点中孩子i的最小键
+    static void bt_refresh_key(BTInner *node, uint32_t i);
+
+    // 第一个大于key的下标
+    static uint32_t bt_upper(const double *scores, const std::string *const *names, uint32_t n, double score, const std::string *name);
+
+    void bt_free(BTNode *node);
+
+public:
+    BPTree();
+    ~BPTree();
+
+    BPTree(const BPTree &) = delete;
+    BPTree &operator=(const BPTree &) = delete;
+
+    // 插入，调用者保证(score, name)不存在(搭配哈希表使用)
+    void bt_insert(double score, const std::string *name, void *val);
+
+    // 删除(score, name)对应的元素
+    bool bt_delete(double score, const std::string *name);
+
+    // 返回元素排名(从1开始)，不存在返回0
+    int bt_rank(double score, const std::string *name);
+
+    // 分数小于score(inclusive时小于等于)的元素个数，用于按分数定位排名
+    uint32_t bt_count_below(double score, bool inclusive);
+
+    void bt_range_by_rank(int min_rank, int max_rank, std::vector<void *> &results);
+
+    // 逆序获取排名范围内的元素，排名从最大元素开始计为1
+    void bt_rev_range_by_rank(int min_rank, int max_rank, std::vector<void *> &results);
+
+    void bt_inorder(std::vector<void *> &results);
+
+    // 由已排序的元素自底向上批量构建，要求当前树为空，复杂度O(N)
+    void bt_build(const std::vector<BTItem> &sorted);
+
+    uint32_t bt_size() { return size; }
+
+    // 释放所有节点，不释放实际数据
+    void bt_clean_up();
+};
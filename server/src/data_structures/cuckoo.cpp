@@ -0,0 +1,175 @@
+#include "cuckoo.h"
+#include "../utils/utils.h"
+#include <stdexcept>
+
+CuckooConfig cuckoo_config;
+
+// 每个16位槽位的最低位与最高位
+static const uint64_t k_lanes_low = 0x0001000100010001ULL;
+static const uint64_t k_lanes_high = 0x8000800080008000ULL;
+
+// 桶中值为fp的槽位的掩码(每个匹配槽位的最高位置1)，fp为0时即空槽位
+static inline uint64_t bucket_match(uint64_t bucket, uint16_t fp)
+{
+    uint64_t x = bucket ^ (k_lanes_low * fp);
+    return (x - k_lanes_low) & ~x & k_lanes_high;
+}
+
+uint16_t CuckooFilter::cf_fingerprint(uint64_t h)
+{
+    uint16_t fp = h >> 48;
+    return fp ? fp : 1;
+}
+
+uint64_t CuckooFilter::cf_index(uint64_t h) const
+{
+    return h & mask;
+}
+
+uint64_t CuckooFilter::cf_alt_index(uint64_t idx, uint16_t fp) const
+{
+    return (idx ^ (fp * 0x5bd1e995ULL)) & mask;
+}
+
+bool CuckooFilter::cf_insert_slot(uint64_t idx, uint16_t fp)
+{
+    uint64_t empty = bucket_match(buckets[idx], 0);
+    if (!empty)
+        return false;
+    int shift = __builtin_ctzll(empty) - 15;
+    buckets[idx] |= (uint64_t)fp << shift;
+    return true;
+}
+
+/// @brief 桶数取2的幂，保证装载率不超过95%
+void CuckooFilter::cf_init(uint64_t capacity_)
+{
+    capacity = capacity_;
+    uint64_t n = 1;
+    while (n * k_cf_bucket_slots * 95 < capacity * 100)
+        n <<= 1;
+    buckets.assign(n, 0);
+    mask = n - 1;
+    count = 0;
+    has_victim = false;
+}
+
+bool CuckooFilter::cf_add(uint64_t h)
+{
+    if (has_victim)
+        return false;
+    uint16_t fp = cf_fingerprint(h);
+    uint64_t i1 = cf_index(h), i2 = cf_alt_index(i1, fp);
+    if (cf_insert_slot(i1, fp) || cf_insert_slot(i2, fp))
+    {
+        count++;
+        return true;
+    }
+
+    // 两个桶都满时随机踢出一个指纹，被踢出的指纹移到它的另一个桶
+    uint64_t idx = (rng & 1) ? i1 : i2;
+    for (uint32_t n = 0; n < cuckoo_config.max_kicks; n++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        int shift = (rng % k_cf_bucket_slots) * 16;
+        uint16_t old = buckets[idx] >> shift;
+        buckets[idx] = (buckets[idx] & ~(0xFFFFULL << shift)) | ((uint64_t)fp << shift);
+        fp = old;
+        idx = cf_alt_index(idx, fp);
+        if (cf_insert_slot(idx, fp))
+        {
+            count++;
+            return true;
+        }
+    }
+    // 新指纹已经放入，最后被踢出的指纹暂存，不会产生误判为不存在的情况
+    has_victim = true;
+    victim_fp = fp;
+    victim_idx = idx;
+    count++;
+    return true;
+}
+
+bool CuckooFilter::cf_exists(uint64_t h) const
+{
+    uint16_t fp = cf_fingerprint(h);
+    uint64_t i1 = cf_index(h), i2 = cf_alt_index(i1, fp);
+    if (bucket_match(buckets[i1], fp) || bucket_match(buckets[i2], fp))
+        return true;
+    return has_victim && victim_fp == fp && (victim_idx == i1 || victim_idx == i2);
+}
+
+bool CuckooFilter::cf_del(uint64_t h)
+{
+    uint16_t fp = cf_fingerprint(h);
+    uint64_t i1 = cf_index(h), i2 = cf_alt_index(i1, fp);
+    if (has_victim && victim_fp == fp && (victim_idx == i1 || victim_idx == i2))
+    {
+        has_victim = false;
+        count--;
+        return true;
+    }
+    for (uint64_t idx : {i1, i2})
+    {
+        uint64_t m = bucket_match(buckets[idx], fp);
+        if (m)
+        {
+            int shift = __builtin_ctzll(m) - 15;
+            buckets[idx] &= ~(0xFFFFULL << shift);
+            count--;
+            // 腾出了空位，暂存的指纹可以放回
+            if (has_victim && (cf_insert_slot(victim_idx, victim_fp) ||
+                               cf_insert_slot(cf_alt_index(victim_idx, victim_fp), victim_fp)))
+                has_victim = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CuckooFilter::cf_prefetch(uint64_t h) const
+{
+    uint64_t i1 = cf_index(h);
+    __builtin_prefetch(&buckets[i1]);
+    __builtin_prefetch(&buckets[cf_alt_index(i1, cf_fingerprint(h))]);
+}
+
+uint64_t CuckooFilter::cf_hash(std::string_view item)
+{
+    return hash64(item.data(), item.size());
+}
+
+void cuckoo_free(CuckooNode *c)
+{
+    delete c;
+}
+
+Cuckoo::Cuckoo(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+CuckooNode *Cuckoo::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::CUCKOO);
+    return obj ? container_of(obj, CuckooNode, obj) : nullptr;
+}
+
+CuckooNode *Cuckoo::create(HMap &hmap, uint64_t capacity)
+{
+    if (hmap.hm_lookup(&probe_.node, &obj_equals))
+        throw std::invalid_argument("键已存在");
+    CuckooNode *c = new CuckooNode();
+    c->cf.cf_init(capacity);
+    obj_insert(hmap, &c->obj, &probe_);
+    return c;
+}
+
+CuckooNode *Cuckoo::find_or_create(HMap &hmap)
+{
+    CuckooNode *c = find(hmap);
+    return c ? c : create(hmap, cuckoo_config.capacity);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include "./hashTable.h"
+#include "./object.h"
+
+/*布谷鸟过滤器：每个桶4个16位指纹，恰好是一个uint64，桶内查找用一次位运算完成*/
+// 元素的两个候选桶为i1与i1 ^ hash(fp)，由任一桶和指纹都能算出另一个桶，因此支持删除
+// 误判率约为 2*4/2^16 ≈ 0.012%
+
+const uint32_t k_cf_bucket_slots = 4;
+
+// 未指定容量时(CF.ADD自动创建)使用的容量
+struct CuckooConfig
+{
+    uint64_t capacity = 100000;
+    uint32_t max_kicks = 500; // 插入时最多踢出的次数
+};
+
+extern CuckooConfig cuckoo_config;
+
+class CuckooFilter
+{
+private:
+    std::vector<uint64_t> buckets; // 桶的个数为2的幂，指纹为0表示空位
+    uint64_t mask = 0;
+    uint64_t capacity = 0;
+    uint64_t count = 0;
+    // 踢出次数用尽后无处安放的指纹暂存于此，此时过滤器视为已满
+    bool has_victim = false;
+    uint16_t victim_fp = 0;
+    uint64_t victim_idx = 0;
+    uint64_t rng = 0x2545F4914F6CDD1DULL; // 选择被踢出位置的随机数状态
+
+protected:
+    static uint16_t cf_fingerprint(uint64_t h);
+    uint64_t cf_index(uint64_t h) const;
+    uint64_t cf_alt_index(uint64_t idx, uint16_t fp) const;
+    // 在桶中放入指纹，桶已满返回false
+    bool cf_insert_slot(uint64_t idx, uint16_t fp);
+
+public:
+    void cf_init(uint64_t capacity);
+
+    // 添加元素的哈希值(允许重复)，过滤器已满返回false
+    bool cf_add(uint64_t h);
+
+    bool cf_exists(uint64_t h) const;
+
+    // 删除一个指纹，只应删除确实添加过的元素，否则可能误删其他元素
+    bool cf_del(uint64_t h);
+
+    // 预取哈希值对应的两个桶
+    void cf_prefetch(uint64_t h) const;
+
+    uint64_t cf_capacity() const { return capacity; }
+    uint64_t cf_count() const { return count; }
+    size_t cf_bytes() const { return buckets.size() * sizeof(uint64_t); }
+
+    // 元素的64位哈希
+    static uint64_t cf_hash(std::string_view item);
+};
+
+// 顶级哈希表中的布谷鸟过滤器对象
+struct CuckooNode
+{
+    Object obj{ObjType::CUCKOO};
+    CuckooFilter cf;
+};
+
+void cuckoo_free(CuckooNode *c);
+
+// 管理顶级哈希表中的CuckooNode
+class Cuckoo
+{
+private:
+    Object probe_{ObjType::CUCKOO};
+
+public:
+    Cuckoo(const std::string &key);
+
+    // 查找过滤器，不存在返回nullptr，键存在但不是布谷鸟过滤器时抛出异常
+    CuckooNode *find(HMap &hmap);
+
+    // 创建过滤器，键已存在时抛出异常
+    CuckooNode *create(HMap &hmap, uint64_t capacity);
+
+    // 查找过滤器，不存在时按默认容量创建
+    CuckooNode *find_or_create(HMap &hmap);
+};
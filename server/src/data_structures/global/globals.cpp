@@ -0,0 +1,32 @@
+#include "globals.h"
+
+std::unordered_map<std::string, std::deque<int>> blocking_keys;
+std::vector<std::string> ready_keys;
+size_t watching_clients = 0;
+ServerStats server_stats;
+
+void signal_key_ready(const std::string &key)
+{
+    if (blocking_keys.count(key))
+        ready_keys.push_back(key);
+}
+
+/// @brief 两次采样的间隔为0时(同一毫秒内)不计入
+void RateSampler::sample(uint64_t now_ms, uint64_t value)
+{
+    if (last_ms != 0 && now_ms > last_ms)
+    {
+        samples[idx] = (value - last_value) * 1000.0 / (now_ms - last_ms);
+        idx = (idx + 1) % k_samples;
+    }
+    last_ms = now_ms;
+    last_value = value;
+}
+
+double RateSampler::rate() const
+{
+    double sum = 0;
+    for (double s : samples)
+        sum += s;
+    return sum / k_samples;
+}
@@ -1,4 +1,58 @@
+#pragma once
 #include"../hashTable.h"
 
 //顶级哈希表
-extern HMap HMap_string;
\ No newline at end of file
+extern HMap HMap_string;
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+//阻塞命令的等待队列：键 -> 按阻塞先后排列的连接fd
+extern std::unordered_map<std::string, std::deque<int>> blocking_keys;
+
+//有客户端阻塞等待、并且收到了新数据的键，由事件循环在本轮处理完IO后统一唤醒
+extern std::vector<std::string> ready_keys;
+
+//向列表写入数据后调用，键上有客户端阻塞时记录为就绪
+void signal_key_ready(const std::string &key);
+
+//正在WATCH键的连接数，为0时写命令不需要更新键的版本号
+extern size_t watching_clients;
+
+#include <stdint.h>
+//事件循环中周期任务的间隔(毫秒)，没有事件时poll最多等待这么久
+const int k_cron_interval_ms = 100;
+
+//瞬时速率：定时对累计值采样，取最近k_samples次采样的平均值(每秒)
+struct RateSampler
+{
+    static const int k_samples = 16;
+    uint64_t last_ms = 0;
+    uint64_t last_value = 0;
+    double samples[k_samples] = {};
+    int idx = 0;
+
+    void sample(uint64_t now_ms, uint64_t value);
+    double rate() const;
+};
+
+//服务器的运行统计，只由事件循环线程读写，都是普通整数，热路径上没有原子操作与同步；
+//总命令数不单独计数，查询时由各命令的执行统计汇总
+struct ServerStats
+{
+    uint64_t start_ms = 0; // 启动时刻(单调时钟)
+    int tcp_port = 0;
+    uint64_t connected_clients = 0;
+    uint64_t blocked_clients = 0;
+    uint64_t total_connections = 0; // 累计接受的连接数
+    uint64_t net_input_bytes = 0;
+    uint64_t net_output_bytes = 0;
+    uint64_t peak_memory = 0; // used_memory的峰值，定时采样
+    RateSampler ops;          // 每秒执行的命令数
+    RateSampler input;        // 每秒读入的字节数
+    RateSampler output;       // 每秒写出的字节数
+};
+
+extern ServerStats server_stats;
@@ -0,0 +1,290 @@
+#include "hash.h"
+#include "string.h"
+#include <string.h>
+#include <stdexcept>
+
+HashConfig hash_config;
+
+// 每个字段与值前的长度头
+static const size_t k_fp_len = sizeof(uint32_t);
+
+size_t FieldPack::fp_read(size_t off, std::string_view &field, std::string_view &value) const
+{
+    uint32_t len;
+    memcpy(&len, &buf[off], k_fp_len);
+    field = std::string_view(reinterpret_cast<const char *>(&buf[off + k_fp_len]), len);
+    off += k_fp_len + len;
+    memcpy(&len, &buf[off], k_fp_len);
+    value = std::string_view(reinterpret_cast<const char *>(&buf[off + k_fp_len]), len);
+    return off + k_fp_len + len;
+}
+
+/// @brief 线性扫描查找字段，字段数量受阈值限制，扫描的是一段连续内存
+size_t FieldPack::fp_locate(std::string_view field, size_t &next) const
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string_view f, v;
+        next = fp_read(off, f, v);
+        if (f == field)
+            return off;
+        off = next;
+    }
+    return std::string::npos;
+}
+
+bool FieldPack::fp_get(std::string_view field, std::string_view &value) const
+{
+    size_t next;
+    size_t off = fp_locate(field, next);
+    if (off == std::string::npos)
+        return false;
+    std::string_view f;
+    fp_read(off, f, value);
+    return true;
+}
+
+bool FieldPack::fp_set(const std::string &field, const std::string &value)
+{
+    uint32_t vlen = value.size();
+    size_t next;
+    size_t off = fp_locate(field, next);
+    if (off != std::string::npos)
+    {
+        // 原地替换值，长度不同时只移动该字段之后的数据
+        size_t voff = off + k_fp_len + field.size();
+        size_t old_total = next - voff;
+        size_t new_total = k_fp_len + vlen;
+        if (new_total > old_total)
+            buf.insert(buf.begin() + next, new_total - old_total, 0);
+        else if (new_total < old_total)
+            buf.erase(buf.begin() + voff + new_total, buf.begin() + next);
+        memcpy(&buf[voff], &vlen, k_fp_len);
+        memcpy(&buf[voff + k_fp_len], value.data(), vlen);
+        return false;
+    }
+
+    uint32_t flen = field.size();
+    off = buf.size();
+    buf.resize(off + k_fp_len * 2 + flen + vlen);
+    memcpy(&buf[off], &flen, k_fp_len);
+    memcpy(&buf[off + k_fp_len], field.data(), flen);
+    off += k_fp_len + flen;
+    memcpy(&buf[off], &vlen, k_fp_len);
+    memcpy(&buf[off + k_fp_len], value.data(), vlen);
+    count++;
+    return true;
+}
+
+bool FieldPack::fp_delete(std::string_view field)
+{
+    size_t next;
+    size_t off = fp_locate(field, next);
+    if (off == std::string::npos)
+        return false;
+    buf.erase(buf.begin() + off, buf.begin() + next);
+    count--;
+    return true;
+}
+
+void FieldPack::fp_all(std::vector<std::pair<std::string_view, std::string_view>> &results) const
+{
+    results.reserve(results.size() + count);
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string_view f, v;
+        off = fp_read(off, f, v);
+        results.emplace_back(f, v);
+    }
+}
+
+void FieldPack::fp_clear()
+{
+    std::vector<uint8_t>().swap(buf);
+    count = 0;
+}
+
+void hash_free(HashNode *h)
+{
+    if (h->encoding == HashEncoding::HASHTABLE)
+    {
+        std::vector<Entry_hash *> all;
+        all.reserve(h->hmap.hm_size());
+        h->hmap.hm_foreach([&all](HNode *node)
+                           { all.push_back(container_of(node, Entry_hash, node)); });
+        // 槽位数组由HMap析构时释放
+        for (Entry_hash *e : all)
+            delete e;
+    }
+    delete h;
+}
+
+Hash::Hash(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+HashNode *Hash::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::HASH);
+    return obj ? container_of(obj, HashNode, obj) : nullptr;
+}
+
+HashNode *Hash::create(HMap &hmap)
+{
+    HashNode *h = find(hmap);
+    if (h)
+        return h;
+    h = new HashNode();
+    obj_insert(hmap, &h->obj, &probe_);
+    return h;
+}
+
+void Hash::del_if_empty(HMap &hmap, HashNode *h)
+{
+    if (h && HashEntry::hlen(h) == 0)
+        obj_delete(hmap, &probe_);
+}
+
+HashEntry::HashEntry(const std::string &field, const std::string &value)
+{
+    entry_.field = field;
+    entry_.value = value;
+    entry_.node.hcode = obj_hash(field);
+}
+
+void HashEntry::try_convert(HashNode *h, const std::string &field, const std::string &value)
+{
+    if (h->encoding != HashEncoding::LISTPACK)
+        return;
+    if (h->pack.fp_size() < hash_config.max_listpack_entries &&
+        field.size() <= hash_config.max_listpack_value &&
+        value.size() <= hash_config.max_listpack_value)
+        return;
+
+    std::vector<std::pair<std::string_view, std::string_view>> all;
+    h->pack.fp_all(all);
+    for (auto &[f, v] : all)
+    {
+        Entry_hash *e = new Entry_hash();
+        e->field = std::string(f);
+        e->value = std::string(v);
+        e->node.hcode = obj_hash(e->field);
+        h->hmap.hm_insert(&e->node);
+    }
+    h->pack.fp_clear();
+    h->encoding = HashEncoding::HASHTABLE;
+}
+
+bool HashEntry::hset(HashNode *h)
+{
+    if (h->encoding == HashEncoding::LISTPACK)
+    {
+        std::string_view old;
+        // 已存在的字段且新值不超长时，原地更新不会增加字段数
+        if (h->pack.fp_get(entry_.field, old) && entry_.value.size() <= hash_config.max_listpack_value)
+            return h->pack.fp_set(entry_.field, entry_.value);
+        try_convert(h, entry_.field, entry_.value);
+        if (h->encoding == HashEncoding::LISTPACK)
+            return h->pack.fp_set(entry_.field, entry_.value);
+    }
+
+    HNode *node = h->hmap.hm_lookup(&entry_.node, equals_field);
+    if (node)
+    {
+        container_of(node, Entry_hash, node)->value = entry_.value;
+        return false;
+    }
+    Entry_hash *e = new Entry_hash();
+    e->field = entry_.field;
+    e->value = entry_.value;
+    e->node.hcode = entry_.node.hcode;
+    h->hmap.hm_insert(&e->node);
+    return true;
+}
+
+bool HashEntry::hget(HashNode *h, std::string_view &value)
+{
+    if (h->encoding == HashEncoding::LISTPACK)
+        return h->pack.fp_get(entry_.field, value);
+    HNode *node = h->hmap.hm_lookup(&entry_.node, equals_field);
+    if (!node)
+        return false;
+    value = container_of(node, Entry_hash, node)->value;
+    return true;
+}
+
+bool HashEntry::hdel(HashNode *h)
+{
+    if (h->encoding == HashEncoding::LISTPACK)
+        return h->pack.fp_delete(entry_.field);
+    HNode *node = h->hmap.hm_delete(&entry_.node, equals_field);
+    if (!node)
+        return false;
+    delete container_of(node, Entry_hash, node);
+    return true;
+}
+
+int64_t HashEntry::hincrby(HashNode *h, int64_t delta)
+{
+    std::string_view old;
+    int64_t cur = 0;
+    if (hget(h, old) && !str_to_int64(std::string(old), cur))
+        throw std::invalid_argument("哈希字段的值不是整数或超出范围");
+    if ((delta > 0 && cur > INT64_MAX - delta) || (delta < 0 && cur < INT64_MIN - delta))
+        throw std::invalid_argument("自增或自减会导致溢出");
+    cur += delta;
+    entry_.value = int64_to_str(cur);
+    hset(h);
+    return cur;
+}
+
+uint32_t HashEntry::hlen(HashNode *h)
+{
+    if (h->encoding == HashEncoding::LISTPACK)
+        return h->pack.fp_size();
+    return h->hmap.hm_size();
+}
+
+void HashEntry::hgetall(HashNode *h, std::vector<std::pair<std::string_view, std::string_view>> &results)
+{
+    if (h->encoding == HashEncoding::LISTPACK)
+    {
+        h->pack.fp_all(results);
+        return;
+    }
+    results.reserve(results.size() + h->hmap.hm_size());
+    h->hmap.hm_foreach([&results](HNode *node)
+                       {
+                           Entry_hash *e = container_of(node, Entry_hash, node);
+                           results.emplace_back(e->field, e->value); });
+}
+
+uint64_t HashEntry::hscan(HashNode *h, uint64_t cursor, uint32_t count, std::vector<std::pair<std::string_view, std::string_view>> &results)
+{
+    // 紧凑编码的字段数受阈值限制，一次返回全部
+    if (h->encoding == HashEncoding::LISTPACK)
+    {
+        h->pack.fp_all(results);
+        return 0;
+    }
+    size_t begin = results.size();
+    do
+    {
+        cursor = h->hmap.hm_scan(cursor, [&results](HNode *node)
+                                 {
+                                     Entry_hash *e = container_of(node, Entry_hash, node);
+                                     results.emplace_back(e->field, e->value); });
+    } while (cursor != 0 && results.size() - begin < count);
+    return cursor;
+}
+
+bool equals_field(HNode *a, HNode *b)
+{
+    Entry_hash *a_ = container_of(a, Entry_hash, node);
+    Entry_hash *b_ = container_of(b, Entry_hash, node);
+    return a_->field == b_->field;
+}
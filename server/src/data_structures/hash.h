@@ -0,0 +1,136 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include "./hashTable.h"
+#include "./object.h"
+
+// 哈希的编码方式
+enum class HashEncoding
+{
+    LISTPACK, // 小哈希：字段与值紧凑存放在FieldPack中
+    HASHTABLE // 大哈希：每个字段一个独立的条目，挂在哈希表上
+};
+
+// 小哈希紧凑编码的转换阈值，任一条件超出即转换为哈希表编码
+struct HashConfig
+{
+    uint32_t max_listpack_entries = 128; // 最大字段个数
+    uint32_t max_listpack_value = 64;    // 字段或值的最大长度
+};
+
+extern HashConfig hash_config;
+
+/*小哈希的紧凑编码，字段与值交替连续存放在一块缓冲区中，按插入顺序排列*/
+// +------+--------+------+--------+------+--------+-----+
+// | flen | field1 | vlen | value1 | flen | field2 | ... |
+// +------+--------+------+--------+------+--------+-----+
+//  4字节   flen字节  4字节  vlen字节
+class FieldPack
+{
+private:
+    std::vector<uint8_t> buf;
+    uint32_t count = 0; // 字段个数
+
+protected:
+    // 读取偏移off处的一对字段与值，返回下一对的偏移
+    size_t fp_read(size_t off, std::string_view &field, std::string_view &value) const;
+
+    // 查找字段，返回所在偏移，不存在返回npos；next带回下一对的偏移
+    size_t fp_locate(std::string_view field, size_t &next) const;
+
+public:
+    // 查找字段，找到时value引用缓冲区中的数据，缓冲区被修改后失效
+    bool fp_get(std::string_view field, std::string_view &value) const;
+
+    // 设置字段的值，新增字段返回true
+    bool fp_set(const std::string &field, const std::string &value);
+
+    bool fp_delete(std::string_view field);
+
+    // 按存放顺序取出所有字段与值，结果引用缓冲区中的数据
+    void fp_all(std::vector<std::pair<std::string_view, std::string_view>> &results) const;
+
+    uint32_t fp_size() const { return count; }
+    size_t fp_bytes() const { return buf.size(); }
+
+    void fp_clear();
+};
+
+// 大哈希中的一个字段
+struct Entry_hash
+{
+    std::string field;
+    std::string value;
+    HNode node;
+};
+
+// 顶级哈希表中的哈希对象
+struct HashNode
+{
+    Object obj{ObjType::HASH};
+    HashEncoding encoding = HashEncoding::LISTPACK;
+    FieldPack pack;
+    HMap hmap;
+};
+
+// 释放整个哈希
+void hash_free(HashNode *h);
+
+// 管理顶级哈希表中的HashNode
+class Hash
+{
+private:
+    Object probe_{ObjType::HASH};
+
+public:
+    Hash(const std::string &key);
+
+    // 查找哈希，不存在返回nullptr，键存在但不是哈希时抛出异常
+    HashNode *find(HMap &hmap);
+
+    // 查找哈希，不存在时创建
+    HashNode *create(HMap &hmap);
+
+    // 哈希中的字段全部删除后，将键从顶级哈希表中删除
+    void del_if_empty(HMap &hmap, HashNode *h);
+};
+
+// 哈希中具体的一个字段
+class HashEntry
+{
+private:
+    Entry_hash entry_;
+
+public:
+    HashEntry(const std::string &field, const std::string &value = "");
+
+    // 设置字段的值，新增字段返回true
+    bool hset(HashNode *h);
+
+    // 获取字段的值，返回的视图在哈希被修改前有效
+    bool hget(HashNode *h, std::string_view &value);
+
+    bool hdel(HashNode *h);
+
+    // 字段的值加上增量，字段不存在时视为0；值不是整数或溢出时抛出异常
+    int64_t hincrby(HashNode *h, int64_t delta);
+
+    static uint32_t hlen(HashNode *h);
+
+    // 取出所有字段与值，返回的视图在哈希被修改前有效
+    static void hgetall(HashNode *h, std::vector<std::pair<std::string_view, std::string_view>> &results);
+
+    // 游标迭代，每次至少访问count个字段(紧凑编码一次返回全部)，返回下一个游标，0表示结束
+    static uint64_t hscan(HashNode *h, uint64_t cursor, uint32_t count, std::vector<std::pair<std::string_view, std::string_view>> &results);
+
+protected:
+    // 写入前检查是否需要从紧凑编码转换
+    static void try_convert(HashNode *h, const std::string &field, const std::string &value);
+};
+
+// 哈希比较 用于哈希内部字段比较
+bool equals_field(HNode *a, HNode *b);
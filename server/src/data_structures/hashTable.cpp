@@ -1,5 +1,6 @@
 #include "hashTable.h"
 #include "../utils/logger/logger.h"
+#include "../utils/latency/latency.h"
 
 HTab::HTab()
 {
@@ -13,7 +14,7 @@ HTab::HTab(uint32_t n)
     // 待优化，不是2的幂时，不能创建对象
     if (n == 0 || ((n - 1) & n) != 0)
     {
-        Logger::error("HTab() 初始化哈希表时，大小不是2的幂");
+        LOG_ERROR("HTab() 初始化哈希表时，大小不是2的幂");
         throw std::invalid_argument("哈希表大小必须是2的幂");
     }
     this->tab = new HNode *[n]();
@@ -43,7 +44,7 @@ void HTab::h_insert(HNode *node)
 {
     if (!node)
     {
-        Logger::debug("h_insert() 插入失败：节点指针为空");
+        LOG_DEBUG("h_insert() 插入失败：节点指针为空");
         return;
     }
     uint64_t pos = get_pos(node->hcode);
@@ -55,11 +56,9 @@ void HTab::h_insert(HNode *node)
 
 HNode **HTab::h_lookup(HNode *key, bool (*eq)(HNode *, HNode *))
 {
+    // 哈希表延迟分配，空表是常态，不记录日志
     if (tab == nullptr)
-    {
-        Logger::debug("h_lookup() 哈希表为空，查找失败。");
         return nullptr;
-    }
     uint64_t pos = get_pos(key->hcode);
     HNode **from = &tab[pos];
     for (HNode *cur = *from; cur != nullptr; from = &cur->next, cur = *from)
@@ -84,6 +83,21 @@ HNode *HTab::h_detach(HNode **from)
     return node;
 }
 
+void HTab::h_prefetch_slot(uint64_t hcode)
+{
+    if (tab)
+        __builtin_prefetch(&tab[get_pos(hcode)]);
+}
+
+void HTab::h_prefetch_chain(uint64_t hcode)
+{
+    if (!tab)
+        return;
+    HNode *first = tab[get_pos(hcode)];
+    if (first)
+        __builtin_prefetch(first);
+}
+
 uint32_t HTab::get_size()
 {
     return size;
@@ -103,6 +117,7 @@ void HTab::h_clean_up()
 {
     if (tab)
     {
+        delete[] tab;
         tab = nullptr;
         mask = 0;
         size = 0;
@@ -117,6 +132,9 @@ uint64_t HTab::get_pos(uint64_t hcode)
 
 void HMap::hm_help_rehashing()
 {
+    if (!oldTab.data())
+        return;
+    uint64_t start = cycles_now();
     uint64_t nwork = 0; // 迁移的键数
     while (nwork < k_rehashing_work && oldTab.get_size() > 0)
     {
@@ -135,6 +153,7 @@ void HMap::hm_help_rehashing()
     {
         oldTab = HTab();
     }
+    latency_sample("rehash", cycles_now() - start);
 }
 
 void HMap::hm_trigger_rehashing()
@@ -142,14 +161,16 @@ void HMap::hm_trigger_rehashing()
     // 确保没有正在进行的重哈希
     if (oldTab.data() != nullptr)
         return;
+    uint64_t start = cycles_now();
     oldTab = std::move(newTab);
     newTab = HTab((oldTab.get_mask() + 1) << 1); // 新哈希表翻倍
     migrate_pos = 0;                             // 从头开始新一轮的重哈希
+    latency_sample("rehash", cycles_now() - start);
 }
 
-HMap::HMap() : oldTab()
+// 槽位数组延迟到第一次插入时再分配，空哈希表(如小集合的紧凑编码)不占用槽位内存
+HMap::HMap() : newTab(), oldTab()
 {
-    newTab = HTab(init_size);
 }
 
 HMap::~HMap()
@@ -171,6 +192,8 @@ HNode *HMap::hm_lookup(HNode *key, bool (*eq)(HNode *, HNode *))
 
 void HMap::hm_insert(HNode *node)
 {
+    if (!newTab.data())
+        newTab = HTab(init_size);
     newTab.h_insert(node);
     // 判断是否需要重哈希
     if (!oldTab.data())
@@ -204,6 +227,104 @@ uint64_t HMap::hm_size()
     return newTab.get_size() + oldTab.get_size();
 }
 
+bool HMap::hm_rehashing()
+{
+    return oldTab.data() != nullptr;
+}
+
+uint64_t HMap::hm_slots()
+{
+    uint64_t slots = 0;
+    if (newTab.data())
+        slots += (uint64_t)newTab.get_mask() + 1;
+    if (oldTab.data())
+        slots += (uint64_t)oldTab.get_mask() + 1;
+    return slots;
+}
+
+/// @brief 分两轮预取：第一轮发出所有槽位的预取，第二轮读取槽位(此时大多已在缓存中)并预取链表首节点
+/// @param keys 待查找的键
+/// @param n 键的个数
+void HMap::hm_prefetch(HNode *const *keys, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        newTab.h_prefetch_slot(keys[i]->hcode);
+        oldTab.h_prefetch_slot(keys[i]->hcode);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        newTab.h_prefetch_chain(keys[i]->hcode);
+        oldTab.h_prefetch_chain(keys[i]->hcode);
+    }
+}
+
+void HMap::hm_foreach(const std::function<void(HNode *)> &fn)
+{
+    for (HTab *t : {&newTab, &oldTab})
+    {
+        if (!t->data())
+            continue;
+        for (uint32_t i = 0; i <= t->get_mask(); i++)
+            for (HNode *cur = t->data()[i]; cur; cur = cur->next)
+                fn(cur);
+    }
+}
+
+// 二进制位翻转
+static uint64_t rev_bits(uint64_t v)
+{
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(v);
+}
+
+// 游标按高位加一的顺序递增：扩容后旧槽位i拆分成的新槽位都排在i之后，已访问过的槽位不会被漏掉或重复访问
+static uint64_t scan_next(uint64_t cursor, uint64_t mask)
+{
+    cursor |= ~mask;
+    cursor = rev_bits(cursor);
+    cursor++;
+    return rev_bits(cursor);
+}
+
+static void scan_slot(HTab &t, uint64_t pos, const std::function<void(HNode *)> &fn)
+{
+    // 先取next再回调，回调中可以读取节点
+    for (HNode *cur = t.data()[pos]; cur;)
+    {
+        HNode *next = cur->next;
+        fn(cur);
+        cur = next;
+    }
+}
+
+/// @brief 仿照Redis的dictScan，正在重哈希时先访问小表的槽位，再访问大表中由它拆分出的所有槽位
+uint64_t HMap::hm_scan(uint64_t cursor, const std::function<void(HNode *)> &fn)
+{
+    if (hm_size() == 0)
+        return 0;
+    if (!oldTab.data())
+    {
+        uint64_t m0 = newTab.get_mask();
+        scan_slot(newTab, cursor & m0, fn);
+        return scan_next(cursor, m0);
+    }
+
+    HTab *small = &oldTab, *large = &newTab;
+    if (small->get_mask() > large->get_mask())
+        std::swap(small, large);
+    uint64_t m0 = small->get_mask(), m1 = large->get_mask();
+    scan_slot(*small, cursor & m0, fn);
+    do
+    {
+        scan_slot(*large, cursor & m1, fn);
+        cursor = scan_next(cursor, m1);
+    } while (cursor & (m0 ^ m1));
+    return cursor;
+}
+
 void HMap::hm_clean_up()
 {
     if (newTab.data())
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <functional>
 
 // 哈希表节点
 // 需要将节点嵌入到实际数据结构中
@@ -57,9 +58,15 @@ public:
     HNode **h_lookup(HNode *key, bool (*eq)(HNode *, HNode *));
     HNode *h_detach(HNode **from);
 
+    // 预取槽位
+    void h_prefetch_slot(uint64_t hcode);
+    // 预取槽位中链表的第一个节点，需在槽位预取完成后调用
+    void h_prefetch_chain(uint64_t hcode);
+
     uint32_t get_size();
     uint32_t get_mask();
     HNode **data();
+    // 释放槽位数组，不释放其中的节点
     void h_clean_up();
 
 protected:
@@ -99,5 +106,20 @@ public:
     void hm_insert(HNode *node);
     HNode *hm_delete(HNode *key, bool (*eq)(HNode *, HNode *));
     uint64_t hm_size();
+
+    // 是否正在渐进式重哈希
+    bool hm_rehashing();
+    // 新旧两张表的槽位数之和
+    uint64_t hm_slots();
+
+    // 批量查找前预取所有键所在的槽位及链表首节点，使多个键的缓存缺失相互重叠
+    void hm_prefetch(HNode *const *keys, size_t n);
+
+    // 遍历所有节点，遍历过程中不能修改哈希表
+    void hm_foreach(const std::function<void(HNode *)> &fn);
+
+    // 游标迭代：访问cursor对应的槽位并返回下一个游标，返回0表示迭代结束
+    // 两次调用之间哈希表可以被修改，迭代开始时就存在且一直未被删除的节点至少被访问一次
+    uint64_t hm_scan(uint64_t cursor, const std::function<void(HNode *)> &fn);
     void hm_clean_up();
 };
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "hyperloglog.h"
+#include "../utils/utils.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HLL_HAVE_X86 1
+#endif
+
+HllConfig hll_config;
+
+static const char k_hll_magic[4] = {'H', 'Y', 'L', 'L'};
+static const uint8_t k_hll_dense = 0;
+static const uint8_t k_hll_sparse = 1;
+static const uint64_t k_hll_card_invalid = 1ULL << 63;
+static const uint8_t k_hll_reg_max = (1 << k_hll_bits) - 1;
+
+static inline uint8_t *hll_bytes(std::string &hll)
+{
+    return reinterpret_cast<uint8_t *>(hll.data());
+}
+
+static inline const uint8_t *hll_bytes(std::string_view hll)
+{
+    return reinterpret_cast<const uint8_t *>(hll.data());
+}
+
+static inline void hll_invalidate(std::string &hll)
+{
+    memcpy(hll_bytes(hll) + 8, &k_hll_card_invalid, sizeof(uint64_t));
+}
+
+// 稀疏编码的第i个条目
+static inline uint32_t sparse_get(const uint8_t *p, size_t i)
+{
+    uint32_t e;
+    memcpy(&e, p + k_hll_header + i * 4, sizeof(e));
+    return e;
+}
+
+// 稠密编码的第i个寄存器，寄存器从字节的低位开始排列，可能跨越两个字节
+static inline uint8_t dense_get(const uint8_t *p, uint32_t i)
+{
+    const uint8_t *regs = p + k_hll_header;
+    uint32_t bit = i * k_hll_bits, byte = bit >> 3, fb = bit & 7;
+    uint32_t v = regs[byte] >> fb;
+    if (fb > 8 - k_hll_bits)
+        v |= (uint32_t)regs[byte + 1] << (8 - fb);
+    return v & k_hll_reg_max;
+}
+
+static inline void dense_set(uint8_t *p, uint32_t i, uint8_t val)
+{
+    uint8_t *regs = p + k_hll_header;
+    uint32_t bit = i * k_hll_bits, byte = bit >> 3, fb = bit & 7;
+    regs[byte] = (regs[byte] & ~(k_hll_reg_max << fb)) | (val << fb);
+    if (fb > 8 - k_hll_bits)
+    {
+        regs[byte + 1] &= ~(k_hll_reg_max >> (8 - fb));
+        regs[byte + 1] |= val >> (8 - fb);
+    }
+}
+
+// 元素对应的寄存器下标与值：低p位选择寄存器，值为其余位中第一个1的位置(从1开始)
+static inline uint32_t hll_pattern(std::string_view element, uint8_t &val)
+{
+    uint64_t h = hash64(element.data(), element.size(), 0xadc83b19ULL);
+    uint32_t idx = h & (k_hll_registers - 1);
+    h >>= k_hll_p;
+    h |= 1ULL << (64 - k_hll_p); // 哨兵位，保证值不超过64-p+1
+    val = __builtin_ctzll(h) + 1;
+    return idx;
+}
+
+std::string hll_create()
+{
+    std::string hll(k_hll_header, '\0');
+    memcpy(hll.data(), k_hll_magic, sizeof(k_hll_magic));
+    hll[4] = k_hll_sparse;
+    // 空集合的基数为0，缓存直接有效
+    return hll;
+}
+
+bool hll_valid(std::string_view hll)
+{
+    if (hll.size() < k_hll_header || memcmp(hll.data(), k_hll_magic, sizeof(k_hll_magic)) != 0)
+        return false;
+    const uint8_t *p = hll_bytes(hll);
+    if (p[4] == k_hll_dense)
+        return hll.size() == k_hll_dense_size;
+    if (p[4] != k_hll_sparse || (hll.size() - k_hll_header) % 4 != 0)
+        return false;
+    // 稀疏编码的下标用于直接访问寄存器，需要逐个检查
+    size_t n = (hll.size() - k_hll_header) / 4;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t e = sparse_get(p, i);
+        if ((e >> 8) >= k_hll_registers || (e & 0xFF) > k_hll_reg_max)
+            return false;
+    }
+    return true;
+}
+
+// 稀疏编码转换为稠密编码
+static void hll_to_dense(std::string &hll)
+{
+    std::string dense(k_hll_dense_size, '\0');
+    memcpy(dense.data(), hll.data(), k_hll_header);
+    uint8_t *d = hll_bytes(dense);
+    d[4] = k_hll_dense;
+    const uint8_t *p = hll_bytes(hll);
+    size_t n = (hll.size() - k_hll_header) / 4;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint32_t e = sparse_get(p, i);
+        dense_set(d, e >> 8, e & 0xFF);
+    }
+    hll.swap(dense);
+}
+
+bool hll_add(std::string &hll, std::string_view element)
+{
+    uint8_t val;
+    uint32_t idx = hll_pattern(element, val);
+    uint8_t *p = hll_bytes(hll);
+
+    if (p[4] == k_hll_sparse)
+    {
+        // 二分查找下标为idx的条目
+        size_t n = (hll.size() - k_hll_header) / 4;
+        size_t lo = 0, hi = n;
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if ((sparse_get(p, mid) >> 8) < idx)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        uint32_t e = idx << 8 | val;
+        if (lo < n && (sparse_get(p, lo) >> 8) == idx)
+        {
+            if ((sparse_get(p, lo) & 0xFF) >= val)
+                return false;
+            memcpy(p + k_hll_header + lo * 4, &e, sizeof(e));
+            hll_invalidate(hll);
+            return true;
+        }
+        if ((n + 1) * 4 <= hll_config.sparse_max_bytes)
+        {
+            char buf[4];
+            memcpy(buf, &e, sizeof(e));
+            hll.insert(k_hll_header + lo * 4, buf, sizeof(buf));
+            hll_invalidate(hll);
+            return true;
+        }
+        hll_to_dense(hll);
+        p = hll_bytes(hll);
+    }
+
+    if (dense_get(p, idx) >= val)
+        return false;
+    dense_set(p, idx, val);
+    hll_invalidate(hll);
+    return true;
+}
+
+/// @brief 每3个字节恰好存放4个寄存器，按组展开
+static void dense_unpack(const uint8_t *p, uint8_t *regs)
+{
+    const uint8_t *src = p + k_hll_header;
+    for (uint32_t i = 0; i < k_hll_registers; i += 4, src += 3)
+    {
+        uint32_t w = src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16;
+        regs[i] = w & k_hll_reg_max;
+        regs[i + 1] = (w >> 6) & k_hll_reg_max;
+        regs[i + 2] = (w >> 12) & k_hll_reg_max;
+        regs[i + 3] = (w >> 18) & k_hll_reg_max;
+    }
+}
+
+void hll_merge_into(std::string_view hll, uint8_t *regs)
+{
+    const uint8_t *p = hll_bytes(hll);
+    if (p[4] == k_hll_sparse)
+    {
+        size_t n = (hll.size() - k_hll_header) / 4;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t e = sparse_get(p, i);
+            regs[e >> 8] = std::max<uint8_t>(regs[e >> 8], e & 0xFF);
+        }
+        return;
+    }
+    uint8_t tmp[k_hll_registers];
+    dense_unpack(p, tmp);
+    hll_max(regs, tmp, k_hll_registers);
+}
+
+std::string hll_from_registers(const uint8_t *regs)
+{
+    std::string hll(k_hll_dense_size, '\0');
+    uint8_t *p = hll_bytes(hll);
+    memcpy(p, k_hll_magic, sizeof(k_hll_magic));
+    p[4] = k_hll_dense;
+    hll_invalidate(hll);
+    uint8_t *dst = p + k_hll_header;
+    for (uint32_t i = 0; i < k_hll_registers; i += 4, dst += 3)
+    {
+        uint32_t w = regs[i] | (uint32_t)regs[i + 1] << 6 | (uint32_t)regs[i + 2] << 12 | (uint32_t)regs[i + 3] << 18;
+        dst[0] = w;
+        dst[1] = w >> 8;
+        dst[2] = w >> 16;
+    }
+    return hll;
+}
+
+uint64_t hll_count(std::string &hll)
+{
+    uint64_t card;
+    memcpy(&card, hll.data() + 8, sizeof(card));
+    if (!(card & k_hll_card_invalid))
+        return card;
+
+    uint8_t regs[k_hll_registers] = {0};
+    hll_merge_into(hll, regs);
+    card = hll_estimate(regs);
+    memcpy(hll_bytes(hll) + 8, &card, sizeof(card));
+    return card;
+}
+
+// 调和平均所需的sum(2^-reg)与值为0的寄存器个数
+static void hll_sum_scalar(const uint8_t *regs, size_t n, double &sum, uint32_t &zeros)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        sum += ldexp(1.0, -(int)regs[i]);
+        zeros += regs[i] == 0;
+    }
+}
+
+static void hll_max_scalar(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = std::max(dst[i], src[i]);
+}
+
+#ifdef HLL_HAVE_X86
+/// @brief 2^-reg直接由指数位构造：double的位模式为(1023 - reg) << 52
+__attribute__((target("avx2"))) static void hll_sum_avx2(const uint8_t *regs, size_t n, double &sum, uint32_t &zeros)
+{
+    const __m256i bias = _mm256_set1_epi64x(1023);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256i zacc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(regs + i));
+        // 0寄存器计数：cmpeq得到-1，累加后取负
+        zacc = _mm256_sub_epi8(zacc, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+        for (int j = 0; j < 32; j += 8)
+        {
+            __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(regs + i + j));
+            __m256i r0 = _mm256_cvtepu8_epi64(b);
+            __m256i r1 = _mm256_cvtepu8_epi64(_mm_srli_si128(b, 4));
+            acc0 = _mm256_add_pd(acc0, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(bias, r0), 52)));
+            acc1 = _mm256_add_pd(acc1, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(bias, r1), 52)));
+        }
+        // 每个字节的计数不超过255轮，定期横向求和
+        if (((i / 32) & 127) == 127)
+        {
+            __m256i s = _mm256_sad_epu8(zacc, _mm256_setzero_si256());
+            zeros += _mm256_extract_epi64(s, 0) + _mm256_extract_epi64(s, 1) + _mm256_extract_epi64(s, 2) + _mm256_extract_epi64(s, 3);
+            zacc = _mm256_setzero_si256();
+        }
+    }
+    __m256i s = _mm256_sad_epu8(zacc, _mm256_setzero_si256());
+    zeros += _mm256_extract_epi64(s, 0) + _mm256_extract_epi64(s, 1) + _mm256_extract_epi64(s, 2) + _mm256_extract_epi64(s, 3);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    hll_sum_scalar(regs + i, n - i, sum, zeros);
+}
+
+__attribute__((target("avx2"))) static void hll_max_avx2(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_max_epu8(a, b));
+    }
+    hll_max_scalar(dst + i, src + i, n - i);
+}
+
+static bool cpu_has_avx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+void hll_max(uint8_t *dst, const uint8_t *src, size_t n)
+{
+#ifdef HLL_HAVE_X86
+    if (cpu_has_avx2())
+        return hll_max_avx2(dst, src, n);
+#endif
+    hll_max_scalar(dst, src, n);
+}
+
+/// @brief 原始估计为alpha * m^2 / sum(2^-reg)，小基数时(存在值为0的寄存器且估计值较小)使用线性计数
+uint64_t hll_estimate(const uint8_t *regs)
+{
+    double sum = 0;
+    uint32_t zeros = 0;
+#ifdef HLL_HAVE_X86
+    if (cpu_has_avx2())
+        hll_sum_avx2(regs, k_hll_registers, sum, zeros);
+    else
+#endif
+        hll_sum_scalar(regs, k_hll_registers, sum, zeros);
+
+    const double m = k_hll_registers;
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros)
+        e = m * log(m / zeros);
+    return (uint64_t)llround(e);
+}
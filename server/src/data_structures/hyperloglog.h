@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*HyperLogLog基数估计，以普通字符串值的形式存储*/
+// +------+-----+------+----------+---------------------+
+// | HYLL | enc | 未用 | 基数缓存 |       寄存器        |
+// +------+-----+------+----------+---------------------+
+//  4字节  1字节  3字节    8字节
+// 稠密编码：16384个6位寄存器紧密排列，共12288字节
+// 稀疏编码：非0的寄存器按下标升序排列，每个4字节(下标 << 8 | 值)
+// 基数缓存的最高位为1时表示缓存失效
+
+const int k_hll_p = 14;                                          // 用于选择寄存器的哈希位数
+const uint32_t k_hll_registers = 1 << k_hll_p;                   // 寄存器个数
+const int k_hll_bits = 6;                                        // 每个寄存器的位数
+const size_t k_hll_header = 16;                                  // 头部大小
+const size_t k_hll_dense_size = k_hll_header + k_hll_registers * k_hll_bits / 8;
+
+// 稀疏编码的大小超过阈值后转换为稠密编码
+struct HllConfig
+{
+    size_t sparse_max_bytes = 3000;
+};
+
+extern HllConfig hll_config;
+
+// 新建空的HLL(稀疏编码)
+std::string hll_create();
+
+// 检查值是否为合法的HLL
+bool hll_valid(std::string_view hll);
+
+// 添加一个元素，有寄存器被更新时返回true，要求hll合法
+bool hll_add(std::string &hll, std::string_view element);
+
+// 把hll的寄存器按最大值合并到regs中，regs为k_hll_registers个字节，每个字节一个寄存器
+void hll_merge_into(std::string_view hll, uint8_t *regs);
+
+// 由寄存器估计基数
+uint64_t hll_estimate(const uint8_t *regs);
+
+// 单个HLL的基数，缓存有效时直接返回，否则重新估计并写回缓存
+uint64_t hll_count(std::string &hll);
+
+// 由寄存器生成稠密编码的HLL
+std::string hll_from_registers(const uint8_t *regs);
+
+// dst[i] = max(dst[i], src[i])，支持AVX2时使用向量化实现(运行时检测)
+void hll_max(uint8_t *dst, const uint8_t *src, size_t n);
@@ -0,0 +1,149 @@
+#include "intset.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTSET_HAVE_X86 1
+#endif
+
+bool IntSet::is_find(int64_t value) const
+{
+    return std::binary_search(elems.begin(), elems.end(), value);
+}
+
+bool IntSet::is_insert(int64_t value)
+{
+    auto it = std::lower_bound(elems.begin(), elems.end(), value);
+    if (it != elems.end() && *it == value)
+        return false;
+    elems.insert(it, value);
+    return true;
+}
+
+bool IntSet::is_delete(int64_t value)
+{
+    auto it = std::lower_bound(elems.begin(), elems.end(), value);
+    if (it == elems.end() || *it != value)
+        return false;
+    elems.erase(it);
+    return true;
+}
+
+void IntSet::is_clear()
+{
+    std::vector<int64_t>().swap(elems);
+}
+
+// 标量归并，keep_matched为true时输出交集，否则输出差集，从(i, j)处继续
+static size_t merge_scalar(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out, size_t i, size_t j, size_t k, bool keep_matched)
+{
+    while (i < na && j < nb)
+    {
+        if (a[i] < b[j])
+        {
+            if (!keep_matched)
+                out[k++] = a[i];
+            i++;
+        }
+        else if (a[i] > b[j])
+            j++;
+        else
+        {
+            if (keep_matched)
+                out[k++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    if (!keep_matched)
+        while (i < na)
+            out[k++] = a[i++];
+    return k;
+}
+
+#ifdef INTSET_HAVE_X86
+/// @brief 每次取a、b各4个元素，把b的4个元素分别广播后与a比较，得到a块中与b块匹配的位置
+///        a块中的元素只可能与一个b块匹配，a块前进时按累积的匹配掩码输出交集或差集
+__attribute__((target("avx2"))) static size_t merge_avx2(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out, bool keep_matched)
+{
+    size_t i = 0, j = 0, k = 0;
+    int acc = 0; // 当前a块已匹配的位置
+    while (i + 4 <= na && j + 4 <= nb)
+    {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j));
+        __m256i m0 = _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x00));
+        __m256i m1 = _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0x55));
+        __m256i m2 = _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0xAA));
+        __m256i m3 = _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, 0xFF));
+        __m256i m = _mm256_or_si256(_mm256_or_si256(m0, m1), _mm256_or_si256(m2, m3));
+        acc |= _mm256_movemask_pd(_mm256_castsi256_pd(m));
+
+        int64_t amax = a[i + 3], bmax = b[j + 3];
+        if (amax <= bmax)
+        {
+            int emit = keep_matched ? acc : (~acc & 0xF);
+            while (emit)
+            {
+                int bit = __builtin_ctz(emit);
+                out[k++] = a[i + bit];
+                emit &= emit - 1;
+            }
+            acc = 0;
+            i += 4;
+        }
+        if (bmax <= amax)
+            j += 4;
+    }
+    // a块处理到一半时，已匹配的元素先按掩码处理，剩下的交给标量归并
+    if (acc && i < na)
+    {
+        size_t end = std::min(i + 4, na);
+        for (size_t t = i; t < end; t++)
+        {
+            bool matched = acc & (1 << (t - i));
+            if (matched)
+            {
+                if (keep_matched)
+                    out[k++] = a[t];
+                continue;
+            }
+            // 未匹配的元素仍可能与b的剩余部分匹配
+            const int64_t *pos = std::lower_bound(b + j, b + nb, a[t]);
+            bool found = pos != b + nb && *pos == a[t];
+            if (found == keep_matched)
+                out[k++] = a[t];
+        }
+        i = end;
+    }
+    return merge_scalar(a, na, b, nb, out, i, j, k, keep_matched);
+}
+
+static bool cpu_has_avx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+size_t intset_intersect(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out)
+{
+#ifdef INTSET_HAVE_X86
+    if (cpu_has_avx2())
+        return merge_avx2(a, na, b, nb, out, true);
+#endif
+    return merge_scalar(a, na, b, nb, out, 0, 0, 0, true);
+}
+
+size_t intset_diff(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out)
+{
+#ifdef INTSET_HAVE_X86
+    if (cpu_has_avx2())
+        return merge_avx2(a, na, b, nb, out, false);
+#endif
+    return merge_scalar(a, na, b, nb, out, 0, 0, 0, false);
+}
+
+size_t intset_union(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out)
+{
+    return std::set_union(a, a + na, b, b + nb, out) - out;
+}
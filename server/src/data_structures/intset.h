@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*全部由整数组成的小集合的紧凑编码，元素按升序连续存放*/
+// +------+------+------+-----+
+// | int1 | int2 | int3 | ... |   int1 < int2 < int3
+// +------+------+------+-----+
+class IntSet
+{
+private:
+    std::vector<int64_t> elems;
+
+public:
+    // 二分查找
+    bool is_find(int64_t value) const;
+
+    // 插入，已存在返回false
+    bool is_insert(int64_t value);
+
+    bool is_delete(int64_t value);
+
+    const std::vector<int64_t> &is_all() const { return elems; }
+    uint32_t is_size() const { return elems.size(); }
+    size_t is_bytes() const { return elems.size() * sizeof(int64_t); }
+
+    void is_clear();
+};
+
+// 有序无重复整数数组的交集、差集(a - b)与并集，结果写入out，返回结果个数
+// out需要预留足够的空间：交集与差集为na，并集为na + nb
+// 支持AVX2时使用向量化实现(运行时检测)，否则使用标量归并
+size_t intset_intersect(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+size_t intset_diff(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+size_t intset_union(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
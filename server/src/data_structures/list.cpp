@@ -0,0 +1,34 @@
+#include "list.h"
+
+void list_free(ListNode *l)
+{
+    delete l;
+}
+
+List::List(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+ListNode *List::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::LIST);
+    return obj ? container_of(obj, ListNode, obj) : nullptr;
+}
+
+ListNode *List::create(HMap &hmap)
+{
+    ListNode *l = find(hmap);
+    if (l)
+        return l;
+    l = new ListNode();
+    obj_insert(hmap, &l->obj, &probe_);
+    return l;
+}
+
+void List::del_if_empty(HMap &hmap, ListNode *l)
+{
+    if (l && l->ql.ql_size() == 0)
+        obj_delete(hmap, &probe_);
+}
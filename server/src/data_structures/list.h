@@ -0,0 +1,35 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include "./hashTable.h"
+#include "./object.h"
+#include "quicklist.h"
+
+// 顶级哈希表中的列表对象
+struct ListNode
+{
+    Object obj{ObjType::LIST};
+    QuickList ql;
+};
+
+// 释放整个列表
+void list_free(ListNode *l);
+
+// 管理顶级哈希表中的ListNode
+class List
+{
+private:
+    Object probe_{ObjType::LIST};
+
+public:
+    List(const std::string &key);
+
+    // 查找列表，不存在返回nullptr，键存在但不是列表时抛出异常
+    ListNode *find(HMap &hmap);
+
+    // 查找列表，不存在时创建
+    ListNode *create(HMap &hmap);
+
+    // 列表中的元素全部弹出后，将键从顶级哈希表中删除
+    void del_if_empty(HMap &hmap, ListNode *l);
+};
@@ -0,0 +1,154 @@
+#include "listpack.h"
+#include <string.h>
+#include <algorithm>
+
+// 每个元素的固定头部：8字节分数 + 4字节成员名长度
+static const size_t k_lp_header = sizeof(double) + sizeof(uint32_t);
+
+size_t ListPack::lp_read(size_t off, double &score, const char *&name, uint32_t &len) const
+{
+    memcpy(&score, &buf[off], sizeof(double));
+    memcpy(&len, &buf[off + sizeof(double)], sizeof(uint32_t));
+    name = reinterpret_cast<const char *>(&buf[off + k_lp_header]);
+    return off + k_lp_header + len;
+}
+
+void ListPack::lp_write(size_t off, double score, const std::string &name)
+{
+    uint32_t len = name.size();
+    memcpy(&buf[off], &score, sizeof(double));
+    memcpy(&buf[off + sizeof(double)], &len, sizeof(uint32_t));
+    memcpy(&buf[off + k_lp_header], name.data(), len);
+}
+
+/// @brief 线性扫描查找成员，元素数量受阈值限制，扫描的是一段连续内存
+bool ListPack::lp_find(const std::string &name, double *score, uint32_t *rank) const
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double s;
+        const char *p;
+        uint32_t len;
+        off = lp_read(off, s, p, len);
+        if (len == name.size() && memcmp(p, name.data(), len) == 0)
+        {
+            if (score)
+                *score = s;
+            if (rank)
+                *rank = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t ListPack::lp_count_below(double score, bool inclusive) const
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double s;
+        const char *p;
+        uint32_t len;
+        off = lp_read(off, s, p, len);
+        if (inclusive ? s > score : s >= score)
+            return i;
+    }
+    return count;
+}
+
+void ListPack::lp_insert(double score, const std::string &name)
+{
+    // 找到第一个大于(score, name)的元素位置
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double s;
+        const char *p;
+        uint32_t len;
+        size_t next = lp_read(off, s, p, len);
+        if (s > score || (s == score && name.compare(0, name.size(), p, len) < 0))
+            break;
+        off = next;
+    }
+    buf.insert(buf.begin() + off, k_lp_header + name.size(), 0);
+    lp_write(off, score, name);
+    count++;
+}
+
+void ListPack::lp_append(double score, const std::string &name)
+{
+    size_t off = buf.size();
+    buf.resize(off + k_lp_header + name.size());
+    lp_write(off, score, name);
+    count++;
+}
+
+bool ListPack::lp_delete(const std::string &name)
+{
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double s;
+        const char *p;
+        uint32_t len;
+        size_t next = lp_read(off, s, p, len);
+        if (len == name.size() && memcmp(p, name.data(), len) == 0)
+        {
+            buf.erase(buf.begin() + off, buf.begin() + next);
+            count--;
+            return true;
+        }
+        off = next;
+    }
+    return false;
+}
+
+void ListPack::lp_range(int min_rank, int max_rank, std::vector<std::pair<std::string, double>> &results) const
+{
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > (int)count)
+        max_rank = count;
+    if (min_rank > max_rank)
+        return;
+
+    results.reserve(results.size() + (max_rank - min_rank + 1));
+    size_t off = 0;
+    for (int rank = 1; rank <= max_rank; rank++)
+    {
+        double s;
+        const char *p;
+        uint32_t len;
+        off = lp_read(off, s, p, len);
+        if (rank >= min_rank)
+            results.emplace_back(std::string(p, len), s);
+    }
+}
+
+void ListPack::lp_rev_range(int min_rank, int max_rank, std::vector<std::pair<std::string, double>> &results) const
+{
+    if (min_rank < 1)
+        min_rank = 1;
+    if (max_rank > (int)count)
+        max_rank = count;
+    if (min_rank > max_rank)
+        return;
+
+    // 逆序排名r对应正序排名count-r+1，正序取出后翻转
+    size_t begin = results.size();
+    lp_range(count - max_rank + 1, count - min_rank + 1, results);
+    std::reverse(results.begin() + begin, results.end());
+}
+
+void ListPack::lp_all(std::vector<std::pair<std::string, double>> &results) const
+{
+    lp_range(1, count, results);
+}
+
+void ListPack::lp_clear()
+{
+    std::vector<uint8_t>().swap(buf);
+    count = 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+/*小有序集合的紧凑编码，所有元素按(score, name)有序连续存放在一块缓冲区中*/
+// +--------+-----+------+--------+-----+------+-----+
+// | score1 | len | name1| score2 | len | name2| ... |
+// +--------+-----+------+--------+-----+------+-----+
+//   8字节   4字节  len字节
+
+class ListPack
+{
+private:
+    std::vector<uint8_t> buf;
+    uint32_t count = 0; // 元素个数
+
+protected:
+    // 读取偏移off处的元素，返回下一个元素的偏移
+    size_t lp_read(size_t off, double &score, const char *&name, uint32_t &len) const;
+
+    // 写入一个元素到偏移off处(该处已预留空间)
+    void lp_write(size_t off, double score, const std::string &name);
+
+public:
+    // 查找成员，找到返回true，并通过score、rank(从1开始)带回分数与排名
+    bool lp_find(const std::string &name, double *score = nullptr, uint32_t *rank = nullptr) const;
+
+    // 分数小于score(inclusive时小于等于)的元素个数
+    uint32_t lp_count_below(double score, bool inclusive) const;
+
+    // 按序插入，调用者保证成员不存在
+    void lp_insert(double score, const std::string &name);
+
+    // 追加到末尾，调用者保证元素按序且不存在，用于批量构建
+    void lp_append(double score, const std::string &name);
+
+    // 删除成员
+    bool lp_delete(const std::string &name);
+
+    // 获取排名在[min_rank,max_rank]中的所有元素，排名从1开始
+    void lp_range(int min_rank, int max_rank, std::vector<std::pair<std::string, double>> &results) const;
+
+    // 逆序获取排名范围内的元素，排名从最大元素开始计为1
+    void lp_rev_range(int min_rank, int max_rank, std::vector<std::pair<std::string, double>> &results) const;
+
+    void lp_all(std::vector<std::pair<std::string, double>> &results) const;
+
+    uint32_t lp_size() const { return count; }
+    size_t lp_bytes() const { return buf.size(); }
+
+    void lp_clear();
+};
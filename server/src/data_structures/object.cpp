@@ -0,0 +1,161 @@
+#include "object.h"
+#include "string.h"
+#include "zset.h"
+#include "hash.h"
+#include "list.h"
+#include "set.h"
+#include "bloom.h"
+#include "cuckoo.h"
+#include "stream.h"
+#include "../utils/latency/latency.h"
+#include <stdexcept>
+#include <unordered_map>
+
+const char *const k_wrongtype_err = "WRONGTYPE 键对应的值类型与操作不匹配";
+
+uint64_t obj_hash(const std::string &key)
+{
+    uint32_t h = 0x811C9DC5;
+    for (const char &ch : key)
+    {
+        h = (h + ch) * 0x01000193;
+    }
+    return h;
+}
+
+bool obj_equals(HNode *a, HNode *b)
+{
+    Object *a_ = container_of(a, Object, node);
+    Object *b_ = container_of(b, Object, node);
+    return a_->key == b_->key;
+}
+
+Object *obj_lookup(HMap &hmap, Object *probe, ObjType type)
+{
+    HNode *node = hmap.hm_lookup(&probe->node, obj_equals);
+    if (!node)
+        return nullptr;
+    Object *obj = container_of(node, Object, node);
+    if (obj->type != type)
+        throw std::invalid_argument(k_wrongtype_err);
+    return obj;
+}
+
+Object *obj_find(HMap &hmap, Object *probe)
+{
+    HNode *node = hmap.hm_lookup(&probe->node, obj_equals);
+    return node ? container_of(node, Object, node) : nullptr;
+}
+
+// 版本号的全局时钟，从1开始，0留给不存在的键
+static uint64_t version_clock = 0;
+
+void obj_insert(HMap &hmap, Object *obj, const Object *probe)
+{
+    obj->version = ++version_clock;
+    obj->key = probe->key;
+    obj->node.hcode = probe->node.hcode;
+    hmap.hm_insert(&obj->node);
+}
+
+bool obj_delete(HMap &hmap, Object *probe)
+{
+    HNode *node = hmap.hm_delete(&probe->node, obj_equals);
+    if (!node)
+        return false;
+    obj_free(container_of(node, Object, node));
+    return true;
+}
+
+bool obj_delete(HMap &hmap, const std::string &key)
+{
+    Object probe(ObjType::STRING);
+    probe.key = key;
+    probe.node.hcode = obj_hash(key);
+    return obj_delete(hmap, &probe);
+}
+
+static Object *obj_find_any(HMap &hmap, const std::string &key)
+{
+    Object probe(ObjType::STRING);
+    probe.key = key;
+    probe.node.hcode = obj_hash(key);
+    return obj_find(hmap, &probe);
+}
+
+// 被WATCH的键：监视的连接数与键被写命令删除时的版本号
+// 版本号存放在对象中，键被删除后只能记在这里，否则"不存在→创建→删除"会与WATCH时的0相等
+struct WatchedKey
+{
+    uint32_t refs = 0;
+    uint64_t deleted_version = 0;
+};
+static std::unordered_map<std::string, WatchedKey> watched_keys;
+
+uint64_t obj_version(HMap &hmap, const std::string &key)
+{
+    Object *obj = obj_find_any(hmap, key);
+    if (obj)
+        return obj->version;
+    auto it = watched_keys.find(key);
+    return it == watched_keys.end() ? 0 : it->second.deleted_version;
+}
+
+uint64_t obj_watch(HMap &hmap, const std::string &key)
+{
+    watched_keys[key].refs++;
+    return obj_version(hmap, key);
+}
+
+void obj_unwatch(const std::string &key)
+{
+    auto it = watched_keys.find(key);
+    if (it != watched_keys.end() && --it->second.refs == 0)
+        watched_keys.erase(it);
+}
+
+void obj_touch(HMap &hmap, const std::string &key)
+{
+    Object *obj = obj_find_any(hmap, key);
+    if (obj)
+    {
+        obj->version = ++version_clock;
+        return;
+    }
+    auto it = watched_keys.find(key);
+    if (it != watched_keys.end())
+        it->second.deleted_version = ++version_clock;
+}
+
+void obj_free(Object *obj)
+{
+    uint64_t start = cycles_now();
+    switch (obj->type)
+    {
+    case ObjType::STRING:
+        delete container_of(obj, Entry_str, obj);
+        break;
+    case ObjType::ZSET:
+        zset_free(container_of(obj, ZsetNode, obj));
+        break;
+    case ObjType::HASH:
+        hash_free(container_of(obj, HashNode, obj));
+        break;
+    case ObjType::LIST:
+        list_free(container_of(obj, ListNode, obj));
+        break;
+    case ObjType::SET:
+        set_free(container_of(obj, SetNode, obj));
+        break;
+    case ObjType::BLOOM:
+        bloom_free(container_of(obj, BloomNode, obj));
+        break;
+    case ObjType::CUCKOO:
+        cuckoo_free(container_of(obj, CuckooNode, obj));
+        break;
+    case ObjType::STREAM:
+        stream_free(container_of(obj, StreamNode, obj));
+        break;
+    }
+    latency_sample("obj-free", cycles_now() - start);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include "./hashTable.h"
+
+#define container_of(ptr, T, member) \
+    reinterpret_cast<T *>(reinterpret_cast<char *>(ptr) - offsetof(T, member))
+
+// 顶级哈希表中对象的类型
+enum class ObjType : uint8_t
+{
+    STRING,
+    ZSET,
+    HASH,
+    LIST,
+    SET,
+    BLOOM, // 布隆过滤器
+    CUCKOO, // 布谷鸟过滤器
+    STREAM
+};
+
+// 顶级哈希表中所有对象的公共头部，各类型的结构体以组合的方式将其作为第一个成员
+// 所有类型共用同一个比较函数，同名键不会被按其他类型的内存布局解析
+struct Object
+{
+    HNode node;
+    std::string key;
+    ObjType type;
+    uint64_t version = 0; // 创建或被写命令修改时取全局递增的时钟，WATCH据此判断键是否被改动过
+
+    explicit Object(ObjType t) : type(t) {}
+};
+
+// 类型不匹配时的错误信息
+extern const char *const k_wrongtype_err;
+
+// 顶级键的哈希(FNV)
+uint64_t obj_hash(const std::string &key);
+
+// 比较两个对象的键
+bool obj_equals(HNode *a, HNode *b);
+
+// 查找probe对应的对象，键不存在返回nullptr，存在但类型不是type时抛出异常
+Object *obj_lookup(HMap &hmap, Object *probe, ObjType type);
+
+// 查找probe对应的任意类型的对象，不存在返回nullptr
+Object *obj_find(HMap &hmap, Object *probe);
+
+// 将新对象插入顶级哈希表，键与哈希值取自probe，调用者保证键不存在
+void obj_insert(HMap &hmap, Object *obj, const Object *probe);
+
+// 删除probe对应的对象(任意类型)并释放，返回键是否存在
+bool obj_delete(HMap &hmap, Object *probe);
+
+// 按键删除任意类型的对象
+bool obj_delete(HMap &hmap, const std::string &key);
+
+// 键当前的版本号，键不存在时返回被WATCH期间最近一次删除时的版本号，没有时返回0
+uint64_t obj_version(HMap &hmap, const std::string &key);
+
+// WATCH一个键(按连接计数)，返回当前的版本号
+uint64_t obj_watch(HMap &hmap, const std::string &key);
+
+// 取消一次WATCH，没有连接监视时丢弃键的删除记录
+void obj_unwatch(const std::string &key);
+
+// 写命令执行后更新键的版本号，键已被删除且正被WATCH时记录删除时的版本号
+void obj_touch(HMap &hmap, const std::string &key);
+
+// 按类型释放对象及其拥有的全部数据
+void obj_free(Object *obj);
@@ -0,0 +1,320 @@
+#include "quicklist.h"
+#include <string.h>
+#include <algorithm>
+
+// 元素前后的长度字段
+static const size_t k_ql_len = sizeof(uint32_t);
+
+// 按LRANGE/LTRIM的语义规范化下标，区间为空返回false
+static bool ql_normalize(int64_t &start, int64_t &stop, uint64_t size)
+{
+    int64_t n = size;
+    if (start < 0)
+        start += n;
+    if (stop < 0)
+        stop += n;
+    if (start < 0)
+        start = 0;
+    if (stop >= n)
+        stop = n - 1;
+    return n > 0 && start <= stop;
+}
+
+QuickList::~QuickList()
+{
+    ql_clear();
+}
+
+bool QuickList::ql_node_fits(const QLNode *node, size_t len)
+{
+    if (!node || node->count >= k_ql_node_entries)
+        return false;
+    return node->used() + len + 2 * k_ql_len <= k_ql_node_bytes;
+}
+
+/// @brief 头部空间不足时重新分配，新的头部空闲至少为need并且不小于已用数据的一半，连续头插时均摊O(1)
+void QuickList::ql_reserve_front(QLNode *node, size_t need)
+{
+    if (node->head >= need)
+        return;
+    size_t used = node->used();
+    size_t front = std::max(need, used / 2 + need);
+    size_t back = node->buf.size() - node->tail;
+    std::vector<uint8_t> buf(front + used + back);
+    if (used)
+        memcpy(&buf[front], &node->buf[node->head], used);
+    node->buf.swap(buf);
+    node->head = front;
+    node->tail = front + used;
+}
+
+void QuickList::ql_reserve_back(QLNode *node, size_t need)
+{
+    if (node->buf.size() - node->tail >= need)
+        return;
+    size_t used = node->used();
+    size_t back = std::max(need, used / 2 + need);
+    // 尾部扩容时顺便回收头部的空闲
+    std::vector<uint8_t> buf(used + back);
+    if (used)
+        memcpy(&buf[0], &node->buf[node->head], used);
+    node->buf.swap(buf);
+    node->head = 0;
+    node->tail = used;
+}
+
+size_t QuickList::ql_read(const QLNode *node, size_t off, std::string_view &elem)
+{
+    uint32_t len;
+    memcpy(&len, &node->buf[off], k_ql_len);
+    elem = std::string_view(reinterpret_cast<const char *>(&node->buf[off + k_ql_len]), len);
+    return off + 2 * k_ql_len + len;
+}
+
+size_t QuickList::ql_read_back(const QLNode *node, size_t end, std::string_view &elem)
+{
+    uint32_t len;
+    memcpy(&len, &node->buf[end - k_ql_len], k_ql_len);
+    size_t start = end - 2 * k_ql_len - len;
+    elem = std::string_view(reinterpret_cast<const char *>(&node->buf[start + k_ql_len]), len);
+    return start;
+}
+
+QLNode *QuickList::ql_new_node(QLNode *prev, QLNode *next)
+{
+    QLNode *node = new QLNode();
+    node->prev = prev;
+    node->next = next;
+    if (prev)
+        prev->next = node;
+    else
+        head_ = node;
+    if (next)
+        next->prev = node;
+    else
+        tail_ = node;
+    nnodes_++;
+    return node;
+}
+
+void QuickList::ql_unlink(QLNode *node)
+{
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        head_ = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        tail_ = node->prev;
+    size_ -= node->count;
+    nnodes_--;
+    delete node;
+}
+
+void QuickList::ql_push_front(std::string_view elem)
+{
+    QLNode *node = head_;
+    if (!ql_node_fits(node, elem.size()))
+        node = ql_new_node(nullptr, head_);
+    uint32_t len = elem.size();
+    size_t need = len + 2 * k_ql_len;
+    ql_reserve_front(node, need);
+    node->head -= need;
+    uint8_t *p = &node->buf[node->head];
+    memcpy(p, &len, k_ql_len);
+    memcpy(p + k_ql_len, elem.data(), len);
+    memcpy(p + k_ql_len + len, &len, k_ql_len);
+    node->count++;
+    size_++;
+}
+
+void QuickList::ql_push_back(std::string_view elem)
+{
+    QLNode *node = tail_;
+    if (!ql_node_fits(node, elem.size()))
+        node = ql_new_node(tail_, nullptr);
+    uint32_t len = elem.size();
+    size_t need = len + 2 * k_ql_len;
+    ql_reserve_back(node, need);
+    uint8_t *p = &node->buf[node->tail];
+    memcpy(p, &len, k_ql_len);
+    memcpy(p + k_ql_len, elem.data(), len);
+    memcpy(p + k_ql_len + len, &len, k_ql_len);
+    node->tail += need;
+    node->count++;
+    size_++;
+}
+
+bool QuickList::ql_pop_front(std::string &out)
+{
+    if (!head_)
+        return false;
+    std::string_view elem;
+    QLNode *node = head_;
+    node->head = ql_read(node, node->head, elem);
+    out.assign(elem.data(), elem.size());
+    node->count--;
+    size_--;
+    if (node->count == 0)
+        ql_unlink(node);
+    return true;
+}
+
+bool QuickList::ql_pop_back(std::string &out)
+{
+    if (!tail_)
+        return false;
+    std::string_view elem;
+    QLNode *node = tail_;
+    node->tail = ql_read_back(node, node->tail, elem);
+    out.assign(elem.data(), elem.size());
+    node->count--;
+    size_--;
+    if (node->count == 0)
+        ql_unlink(node);
+    return true;
+}
+
+QLNode *QuickList::ql_locate(uint64_t idx, uint32_t &offset) const
+{
+    // 从离下标更近的一端开始按节点计数跳过
+    if (idx < size_ / 2)
+    {
+        QLNode *node = head_;
+        while (idx >= node->count)
+        {
+            idx -= node->count;
+            node = node->next;
+        }
+        offset = idx;
+        return node;
+    }
+    uint64_t ridx = size_ - 1 - idx;
+    QLNode *node = tail_;
+    while (ridx >= node->count)
+    {
+        ridx -= node->count;
+        node = node->prev;
+    }
+    offset = node->count - 1 - ridx;
+    return node;
+}
+
+bool QuickList::ql_index(int64_t idx, std::string_view &out) const
+{
+    if (idx < 0)
+        idx += size_;
+    if (idx < 0 || (uint64_t)idx >= size_)
+        return false;
+    uint32_t offset;
+    QLNode *node = ql_locate(idx, offset);
+    // 节点内从离目标更近的一端扫描
+    if (offset < node->count / 2)
+    {
+        size_t off = node->head;
+        for (uint32_t i = 0; i <= offset; i++)
+            off = ql_read(node, off, out);
+    }
+    else
+    {
+        size_t end = node->tail;
+        for (uint32_t i = node->count; i > offset; i--)
+            end = ql_read_back(node, end, out);
+    }
+    return true;
+}
+
+void QuickList::ql_range(int64_t start, int64_t stop, std::vector<std::string_view> &results) const
+{
+    if (!ql_normalize(start, stop, size_))
+        return;
+    uint64_t n = stop - start + 1;
+    results.reserve(results.size() + n);
+
+    uint32_t offset;
+    QLNode *node = ql_locate(start, offset);
+    size_t off = node->head;
+    std::string_view elem;
+    for (uint32_t i = 0; i < offset; i++)
+        off = ql_read(node, off, elem);
+    while (n > 0)
+    {
+        if (off >= node->tail)
+        {
+            node = node->next;
+            off = node->head;
+        }
+        off = ql_read(node, off, elem);
+        results.push_back(elem);
+        n--;
+    }
+}
+
+void QuickList::ql_del_front(uint64_t n)
+{
+    while (n > 0 && head_)
+    {
+        QLNode *node = head_;
+        if (n >= node->count)
+        {
+            n -= node->count;
+            ql_unlink(node);
+            continue;
+        }
+        std::string_view elem;
+        for (; n > 0; n--)
+        {
+            node->head = ql_read(node, node->head, elem);
+            node->count--;
+            size_--;
+        }
+    }
+}
+
+void QuickList::ql_del_back(uint64_t n)
+{
+    while (n > 0 && tail_)
+    {
+        QLNode *node = tail_;
+        if (n >= node->count)
+        {
+            n -= node->count;
+            ql_unlink(node);
+            continue;
+        }
+        std::string_view elem;
+        for (; n > 0; n--)
+        {
+            node->tail = ql_read_back(node, node->tail, elem);
+            node->count--;
+            size_--;
+        }
+    }
+}
+
+void QuickList::ql_trim(int64_t start, int64_t stop)
+{
+    if (!ql_normalize(start, stop, size_))
+    {
+        ql_clear();
+        return;
+    }
+    uint64_t back = size_ - 1 - stop;
+    ql_del_front(start);
+    ql_del_back(back);
+}
+
+void QuickList::ql_clear()
+{
+    QLNode *node = head_;
+    while (node)
+    {
+        QLNode *next = node->next;
+        delete node;
+        node = next;
+    }
+    head_ = tail_ = nullptr;
+    size_ = 0;
+    nnodes_ = 0;
+}
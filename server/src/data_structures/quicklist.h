@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 每个节点最多容纳的元素数
+const uint32_t k_ql_node_entries = 128;
+// 每个节点数据区的最大字节数，单个元素超出时独占一个节点
+const uint32_t k_ql_node_bytes = 8192;
+
+/*快速列表的节点，元素紧凑连续存放，头尾两侧都预留空间，两端插入删除都不需要移动已有元素*/
+// +------+-----+-------+-----+-----+-------+-----+------+
+// | 空闲 | len | elem1 | len | len | elem2 | len | 空闲 |
+// +------+-----+-------+-----+-----+-------+-----+------+
+//        ^head 4字节          4字节                 ^tail
+// 元素前后各存一份长度，可以从任意一端遍历
+struct QLNode
+{
+    QLNode *prev = nullptr;
+    QLNode *next = nullptr;
+    uint32_t count = 0;       // 元素个数
+    uint32_t head = 0;        // 有效数据起始偏移
+    uint32_t tail = 0;        // 有效数据结束偏移
+    std::vector<uint8_t> buf; // 数据区
+
+    uint32_t used() const { return tail - head; }
+};
+
+// 由紧凑节点组成的双向链表，两端push/pop均摊O(1)
+// 范围读取时逐节点顺序扫描连续内存，不需要每个元素追一次指针
+class QuickList
+{
+private:
+    QLNode *head_ = nullptr;
+    QLNode *tail_ = nullptr;
+    uint64_t size_ = 0;   // 元素总数
+    uint32_t nnodes_ = 0; // 节点个数
+
+protected:
+    // 节点能否再容纳一个长度为len的元素
+    static bool ql_node_fits(const QLNode *node, size_t len);
+
+    // 确保节点头部/尾部至少有need字节空闲
+    static void ql_reserve_front(QLNode *node, size_t need);
+    static void ql_reserve_back(QLNode *node, size_t need);
+
+    // 读取off处的元素，返回下一个元素的偏移
+    static size_t ql_read(const QLNode *node, size_t off, std::string_view &elem);
+
+    // 读取结束于end处的元素，返回该元素的起始偏移
+    static size_t ql_read_back(const QLNode *node, size_t end, std::string_view &elem);
+
+    // 定位下标idx(从0开始)所在节点，offset带回节点内的下标
+    QLNode *ql_locate(uint64_t idx, uint32_t &offset) const;
+
+    QLNode *ql_new_node(QLNode *prev, QLNode *next);
+    void ql_unlink(QLNode *node);
+
+public:
+    QuickList() = default;
+    ~QuickList();
+
+    QuickList(const QuickList &) = delete;
+    QuickList &operator=(const QuickList &) = delete;
+
+    void ql_push_front(std::string_view elem);
+    void ql_push_back(std::string_view elem);
+
+    // 弹出元素，列表为空返回false
+    bool ql_pop_front(std::string &out);
+    bool ql_pop_back(std::string &out);
+
+    // 下标访问，负数下标从末尾计数，返回的视图在列表被修改前有效
+    bool ql_index(int64_t idx, std::string_view &out) const;
+
+    // 获取下标在[start, stop]中的元素，负数下标从末尾计数，返回的视图在列表被修改前有效
+    void ql_range(int64_t start, int64_t stop, std::vector<std::string_view> &results) const;
+
+    // 只保留下标在[start, stop]中的元素
+    void ql_trim(int64_t start, int64_t stop);
+
+    // 从头部/尾部删除n个元素，整节点直接释放
+    void ql_del_front(uint64_t n);
+    void ql_del_back(uint64_t n);
+
+    uint64_t ql_size() const { return size_; }
+    uint32_t ql_nodes() const { return nnodes_; }
+
+    void ql_clear();
+};
@@ -0,0 +1,261 @@
+#include "set.h"
+#include "string.h"
+#include <algorithm>
+#include <unordered_set>
+
+SetConfig set_config;
+
+void set_free(SetNode *s)
+{
+    if (s->encoding == SetEncoding::HASHTABLE)
+    {
+        std::vector<Entry_set *> all;
+        all.reserve(s->hmap.hm_size());
+        s->hmap.hm_foreach([&all](HNode *node)
+                           { all.push_back(container_of(node, Entry_set, node)); });
+        // 槽位数组由HMap析构时释放
+        for (Entry_set *e : all)
+            delete e;
+    }
+    delete s;
+}
+
+Set::Set(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+SetNode *Set::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::SET);
+    return obj ? container_of(obj, SetNode, obj) : nullptr;
+}
+
+SetNode *Set::create(HMap &hmap)
+{
+    SetNode *s = find(hmap);
+    if (s)
+        return s;
+    s = new SetNode();
+    obj_insert(hmap, &s->obj, &probe_);
+    return s;
+}
+
+void Set::del_if_empty(HMap &hmap, SetNode *s)
+{
+    if (s && SetEntry::scard(s) == 0)
+        obj_delete(hmap, &probe_);
+}
+
+// 向哈希表编码的集合中插入成员，调用者保证成员不存在
+static void hashset_insert(SetNode *s, const std::string &member, uint64_t hcode)
+{
+    Entry_set *e = new Entry_set();
+    e->member = member;
+    e->node.hcode = hcode;
+    s->hmap.hm_insert(&e->node);
+}
+
+SetEntry::SetEntry(const std::string &member)
+{
+    entry_.member = member;
+    entry_.node.hcode = obj_hash(member);
+}
+
+void SetEntry::try_convert(SetNode *s, bool is_int)
+{
+    if (s->encoding != SetEncoding::INTSET)
+        return;
+    if (is_int && s->iset.is_size() < set_config.max_intset_entries)
+        return;
+
+    for (int64_t v : s->iset.is_all())
+    {
+        std::string member = int64_to_str(v);
+        hashset_insert(s, member, obj_hash(member));
+    }
+    s->iset.is_clear();
+    s->encoding = SetEncoding::HASHTABLE;
+}
+
+bool SetEntry::sadd(SetNode *s)
+{
+    int64_t v;
+    bool is_int = str_to_int64(entry_.member, v);
+    if (s->encoding == SetEncoding::INTSET)
+    {
+        // 已存在的整数成员不需要转换
+        if (is_int && s->iset.is_find(v))
+            return false;
+        try_convert(s, is_int);
+        if (s->encoding == SetEncoding::INTSET)
+            return s->iset.is_insert(v);
+    }
+
+    if (s->hmap.hm_lookup(&entry_.node, equals_member))
+        return false;
+    hashset_insert(s, entry_.member, entry_.node.hcode);
+    return true;
+}
+
+bool SetEntry::srem(SetNode *s)
+{
+    if (s->encoding == SetEncoding::INTSET)
+    {
+        int64_t v;
+        return str_to_int64(entry_.member, v) && s->iset.is_delete(v);
+    }
+    HNode *node = s->hmap.hm_delete(&entry_.node, equals_member);
+    if (!node)
+        return false;
+    delete container_of(node, Entry_set, node);
+    return true;
+}
+
+bool SetEntry::sismember(SetNode *s)
+{
+    if (s->encoding == SetEncoding::INTSET)
+    {
+        int64_t v;
+        return str_to_int64(entry_.member, v) && s->iset.is_find(v);
+    }
+    return s->hmap.hm_lookup(&entry_.node, equals_member) != nullptr;
+}
+
+uint32_t SetEntry::scard(SetNode *s)
+{
+    if (s->encoding == SetEncoding::INTSET)
+        return s->iset.is_size();
+    return s->hmap.hm_size();
+}
+
+void SetEntry::smembers(SetNode *s, std::vector<std::string> &results)
+{
+    if (s->encoding == SetEncoding::INTSET)
+    {
+        results.reserve(results.size() + s->iset.is_size());
+        for (int64_t v : s->iset.is_all())
+            results.push_back(int64_to_str(v));
+        return;
+    }
+    results.reserve(results.size() + s->hmap.hm_size());
+    s->hmap.hm_foreach([&results](HNode *node)
+                       { results.push_back(container_of(node, Entry_set, node)->member); });
+}
+
+// 全部为整数集合时直接在有序数组上运算
+static void intset_setop(const std::vector<SetNode *> &sets, SetOp op, std::vector<std::string> &results)
+{
+    std::vector<int64_t> cur, tmp;
+    if (op == SetOp::INTER)
+    {
+        // 从最小的集合开始，中间结果只会越来越小
+        std::vector<SetNode *> order(sets);
+        std::sort(order.begin(), order.end(), [](SetNode *a, SetNode *b)
+                  { return a->iset.is_size() < b->iset.is_size(); });
+        cur = order[0]->iset.is_all();
+        for (size_t i = 1; i < order.size() && !cur.empty(); i++)
+        {
+            const std::vector<int64_t> &b = order[i]->iset.is_all();
+            tmp.resize(cur.size());
+            tmp.resize(intset_intersect(cur.data(), cur.size(), b.data(), b.size(), tmp.data()));
+            cur.swap(tmp);
+        }
+    }
+    else
+    {
+        cur = sets[0]->iset.is_all();
+        for (size_t i = 1; i < sets.size(); i++)
+        {
+            const std::vector<int64_t> &b = sets[i]->iset.is_all();
+            if (op == SetOp::UNION)
+            {
+                tmp.resize(cur.size() + b.size());
+                tmp.resize(intset_union(cur.data(), cur.size(), b.data(), b.size(), tmp.data()));
+            }
+            else
+            {
+                tmp.resize(cur.size());
+                tmp.resize(intset_diff(cur.data(), cur.size(), b.data(), b.size(), tmp.data()));
+            }
+            cur.swap(tmp);
+        }
+    }
+    results.reserve(cur.size());
+    for (int64_t v : cur)
+        results.push_back(int64_to_str(v));
+}
+
+void SetEntry::setop(const std::vector<SetNode *> &sets, SetOp op, std::vector<std::string> &results)
+{
+    // 不存在的集合视为空集
+    std::vector<SetNode *> present;
+    for (SetNode *s : sets)
+    {
+        if (s)
+            present.push_back(s);
+        else if (op == SetOp::INTER)
+            return;
+    }
+    if (op == SetOp::DIFF && (sets.empty() || !sets[0]))
+        return;
+    if (present.empty())
+        return;
+
+    bool all_int = std::all_of(present.begin(), present.end(), [](SetNode *s)
+                               { return s->encoding == SetEncoding::INTSET; });
+    if (all_int)
+    {
+        intset_setop(present, op, results);
+        return;
+    }
+
+    if (op == SetOp::UNION)
+    {
+        std::unordered_set<std::string> seen;
+        for (SetNode *s : present)
+        {
+            std::vector<std::string> members;
+            smembers(s, members);
+            for (auto &m : members)
+                if (seen.insert(m).second)
+                    results.push_back(std::move(m));
+        }
+        return;
+    }
+
+    // 交集遍历最小的集合，差集遍历第一个集合，逐个成员探测其他集合
+    size_t base = 0;
+    if (op == SetOp::INTER)
+        base = std::min_element(present.begin(), present.end(), [](SetNode *a, SetNode *b)
+                                { return scard(a) < scard(b); }) -
+               present.begin();
+    std::vector<std::string> members;
+    smembers(present[base], members);
+    for (auto &m : members)
+    {
+        SetEntry probe(m);
+        bool keep = true;
+        for (size_t i = 0; i < present.size(); i++)
+        {
+            if (i == base)
+                continue;
+            bool in = probe.sismember(present[i]);
+            if (in != (op == SetOp::INTER))
+            {
+                keep = false;
+                break;
+            }
+        }
+        if (keep)
+            results.push_back(std::move(m));
+    }
+}
+
+bool equals_member(HNode *a, HNode *b)
+{
+    Entry_set *a_ = container_of(a, Entry_set, node);
+    Entry_set *b_ = container_of(b, Entry_set, node);
+    return a_->member == b_->member;
+}
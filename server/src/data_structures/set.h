@@ -0,0 +1,101 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include <cstdint>
+#include <vector>
+#include "./hashTable.h"
+#include "./object.h"
+#include "intset.h"
+
+// 集合的编码方式
+enum class SetEncoding
+{
+    INTSET,   // 全部是整数的小集合：有序整数数组
+    HASHTABLE // 其他：每个成员一个独立的条目，挂在哈希表上
+};
+
+// 整数集合的转换阈值，元素个数超出或加入非整数成员时转换为哈希表编码
+struct SetConfig
+{
+    uint32_t max_intset_entries = 512; // 最大元素个数
+};
+
+extern SetConfig set_config;
+
+// 大集合中的一个成员
+struct Entry_set
+{
+    std::string member;
+    HNode node;
+};
+
+// 顶级哈希表中的集合对象
+struct SetNode
+{
+    Object obj{ObjType::SET};
+    SetEncoding encoding = SetEncoding::INTSET;
+    IntSet iset;
+    HMap hmap;
+};
+
+// 释放整个集合
+void set_free(SetNode *s);
+
+// 集合运算类型
+enum class SetOp
+{
+    INTER,
+    UNION,
+    DIFF
+};
+
+// 管理顶级哈希表中的SetNode
+class Set
+{
+private:
+    Object probe_{ObjType::SET};
+
+public:
+    Set(const std::string &key);
+
+    // 查找集合，不存在返回nullptr，键存在但不是集合时抛出异常
+    SetNode *find(HMap &hmap);
+
+    // 查找集合，不存在时创建
+    SetNode *create(HMap &hmap);
+
+    // 集合中的成员全部删除后，将键从顶级哈希表中删除
+    void del_if_empty(HMap &hmap, SetNode *s);
+};
+
+// 集合中具体的一个成员
+class SetEntry
+{
+private:
+    Entry_set entry_;
+
+public:
+    SetEntry(const std::string &member);
+
+    // 添加成员，新增返回true
+    bool sadd(SetNode *s);
+
+    bool srem(SetNode *s);
+
+    bool sismember(SetNode *s);
+
+    static uint32_t scard(SetNode *s);
+
+    static void smembers(SetNode *s, std::vector<std::string> &results);
+
+    // 集合运算，不存在的集合以nullptr传入，视为空集
+    // 交集从最小的集合出发逐个探测其他集合，全部为整数集合时使用向量化的有序数组运算
+    static void setop(const std::vector<SetNode *> &sets, SetOp op, std::vector<std::string> &results);
+
+protected:
+    // 写入前检查是否需要从整数集合转换
+    static void try_convert(SetNode *s, bool is_int);
+};
+
+// 哈希比较 用于集合内部成员比较
+bool equals_member(HNode *a, HNode *b);
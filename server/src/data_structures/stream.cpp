@@ -0,0 +1,248 @@
+#include "stream.h"
+#include <string.h>
+#include <algorithm>
+
+// 条目的固定头部：ms + seq + 字段数
+static const size_t k_sl_entry_header = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+static inline uint64_t read_u64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t read_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+StreamID SLNode::id_at(uint32_t i) const
+{
+    const uint8_t *p = buf.data() + offs[i];
+    return StreamID{read_u64(p), read_u64(p + 8)};
+}
+
+StreamLog::~StreamLog()
+{
+    for (SLNode *node : nodes_)
+        delete node;
+}
+
+void StreamLog::sl_append(StreamID id, const std::vector<std::string> &args, size_t first)
+{
+    size_t need = k_sl_entry_header;
+    for (size_t i = first; i < args.size(); i++)
+        need += sizeof(uint32_t) + args[i].size();
+
+    SLNode *node = nodes_.empty() ? nullptr : nodes_.back();
+    if (!node || node->offs.size() >= k_sl_node_entries ||
+        (!node->offs.empty() && node->buf.size() + need > k_sl_node_bytes))
+    {
+        node = new SLNode();
+        node->buf.reserve(std::max<size_t>(need, k_sl_node_bytes));
+        nodes_.push_back(node);
+    }
+
+    size_t off = node->buf.size();
+    node->offs.push_back(off);
+    node->buf.resize(off + need);
+    uint8_t *p = node->buf.data() + off;
+    uint32_t nfields = (args.size() - first) / 2;
+    memcpy(p, &id.ms, 8);
+    memcpy(p + 8, &id.seq, 8);
+    memcpy(p + 16, &nfields, 4);
+    p += k_sl_entry_header;
+    for (size_t i = first; i < args.size(); i++)
+    {
+        uint32_t len = args[i].size();
+        memcpy(p, &len, 4);
+        memcpy(p + 4, args[i].data(), len);
+        p += 4 + len;
+    }
+    node->last = id;
+    last_id_ = id;
+    size_++;
+}
+
+size_t StreamLog::sl_node_lower(StreamID id) const
+{
+    return std::lower_bound(nodes_.begin(), nodes_.end(), id, [](const SLNode *node, StreamID v)
+                            { return node->last < v; }) -
+           nodes_.begin();
+}
+
+uint32_t StreamLog::sl_entry_lower(const SLNode *node, StreamID id)
+{
+    uint32_t lo = node->start, hi = node->offs.size();
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (node->id_at(mid) < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void StreamLog::sl_read(const SLNode *node, uint32_t i, StreamEntryView &out)
+{
+    const uint8_t *p = node->buf.data() + node->offs[i];
+    out.id = StreamID{read_u64(p), read_u64(p + 8)};
+    uint32_t nfields = read_u32(p + 16);
+    p += k_sl_entry_header;
+    out.fields.resize(nfields * 2);
+    for (auto &f : out.fields)
+    {
+        uint32_t len = read_u32(p);
+        f = std::string_view(reinterpret_cast<const char *>(p + 4), len);
+        p += 4 + len;
+    }
+}
+
+void StreamLog::sl_range(StreamID start, StreamID end, uint64_t count, std::vector<StreamEntryView> &results) const
+{
+    if (end < start)
+        return;
+    for (size_t n = sl_node_lower(start); n < nodes_.size(); n++)
+    {
+        const SLNode *node = nodes_[n];
+        for (uint32_t i = sl_entry_lower(node, start); i < node->offs.size(); i++)
+        {
+            if (count && results.size() >= count)
+                return;
+            if (end < node->id_at(i))
+                return;
+            results.emplace_back();
+            sl_read(node, i, results.back());
+        }
+    }
+}
+
+void StreamLog::sl_rev_range(StreamID start, StreamID end, uint64_t count, std::vector<StreamEntryView> &results) const
+{
+    if (end < start || nodes_.empty())
+        return;
+    // 从包含end的节点(或其之前的节点)开始逆序扫描
+    size_t n = std::min(sl_node_lower(end), nodes_.size() - 1);
+    for (;; n--)
+    {
+        const SLNode *node = nodes_[n];
+        uint32_t i = sl_entry_lower(node, end);
+        // i指向第一个不小于end的条目，等于end时包含在内
+        if (i < node->offs.size() && node->id_at(i) == end)
+            i++;
+        while (i > node->start)
+        {
+            i--;
+            if (count && results.size() >= count)
+                return;
+            if (node->id_at(i) < start)
+                return;
+            results.emplace_back();
+            sl_read(node, i, results.back());
+        }
+        if (n == 0)
+            return;
+    }
+}
+
+/// @brief 整个节点的条目都需要删除时直接释放节点，精确裁剪时再前移头节点的start
+uint64_t StreamLog::sl_trim(uint64_t maxlen, bool approx)
+{
+    uint64_t removed = 0;
+    while (size_ > maxlen && !nodes_.empty())
+    {
+        SLNode *node = nodes_.front();
+        uint64_t excess = size_ - maxlen;
+        if (node->live() <= excess)
+        {
+            removed += node->live();
+            size_ -= node->live();
+            nodes_.pop_front();
+            delete node;
+            continue;
+        }
+        if (approx)
+            break;
+        node->start += excess;
+        size_ -= excess;
+        removed += excess;
+    }
+    return removed;
+}
+
+void stream_free(StreamNode *s)
+{
+    delete s;
+}
+
+Stream::Stream(const std::string &key)
+{
+    probe_.key = key;
+    probe_.node.hcode = obj_hash(key);
+}
+
+StreamNode *Stream::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &probe_, ObjType::STREAM);
+    return obj ? container_of(obj, StreamNode, obj) : nullptr;
+}
+
+StreamNode *Stream::create(HMap &hmap)
+{
+    StreamNode *s = find(hmap);
+    if (s)
+        return s;
+    s = new StreamNode();
+    obj_insert(hmap, &s->obj, &probe_);
+    return s;
+}
+
+std::string stream_id_str(StreamID id)
+{
+    return std::to_string(id.ms) + "-" + std::to_string(id.seq);
+}
+
+// 严格解析无符号十进制整数
+static bool parse_u64(const char *p, size_t n, uint64_t &out)
+{
+    if (n == 0 || n > 20)
+        return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (p[i] < '0' || p[i] > '9')
+            return false;
+        uint64_t d = p[i] - '0';
+        if (v > (UINT64_MAX - d) / 10)
+            return false;
+        v = v * 10 + d;
+    }
+    out = v;
+    return true;
+}
+
+bool stream_parse_id(const std::string &str, StreamID &id, uint64_t def_seq, bool *seq_auto)
+{
+    if (seq_auto)
+        *seq_auto = false;
+    size_t dash = str.find('-');
+    if (dash == std::string::npos)
+    {
+        id.seq = def_seq;
+        return parse_u64(str.data(), str.size(), id.ms);
+    }
+    if (!parse_u64(str.data(), dash, id.ms))
+        return false;
+    if (seq_auto && str.size() == dash + 2 && str[dash + 1] == '*')
+    {
+        *seq_auto = true;
+        id.seq = 0;
+        return true;
+    }
+    return parse_u64(str.data() + dash + 1, str.size() - dash - 1, id.seq);
+}
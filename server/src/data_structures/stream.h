@@ -0,0 +1,122 @@
+#pragma once
+#include "base.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "./hashTable.h"
+#include "./object.h"
+
+// 每个节点最多容纳的条目数
+const uint32_t k_sl_node_entries = 100;
+// 每个节点数据区的最大字节数，单个条目超出时独占一个节点
+const uint32_t k_sl_node_bytes = 4096;
+
+// 条目ID：毫秒时间戳-序号
+struct StreamID
+{
+    uint64_t ms = 0;
+    uint64_t seq = 0;
+
+    bool operator<(const StreamID &o) const { return ms < o.ms || (ms == o.ms && seq < o.seq); }
+    bool operator==(const StreamID &o) const { return ms == o.ms && seq == o.seq; }
+    bool operator<=(const StreamID &o) const { return !(o < *this); }
+};
+
+const StreamID k_stream_id_min{0, 0};
+const StreamID k_stream_id_max{UINT64_MAX, UINT64_MAX};
+
+/*流的节点，条目按ID升序紧凑连续存放，offs记录每个条目的起始偏移*/
+// +----+-----+---------+-----+--------+-----+--------+-----+----+-----+
+// | ms | seq | nfields | len | field1 | len | value1 | ... | ms | ... |
+// +----+-----+---------+-----+--------+-----+--------+-----+----+-----+
+//  8字节 8字节   4字节   4字节
+// 头部被裁剪的条目只前移start，整个节点的条目都被裁剪后才释放节点
+struct SLNode
+{
+    std::vector<uint8_t> buf;
+    std::vector<uint32_t> offs; // 每个条目在buf中的偏移
+    uint32_t start = 0;         // 第一个未被裁剪的条目下标
+    StreamID last;              // 最后一个条目的ID
+
+    uint32_t live() const { return offs.size() - start; }
+    StreamID id_at(uint32_t i) const;
+};
+
+// 读出的一个条目，字段与值直接引用节点中的数据
+struct StreamEntryView
+{
+    StreamID id;
+    std::vector<std::string_view> fields; // 字段与值交替排列
+};
+
+// 只在尾部追加、从头部裁剪的条目日志
+// 节点按ID有序排列，按ID定位时先二分查找节点，再在节点内二分查找条目，范围读取为顺序扫描
+class StreamLog
+{
+private:
+    std::deque<SLNode *> nodes_;
+    uint64_t size_ = 0; // 条目总数
+    StreamID last_id_;  // 曾经添加过的最大ID，条目被裁剪后也保留
+
+protected:
+    // 第一个最后ID不小于id的节点下标
+    size_t sl_node_lower(StreamID id) const;
+    // 节点内第一个ID不小于id的条目下标
+    static uint32_t sl_entry_lower(const SLNode *node, StreamID id);
+    static void sl_read(const SLNode *node, uint32_t i, StreamEntryView &out);
+
+public:
+    StreamLog() = default;
+    ~StreamLog();
+
+    StreamLog(const StreamLog &) = delete;
+    StreamLog &operator=(const StreamLog &) = delete;
+
+    // 追加条目，字段与值为args[first..]，调用者保证id大于sl_last_id()
+    void sl_append(StreamID id, const std::vector<std::string> &args, size_t first);
+
+    // 正序获取ID在[start, end]内的条目，count为0时不限个数
+    void sl_range(StreamID start, StreamID end, uint64_t count, std::vector<StreamEntryView> &results) const;
+
+    // 逆序获取ID在[start, end]内的条目
+    void sl_rev_range(StreamID start, StreamID end, uint64_t count, std::vector<StreamEntryView> &results) const;
+
+    // 只保留最新的maxlen个条目，approx为true时只释放整个节点，返回删除的条目数
+    uint64_t sl_trim(uint64_t maxlen, bool approx);
+
+    uint64_t sl_size() const { return size_; }
+    StreamID sl_last_id() const { return last_id_; }
+};
+
+// 顶级哈希表中的流对象
+struct StreamNode
+{
+    Object obj{ObjType::STREAM};
+    StreamLog log;
+};
+
+void stream_free(StreamNode *s);
+
+// 管理顶级哈希表中的StreamNode
+class Stream
+{
+private:
+    Object probe_{ObjType::STREAM};
+
+public:
+    Stream(const std::string &key);
+
+    // 查找流，不存在返回nullptr，键存在但不是流时抛出异常
+    StreamNode *find(HMap &hmap);
+
+    // 查找流，不存在时创建
+    StreamNode *create(HMap &hmap);
+};
+
+// ID的字符串形式 ms-seq
+std::string stream_id_str(StreamID id);
+
+// 解析 ms-seq 或 ms(序号取def_seq)，seq_auto不为空时还接受 ms-*，并通过seq_auto带回
+bool stream_parse_id(const std::string &str, StreamID &id, uint64_t def_seq, bool *seq_auto = nullptr);
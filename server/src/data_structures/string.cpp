@@ -1,28 +1,67 @@
 #include "string.h"
 #include "../utils/logger/logger.h"
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// 共享的小整数字符串，GET/MGET回复常见的小计数值时直接引用，不需要格式化和分配
+static const int64_t k_shared_integers = 10000;
+
+static const std::vector<std::string> &shared_integers()
+{
+    static const std::vector<std::string> pool = []
+    {
+        std::vector<std::string> v;
+        v.reserve(k_shared_integers);
+        for (int64_t i = 0; i < k_shared_integers; i++)
+            v.push_back(std::to_string(i));
+        return v;
+    }();
+    return pool;
+}
+
+// 值能无损表示为int64时使用INT编码存储
+static void entry_assign(Entry_str *entry, std::string &value)
+{
+    int64_t ival;
+    if (str_to_int64(value, ival))
+    {
+        entry->encoding = StrEncoding::INT;
+        entry->ival = ival;
+        std::string().swap(entry->value);
+    }
+    else
+    {
+        entry->encoding = StrEncoding::RAW;
+        entry->value.swap(value);
+    }
+}
 
 StringEntry::StringEntry(std::string key, std::string value)
 {
-    entry.key = key;
-    entry.value = value;
-    entry.node.hcode = hash();
+    entry.obj.key = std::move(key);
+    entry.value = std::move(value);
+    entry.obj.node.hcode = obj_hash(entry.obj.key);
 }
 
 std::string StringEntry::get(HMap &hmap)
 {
     // Logger::debug("=== 开始查找 ===");
     // Logger::debug("查找键: " + entry.key);
-    HNode *node = hmap.hm_lookup(&entry.node, &equals);
-    if (!node)
+    Entry_str *foundEntry = find(hmap);
+    if (!foundEntry)
     {
-        Logger::debug("查找失败");
+        LOG_DEBUG("查找失败");
         return "";
     }
     // Logger::debug("*** 查找成功 - 找到节点");
 
-    Entry_str *foundEntry = container_of(node, Entry_str, node);
-
     // 详细输出找到的内容
     // Logger::debug("找到的Entry信息:");
     // Logger::debug("  - 地址: " + std::to_string((uintptr_t)foundEntry));
@@ -31,7 +70,7 @@ std::string StringEntry::get(HMap &hmap)
     // Logger::debug("  - 值长度: " + std::to_string(foundEntry->value.length()));
     // Logger::debug("  - 值空检查: " + std::to_string(foundEntry->value.empty()));
 
-    std::string val = foundEntry->value;
+    std::string val = entry_value(foundEntry);
 
     // Logger::debug("准备返回值: '" + val + "'");
     // std::cout << "控制台输出: " << val << std::endl;
@@ -39,6 +78,23 @@ std::string StringEntry::get(HMap &hmap)
     return val;
 }
 
+Entry_str *StringEntry::find(HMap &hmap)
+{
+    Object *obj = obj_lookup(hmap, &entry.obj, ObjType::STRING);
+    return obj ? container_of(obj, Entry_str, obj) : nullptr;
+}
+
+Entry_str *StringEntry::find_string(HMap &hmap)
+{
+    Object *obj = obj_find(hmap, &entry.obj);
+    return obj && obj->type == ObjType::STRING ? container_of(obj, Entry_str, obj) : nullptr;
+}
+
+bool StringEntry::exists(HMap &hmap)
+{
+    return obj_find(hmap, &entry.obj) != nullptr;
+}
+
 bool StringEntry::set(HMap &hmap)
 {
     try
@@ -47,19 +103,23 @@ bool StringEntry::set(HMap &hmap)
         // Logger::debug("插入键: '" + entry.key + "'");
         // Logger::debug("插入值: '" + entry.value + "'");
         // Logger::debug("值长度: " + std::to_string(entry.value.length()));
-        HNode *node = hmap.hm_lookup(&entry.node, &equals);
+        HNode *node = hmap.hm_lookup(&entry.obj.node, &obj_equals);
+        // 其他类型的同名键直接删除，由字符串替换
+        if (node && container_of(node, Object, node)->type != ObjType::STRING)
+        {
+            obj_delete(hmap, &entry.obj);
+            node = nullptr;
+        }
         // 如果已存在则更新
         if (node)
         {
-            container_of(node, Entry_str, node)->value.swap(entry.value);
+            entry_assign(container_of(node, Entry_str, obj.node), entry.value);
         }
         else
         { // 不存在则直接插入
             Entry_str *insert_entry = new Entry_str();
-            insert_entry->key = entry.key;
-            insert_entry->value = entry.value;
-            insert_entry->node.hcode = entry.node.hcode;
-            hmap.hm_insert(&insert_entry->node);
+            entry_assign(insert_entry, entry.value);
+            obj_insert(hmap, &insert_entry->obj, &entry.obj);
         }
     }
     catch (const std::exception &e)
@@ -71,29 +131,405 @@ bool StringEntry::set(HMap &hmap)
 
 bool StringEntry::del(HMap &hmap)
 {
-    HNode *node = hmap.hm_delete(&entry.node, &equals);
-    if (!node)
+    return obj_delete(hmap, &entry.obj);
+}
+
+/// @brief 整数自增，INT编码的值直接在ival上运算
+/// @param delta 增量
+/// @return 自增后的值
+int64_t StringEntry::incrby(HMap &hmap, int64_t delta)
+{
+    Entry_str *target = find(hmap);
+    int64_t cur = 0;
+    if (target)
     {
-        return false;
+        if (target->encoding == StrEncoding::INT)
+            cur = target->ival;
+        else if (!str_to_int64(target->value, cur))
+            throw std::invalid_argument("值不是整数或超出范围");
+    }
+
+    if ((delta > 0 && cur > INT64_MAX - delta) || (delta < 0 && cur < INT64_MIN - delta))
+        throw std::invalid_argument("自增或自减会导致溢出");
+    cur += delta;
+
+    if (!target)
+    {
+        target = new Entry_str();
+        obj_insert(hmap, &target->obj, &entry.obj);
+    }
+    else if (target->encoding == StrEncoding::RAW)
+        std::string().swap(target->value);
+    target->encoding = StrEncoding::INT;
+    target->ival = cur;
+    return cur;
+}
+
+// 将INT编码的条目转为RAW编码，原地修改值之前调用
+static void entry_to_raw(Entry_str *entry)
+{
+    if (entry->encoding == StrEncoding::INT)
+    {
+        entry->value = int64_to_str(entry->ival);
+        entry->encoding = StrEncoding::RAW;
     }
-    delete container_of(node, Entry_str, node);
+}
+
+// 查找键对应的条目，不存在时按需创建一个空的RAW条目
+static Entry_str *entry_lookup_or_create(HMap &hmap, Entry_str &key)
+{
+    Object *obj = obj_lookup(hmap, &key.obj, ObjType::STRING);
+    if (obj)
+        return container_of(obj, Entry_str, obj);
+    Entry_str *target = new Entry_str();
+    obj_insert(hmap, &target->obj, &key.obj);
+    return target;
+}
+
+size_t StringEntry::append(HMap &hmap)
+{
+    Entry_str *target = find(hmap);
+    if (!target)
+    {
+        size_t len = entry.value.size();
+        set(hmap);
+        return len;
+    }
+    entry_to_raw(target);
+    if (target->value.size() + entry.value.size() > k_max_str_len)
+        throw std::invalid_argument("字符串长度超出最大限制");
+    target->value.append(entry.value);
+    return target->value.size();
+}
+
+size_t StringEntry::setrange(HMap &hmap, size_t offset)
+{
+    if (offset > k_max_str_len || entry.value.size() > k_max_str_len - offset)
+        throw std::invalid_argument("字符串长度超出最大限制");
+
+    // 写入空串不创建键，也不改变已有值
+    if (entry.value.empty())
+        return strlen(hmap);
+
+    Entry_str *target = entry_lookup_or_create(hmap, entry);
+    entry_to_raw(target);
+    size_t end = offset + entry.value.size();
+    if (target->value.size() < end)
+        target->value.resize(end, '\0');
+    target->value.replace(offset, entry.value.size(), entry.value);
+    return target->value.size();
+}
+
+size_t StringEntry::strlen(HMap &hmap)
+{
+    Entry_str *target = find(hmap);
+    if (!target)
+        return 0;
+    if (target->encoding == StrEncoding::INT)
+        return int64_to_str(target->ival).size();
+    return target->value.size();
+}
+
+bool StringEntry::getdel(HMap &hmap, std::string &out)
+{
+    if (!find(hmap))
+        return false;
+    HNode *node = hmap.hm_delete(&entry.obj.node, &obj_equals);
+    Entry_str *target = container_of(node, Entry_str, obj.node);
+    // 条目即将释放，值直接移出
+    if (target->encoding == StrEncoding::INT)
+        out = int64_to_str(target->ival);
+    else
+        out = std::move(target->value);
+    delete target;
     return true;
 }
 
-// FNV
-uint64_t StringEntry::hash()
+// 条目的原始字节，INT编码的值格式化到tmp中
+static std::string_view entry_bytes(const Entry_str *entry, std::string &tmp)
 {
-    uint32_t h = 0x811C9DC5;
-    for (char &ch : entry.key)
+    if (entry->encoding == StrEncoding::INT)
     {
-        h = (h + ch) * 0x01000193;
+        tmp = int64_to_str(entry->ival);
+        return tmp;
     }
-    return h;
+    return entry->value;
+}
+
+// 按GETRANGE的语义把[start, end]规范化到[0, len)内，范围为空时返回false
+static bool bit_range(int64_t &start, int64_t &end, int64_t len)
+{
+    if (start < 0)
+        start = std::max<int64_t>(start + len, 0);
+    if (end < 0)
+        end = std::max<int64_t>(end + len, 0);
+    if (end >= len)
+        end = len - 1;
+    return len > 0 && start <= end;
 }
 
-bool equals(HNode *a, HNode *b)
+static inline int bit_at(const uint8_t *p, uint64_t offset)
 {
-    Entry_str *a_ = container_of(a, Entry_str, node);
-    Entry_str *b_ = container_of(b, Entry_str, node);
-    return a_->key == b_->key;
-}
\ No newline at end of file
+    return (p[offset >> 3] >> (7 - (offset & 7))) & 1;
+}
+
+int StringEntry::setbit(HMap &hmap, uint64_t offset, int bit)
+{
+    if (offset >= (uint64_t)k_max_str_len * 8)
+        throw std::invalid_argument("位偏移量不是整数或超出范围");
+
+    Entry_str *target = entry_lookup_or_create(hmap, entry);
+    entry_to_raw(target);
+    size_t byte = offset >> 3;
+    if (target->value.size() <= byte)
+        target->value.resize(byte + 1, '\0');
+    uint8_t &b = reinterpret_cast<uint8_t &>(target->value[byte]);
+    uint8_t mask = 0x80 >> (offset & 7);
+    int old = (b & mask) ? 1 : 0;
+    b = bit ? (b | mask) : (b & ~mask);
+    return old;
+}
+
+int StringEntry::getbit(HMap &hmap, uint64_t offset)
+{
+    Entry_str *target = find(hmap);
+    if (!target)
+        return 0;
+    std::string tmp;
+    std::string_view bytes = entry_bytes(target, tmp);
+    if ((offset >> 3) >= bytes.size())
+        return 0;
+    return bit_at(reinterpret_cast<const uint8_t *>(bytes.data()), offset);
+}
+
+/// @brief 首尾不完整的字节按掩码计数，中间的整字节交给向量化的popcount
+uint64_t StringEntry::bitcount(HMap &hmap, int64_t start, int64_t end, bool bit_unit)
+{
+    Entry_str *target = find(hmap);
+    if (!target)
+        return 0;
+    std::string tmp;
+    std::string_view bytes = entry_bytes(target, tmp);
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(bytes.data());
+    int64_t len = bytes.size();
+    if (!bit_unit)
+        return bit_range(start, end, len) ? bit_popcount(p + start, end - start + 1) : 0;
+
+    if (!bit_range(start, end, len * 8))
+        return 0;
+    int64_t first = start >> 3, last = end >> 3;
+    uint8_t first_mask = 0xFF >> (start & 7);
+    uint8_t last_mask = 0xFF << (7 - (end & 7));
+    if (first == last)
+        return __builtin_popcount(p[first] & first_mask & last_mask);
+    return __builtin_popcount(p[first] & first_mask) + bit_popcount(p + first + 1, last - first - 1) +
+           __builtin_popcount(p[last] & last_mask);
+}
+
+/// @brief 首尾不完整的字节逐位检查，中间先跳过全0(查找1)或全1(查找0)的字节
+int64_t StringEntry::bitpos(HMap &hmap, int bit, int64_t start, int64_t end, bool has_end, bool bit_unit)
+{
+    Entry_str *target = find(hmap);
+    if (!target)
+        return bit ? -1 : 0;
+    std::string tmp;
+    std::string_view bytes = entry_bytes(target, tmp);
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(bytes.data());
+    int64_t len = bytes.size();
+    if (!has_end)
+        end = bit_unit ? len * 8 - 1 : len - 1;
+    if (!bit_range(start, end, bit_unit ? len * 8 : len))
+        return -1;
+    if (!bit_unit)
+    {
+        start *= 8;
+        end = end * 8 + 7;
+    }
+
+    int64_t pos = start;
+    for (; pos <= end && (pos & 7); pos++)
+        if (bit_at(p, pos) == bit)
+            return pos;
+    // [pos/8, (end+1)/8)为范围内的整字节
+    if (pos <= end && (end + 1) / 8 > pos / 8)
+    {
+        size_t first = pos / 8, n = (end + 1) / 8 - first;
+        size_t idx = bit_find_byte(p + first, n, bit ? 0x00 : 0xFF);
+        pos = (first + idx) * 8;
+        if (idx < n)
+        {
+            while (bit_at(p, pos) != bit)
+                pos++;
+            return pos;
+        }
+    }
+    for (; pos <= end; pos++)
+        if (bit_at(p, pos) == bit)
+            return pos;
+
+    // 查找0且未指定范围的结尾时，视为值的右侧补0
+    return (!bit && !has_end) ? end + 1 : -1;
+}
+
+/// @brief 结果在独立的缓冲区中计算，dest可以同时是源键
+size_t StringEntry::bitop(HMap &hmap, BitOp op, const std::string &dest, const std::vector<std::string> &srcs)
+{
+    // 先查找全部的源键，类型不匹配时在修改dest之前报错
+    std::vector<std::string> tmps(srcs.size());
+    std::vector<std::string_view> views(srcs.size());
+    size_t max_len = 0;
+    for (size_t i = 0; i < srcs.size(); i++)
+    {
+        Entry_str *src = StringEntry(srcs[i]).find(hmap);
+        if (src)
+            views[i] = entry_bytes(src, tmps[i]);
+        max_len = std::max(max_len, views[i].size());
+    }
+
+    std::string result(views[0]);
+    result.resize(max_len, '\0');
+    uint8_t *r = reinterpret_cast<uint8_t *>(result.data());
+    if (op == BitOp::NOT)
+        bit_not(r, max_len);
+    for (size_t i = 1; i < views.size(); i++)
+    {
+        bit_combine(op, r, reinterpret_cast<const uint8_t *>(views[i].data()), views[i].size());
+        // 较短的值右侧补0：与运算结果为0，或与异或运算结果不变
+        if (op == BitOp::AND)
+            memset(r + views[i].size(), 0, max_len - views[i].size());
+    }
+
+    StringEntry target(dest, std::move(result));
+    if (max_len == 0)
+        target.del(hmap);
+    else
+        target.set(hmap);
+    return max_len;
+}
+
+/// @brief 浮点自增，结果以最短的十进制形式保存，结果为整数时会转为INT编码
+/// @param delta 增量
+/// @return 自增后的值的字符串形式
+std::string StringEntry::incrbyfloat(HMap &hmap, long double delta)
+{
+    Entry_str *target = find(hmap);
+    long double cur = 0;
+    if (target)
+    {
+        if (target->encoding == StrEncoding::INT)
+            cur = target->ival;
+        else
+        {
+            const std::string &v = target->value;
+            char *end = nullptr;
+            cur = v.empty() || isspace((unsigned char)v[0]) ? NAN : strtold(v.c_str(), &end);
+            if (std::isnan(cur) || end != v.c_str() + v.size())
+                throw std::invalid_argument("值不是合法的浮点数");
+        }
+    }
+
+    cur += delta;
+    if (std::isnan(cur) || std::isinf(cur))
+        throw std::invalid_argument("自增结果为NaN或Infinity");
+
+    // 与Redis一致：定点格式输出后去掉小数部分末尾的0，大数不会变成指数形式
+    char buf[5 * 1024];
+    int len = snprintf(buf, sizeof(buf), "%.17Lf", cur);
+    if (len <= 0 || len >= (int)sizeof(buf))
+        throw std::invalid_argument("自增结果超出范围");
+    if (memchr(buf, '.', len))
+    {
+        while (buf[len - 1] == '0')
+            len--;
+        if (buf[len - 1] == '.')
+            len--;
+    }
+    std::string res(buf, len);
+    if (res == "-0")
+        res = "0";
+
+    if (!target)
+    {
+        target = new Entry_str();
+        obj_insert(hmap, &target->obj, &entry.obj);
+    }
+    std::string tmp(res);
+    entry_assign(target, tmp);
+    return res;
+}
+
+bool str_to_int64(const std::string &str, int64_t &out)
+{
+    size_t n = str.size();
+    if (n == 0 || n > 20)
+        return false;
+    size_t i = 0;
+    bool neg = false;
+    if (str[0] == '-')
+    {
+        neg = true;
+        i = 1;
+        if (n == 1)
+            return false;
+    }
+    // 不允许前导0，保证转换回字符串后与原值完全一致
+    if (str[i] == '0' && n > i + 1)
+        return false;
+    if (neg && str[i] == '0')
+        return false;
+
+    uint64_t v = 0;
+    for (; i < n; i++)
+    {
+        char c = str[i];
+        if (c < '0' || c > '9')
+            return false;
+        if (v > (UINT64_MAX - (c - '0')) / 10)
+            return false;
+        v = v * 10 + (c - '0');
+    }
+    if (neg)
+    {
+        if (v > (uint64_t)INT64_MAX + 1)
+            return false;
+        out = (int64_t)(0 - v);
+    }
+    else
+    {
+        if (v > (uint64_t)INT64_MAX)
+            return false;
+        out = (int64_t)v;
+    }
+    return true;
+}
+
+const std::string *shared_integer(int64_t value)
+{
+    if (value >= 0 && value < k_shared_integers)
+        return &shared_integers()[value];
+    return nullptr;
+}
+
+std::string int64_to_str(int64_t value)
+{
+    return std::to_string(value);
+}
+
+std::string entry_value(const Entry_str *entry)
+{
+    return entry->encoding == StrEncoding::INT ? int64_to_str(entry->ival) : entry->value;
+}
+
+std::string_view str_range(std::string_view str, int64_t start, int64_t end)
+{
+    int64_t len = str.size();
+    if (start < 0)
+        start = std::max<int64_t>(len + start, 0);
+    if (end < 0)
+        end = len + end;
+    if (end >= len)
+        end = len - 1;
+    if (len == 0 || end < 0 || start > end)
+        return std::string_view();
+    return str.substr(start, end - start + 1);
+}
@@ -1,17 +1,26 @@
 #pragma once
 #include "base.h"
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <vector>
 #include "./hashTable.h"
+#include "./object.h"
+#include "./bitops.h"
 
-#define container_of(ptr, T, member) \
-    reinterpret_cast<T *>(reinterpret_cast<char *>(ptr) - offsetof(T, member))
+// 字符串值的编码方式
+enum class StrEncoding : uint8_t
+{
+    RAW, // 原始字符串，存放在value中
+    INT  // 可以无损表示为int64的值，直接存放在ival中，自增自减无需分配内存和格式化
+};
 
 struct Entry_str
 {
-    std::string key;
+    Object obj{ObjType::STRING};
     std::string value;
-    HNode node;
+    int64_t ival = 0;
+    StrEncoding encoding = StrEncoding::RAW;
 };
 
 class StringEntry
@@ -30,20 +39,70 @@ public:
     StringEntry &operator=(StringEntry &&) = default;
 
     // 访问器
-    const std::string &key() const { return entry.key; }
+    const std::string &key() const { return entry.obj.key; }
     const std::string &value() const { return entry.value; }
     std::string &value() { return entry.value; }
-    HNode *node() { return &entry.node; }
-    const HNode *node() const { return &entry.node; }
+    HNode *node() { return &entry.obj.node; }
+    const HNode *node() const { return &entry.obj.node; }
 
     // 业务操作
     std::string get(HMap &hmap);
+    // 查找键对应的条目，不存在返回nullptr，键不是字符串时抛出异常
+    Entry_str *find(HMap &hmap);
+    // 查找字符串条目，键不存在或不是字符串时都返回nullptr，不抛出异常
+    Entry_str *find_string(HMap &hmap);
+    // 键是否存在(任意类型)
+    bool exists(HMap &hmap);
+    // 键已存在且为其他类型时，旧值被替换
     bool set(HMap &hmap);
+    // 删除任意类型的键
     bool del(HMap &hmap);
 
-    // 工具方法
-    uint64_t hash();
+    // INCR/DECR/INCRBY/DECRBY：键不存在时视为0，返回自增后的值；值不是整数或溢出时抛出异常
+    int64_t incrby(HMap &hmap, int64_t delta);
+
+    // INCRBYFLOAT：返回自增后的值的字符串形式；值不是数字或结果溢出时抛出异常
+    std::string incrbyfloat(HMap &hmap, long double delta);
+
+    // 以下操作直接修改已存储的值，value()为操作数
+    // APPEND：追加到已有值末尾，返回追加后的长度
+    size_t append(HMap &hmap);
+    // SETRANGE：从offset处覆盖写入，不足部分补0，返回写入后的长度
+    size_t setrange(HMap &hmap, size_t offset);
+    // STRLEN：键不存在返回0
+    size_t strlen(HMap &hmap);
+    // GETDEL：删除键并通过out带回值，键不存在返回false
+    bool getdel(HMap &hmap, std::string &out);
+
+    // 位图操作，第offset位位于第offset/8个字节，字节内从最高位开始计数
+    // SETBIT：键不存在时创建，长度不足时补0，返回该位原来的值
+    int setbit(HMap &hmap, uint64_t offset, int bit);
+    // GETBIT：超出长度的位视为0
+    int getbit(HMap &hmap, uint64_t offset);
+    // BITCOUNT：统计[start, end]内置1的位数，负数下标从末尾计数，bit_unit为true时下标以位为单位，否则以字节为单位
+    uint64_t bitcount(HMap &hmap, int64_t start, int64_t end, bool bit_unit);
+    // BITPOS：[start, end]内第一个值为bit的位的偏移，未找到返回-1
+    // 查找0且未指定end时，值的右侧视为无限补0，返回值的总位数
+    int64_t bitpos(HMap &hmap, int bit, int64_t start, int64_t end, bool has_end, bool bit_unit);
+
+    // BITOP：对srcs中的值逐位运算后写入dest，较短的值右侧视为补0，返回结果的长度，结果为空时删除dest
+    static size_t bitop(HMap &hmap, BitOp op, const std::string &dest, const std::vector<std::string> &srcs);
 };
 
-// 哈希比较
-bool equals(HNode *a, HNode *b);
\ No newline at end of file
+// 严格的字符串转int64：不允许前导空白、前导0、'+'号，成功返回true
+bool str_to_int64(const std::string &str, int64_t &out);
+
+// 共享的小整数字符串，value不在共享范围内时返回nullptr，返回的字符串在进程生命周期内有效
+const std::string *shared_integer(int64_t value);
+
+// int64转字符串
+std::string int64_to_str(int64_t value);
+
+// 条目的值的字符串形式
+std::string entry_value(const Entry_str *entry);
+
+// 按GETRANGE的语义截取[start, end]，负数下标从末尾计数，返回的视图引用str中的数据
+std::string_view str_range(std::string_view str, int64_t start, int64_t end);
+
+// SETRANGE/APPEND后值允许的最大长度
+const size_t k_max_str_len = 512 * 1024 * 1024;
\ No newline at end of file
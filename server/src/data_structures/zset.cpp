@@ -1,10 +1,171 @@
 #include "zset.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+#include "../utils/threadPool/threadPool.h"
+
+ZsetConfig zset_config;
+
+static uint64_t str_hash(const std::string &str)
+{
+    uint32_t h = 0x811C9DC5;
+    for (const char &ch : str)
+    {
+        h = (h + ch) * 0x01000193;
+    }
+    return h;
+}
+
+// 排序索引操作，屏蔽AVL树与B+树两种引擎的差异
+#ifdef ZSET_USE_BTREE
+static void index_insert(Value *val, Entry_zset *p)
+{
+    val->tree.bt_insert(p->score, &p->name, p);
+}
+
+static void index_erase(Value *val, Entry_zset *p)
+{
+    val->tree.bt_delete(p->score, &p->name);
+}
+
+static int index_rank(Value *val, Entry_zset *p)
+{
+    return val->tree.bt_rank(p->score, &p->name);
+}
+
+static void index_collect(const std::vector<void *> &nodes, std::vector<Entry_zset *> &results)
+{
+    results.reserve(results.size() + nodes.size());
+    for (void *item : nodes)
+        results.push_back(static_cast<Entry_zset *>(item));
+}
+
+static void index_range(Value *val, int min_rank, int max_rank, std::vector<Entry_zset *> &results)
+{
+    std::vector<void *> nodes;
+    val->tree.bt_range_by_rank(min_rank, max_rank, nodes);
+    index_collect(nodes, results);
+}
+
+static void index_rev_range(Value *val, int min_rank, int max_rank, std::vector<Entry_zset *> &results)
+{
+    std::vector<void *> nodes;
+    val->tree.bt_rev_range_by_rank(min_rank, max_rank, nodes);
+    index_collect(nodes, results);
+}
+
+static void index_all(Value *val, std::vector<Entry_zset *> &results)
+{
+    std::vector<void *> nodes;
+    val->tree.bt_inorder(nodes);
+    index_collect(nodes, results);
+}
+
+static void index_build(Value *val, std::vector<Entry_zset *> &sorted)
+{
+    std::vector<BTItem> items;
+    items.reserve(sorted.size());
+    for (Entry_zset *p : sorted)
+        items.push_back({p->score, &p->name, p});
+    val->tree.bt_build(items);
+}
+
+static void index_clean_up(Value *val)
+{
+    val->tree.bt_clean_up();
+}
+
+static int index_count_below(Value *val, double score, bool inclusive)
+{
+    return (int)val->tree.bt_count_below(score, inclusive);
+}
+#else
+static void index_insert(Value *val, Entry_zset *p)
+{
+    val->tree.avl_insert(&p->avl_node, less);
+}
+
+static void index_erase(Value *val, Entry_zset *p)
+{
+    val->tree.avl_delete_(&p->avl_node);
+}
+
+static int index_rank(Value *val, Entry_zset *p)
+{
+    return val->tree.avl_rank(&p->avl_node);
+}
+
+static void index_collect(const std::vector<AVLNode *> &nodes, std::vector<Entry_zset *> &results)
+{
+    results.reserve(results.size() + nodes.size());
+    for (AVLNode *item : nodes)
+        results.push_back(container_of(item, Entry_zset, avl_node));
+}
+
+static void index_range(Value *val, int min_rank, int max_rank, std::vector<Entry_zset *> &results)
+{
+    std::vector<AVLNode *> nodes;
+    val->tree.avl_range_by_rank(min_rank, max_rank, nodes);
+    index_collect(nodes, results);
+}
+
+static void index_rev_range(Value *val, int min_rank, int max_rank, std::vector<Entry_zset *> &results)
+{
+    std::vector<AVLNode *> nodes;
+    val->tree.avl_rev_range_by_rank(min_rank, max_rank, nodes);
+    index_collect(nodes, results);
+}
+
+static void index_all(Value *val, std::vector<Entry_zset *> &results)
+{
+    std::vector<AVLNode *> nodes;
+    val->tree.avl_inorder(nodes);
+    index_collect(nodes, results);
+}
+
+static void index_build(Value *val, std::vector<Entry_zset *> &sorted)
+{
+    std::vector<AVLNode *> nodes;
+    nodes.reserve(sorted.size());
+    for (Entry_zset *p : sorted)
+        nodes.push_back(&p->avl_node);
+    val->tree.avl_build(nodes);
+}
+
+static void index_clean_up(Value *val)
+{
+    val->tree.avl_clean_up();
+}
+
+// 按分数定位时的边界
+struct ScoreBound
+{
+    double score;
+    bool inclusive;
+};
+
+static bool score_below(AVLNode *node, const void *arg)
+{
+    const ScoreBound *bound = static_cast<const ScoreBound *>(arg);
+    double s = container_of(node, Entry_zset, avl_node)->score;
+    return bound->inclusive ? s <= bound->score : s < bound->score;
+}
+
+static int index_count_below(Value *val, double score, bool inclusive)
+{
+    ScoreBound bound{score, inclusive};
+    return (int)val->tree.avl_count_prefix(score_below, &bound);
+}
+#endif
 
 Zset::Zset(const std::string &key)
 {
-    node_.key = key;
-    node_.node.hcode = hash();
+    node_.obj.key = key;
+    node_.obj.node.hcode = obj_hash(key);
     node_.value = nullptr;
 }
 
@@ -19,10 +180,8 @@ Value *Zset::create(HMap &hmap)
     try
     {
         ZsetNode *insert_node = new ZsetNode();
-        insert_node->key = node_.key;
-        insert_node->node.hcode = node_.node.hcode;
         insert_node->value = new Value();
-        hmap.hm_insert(&insert_node->node);
+        obj_insert(hmap, &insert_node->obj, &node_.obj);
         ret = insert_node->value;
     }
     catch (std::exception &e)
@@ -34,69 +193,58 @@ Value *Zset::create(HMap &hmap)
 
 Value *Zset::exsit(HMap &hmap)
 {
-    HNode *target = hmap.hm_lookup(&node_.node, equals_);
+    Object *target = obj_lookup(hmap, &node_.obj, ObjType::ZSET);
     if (target)
     {
-        return container_of(target, ZsetNode, node)->value;
+        return container_of(target, ZsetNode, obj)->value;
     }
     return nullptr;
 }
 
 bool Zset::zdel(HMap &hmap)
 {
+    // 首先在顶级哈希表中找到集合的节点，类型不符时抛出异常
+    if (!exsit(hmap))
+        return true;
     try
     {
-        // 首先在顶级哈希表中找到集合的节点
-        HNode *target = hmap.hm_delete(&node_.node, equals_);
-        if (!target)
-            return true;
-        ZsetNode *p = container_of(target, ZsetNode, node);
-
-        // 通过遍历avl树收集集合中所有元素
-        std::vector<AVLNode *> all_elements;
-        p->value->tree.avl_inorder(all_elements);
-
-        for (auto &node : all_elements)
-        {
-            Entry_zset *cur_ds = container_of(node, Entry_zset, avl_node);
-            // 清理哈希表钩子
-            p->value->hmap.hm_delete(&cur_ds->hash_node, equals_entry);
-            // 清理avl树钩子
-            p->value->tree.avl_delete_(node);
-            // 释放实际数据结构内存
-            delete cur_ds;
-            cur_ds = nullptr;
-        }
-        // 清理完集合中所有元素后，释放顶级哈希表中该集合的节点。
-        p->value->tree.avl_clean_up();
-        p->value->hmap.hm_clean_up();
-        delete p->value;
-        p->value = nullptr;
-        delete p;
-        p = nullptr;
+        return obj_delete(hmap, &node_.obj);
     }
     catch (const std::exception &e)
     {
         return false;
     }
-    return true;
 }
 
-uint64_t Zset::hash()
+void zset_free(ZsetNode *p)
 {
-    uint32_t h = 0x811C9DC5;
-    for (char &ch : node_.key)
+    // 紧凑编码的集合没有独立分配的元素，直接释放
+    if (p->value->encoding == ZsetEncoding::LISTPACK)
     {
-        h = (h + ch) * 0x01000193;
+        delete p->value;
+        delete p;
+        return;
     }
-    return h;
-}
 
-bool equals_(HNode *a, HNode *b)
-{
-    ZsetNode *a_ = container_of(a, ZsetNode, node);
-    ZsetNode *b_ = container_of(b, ZsetNode, node);
-    return a_->key == b_->key;
+    // 通过遍历排序索引收集集合中所有元素
+    std::vector<Entry_zset *> all_elements;
+    index_all(p->value, all_elements);
+    // 索引整体清空，无需逐个删除节点
+    index_clean_up(p->value);
+
+    for (auto &cur_ds : all_elements)
+    {
+        // 清理哈希表钩子
+        p->value->hmap.hm_delete(&cur_ds->hash_node, equals_entry);
+        // 释放实际数据结构内存
+        delete cur_ds;
+        cur_ds = nullptr;
+    }
+    // 清理完集合中所有元素后，释放顶级哈希表中该集合的节点。
+    p->value->hmap.hm_clean_up();
+    delete p->value;
+    p->value = nullptr;
+    delete p;
 }
 
 bool equals_entry(HNode *a, HNode *b)
@@ -120,31 +268,72 @@ ZsetEntry::ZsetEntry(const std::string &name)
     entry_.hash_node.hcode = hash();
 }
 
+/// @brief 紧凑编码的集合在元素个数或成员名长度超出阈值时，转换为哈希表+排序索引编码
+void ZsetEntry::try_convert(Value *val)
+{
+    if (val->encoding != ZsetEncoding::LISTPACK)
+        return;
+    if (val->pack.lp_size() < zset_config.max_listpack_entries &&
+        entry_.name.size() <= zset_config.max_listpack_value)
+        return;
+
+    std::vector<std::pair<std::string, double>> items;
+    val->pack.lp_all(items);
+    for (auto &item : items)
+    {
+        Entry_zset *insert_entry = new Entry_zset();
+        insert_entry->name.swap(item.first);
+        insert_entry->score = item.second;
+        insert_entry->hash_node.hcode = str_hash(insert_entry->name);
+
+        index_insert(val, insert_entry);
+        val->hmap.hm_insert(&insert_entry->hash_node);
+    }
+    val->pack.lp_clear();
+    val->encoding = ZsetEncoding::HASHTREE;
+}
+
 bool ZsetEntry::zadd(Value *val)
 {
     try
     {
+        if (val->encoding == ZsetEncoding::LISTPACK)
+        {
+            // 已存在则先删除，再按新分数插入到有序位置
+            if (val->pack.lp_delete(entry_.name))
+            {
+                val->pack.lp_insert(entry_.score, entry_.name);
+                return true;
+            }
+            try_convert(val);
+            if (val->encoding == ZsetEncoding::LISTPACK)
+            {
+                val->pack.lp_insert(entry_.score, entry_.name);
+                return true;
+            }
+        }
+
         // 先通过哈希表判断，该元素是否存在
         HNode *target = val->hmap.hm_lookup(&entry_.hash_node, equals_entry);
         if (target)
         {
-            // 先将分数为旧值的节点从avl中删除，将分数更新后，再将节点插入到avl中，以达到分数更新后，排名也更新的效果
+            // 先将分数为旧值的节点从排序索引中删除，将分数更新后，再将节点插入到索引中，以达到分数更新后，排名也更新的效果
             Entry_zset *p = container_of(target, Entry_zset, hash_node);
-            val->tree.avl_delete_(&p->avl_node);
+            index_erase(val, p);
             // 更新分数
             p->score = entry_.score;
-            // 重新插入以调整avl树
-            val->tree.avl_insert(&p->avl_node, less);
+            // 重新插入以调整排序索引
+            index_insert(val, p);
         }
         else
         {
-            // 若不存在则开辟空间创建一个新Entry_zset，并分别插入到哈希表、avl中
+            // 若不存在则开辟空间创建一个新Entry_zset，并分别插入到哈希表、排序索引中
             Entry_zset *insert_entry = new Entry_zset();
             insert_entry->name = entry_.name;
             insert_entry->score = entry_.score;
             insert_entry->hash_node.hcode = hash();
 
-            val->tree.avl_insert(&insert_entry->avl_node, less);
+            index_insert(val, insert_entry);
             val->hmap.hm_insert(&insert_entry->hash_node);
         }
     }
@@ -155,16 +344,260 @@ bool ZsetEntry::zadd(Value *val)
     return true;
 }
 
+/// @brief 带标志的ZADD
+/// @param flags ZaddFlag的组合，调用者保证组合合法
+/// @param newscore 带回元素的最终分数(INCR时用于回复)
+/// @return 元素的处理结果
+ZaddResult ZsetEntry::zadd(Value *val, uint32_t flags, double &newscore)
+{
+    bool exists = false;
+    double cur = zscore(val, exists);
+    if ((exists && (flags & ZADD_NX)) || (!exists && (flags & ZADD_XX)))
+        return ZaddResult::NOP;
+
+    double score = entry_.score;
+    if ((flags & ZADD_INCR) && exists)
+        score += cur;
+    if (std::isnan(score))
+        throw std::invalid_argument("分数计算结果不是数字");
+
+    if (exists)
+    {
+        newscore = cur;
+        if ((flags & ZADD_GT) && !(score > cur))
+            return ZaddResult::NOP;
+        if ((flags & ZADD_LT) && !(score < cur))
+            return ZaddResult::NOP;
+        if (score == cur)
+            return ZaddResult::NOP;
+    }
+
+    entry_.score = score;
+    newscore = score;
+    zadd(val);
+    return exists ? ZaddResult::UPDATED : ZaddResult::ADDED;
+}
+
+/// @brief 向空集合批量添加元素：排序去重后，小集合直接顺序写入紧凑编码，大集合一次性构建平衡的排序索引
+/// @param val 紧凑编码的空集合
+/// @param items (成员, 分数)
+/// @return 添加的元素个数
+int ZsetEntry::zbuild(Value *val, std::vector<std::pair<std::string, double>> &items)
+{
+    // 按成员名稳定排序，同名成员保留最后一次出现
+    std::stable_sort(items.begin(), items.end(), [](const std::pair<std::string, double> &a, const std::pair<std::string, double> &b)
+                     { return a.first < b.first; });
+    size_t n = 0;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        if (i + 1 < items.size() && items[i + 1].first == items[i].first)
+            continue;
+        if (n != i)
+            items[n] = std::move(items[i]);
+        n++;
+    }
+    items.resize(n);
+    std::sort(items.begin(), items.end(), [](const std::pair<std::string, double> &a, const std::pair<std::string, double> &b)
+              { return a.second == b.second ? a.first < b.first : a.second < b.second; });
+
+    bool compact = items.size() <= zset_config.max_listpack_entries;
+    for (size_t i = 0; compact && i < items.size(); i++)
+        compact = items[i].first.size() <= zset_config.max_listpack_value;
+
+    if (compact)
+    {
+        for (auto &item : items)
+            val->pack.lp_append(item.second, item.first);
+        return (int)items.size();
+    }
+
+    std::vector<Entry_zset *> sorted;
+    sorted.reserve(items.size());
+    for (auto &item : items)
+    {
+        Entry_zset *insert_entry = new Entry_zset();
+        insert_entry->name.swap(item.first);
+        insert_entry->score = item.second;
+        insert_entry->hash_node.hcode = str_hash(insert_entry->name);
+        val->hmap.hm_insert(&insert_entry->hash_node);
+        sorted.push_back(insert_entry);
+    }
+    index_build(val, sorted);
+    val->encoding = ZsetEncoding::HASHTREE;
+    return (int)sorted.size();
+}
+
+using ZsetItems = std::vector<std::pair<std::string, double>>;
+
+static double zset_aggregate(double acc, double v, ZsetAggregate agg)
+{
+    switch (agg)
+    {
+    case ZsetAggregate::MIN:
+        return v < acc ? v : acc;
+    case ZsetAggregate::MAX:
+        return v > acc ? v : acc;
+    default:
+    {
+        double sum = acc + v;
+        // inf + -inf 视为0
+        return std::isnan(sum) ? 0.0 : sum;
+    }
+    }
+}
+
+/// @brief 对一个分区内的元素做集合运算，同一成员一定落在同一分区，分区之间互不影响
+/// @param srcs 各输入集合落在该分区的元素，交集时第一个集合为最小集合
+/// @param out 该分区的结果
+static void zsetop_partition(std::vector<ZsetItems> &srcs, const std::vector<double> &weights, ZsetAggregate agg, ZsetSetOp op, ZsetItems &out)
+{
+    if (op == ZsetSetOp::DIFF)
+    {
+        std::unordered_set<std::string> removed;
+        for (size_t s = 1; s < srcs.size(); s++)
+            for (auto &item : srcs[s])
+                removed.insert(item.first);
+        for (auto &item : srcs[0])
+            if (!removed.count(item.first))
+                out.push_back(std::move(item));
+        return;
+    }
+
+    // 成员 -> (聚合分数, 出现次数)
+    std::unordered_map<std::string, std::pair<double, size_t>> acc;
+    acc.reserve(srcs[0].size());
+    for (size_t s = 0; s < srcs.size(); s++)
+    {
+        for (auto &item : srcs[s])
+        {
+            double v = item.second * weights[s];
+            // inf * 0 视为0
+            if (std::isnan(v))
+                v = 0.0;
+            auto it = acc.find(item.first);
+            if (it == acc.end())
+            {
+                // 交集只需要跟踪最小集合中的成员
+                if (op == ZsetSetOp::INTER && s > 0)
+                    continue;
+                acc.emplace(std::move(item.first), std::make_pair(v, (size_t)1));
+                continue;
+            }
+            it->second.first = zset_aggregate(it->second.first, v, agg);
+            it->second.second++;
+        }
+    }
+
+    out.reserve(acc.size());
+    for (auto &kv : acc)
+    {
+        if (op == ZsetSetOp::UNION || kv.second.second == srcs.size())
+            out.emplace_back(kv.first, kv.second.first);
+    }
+}
+
+/// @brief 多集合运算：先在事件循环线程中把各输入集合的元素拷贝出来，
+/// 输入元素总数超过阈值时按成员哈希分区，交给线程池并行计算，各分区结果直接拼接
+ZsetItems ZsetEntry::zsetop(const std::vector<Value *> &srcs, const std::vector<double> &weights, ZsetAggregate agg, ZsetSetOp op)
+{
+    ZsetItems res;
+    std::vector<ZsetItems> inputs(srcs.size());
+    std::vector<double> w(weights);
+    size_t total = 0;
+    ZsetEntry reader("");
+    for (size_t s = 0; s < srcs.size(); s++)
+    {
+        if (srcs[s])
+            inputs[s] = reader.zall(srcs[s]);
+        total += inputs[s].size();
+    }
+
+    if (op == ZsetSetOp::INTER)
+    {
+        // 任一集合为空则交集为空；把最小的集合换到第一个，只跟踪其中的成员
+        size_t smallest = 0;
+        for (size_t s = 0; s < inputs.size(); s++)
+        {
+            if (inputs[s].empty())
+                return res;
+            if (inputs[s].size() < inputs[smallest].size())
+                smallest = s;
+        }
+        std::swap(inputs[0], inputs[smallest]);
+        std::swap(w[0], w[smallest]);
+    }
+    if (op == ZsetSetOp::DIFF && inputs[0].empty())
+        return res;
+
+    threadPool &pool = threadPool::instance();
+    size_t nparts = total > zset_config.parallel_threshold ? pool.size() : 1;
+    if (nparts <= 1)
+    {
+        zsetop_partition(inputs, w, agg, op, res);
+        return res;
+    }
+
+    // 按成员哈希分区：parts[p][s]为第s个集合中落在分区p的元素
+    std::vector<std::vector<ZsetItems>> parts(nparts, std::vector<ZsetItems>(inputs.size()));
+    for (size_t s = 0; s < inputs.size(); s++)
+    {
+        for (auto &item : inputs[s])
+        {
+            size_t p = str_hash(item.first) % nparts;
+            parts[p][s].push_back(std::move(item));
+        }
+        ZsetItems().swap(inputs[s]);
+    }
+
+    std::vector<ZsetItems> outs(nparts);
+    std::vector<std::future<void>> futures;
+    futures.reserve(nparts);
+    for (size_t p = 0; p < nparts; p++)
+    {
+        futures.push_back(pool.submit([&parts, &outs, &w, agg, op, p]
+                                      { zsetop_partition(parts[p], w, agg, op, outs[p]); }));
+    }
+    // 必须等待所有任务结束后才能返回，任务引用了本函数中的数据
+    std::exception_ptr err;
+    for (auto &f : futures)
+    {
+        try
+        {
+            f.get();
+        }
+        catch (...)
+        {
+            err = std::current_exception();
+        }
+    }
+    if (err)
+        std::rethrow_exception(err);
+
+    size_t n = 0;
+    for (auto &out : outs)
+        n += out.size();
+    res.reserve(n);
+    for (auto &out : outs)
+        std::move(out.begin(), out.end(), std::back_inserter(res));
+    return res;
+}
+
 bool ZsetEntry::zrem(Value *val)
 {
     try
-    { // 通过哈希表判断要删除的元素是否存在
+    {
+        if (val->encoding == ZsetEncoding::LISTPACK)
+        {
+            val->pack.lp_delete(entry_.name);
+            return true;
+        }
+        // 通过哈希表判断要删除的元素是否存在
         HNode *target = val->hmap.hm_lookup(&entry_.hash_node, equals_entry);
         if (!target)
             return true;
         Entry_zset *p = container_of(target, Entry_zset, hash_node);
         val->hmap.hm_delete(&entry_.hash_node, equals_entry);
-        val->tree.avl_delete_(&p->avl_node);
+        index_erase(val, p);
 
         delete p;
     }
@@ -177,6 +610,12 @@ bool ZsetEntry::zrem(Value *val)
 
 double ZsetEntry::zscore(Value *val, bool &isok)
 {
+    if (val->encoding == ZsetEncoding::LISTPACK)
+    {
+        double score = 0.0;
+        isok = val->pack.lp_find(entry_.name, &score);
+        return score;
+    }
     HNode *target = val->hmap.hm_lookup(&entry_.hash_node, equals_entry);
     if (!target)
     {
@@ -189,6 +628,12 @@ double ZsetEntry::zscore(Value *val, bool &isok)
 
 int ZsetEntry::zrank(Value *val, bool &isok)
 {
+    if (val->encoding == ZsetEncoding::LISTPACK)
+    {
+        uint32_t rank = 0;
+        isok = val->pack.lp_find(entry_.name, nullptr, &rank);
+        return isok ? (int)rank : -1;
+    }
     HNode *target = val->hmap.hm_lookup(&entry_.hash_node, equals_entry);
     if (!target)
     {
@@ -196,52 +641,102 @@ int ZsetEntry::zrank(Value *val, bool &isok)
         return -1;
     }
     isok = true;
-    return val->tree.avl_rank(&container_of(target, Entry_zset, hash_node)->avl_node);
+    return index_rank(val, container_of(target, Entry_zset, hash_node));
 }
 
 int ZsetEntry::zcard(Value *val)
 {
+    if (val->encoding == ZsetEncoding::LISTPACK)
+        return (int)val->pack.lp_size();
     return (int)val->hmap.hm_size();
 }
 
 std::vector<std::pair<std::string, double>> ZsetEntry::zrange(Value *val, int min_rank, int max_rank)
 {
     std::vector<std::pair<std::string, double>> res; // 真实数据的结果集
-    std::vector<AVLNode *> results;                  // 范围内的avl节点结果集
-    val->tree.avl_range_by_rank(min_rank, max_rank, results);
-    for (auto &item : results)
+    std::vector<Entry_zset *> results;               // 范围内的元素结果集
+    int n = zcard(val);
+    if (val->encoding == ZsetEncoding::LISTPACK)
+    {
+        val->pack.lp_range(normalize_rank(min_rank, n), normalize_rank(max_rank, n), res);
+        return res;
+    }
+    index_range(val, normalize_rank(min_rank, n), normalize_rank(max_rank, n), results);
+    res.reserve(results.size());
+    for (auto &p : results)
     {
-        Entry_zset *p = container_of(item, Entry_zset, avl_node);
         res.emplace_back(p->name, p->score);
         // std::cout << p->name << " " << p->score << std::endl;
     }
     return res;
 }
 
+int ZsetEntry::zseek(Value *val, double score, bool inclusive)
+{
+    if (val->encoding == ZsetEncoding::LISTPACK)
+        return (int)val->pack.lp_count_below(score, inclusive);
+    return index_count_below(val, score, inclusive);
+}
+
+/// @brief 先按分数定位出两端的排名，再复用按排名的范围查询，复杂度O(logN + M)
+std::vector<std::pair<std::string, double>> ZsetEntry::zrangebyscore(Value *val, double min_score, double max_score)
+{
+    int lo = zseek(val, min_score, false) + 1;
+    int hi = zseek(val, max_score, true);
+    if (lo > hi)
+        return {};
+    return zrange(val, lo, hi);
+}
+
+std::vector<std::pair<std::string, double>> ZsetEntry::zrevrange(Value *val, int min_rank, int max_rank)
+{
+    std::vector<std::pair<std::string, double>> res;
+    std::vector<Entry_zset *> results;
+    int n = zcard(val);
+    if (val->encoding == ZsetEncoding::LISTPACK)
+    {
+        val->pack.lp_rev_range(normalize_rank(min_rank, n), normalize_rank(max_rank, n), res);
+        return res;
+    }
+    index_rev_range(val, normalize_rank(min_rank, n), normalize_rank(max_rank, n), results);
+    res.reserve(results.size());
+    for (auto &p : results)
+    {
+        res.emplace_back(p->name, p->score);
+    }
+    return res;
+}
+
 std::vector<std::pair<std::string, double>> ZsetEntry::zall(Value *val)
 {
     std::vector<std::pair<std::string, double>> res;
-    std::vector<AVLNode *> results;
-    val->tree.avl_inorder(results);
-    for (auto &item : results)
+    std::vector<Entry_zset *> results;
+    if (val->encoding == ZsetEncoding::LISTPACK)
+    {
+        val->pack.lp_all(res);
+        return res;
+    }
+    index_all(val, results);
+    res.reserve(results.size());
+    for (auto &p : results)
     {
-        Entry_zset *p = container_of(item, Entry_zset, avl_node);
         res.emplace_back(p->name, p->score);
         // std::cout << p->name << " " << p->score << std::endl;
     }
     return res;
 }
 
+int ZsetEntry::normalize_rank(int rank, int n)
+{
+    return rank < 0 ? n + rank + 1 : rank;
+}
+
 uint64_t ZsetEntry::hash()
 {
-    uint32_t h = 0x811C9DC5;
-    for (char &ch : entry_.name)
-    {
-        h = (h + ch) * 0x01000193;
-    }
-    return h;
+    return str_hash(entry_.name);
 }
 
+#ifndef ZSET_USE_BTREE
 bool less(AVLNode *a, AVLNode *b)
 {
     Entry_zset *a_ = container_of(a, Entry_zset, avl_node);
@@ -251,4 +746,5 @@ bool less(AVLNode *a, AVLNode *b)
         return a_->name < b_->name;
     else
         return a_->score < b_->score;
-}
\ No newline at end of file
+}
+#endif
@@ -3,28 +3,59 @@
 #include <string>
 #include <cstdint>
 #include "./hashTable.h"
+#include "./object.h"
+#include "listpack.h"
+#ifdef ZSET_USE_BTREE
+#include "btree.h"
+#else
 #include "avl.h"
+#endif
 #include <vector>
 #include <utility>
 
-#define container_of(ptr, T, member) \
-    reinterpret_cast<T *>(reinterpret_cast<char *>(ptr) - offsetof(T, member))
+// 有序集合的编码方式
+enum class ZsetEncoding
+{
+    LISTPACK, // 小集合：所有元素紧凑存放在ListPack中
+    HASHTREE  // 大集合：哈希表 + 排序索引
+};
+
+// 小集合紧凑编码的转换阈值，任一条件超出即转换为哈希表+排序索引编码
+struct ZsetConfig
+{
+    uint32_t max_listpack_entries = 128; // 最大元素个数
+    uint32_t max_listpack_value = 64;    // 成员名最大长度
 
-// 将有序集的键值对数据抽象为一个结构体，成员存储在 hamp和tree中
+    uint32_t parallel_threshold = 1 << 16; // 集合运算的输入元素总数超过该值时，按成员哈希分区并行计算
+};
+
+extern ZsetConfig zset_config;
+
+// 将有序集的键值对数据抽象为一个结构体
+// 小集合成员存储在pack中，超出阈值后转换为存储在hmap和tree中
+// 排序索引由编译选项ZSET_USE_BTREE决定：默认使用AVL树，开启后使用B+树
 struct Value
 {
+    ZsetEncoding encoding = ZsetEncoding::LISTPACK;
+    ListPack pack;
     HMap hmap;
+#ifdef ZSET_USE_BTREE
+    BPTree tree;
+#else
     AVLTree tree;
+#endif
 };
 
 // 定义哈希表中存储一个ZsetNode对象
 struct ZsetNode
 {
-    std::string key; // 顶级哈希表中的关键字
+    Object obj{ObjType::ZSET}; // 顶级哈希表中的关键字
     Value *value;
-    HNode node;
 };
 
+// 释放整个有序集合
+void zset_free(ZsetNode *p);
+
 // 管理顶级哈希表中的ZsetNode
 class Zset
 {
@@ -36,14 +67,11 @@ public:
     // 在顶级哈希表中创建一个ZsetNode对象
     Value *create(HMap &hmap);
 
-    // 顶级哈希表中是否存在
+    // 顶级哈希表中是否存在，键存在但不是有序集合时抛出异常
     Value *exsit(HMap &hmap);
 
     // 在顶级哈希表中删除一个ZsetNode对象(删除整个有序集合)
     bool zdel(HMap &hmap);
-
-private:
-    uint64_t hash();
 };
 
 // 有序集中具体的一个元素
@@ -51,10 +79,48 @@ struct Entry_zset
 {
     double score;     // 分数
     std::string name; // 成员
+#ifndef ZSET_USE_BTREE
     AVLNode avl_node;
+#endif
     HNode hash_node;
 };
 
+// ZADD的可选标志
+enum ZaddFlag : uint32_t
+{
+    ZADD_NONE = 0,
+    ZADD_NX = 1 << 0,   // 只添加新元素，不更新已存在元素
+    ZADD_XX = 1 << 1,   // 只更新已存在元素，不添加新元素
+    ZADD_GT = 1 << 2,   // 新分数大于当前分数时才更新
+    ZADD_LT = 1 << 3,   // 新分数小于当前分数时才更新
+    ZADD_CH = 1 << 4,   // 返回值统计被修改的元素数(新增+分数变化)
+    ZADD_INCR = 1 << 5, // 分数作为增量，类似ZINCRBY
+};
+
+// 带标志的ZADD对单个元素的处理结果
+enum class ZaddResult
+{
+    ADDED,   // 新增
+    UPDATED, // 分数被修改
+    NOP      // 未修改(被标志拒绝或分数未变)
+};
+
+// 多集合运算类型
+enum class ZsetSetOp
+{
+    UNION, // 并集
+    INTER, // 交集
+    DIFF   // 差集：第一个集合减去其余集合
+};
+
+// 集合运算时同一成员多个分数的聚合方式
+enum class ZsetAggregate
+{
+    SUM,
+    MIN,
+    MAX
+};
+
 // 管理一个集合中的所有元素，即对顶级哈希表中的一个有序集的值的管理
 class ZsetEntry
 {
@@ -68,6 +134,15 @@ public:
     // ZADD key score member：添加一个元素sorted set ，如果已经存在则更新其score值
     bool zadd(Value *val);
 
+    // ZADD key [NX|XX|GT|LT|CH|INCR] score member：按标志添加或更新元素，newscore带回元素最终分数
+    ZaddResult zadd(Value *val, uint32_t flags, double &newscore);
+
+    // 向空集合批量添加元素，items中同名成员以最后一次出现为准，返回添加的元素个数
+    static int zbuild(Value *val, std::vector<std::pair<std::string, double>> &items);
+
+    // ZUNIONSTORE/ZINTERSTORE/ZDIFFSTORE的计算部分，srcs中nullptr表示集合不存在，返回(成员, 分数)结果集(无序)
+    static std::vector<std::pair<std::string, double>> zsetop(const std::vector<Value *> &srcs, const std::vector<double> &weights, ZsetAggregate agg, ZsetSetOp op);
+
     // ZREM key member：删除sorted set中的一个指定元素
     bool zrem(Value *val);
 
@@ -80,21 +155,35 @@ public:
     // ZCARD key：获取sorted set中的元素个数
     int zcard(Value *val);
 
-    // ZRANGE key min max：按照score排序后，获取指定排名范围内的元素
+    // ZRANGE key min max：按照score排序后，获取指定排名范围内的元素，负数排名表示从末尾倒数
     std::vector<std::pair<std::string, double>> zrange(Value *val, int min_rank, int max_rank);
 
+    // 按分数定位：返回分数小于score(inclusive时小于等于)的元素个数，即第一个不满足条件的元素排名减1
+    int zseek(Value *val, double score, bool inclusive);
+
+    // ZRANGEBYSCORE key min max：获取分数在[min, max]中的元素
+    std::vector<std::pair<std::string, double>> zrangebyscore(Value *val, double min_score, double max_score);
+
+    // ZREVRANGE key min max：按照score从大到小排序后，获取指定排名范围内的元素
+    std::vector<std::pair<std::string, double>> zrevrange(Value *val, int min_rank, int max_rank);
+
     //ZALL key :按照score排名后，返回集合所有元素
     std::vector<std::pair<std::string, double>> zall(Value *val);
 
 protected:
     uint64_t hash();
-};
 
-// 哈希比较 用于顶级哈希表key比较
-bool equals_(HNode *a, HNode *b);
+    // 写入前检查是否需要从紧凑编码转换
+    void try_convert(Value *val);
+
+    // 将负数排名转换为正数排名，-1表示最后一个元素
+    static int normalize_rank(int rank, int n);
+};
 
 // 哈希比较 用于集合内部哈希表key比较
 bool equals_entry(HNode *a, HNode *b);
 
+#ifndef ZSET_USE_BTREE
 // avl树节点的比较
-bool less(AVLNode *a, AVLNode *b);
\ No newline at end of file
+bool less(AVLNode *a, AVLNode *b);
+#endif
\ No newline at end of file
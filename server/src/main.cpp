@@ -16,6 +16,9 @@ int main()
 
     Logger::init(config);
 
+    // Prometheus抓取指标的HTTP端口，设为0不开启
+    metrics_config.port = 9121;
+
     Server server;
     server.run();
 
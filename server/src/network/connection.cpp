@@ -6,10 +6,38 @@
 #include <errno.h>
 #include <assert.h>
 #include "../utils/buffer/bufferPool.h"
+#include "../utils/latency/latency.h"
 #include <string.h>
 #include "../protocol/parser.h"
 #include "../protocol/serializer.h"
-#include <iostream>
+#include "../utils/utils.h"
+#include "../data_structures/global/globals.h"
+#include "../data_structures/object.h"
+#include <sys/uio.h>
+#include <algorithm>
+
+// 订阅者未写出的消息积压的上限，超过后断开连接，避免慢订阅者耗尽内存
+static const size_t k_max_shared_bytes = 32 << 20;
+
+// 订阅模式下只能执行的命令
+static bool allowed_in_subscribed(const std::string &name)
+{
+    return name == "SUBSCRIBE" || name == "UNSUBSCRIBE" || name == "PSUBSCRIBE" || name == "PUNSUBSCRIBE";
+}
+
+// MULTI期间不进入队列、直接执行的命令
+static bool is_txn_command(const std::string &name)
+{
+    return name == "MULTI" || name == "EXEC" || name == "DISCARD" || name == "WATCH" || name == "UNWATCH";
+}
+
+static Response make_reply(const std::string &msg)
+{
+    Response resp;
+    resp.type = ResponseType::SIMPLE_STRING;
+    resp.simple_string = msg;
+    return resp;
+}
 
 int Conntion::count = 0;
 
@@ -19,17 +47,24 @@ Conntion::Conntion(int fd)
     this->state.is_read = true;
     count++;
     this->uid = count;
+    server_stats.connected_clients++;
+    server_stats.total_connections++;
 }
 
 Conntion::~Conntion()
 {
+    pubsub.unsubscribe_all(this);
+    unwatch();
+    if (block.blocked)
+        server_stats.blocked_clients--;
+    server_stats.connected_clients--;
 }
 
 void Conntion::handle_read(CommandDispatcher &cmdDisp)
 {
     if (fd < 0)
     {
-        Logger::fatal("handle_read() 连接id为" + std::to_string(uid) + "的连接fd有误");
+        LOG_FATAL("handle_read() 连接id为" + std::to_string(uid) + "的连接fd有误");
         state.is_close = true;
         return;
     }
@@ -40,12 +75,12 @@ void Conntion::handle_read(CommandDispatcher &cmdDisp)
     {
         if (errno == EAGAIN)
         {
-            Logger::debug("handle_read() 连接id为" + std::to_string(uid) + "的连接系统调用read()被延误");
+            LOG_DEBUG("handle_read() 连接id为" + std::to_string(uid) + "的连接系统调用read()被延误");
             return;
         }
         else
         {
-            Logger::error("handle_read() 连接id为" + std::to_string(uid) + "的连接从内核缓冲区读数据发生错误");
+            LOG_ERROR("handle_read() 连接id为" + std::to_string(uid) + "的连接从内核缓冲区读数据发生错误");
             state.is_close = true;
             return;
         }
@@ -54,88 +89,344 @@ void Conntion::handle_read(CommandDispatcher &cmdDisp)
     {
         if (read_buffer.size() == 0)
         {
-            Logger::info("handle_read() 连接id为" + std::to_string(uid) + "的连接客户端断开连接");
+            LOG_INFO("handle_read() 连接id为" + std::to_string(uid) + "的连接客户端断开连接");
             state.is_close = true;
             return;
         }
         else
         {
-            Logger::error("handle_read() 连接id为" + std::to_string(uid) + "的连接意外EFO");
+            LOG_ERROR("handle_read() 连接id为" + std::to_string(uid) + "的连接意外EFO");
             state.is_close = true;
             return;
         }
     }
+    server_stats.net_input_bytes += rv;
     bufferPool read_bufferPool(read_buffer);
     read_bufferPool.buffer_append(buf, (uint32_t)rv);
-    Logger::debug("handle_read() 缓冲区大小：" + std::to_string(read_buffer.size()));
-    Logger::debug("handle_read() 入读数据长度：" + std::to_string(rv));
+    LOG_DEBUG("handle_read() 缓冲区大小：" + std::to_string(read_buffer.size()));
+    LOG_DEBUG("handle_read() 入读数据长度：" + std::to_string(rv));
     // Logger::debug("handle_read() 入读数据：" + std::string(buf, buf + rv));
 
-    while (try_one_request(cmdDisp))
+    process_requests(cmdDisp);
+}
+
+void Conntion::process_requests(CommandDispatcher &cmdDisp)
+{
+    // 阻塞期间后续的请求留在缓冲区中，解除阻塞后再按顺序处理
+    while (!block.blocked && try_one_request(cmdDisp))
     {
     }
 
-    if (write_buffer.size() > 0)
+    if (has_output())
     {
         state.is_read = false;
         state.is_write = true;
         handle_write();
     }
+    else if (block.blocked)
+        state.is_read = false;
+}
+
+void Conntion::append_response(const Response &resp)
+{
+    // 前面还有未写出的共享帧时排到它们后面
+    if (!shared_out.empty())
+    {
+        push_frame(make_frame(resp));
+        return;
+    }
+    // 将响应序列化
+    const std::string &res = Serializer::serialize(resp);
+    uint32_t resp_len = res.size();
+    // 将序列化后的响应写入缓冲
+    bufferPool write_bufferPool(write_buffer);
+    write_bufferPool.buffer_append((const uint8_t *)&resp_len, 4);
+    write_bufferPool.buffer_append((const uint8_t *)res.data(), resp_len);
+}
+
+void Conntion::push_frame(const SharedFrame &frame)
+{
+    if (state.is_close)
+        return;
+    if (shared_bytes + frame->size() > k_max_shared_bytes)
+    {
+        LOG_ERROR("push_frame() 连接id为" + std::to_string(uid) + "的连接积压的消息超过上限，断开连接");
+        state.is_close = true;
+        return;
+    }
+    shared_out.push_back(frame);
+    shared_bytes += frame->size();
+    state.is_write = true;
+}
+
+void Conntion::handle_pubsub(const Response &resp)
+{
+    const std::string &name = resp.simple_string;
+    bool pattern = name == "PSUBSCRIBE" || name == "PUNSUBSCRIBE";
+    bool sub = name == "SUBSCRIBE" || name == "PSUBSCRIBE";
+    std::string kind = (pattern ? "p" : "") + std::string(sub ? "subscribe" : "unsubscribe");
+
+    std::vector<std::string> targets;
+    for (const Response &item : resp.array)
+        targets.push_back(item.bulk_string);
+    // 不带参数的退订表示退订全部
+    if (!sub && targets.empty())
+    {
+        const std::unordered_set<std::string> &all = pattern ? subs.patterns : subs.channels;
+        targets.assign(all.begin(), all.end());
+    }
+
+    auto reply = [&](const std::string *target)
+    {
+        Response r;
+        r.type = ResponseType::ARRAY;
+        r.array.resize(3);
+        r.array[0].type = ResponseType::BULK_STRING;
+        r.array[0].bulk_string = kind;
+        r.array[1].type = target ? ResponseType::BULK_STRING : ResponseType::NULL_BULK_STRING;
+        if (target)
+            r.array[1].bulk_view = *target;
+        r.array[2].type = ResponseType::INTEGER;
+        r.array[2].integer = subs.count();
+        append_response(r);
+    };
+    if (targets.empty())
+        reply(nullptr);
+    for (const std::string &target : targets)
+    {
+        if (sub)
+            pattern ? pubsub.psubscribe(this, target) : pubsub.subscribe(this, target);
+        else
+            pattern ? pubsub.punsubscribe(this, target) : pubsub.unsubscribe(this, target);
+        reply(&target);
+    }
+}
+
+void Conntion::unwatch()
+{
+    if (txn.watched.empty())
+        return;
+    for (auto &w : txn.watched)
+        obj_unwatch(w.first);
+    txn.watched.clear();
+    watching_clients--;
+}
+
+void Conntion::queue_command(std::vector<std::string> &args, CommandDispatcher &cmdDisp)
+{
+    Response err;
+    if (!cmdDisp.check_command(args, err))
+    {
+        txn.dirty = true;
+        append_response(err);
+        return;
+    }
+    if (allowed_in_subscribed(args[0]))
+    {
+        txn.dirty = true;
+        append_response(make_reply("事务中不能执行订阅类命令"));
+        return;
+    }
+    txn.queued.push_back(std::move(args));
+    append_response(make_reply("QUEUED"));
+}
+
+/// @brief EXEC先按WATCH时记录的版本号逐个检查被监视的键，任何一个被改动过(包括创建后又删除)就放弃执行并回复空值，
+///        检查的代价只与WATCH的键数有关
+void Conntion::handle_transaction(const Response &resp, CommandDispatcher &cmdDisp)
+{
+    const std::string &name = resp.simple_string;
+    if (name == "MULTI")
+    {
+        if (txn.active)
+        {
+            append_response(make_reply("MULTI不能嵌套"));
+            return;
+        }
+        txn.active = true;
+        append_response(make_reply("OK"));
+    }
+    else if (name == "WATCH")
+    {
+        if (txn.active)
+        {
+            append_response(make_reply("WATCH不能在MULTI之后执行"));
+            return;
+        }
+        if (txn.watched.empty())
+            watching_clients++;
+        for (const Response &item : resp.array)
+        {
+            const std::string &key = item.bulk_string;
+            bool seen = false;
+            for (auto &w : txn.watched)
+                seen |= w.first == key;
+            // 重复WATCH同一个键时保留最早的版本号
+            if (!seen)
+                txn.watched.emplace_back(key, obj_watch(HMap_string, key));
+        }
+        append_response(make_reply("OK"));
+    }
+    else if (name == "UNWATCH")
+    {
+        unwatch();
+        append_response(make_reply("OK"));
+    }
+    else if (!txn.active)
+        append_response(make_reply(name + "之前没有MULTI"));
+    else
+    {
+        // EXEC或DISCARD都会结束事务并取消所有的WATCH
+        bool exec = name == "EXEC";
+        bool dirty = txn.dirty;
+        bool changed = false;
+        for (auto &w : txn.watched)
+            changed |= obj_version(HMap_string, w.first) != w.second;
+        std::vector<std::vector<std::string>> queued;
+        queued.swap(txn.queued);
+        txn.active = false;
+        txn.dirty = false;
+        unwatch();
+
+        if (!exec)
+            append_response(make_reply("OK"));
+        else if (dirty)
+            append_response(make_reply("事务中有命令出错，已放弃执行"));
+        else if (changed)
+        {
+            Response null;
+            null.type = ResponseType::NULL_BULK_STRING;
+            append_response(null);
+        }
+        else
+            append_response(cmdDisp.execute_transaction(queued, uid));
+    }
+}
+
+void Conntion::unblock()
+{
+    if (block.blocked)
+        server_stats.blocked_clients--;
+    block = BlockState();
+}
+
+bool Conntion::retry_blocked(CommandDispatcher &cmdDisp)
+{
+    Response resp = cmdDisp.execute_command(block.args, uid);
+    if (resp.type == ResponseType::BLOCKED)
+        return false;
+    unblock();
+    append_response(resp);
+    state.is_read = true;
+    process_requests(cmdDisp);
+    return true;
+}
+
+void Conntion::block_timeout(CommandDispatcher &cmdDisp)
+{
+    unblock();
+    Response resp;
+    resp.type = ResponseType::NULL_BULK_STRING;
+    append_response(resp);
+    state.is_read = true;
+    process_requests(cmdDisp);
 }
 
 void Conntion::handle_write()
 {
     if (fd < 0)
     {
-        Logger::fatal("handle_write() 连接id为" + std::to_string(uid) + "的连接fd有误");
+        LOG_FATAL("handle_write() 连接id为" + std::to_string(uid) + "的连接fd有误");
         state.is_close = true;
         return;
     }
 
-    if (write_buffer.size() == 0)
+    if (!has_output())
     {
-        Logger::debug("handle_write() 连接id为" + std::to_string(uid) + "的连接写入缓冲区为空");
+        LOG_DEBUG("handle_write() 连接id为" + std::to_string(uid) + "的连接写入缓冲区为空");
         return;
     }
 
-    ssize_t rv = write(fd, write_buffer.data(), write_buffer.size());
+    // 一次系统调用写出自有缓冲与若干共享帧
+    const int k_max_iov = 64;
+    struct iovec iov[k_max_iov];
+    int iovcnt = 0;
+    if (!write_buffer.empty())
+        iov[iovcnt++] = {write_buffer.data(), write_buffer.size()};
+    size_t off = shared_off;
+    for (auto it = shared_out.begin(); it != shared_out.end() && iovcnt < k_max_iov; ++it, off = 0)
+        iov[iovcnt++] = {(void *)((*it)->data() + off), (*it)->size() - off};
+
+    uint64_t start = cycles_now();
+    ssize_t rv = writev(fd, iov, iovcnt);
+    latency_sample("write", cycles_now() - start);
     if (rv < 0)
     {
         if (errno == EAGAIN)
         {
-            Logger::debug("handle_write() 连接id为" + std::to_string(uid) + "的连接系统调用write()被延误");
+            LOG_DEBUG("handle_write() 连接id为" + std::to_string(uid) + "的连接系统调用write()被延误");
             return;
         }
         else
         {
-            Logger::error("handle_write() 连接id为" + std::to_string(uid) + "的连接将数据写入内核缓冲区时发生错误");
+            LOG_ERROR("handle_write() 连接id为" + std::to_string(uid) + "的连接将数据写入内核缓冲区时发生错误");
             state.is_close = true;
             return;
         }
     }
 
+    size_t written = rv;
+    server_stats.net_output_bytes += written;
+    size_t own = std::min(written, write_buffer.size());
     bufferPool write_bufferPool(write_buffer);
-    write_bufferPool.buffer_consume((uint32_t)rv);
+    write_bufferPool.buffer_consume((uint32_t)own);
+    written -= own;
+    shared_bytes -= written;
+    while (written > 0)
+    {
+        size_t left = shared_out.front()->size() - shared_off;
+        if (written < left)
+        {
+            shared_off += written;
+            break;
+        }
+        written -= left;
+        shared_out.pop_front();
+        shared_off = 0;
+    }
 
-    if (write_buffer.size() == 0)
+    if (!has_output())
     {
         state.is_write = false;
-        state.is_read = true;
+        // 阻塞中的连接不再读取新的请求
+        state.is_read = !block.blocked;
+    }
+}
+
+// 把命令的参数用空格连接，用于调试日志
+static std::string join_args(const std::vector<std::string> &args)
+{
+    std::string out;
+    for (const std::string &a : args)
+    {
+        out += ' ';
+        out += a;
     }
+    return out;
 }
 
 bool Conntion::try_one_request(CommandDispatcher &cmdDisp)
 {
     if (fd < 0)
     {
-        Logger::fatal("try_one_request() 连接id为" + std::to_string(uid) + "的连接fd有误");
+        LOG_FATAL("try_one_request() 连接id为" + std::to_string(uid) + "的连接fd有误");
         return false;
     }
 
-    // 检查输入缓冲区数据是否足够
+    // 检查输入缓冲区数据是否足够，不够时等待下一次读取，是每次读取的正常结束
     if (read_buffer.size() < 4)
     {
-        Logger::error("try_one_request() 连接id为" + std::to_string(uid) + "的连接输入缓冲区数据不够首部长度");
+        LOG_DEBUG("try_one_request() 连接id为" + std::to_string(uid) + "的连接输入缓冲区数据不够首部长度");
         return false;
     }
     const int k_max_msg = 32 << 20;
@@ -143,39 +434,63 @@ bool Conntion::try_one_request(CommandDispatcher &cmdDisp)
     memcpy(&len, read_buffer.data(), 4);
     if (len > k_max_msg)
     {
-        Logger::error("try_one_request() 连接id为" + std::to_string(uid) + "的连接数据长度超过最大长度");
+        LOG_ERROR("try_one_request() 连接id为" + std::to_string(uid) + "的连接数据长度超过最大长度");
         return false;
     }
 
     if (read_buffer.size() < len + 4)
     {
-        Logger::error("try_one_request() 连接id为" + std::to_string(uid) + "的连接输入缓冲区数据不够请求体长度");
+        LOG_DEBUG("try_one_request() 连接id为" + std::to_string(uid) + "的连接输入缓冲区数据不够请求体长度");
         return false;
     }
 
     uint8_t *request_data = read_buffer.data() + 4;
-    bufferPool read_bufferPool(read_buffer);
-    read_bufferPool.buffer_consume(len + 4);
-
     std::vector<std::string> args;
     Parser p(request_data, len);
-    if (!p.parser_req(args))
+    int32_t ret = p.parser_req(args);
+    // 解析完成后再消费，消费会移动缓冲区中的数据，之后request_data不再有效
+    bufferPool read_bufferPool(read_buffer);
+    read_bufferPool.buffer_consume(len + 4);
+    if (!ret)
     {
-        Logger::debug("try_one_request() 命令解析成功");
-        for (auto &a : args)
+        LOG_DEBUG("try_one_request() 命令解析成功:" + join_args(args));
+        if (subs.count() > 0 && !allowed_in_subscribed(args[0]))
+        {
+            Response err;
+            err.type = ResponseType::SIMPLE_STRING;
+            err.simple_string = "订阅模式下只能执行SUBSCRIBE/UNSUBSCRIBE/PSUBSCRIBE/PUNSUBSCRIBE";
+            append_response(err);
+            return true;
+        }
+        if (txn.active && !is_txn_command(args[0]))
         {
-            std::cout << a << " ";
+            queue_command(args, cmdDisp);
+            return true;
         }
-        std::cout << std::endl;
         // 执行命令生成响应
-        Response resp = cmdDisp.execute_command(args);
-        // 将响应序列化
-        const std::string &res = Serializer::serialize(resp);
-        uint32_t resp_len = res.size();
-        // 将序列化后的响应写入缓冲
-        bufferPool write_bufferPool(write_buffer);
-        write_bufferPool.buffer_append((const uint8_t *)&resp_len, 4);
-        write_bufferPool.buffer_append((const uint8_t *)res.data(), resp_len);
+        Response resp = cmdDisp.execute_command(args, uid);
+        if (resp.type == ResponseType::PUBSUB)
+        {
+            handle_pubsub(resp);
+            return true;
+        }
+        if (resp.type == ResponseType::TRANSACTION)
+        {
+            handle_transaction(resp, cmdDisp);
+            return true;
+        }
+        if (resp.type == ResponseType::BLOCKED)
+        {
+            // 挂起连接，不写回复，由服务器加入等待队列与定时器
+            block.blocked = true;
+            server_stats.blocked_clients++;
+            block.args = resp.blocked_args.empty() ? std::move(args) : std::move(resp.blocked_args);
+            for (auto &key : resp.array)
+                block.keys.push_back(std::move(key.bulk_string));
+            block.deadline = resp.integer > 0 ? get_monotonic_ms() + resp.integer : 0;
+            return false;
+        }
+        append_response(resp);
         return true;
     }
     return false;
@@ -1,14 +1,45 @@
 #pragma once
 #include <vector>
+#include <deque>
+#include <unordered_set>
 #include <stdint.h>
 #include "../utils/logger/logger.h"
 #include"../command/command_dispatcher.h"
+#include "pubsub.h"
 
 struct State
 {
-    bool is_read;
-    bool is_write;
-    bool is_close;
+    bool is_read = false;
+    bool is_write = false;
+    bool is_close = false;
+};
+
+// 阻塞命令挂起时的状态
+struct BlockState
+{
+    bool blocked = false;           // 是否正在阻塞
+    bool registered = false;        // 是否已加入等待队列与定时器
+    std::vector<std::string> args;  // 被挂起的命令，唤醒后重新执行
+    std::vector<std::string> keys;  // 等待的键
+    uint64_t deadline = 0;          // 超时时刻(单调时钟毫秒)，0表示一直等待
+};
+
+// 发布订阅状态，订阅了任意频道或模式的连接进入订阅模式
+struct SubState
+{
+    std::unordered_set<std::string> channels;
+    std::unordered_set<std::string> patterns;
+
+    size_t count() const { return channels.size() + patterns.size(); }
+};
+
+// 事务状态
+struct TxnState
+{
+    bool active = false; // 处于MULTI之后、EXEC/DISCARD之前
+    bool dirty = false;  // 排队时有命令出错，EXEC时放弃整个事务
+    std::vector<std::vector<std::string>> queued;
+    std::vector<std::pair<std::string, uint64_t>> watched; // WATCH的键及当时的版本号
 };
 
 class Conntion
@@ -17,8 +48,15 @@ private:
     int fd; // 连接对应的文件描述
     std::vector<uint8_t> read_buffer;
     std::vector<uint8_t> write_buffer;
+    // 排在write_buffer之后的共享帧(发布的消息)，队列非空时新的响应也追加到队列中以保持顺序
+    std::deque<SharedFrame> shared_out;
+    size_t shared_off = 0;   // 队首帧已写出的字节数
+    size_t shared_bytes = 0; // 队列中未写出的总字节数
 
     State state;
+    BlockState block;
+    SubState subs;
+    TxnState txn;
     int uid;          // 每个连接的唯一id
     static int count; // 记录连接数量
 
@@ -30,7 +68,33 @@ public:
     void handle_write();
     bool try_one_request( CommandDispatcher &cmdDisp);
 
+    // 挂起的命令被唤醒后重新执行，执行成功返回true并继续处理缓冲区中剩余的请求
+    bool retry_blocked(CommandDispatcher &cmdDisp);
+    // 阻塞超时，回复空值并继续处理缓冲区中剩余的请求
+    void block_timeout(CommandDispatcher &cmdDisp);
+
     int get_fd() { return fd; }
     State get_state() { return state; }
     int get_id() { return uid; }
+    BlockState &get_block() { return block; }
+    SubState &get_subs() { return subs; }
+
+    // 推送一帧共享的消息，积压超过上限的订阅者会被断开
+    void push_frame(const SharedFrame &frame);
+
+private:
+    // 将响应序列化后写入输出缓冲
+    void append_response(const Response &resp);
+    // 处理缓冲区中的请求直到数据不足或命令阻塞，然后尝试写出响应
+    void process_requests(CommandDispatcher &cmdDisp);
+    // 解除阻塞状态
+    void unblock();
+    // 执行SUBSCRIBE/UNSUBSCRIBE/PSUBSCRIBE/PUNSUBSCRIBE，每个频道或模式回复一帧
+    void handle_pubsub(const Response &resp);
+    // 执行MULTI/EXEC/DISCARD/WATCH/UNWATCH
+    void handle_transaction(const Response &resp, CommandDispatcher &cmdDisp);
+    // MULTI期间把命令加入队列
+    void queue_command(std::vector<std::string> &args, CommandDispatcher &cmdDisp);
+    void unwatch();
+    bool has_output() const { return !write_buffer.empty() || !shared_out.empty(); }
 };
\ No newline at end of file
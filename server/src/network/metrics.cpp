@@ -0,0 +1,282 @@
+#include "metrics.h"
+#include "pubsub.h"
+#include "../data_structures/global/globals.h"
+#include "../utils/latency/latency.h"
+#include "../utils/utils.h"
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <algorithm>
+#include <ctype.h>
+
+MetricsConfig metrics_config;
+
+// 命令耗时直方图的上界(微秒)：1us到约1s的2的幂
+static const std::vector<uint64_t> &duration_bounds_us()
+{
+    static const std::vector<uint64_t> bounds = []
+    {
+        std::vector<uint64_t> b;
+        for (uint64_t us = 1; us <= (1 << 20); us <<= 1)
+            b.push_back(us);
+        return b;
+    }();
+    return bounds;
+}
+
+static std::string format_double(double v)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    return buf;
+}
+
+static std::string lower(std::string s)
+{
+    for (char &c : s)
+        c = tolower((unsigned char)c);
+    return s;
+}
+
+static void family_header(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+static void sample(std::string &out, const char *name, const std::string &labels, const std::string &value)
+{
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+static void scalar(std::string &out, const char *name, const char *type, const char *help, uint64_t value)
+{
+    family_header(out, name, type, help);
+    sample(out, name, "", std::to_string(value));
+}
+
+/// @brief 进程级的指标量少，作为一段一次渲染
+static void render_server(std::string &out)
+{
+    scalar(out, "redis_uptime_seconds", "gauge", "Seconds since the server started.", (get_monotonic_ms() - server_stats.start_ms) / 1000);
+    scalar(out, "redis_connected_clients", "gauge", "Number of client connections.", server_stats.connected_clients);
+    scalar(out, "redis_blocked_clients", "gauge", "Clients blocked on BLPOP/BRPOP/BLMOVE/XREAD.", server_stats.blocked_clients);
+    scalar(out, "redis_connections_received_total", "counter", "Connections accepted since start.", server_stats.total_connections);
+    scalar(out, "redis_net_input_bytes_total", "counter", "Bytes read from clients.", server_stats.net_input_bytes);
+    scalar(out, "redis_net_output_bytes_total", "counter", "Bytes written to clients.", server_stats.net_output_bytes);
+    uint64_t used = used_memory();
+    scalar(out, "redis_memory_used_bytes", "gauge", "Heap bytes in use by the allocator.", used);
+    scalar(out, "redis_memory_rss_bytes", "gauge", "Resident set size of the process.", rss_memory());
+    scalar(out, "redis_memory_peak_bytes", "gauge", "Peak heap bytes in use.", std::max<uint64_t>(server_stats.peak_memory, used));
+    scalar(out, "redis_keyspace_keys", "gauge", "Number of keys.", HMap_string.hm_size());
+    scalar(out, "redis_keyspace_slots", "gauge", "Slots of the top-level hash table.", HMap_string.hm_slots());
+    scalar(out, "redis_keyspace_rehashing", "gauge", "Whether the top-level hash table is rehashing.", HMap_string.hm_rehashing());
+    scalar(out, "redis_pubsub_channels", "gauge", "Channels with at least one subscriber.", pubsub.channel_count());
+    scalar(out, "redis_pubsub_patterns", "gauge", "Subscribed patterns.", pubsub.pattern_count());
+}
+
+// 每个命令一组样本的指标族
+struct CommandFamily
+{
+    const char *name;
+    const char *type;
+    const char *help;
+    void (*render)(std::string &out, const char *name, const Command &cmd);
+};
+
+static std::string cmd_label(const Command &cmd)
+{
+    return "cmd=\"" + lower(cmd.name) + "\"";
+}
+
+static void render_calls(std::string &out, const char *name, const Command &cmd)
+{
+    sample(out, name, cmd_label(cmd), std::to_string(cmd.stats.calls));
+}
+
+static void render_failed(std::string &out, const char *name, const Command &cmd)
+{
+    sample(out, name, cmd_label(cmd), std::to_string(cmd.stats.failed_calls));
+}
+
+static void render_rejected(std::string &out, const char *name, const Command &cmd)
+{
+    sample(out, name, cmd_label(cmd), std::to_string(cmd.stats.rejected_calls));
+}
+
+static void render_duration(std::string &out, const char *name, const Command &cmd)
+{
+    double per_us = cycles_per_us();
+    const std::vector<uint64_t> &bounds_us = duration_bounds_us();
+    std::vector<uint64_t> bounds;
+    bounds.reserve(bounds_us.size());
+    for (uint64_t us : bounds_us)
+        bounds.push_back((uint64_t)(us * per_us));
+    std::vector<uint64_t> counts = cmd.stats.latency.counts_at(bounds);
+
+    std::string label = cmd_label(cmd);
+    std::string bucket = std::string(name) + "_bucket";
+    for (size_t i = 0; i < bounds_us.size(); i++)
+        sample(out, bucket.c_str(), label + ",le=\"" + format_double(bounds_us[i] / 1e6) + "\"", std::to_string(counts[i]));
+    sample(out, bucket.c_str(), label + ",le=\"+Inf\"", std::to_string(cmd.stats.latency.count()));
+    sample(out, (std::string(name) + "_sum").c_str(), label, format_double(cmd.stats.cycles / per_us / 1e6));
+    sample(out, (std::string(name) + "_count").c_str(), label, std::to_string(cmd.stats.latency.count()));
+}
+
+static const CommandFamily command_families[] = {
+    {"redis_commands_total", "counter", "Handler calls per command.", &render_calls},
+    {"redis_commands_failed_total", "counter", "Calls whose handler returned an error.", &render_failed},
+    {"redis_commands_rejected_total", "counter", "Calls rejected for a wrong number of arguments.", &render_rejected},
+    {"redis_command_duration_seconds", "histogram", "Handler execution time per command.", &render_duration},
+};
+static const size_t k_command_families = sizeof(command_families) / sizeof(command_families[0]);
+
+static void render_latency_events(std::string &out)
+{
+    const auto &events = latency_monitor.all();
+    std::vector<std::string> names;
+    for (const auto &kv : events)
+        names.push_back(kv.first);
+    std::sort(names.begin(), names.end());
+
+    family_header(out, "redis_latency_spike_last_milliseconds", "gauge", "Latest event-loop stall above the latency monitor threshold.");
+    for (const std::string &name : names)
+        sample(out, "redis_latency_spike_last_milliseconds", "event=\"" + name + "\"", std::to_string(events.at(name).latest().latency));
+    family_header(out, "redis_latency_spike_max_milliseconds", "gauge", "Largest event-loop stall above the latency monitor threshold.");
+    for (const std::string &name : names)
+        sample(out, "redis_latency_spike_max_milliseconds", "event=\"" + name + "\"", std::to_string(events.at(name).max));
+}
+
+MetricsRenderer::MetricsRenderer(const CommandDispatcher &disp)
+{
+    for (const Command *cmd : disp.commands())
+        if (cmd->stats.calls > 0 || cmd->stats.rejected_calls > 0)
+            cmds.push_back(cmd);
+}
+
+/// @brief 段的顺序：进程级指标，各命令指标族(每族先头部再逐个命令)，延迟监控事件
+bool MetricsRenderer::next(std::string &out)
+{
+    if (family == 0)
+    {
+        render_server(out);
+        family++;
+        return true;
+    }
+    if (family <= k_command_families)
+    {
+        const CommandFamily &f = command_families[family - 1];
+        if (item == 0)
+            family_header(out, f.name, f.type, f.help);
+        if (item < cmds.size())
+            f.render(out, f.name, *cmds[item]);
+        if (++item >= cmds.size())
+        {
+            family++;
+            item = 0;
+        }
+        return true;
+    }
+    if (family == k_command_families + 1)
+    {
+        render_latency_events(out);
+        family++;
+        return true;
+    }
+    return false;
+}
+
+void MetricsConn::handle_read(const CommandDispatcher &disp)
+{
+    char buf[4096];
+    ssize_t rv = read(fd, buf, sizeof(buf));
+    if (rv < 0 && errno == EAGAIN)
+        return;
+    if (rv <= 0)
+    {
+        closed = true;
+        return;
+    }
+    request.append(buf, rv);
+    if (request.find("\r\n\r\n") != std::string::npos)
+    {
+        respond(disp);
+        handle_write();
+    }
+    else if (request.size() > metrics_config.max_request)
+    {
+        responding = true;
+        output = "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        handle_write();
+    }
+}
+
+void MetricsConn::respond(const CommandDispatcher &disp)
+{
+    responding = true;
+    std::string line = request.substr(0, request.find("\r\n"));
+    std::string method = line.substr(0, line.find(' '));
+    std::string path = line.size() > method.size() ? line.substr(method.size() + 1) : "";
+    path = path.substr(0, path.find(' '));
+    path = path.substr(0, path.find('?'));
+
+    if (method != "GET")
+        output = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    else if (path != "/metrics")
+        output = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    else
+    {
+        output = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nConnection: close\r\n\r\n";
+        renderer.emplace(disp);
+    }
+}
+
+void MetricsConn::handle_write()
+{
+    while (true)
+    {
+        if (output.size() - output_off < metrics_config.render_chunk && renderer)
+        {
+            output.erase(0, output_off);
+            output_off = 0;
+            size_t target = output.size() + metrics_config.render_chunk;
+            while (output.size() < target && renderer->next(output))
+                ;
+            if (output.size() < target)
+                renderer.reset();
+        }
+        if (output_off == output.size())
+        {
+            if (!renderer)
+                closed = true;
+            return;
+        }
+        ssize_t rv = write(fd, output.data() + output_off, output.size() - output_off);
+        if (rv < 0)
+        {
+            if (errno != EAGAIN)
+                closed = true;
+            return;
+        }
+        output_off += rv;
+        // 本轮已渲染过一段，剩下的留到下一次可写时，避免一次抓取长时间占用事件循环
+        if (output_off < output.size() || renderer)
+            return;
+    }
+}
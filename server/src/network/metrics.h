@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../command/command_dispatcher.h"
+
+struct MetricsConfig
+{
+    int port = 0;                   // /metrics的监听端口，0表示不开启
+    size_t render_chunk = 16 << 10; // 每轮事件循环为一个抓取连接最多渲染的字节数
+    size_t max_request = 8 << 10;   // HTTP请求头的最大长度
+};
+
+extern MetricsConfig metrics_config;
+
+/*按Prometheus文本格式分段渲染指标*/
+// 游标按(指标族, 命令)推进，每次只渲染一个指标族的头部或一个命令在该族中的样本，
+// 同一指标族的样本连续输出；渲染过程中统计可能继续变化，各段取的是渲染到该段时的值
+class MetricsRenderer
+{
+private:
+    std::vector<const Command *> cmds; // 执行过的命令，开始渲染时确定
+    size_t family = 0;
+    size_t item = 0;
+
+public:
+    explicit MetricsRenderer(const CommandDispatcher &disp);
+
+    // 向out追加下一段，全部渲染完返回false
+    bool next(std::string &out);
+};
+
+/*抓取/metrics的HTTP连接：读完请求头后边渲染边写出，写完后关闭(响应以关闭连接结束，不需要Content-Length)*/
+class MetricsConn
+{
+private:
+    int fd;
+    std::string request;
+    std::string output;
+    size_t output_off = 0;
+    std::optional<MetricsRenderer> renderer; // 请求为GET /metrics时才有
+    bool responding = false;
+    bool closed = false;
+
+    // 解析请求行，准备响应头与渲染器
+    void respond(const CommandDispatcher &disp);
+
+public:
+    explicit MetricsConn(int fd) : fd(fd) {}
+
+    int get_fd() const { return fd; }
+    bool want_read() const { return !responding; }
+    bool want_write() const { return responding; }
+    bool is_closed() const { return closed; }
+
+    void handle_read(const CommandDispatcher &disp);
+    // 输出缓冲中未写出的数据不足一段时再渲染一段，写不动时等待下一次可写
+    void handle_write();
+};
@@ -0,0 +1,160 @@
+#include "pubsub.h"
+#include "connection.h"
+#include "../protocol/serializer.h"
+#include <algorithm>
+
+PubSub pubsub;
+
+SharedFrame make_frame(const Response &resp)
+{
+    const std::string &res = Serializer::serialize(resp);
+    uint32_t len = res.size();
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(4 + len);
+    frame->append((const char *)&len, 4);
+    frame->append(res);
+    return frame;
+}
+
+// 订阅者的顺序无关，用末尾元素填补被删除的位置
+static bool remove_sub(std::vector<Conntion *> &subs, Conntion *conn)
+{
+    auto it = std::find(subs.begin(), subs.end(), conn);
+    if (it == subs.end())
+        return false;
+    *it = subs.back();
+    subs.pop_back();
+    return true;
+}
+
+bool PubSub::subscribe(Conntion *conn, const std::string &channel)
+{
+    if (!conn->get_subs().channels.insert(channel).second)
+        return false;
+    channels[channel].push_back(conn);
+    return true;
+}
+
+bool PubSub::psubscribe(Conntion *conn, const std::string &pattern)
+{
+    if (!conn->get_subs().patterns.insert(pattern).second)
+        return false;
+    std::unique_ptr<PatternSub> &ps = patterns[pattern];
+    if (!ps)
+    {
+        ps = std::make_unique<PatternSub>(pattern);
+        PatternTrie *node = &trie;
+        for (unsigned char c : ps->matcher.prefix())
+        {
+            std::unique_ptr<PatternTrie> &child = node->next[c];
+            if (!child)
+                child = std::make_unique<PatternTrie>();
+            node = child.get();
+        }
+        node->subs.push_back(ps.get());
+    }
+    ps->subs.push_back(conn);
+    return true;
+}
+
+bool PubSub::unsubscribe(Conntion *conn, const std::string &channel)
+{
+    if (!conn->get_subs().channels.erase(channel))
+        return false;
+    auto it = channels.find(channel);
+    remove_sub(it->second, conn);
+    if (it->second.empty())
+        channels.erase(it);
+    return true;
+}
+
+bool PubSub::trie_erase(PatternTrie &node, const std::string &prefix, size_t depth, PatternSub *ps)
+{
+    if (depth == prefix.size())
+        node.subs.erase(std::find(node.subs.begin(), node.subs.end(), ps));
+    else
+    {
+        auto it = node.next.find((unsigned char)prefix[depth]);
+        if (trie_erase(*it->second, prefix, depth + 1, ps))
+            node.next.erase(it);
+    }
+    return node.subs.empty() && node.next.empty();
+}
+
+bool PubSub::punsubscribe(Conntion *conn, const std::string &pattern)
+{
+    if (!conn->get_subs().patterns.erase(pattern))
+        return false;
+    auto it = patterns.find(pattern);
+    PatternSub *ps = it->second.get();
+    remove_sub(ps->subs, conn);
+    if (ps->subs.empty())
+    {
+        trie_erase(trie, ps->matcher.prefix(), 0, ps);
+        patterns.erase(it);
+    }
+    return true;
+}
+
+void PubSub::unsubscribe_all(Conntion *conn)
+{
+    // 退订会修改集合本身，先拷贝出来
+    SubState &subs = conn->get_subs();
+    std::vector<std::string> names(subs.channels.begin(), subs.channels.end());
+    for (const std::string &name : names)
+        unsubscribe(conn, name);
+    names.assign(subs.patterns.begin(), subs.patterns.end());
+    for (const std::string &name : names)
+        punsubscribe(conn, name);
+}
+
+/// @brief 每条消息只序列化一次，所有订阅者的输出队列共享同一帧；
+///        模式沿字典树按频道名的前缀逐层收集候选，只对前缀相符的模式做匹配
+size_t PubSub::publish(const std::string &channel, const std::string &message)
+{
+    size_t receivers = 0;
+    auto it = channels.find(channel);
+    if (it != channels.end())
+    {
+        Response resp;
+        resp.type = ResponseType::ARRAY;
+        resp.array.resize(3);
+        for (Response &item : resp.array)
+            item.type = ResponseType::BULK_STRING;
+        resp.array[0].bulk_view = "message";
+        resp.array[1].bulk_view = channel;
+        resp.array[2].bulk_view = message;
+        SharedFrame frame = make_frame(resp);
+        for (Conntion *conn : it->second)
+            conn->push_frame(frame);
+        receivers += it->second.size();
+    }
+
+    const PatternTrie *node = &trie;
+    for (size_t depth = 0; node; depth++)
+    {
+        for (PatternSub *ps : node->subs)
+        {
+            if (!ps->matcher.match(channel))
+                continue;
+            Response resp;
+            resp.type = ResponseType::ARRAY;
+            resp.array.resize(4);
+            for (Response &item : resp.array)
+                item.type = ResponseType::BULK_STRING;
+            resp.array[0].bulk_view = "pmessage";
+            resp.array[1].bulk_view = ps->pattern;
+            resp.array[2].bulk_view = channel;
+            resp.array[3].bulk_view = message;
+            SharedFrame frame = make_frame(resp);
+            for (Conntion *conn : ps->subs)
+                conn->push_frame(frame);
+            receivers += ps->subs.size();
+        }
+        if (depth == channel.size())
+            break;
+        auto next = node->next.find((unsigned char)channel[depth]);
+        node = next == node->next.end() ? nullptr : next->second.get();
+    }
+    return receivers;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../utils/match/match.h"
+#include "../protocol/serializer.h"
+
+class Conntion;
+
+// 编码好的一帧响应(4字节长度首部+RESP)，一次发布只编码一次，由所有订阅者的输出队列共享
+using SharedFrame = std::shared_ptr<const std::string>;
+
+// 一个模式及订阅它的连接
+struct PatternSub
+{
+    std::string pattern;
+    GlobPattern matcher; // 订阅时编译一次，发布时直接匹配
+    std::vector<Conntion *> subs;
+
+    explicit PatternSub(const std::string &p) : pattern(p), matcher(p) {}
+};
+
+// 按模式的字面前缀(第一个通配符之前的部分)组织的字典树，
+// 发布时沿频道名走一遍即可找出前缀相符的模式，前缀不符的模式不参与匹配
+struct PatternTrie
+{
+    std::map<unsigned char, std::unique_ptr<PatternTrie>> next;
+    std::vector<PatternSub *> subs; // 字面前缀恰好在此结束的模式
+};
+
+class PubSub
+{
+private:
+    std::unordered_map<std::string, std::vector<Conntion *>> channels; // 频道 -> 订阅的连接
+    std::unordered_map<std::string, std::unique_ptr<PatternSub>> patterns;
+    PatternTrie trie;
+
+    // 从字典树中摘除模式，并删除沿途变空的节点
+    static bool trie_erase(PatternTrie &node, const std::string &prefix, size_t depth, PatternSub *ps);
+
+public:
+    // 返回是否新增了订阅，已订阅时返回false
+    bool subscribe(Conntion *conn, const std::string &channel);
+    bool psubscribe(Conntion *conn, const std::string &pattern);
+
+    // 返回是否退订成功，未订阅时返回false
+    bool unsubscribe(Conntion *conn, const std::string &channel);
+    bool punsubscribe(Conntion *conn, const std::string &pattern);
+
+    // 退订连接的所有频道与模式，连接关闭时调用
+    void unsubscribe_all(Conntion *conn);
+
+    // 向频道发布消息，返回收到消息的订阅者数(通过多个模式收到的连接按次数计)
+    size_t publish(const std::string &channel, const std::string &message);
+
+    // 有订阅者的频道数与模式数
+    size_t channel_count() const { return channels.size(); }
+    size_t pattern_count() const { return patterns.size(); }
+};
+
+extern PubSub pubsub;
+
+// 将响应编码为一帧
+SharedFrame make_frame(const Response &resp);
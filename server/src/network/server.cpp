@@ -6,19 +6,28 @@
 #include "../utils/utils.h"
 #include <string>
 #include "../data_structures/global/globals.h"
+#include "../data_structures/object.h"
+#include <algorithm>
+#include <signal.h>
 
 HMap HMap_string = HMap();
 
 Server::Server()
 {
+    // 向已断开的客户端(如还没来得及发现断开的订阅者)写数据时，由write返回EPIPE并关闭连接，而不是终止进程
+    signal(SIGPIPE, SIG_IGN);
+
+    server_stats.start_ms = get_monotonic_ms();
+    server_stats.tcp_port = 1234;
+
     addr.sin_family = AF_INET;
-    addr.sin_port = ntohs(1234);
+    addr.sin_port = ntohs(server_stats.tcp_port);
     addr.sin_addr.s_addr = ntohl(0);
 
     fd = socket(AF_INET, SOCK_STREAM, 0);
     if (fd < 0)
     {
-        Logger::fatal("Server() 监听fd无效");
+        LOG_FATAL("Server() 监听fd无效");
     }
 
     int val = 1;
@@ -27,7 +36,7 @@ Server::Server()
     int rv = bind(fd, (const sockaddr *)&addr, sizeof(addr));
     if (rv)
     {
-        Logger::fatal("Server() 绑定fd失败");
+        LOG_FATAL("Server() 绑定fd失败");
     }
 
     // 设置监听套接字为非阻塞模式
@@ -36,8 +45,57 @@ Server::Server()
     rv = listen(fd, SOMAXCONN);
     if (rv)
     {
-        Logger::fatal("Server() 监听失败");
+        LOG_FATAL("Server() 监听失败");
+    }
+
+    if (metrics_config.port > 0)
+        metrics_listen();
+}
+
+void Server::metrics_listen()
+{
+    struct sockaddr_in maddr = {};
+    maddr.sin_family = AF_INET;
+    maddr.sin_port = ntohs(metrics_config.port);
+    maddr.sin_addr.s_addr = ntohl(0);
+
+    int mfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (mfd < 0)
+    {
+        LOG_ERROR("metrics_listen() 监听fd无效");
+        return;
+    }
+    int val = 1;
+    setsockopt(mfd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+    if (bind(mfd, (const sockaddr *)&maddr, sizeof(maddr)) || listen(mfd, SOMAXCONN))
+    {
+        LOG_ERROR("metrics_listen() 绑定或监听端口" + std::to_string(metrics_config.port) + "失败");
+        close(mfd);
+        return;
     }
+    fd_set_nonblock(mfd);
+    metrics_fd = mfd;
+}
+
+void Server::metrics_accept()
+{
+    int connfd = accept(metrics_fd, NULL, NULL);
+    if (connfd < 0)
+    {
+        LOG_ERROR("metrics_accept() 获取新连接fd失败");
+        return;
+    }
+    fd_set_nonblock(connfd);
+    if (metrics_pool.size() <= (size_t)connfd)
+        metrics_pool.resize(connfd + 1);
+    metrics_pool[connfd] = new MetricsConn(connfd);
+}
+
+void Server::close_metrics(MetricsConn *conn)
+{
+    close(conn->get_fd());
+    metrics_pool[conn->get_fd()] = NULL;
+    delete conn;
 }
 
 Server::~Server()
@@ -46,67 +104,257 @@ Server::~Server()
 
 void Server::run()
 {
-    Logger::debug("Redis 服务器开始运行");
+    LOG_DEBUG("Redis 服务器开始运行");
     while (true)
     {
         pollfd_args.clear();
         struct pollfd pfd = {fd, POLLIN, 0};
-        // 监听fd位于poll数组起始位置
+        // 监听fd位于poll数组起始位置，开启/metrics时其监听fd紧随其后
         pollfd_args.push_back(pfd);
+        if (metrics_fd >= 0)
+            pollfd_args.push_back({metrics_fd, POLLIN, 0});
+        size_t nlisten = pollfd_args.size();
 
         // 将旧连接加入poll数组以待重新轮询
         for (Conntion *conn : conn_pool)
         {
             if (!conn)
                 continue;
+            // 被标记关闭但没有IO事件的连接(如积压过多的订阅者)在这里关闭
+            if (conn->get_state().is_close)
+            {
+                close_conn(conn);
+                continue;
+            }
             pfd = {conn->get_fd(), POLLERR, 0};
             State conn_state = conn->get_state();
             if (conn_state.is_read)
                 pfd.events |= POLLIN;
             if (conn_state.is_write)
                 pfd.events |= POLLOUT;
+            // 阻塞中的连接不读取新请求，但需要感知客户端断开
+            if (conn->get_block().blocked)
+                pfd.events |= POLLRDHUP;
+            pollfd_args.push_back(pfd);
+        }
+
+        // 抓取指标的连接，读请求时等待可读，响应时等待可写
+        for (MetricsConn *mconn : metrics_pool)
+        {
+            if (!mconn)
+                continue;
+            if (mconn->is_closed())
+            {
+                close_metrics(mconn);
+                continue;
+            }
+            pfd = {mconn->get_fd(), (short)(mconn->want_read() ? POLLIN : POLLOUT), 0};
             pollfd_args.push_back(pfd);
         }
 
-        int rv = poll(pollfd_args.data(), (nfds_t)pollfd_args.size(), -1);
+        // 没有事件时最多等到最近的定时器到期或下一次周期任务
+        int timeout = next_timer_ms();
+        if (timeout < 0 || timeout > k_cron_interval_ms)
+            timeout = k_cron_interval_ms;
+        int rv = poll(pollfd_args.data(), (nfds_t)pollfd_args.size(), timeout);
         if (rv < 0 && errno == EINTR)
             continue;
         if (rv < 0)
-            Logger::fatal("run() poll轮询失败");
+            LOG_FATAL("run() poll轮询失败");
 
         // 处理监听套接字
         if (pollfd_args[0].revents == POLLIN)
         {
             Conntion *conn = handle_accept();
-            if (!conn)
-                continue;
-            if (conn_pool.size() <= conn->get_fd())
-                conn_pool.resize(conn->get_fd() + 1);
-            conn_pool[conn->get_fd()] = conn;
+            if (conn)
+            {
+                if (conn_pool.size() <= (size_t)conn->get_fd())
+                    conn_pool.resize(conn->get_fd() + 1);
+                conn_pool[conn->get_fd()] = conn;
+            }
         }
 
+        if (metrics_fd >= 0 && (pollfd_args[1].revents & POLLIN))
+            metrics_accept();
+
         // 处理连接套接字
-        for (size_t i = 1; i < pollfd_args.size(); i++)
+        for (size_t i = nlisten; i < pollfd_args.size(); i++)
         {
             uint32_t revents = pollfd_args[i].revents;
             if (revents == 0)
                 continue;
-            Conntion *conn = conn_pool[pollfd_args[i].fd];
+            size_t cfd = pollfd_args[i].fd;
+            Conntion *conn = cfd < conn_pool.size() ? conn_pool[cfd] : nullptr;
+            if (!conn)
+            {
+                MetricsConn *mconn = cfd < metrics_pool.size() ? metrics_pool[cfd] : nullptr;
+                if (!mconn)
+                    continue;
+                if (revents & POLLIN)
+                    mconn->handle_read(cmdDisp);
+                if (revents & POLLOUT)
+                    mconn->handle_write();
+                if ((revents & (POLLERR | POLLHUP)) || mconn->is_closed())
+                    close_metrics(mconn);
+                continue;
+            }
             if (revents & POLLIN)
                 conn->handle_read(cmdDisp);
             if (revents & POLLOUT)
                 conn->handle_write();
-            // 连接状态设置为关闭的逻辑有问题，不能实现客户端通过一个连接连续请求  先将其注释掉以实现客户端通过一个连接连续请求
-            // 导致现在服务端无法正确处理客户端主动断开连接的情况
-            if ((revents & POLLERR) /*|| conn->get_state().is_close*/)
+            if ((revents & (POLLERR | POLLHUP | POLLRDHUP)) || conn->get_state().is_close)
+            {
+                close_conn(conn);
+                continue;
+            }
+            after_process(conn);
+        }
+
+        // 本轮命令写入的键唤醒阻塞的连接，然后处理超时
+        handle_ready_keys();
+        handle_timers();
+        cron();
+    }
+}
+
+void Server::cron()
+{
+    uint64_t now = get_monotonic_ms();
+    if (now - last_cron_ms < (uint64_t)k_cron_interval_ms)
+        return;
+    last_cron_ms = now;
+    server_stats.ops.sample(now, cmdDisp.total_calls());
+    server_stats.input.sample(now, server_stats.net_input_bytes);
+    server_stats.output.sample(now, server_stats.net_output_bytes);
+    server_stats.peak_memory = std::max<uint64_t>(server_stats.peak_memory, used_memory());
+}
+
+void Server::close_conn(Conntion *conn)
+{
+    if (conn->get_block().registered)
+        block_unregister(conn);
+    close(conn->get_fd());
+    LOG_DEBUG("连接关闭 id为" + std::to_string(conn->get_id()) + " fd为" + std::to_string(conn->get_fd()));
+    conn_pool[conn->get_fd()] = NULL;
+    delete conn;
+}
+
+void Server::after_process(Conntion *conn)
+{
+    BlockState &block = conn->get_block();
+    if (block.blocked && !block.registered)
+        block_register(conn);
+}
+
+void Server::block_register(Conntion *conn)
+{
+    BlockState &block = conn->get_block();
+    for (const std::string &key : block.keys)
+        blocking_keys[key].push_back(conn->get_fd());
+    if (block.deadline)
+        timers.push({block.deadline, conn->get_fd(), conn->get_id()});
+    block.registered = true;
+}
+
+void Server::block_unregister(Conntion *conn)
+{
+    for (const std::string &key : conn->get_block().keys)
+    {
+        auto it = blocking_keys.find(key);
+        if (it == blocking_keys.end())
+            continue;
+        std::deque<int> &q = it->second;
+        for (auto qit = q.begin(); qit != q.end(); ++qit)
+        {
+            if (*qit == conn->get_fd())
             {
-                close(conn->get_fd());
-                Logger::debug("连接关闭 id为" + std::to_string(conn->get_id()) + " fd为" + std::to_string(conn->get_fd()));
-                conn_pool[conn->get_fd()] = NULL;
-                delete conn;
+                q.erase(qit);
+                break;
             }
         }
+        if (q.empty())
+            blocking_keys.erase(it);
     }
+    conn->get_block().registered = false;
+}
+
+/// @brief 每个就绪键按队列顺序唤醒连接，被唤醒的连接重新执行挂起的命令
+///        命令仍然拿不到数据且键已不存在(如列表已被先唤醒的连接取空)时停止唤醒该键上的其余连接；
+///        键仍存在时(如流中的条目不会被读取者消耗，但该连接等待的是更大的ID)跳过该连接继续唤醒
+void Server::handle_ready_keys()
+{
+    // 唤醒的命令(如BLMOVE)可能又写入其他键，直到没有新的就绪键为止
+    while (!ready_keys.empty())
+    {
+        std::vector<std::string> keys;
+        keys.swap(ready_keys);
+        for (const std::string &key : keys)
+        {
+            std::vector<Conntion *> skipped;
+            while (true)
+            {
+                auto it = blocking_keys.find(key);
+                if (it == blocking_keys.end())
+                    break;
+                Conntion *conn = conn_pool[it->second.front()];
+                // 先移出所有队列再执行，执行中可能再次阻塞并重新登记
+                block_unregister(conn);
+                if (!conn->retry_blocked(cmdDisp))
+                {
+                    skipped.push_back(conn);
+                    Object probe(ObjType::STRING);
+                    probe.key = key;
+                    probe.node.hcode = obj_hash(key);
+                    if (!HMap_string.hm_lookup(&probe.node, &obj_equals))
+                        break;
+                    continue;
+                }
+                if (conn->get_state().is_close)
+                    close_conn(conn);
+                else
+                    after_process(conn);
+            }
+            // 没有拿到数据的连接按原来的顺序放回队首
+            for (auto rit = skipped.rbegin(); rit != skipped.rend(); ++rit)
+            {
+                Conntion *conn = *rit;
+                for (const std::string &k : conn->get_block().keys)
+                    blocking_keys[k].push_front(conn->get_fd());
+                conn->get_block().registered = true;
+            }
+        }
+    }
+}
+
+void Server::handle_timers()
+{
+    uint64_t now = get_monotonic_ms();
+    while (!timers.empty() && timers.top().when <= now)
+    {
+        BlockTimer t = timers.top();
+        timers.pop();
+        Conntion *conn = (size_t)t.fd < conn_pool.size() ? conn_pool[t.fd] : nullptr;
+        // 连接已关闭、fd被复用，或连接已被唤醒后又以新的超时阻塞，定时器失效
+        if (!conn || conn->get_id() != t.uid || !conn->get_block().blocked || conn->get_block().deadline != t.when)
+            continue;
+        block_unregister(conn);
+        conn->block_timeout(cmdDisp);
+        if (conn->get_state().is_close)
+            close_conn(conn);
+        else
+            after_process(conn);
+    }
+    // 超时回复后连接继续执行的命令可能写入了键
+    handle_ready_keys();
+}
+
+int Server::next_timer_ms()
+{
+    if (timers.empty())
+        return -1;
+    uint64_t now = get_monotonic_ms();
+    uint64_t when = timers.top().when;
+    return when <= now ? 0 : (int)std::min<uint64_t>(when - now, INT32_MAX);
 }
 
 Conntion *Server::handle_accept()
@@ -117,7 +365,7 @@ Conntion *Server::handle_accept()
 
     if (connfd < 0)
     {
-        Logger::error("获取新连接fd失败");
+        LOG_ERROR("获取新连接fd失败");
         return NULL;
     }
     uint32_t ip = client_addr.sin_addr.s_addr;
@@ -127,7 +375,7 @@ Conntion *Server::handle_accept()
     std::string ip_string(ip_str);
     std::string port_string = std::to_string(ntohs(client_addr.sin_port));
 
-    Logger::debug("handle_accept() 新连接ip:" + ip_string + " 端口:" + port_string);
+    LOG_DEBUG("handle_accept() 新连接ip:" + ip_string + " 端口:" + port_string);
 
     // 设置新连接fd为非阻塞模式
     fd_set_nonblock(connfd);
@@ -2,11 +2,23 @@
 #include <stdint.h>
 #include <poll.h>
 #include <vector>
+#include <queue>
 #include <netinet/in.h>
 #include "connection.h"
+#include "metrics.h"
 #include "../utils/logger/logger.h"
 #include "../command/command_dispatcher.h"
 
+// 阻塞命令的超时定时器
+struct BlockTimer
+{
+    uint64_t when; // 超时时刻(单调时钟毫秒)
+    int fd;
+    int uid; // 连接唯一id，fd被复用或连接已解除阻塞时定时器失效
+
+    bool operator>(const BlockTimer &other) const { return when > other.when; }
+};
+
 class Server
 {
 public:
@@ -22,5 +34,32 @@ private:
 
     CommandDispatcher cmdDisp; // 命令分发管理器
 
+    int metrics_fd = -1;                  // /metrics的监听连接文件描述，未开启时为-1
+    std::vector<MetricsConn *> metrics_pool; // 抓取指标的HTTP连接，按fd索引
+
+    // 阻塞超时定时器，最早超时的在堆顶
+    std::priority_queue<BlockTimer, std::vector<BlockTimer>, std::greater<BlockTimer>> timers;
+
     Conntion *handle_accept();
+
+    // 开启/metrics的监听，失败时只记录错误，不影响数据端口
+    void metrics_listen();
+    void metrics_accept();
+    void close_metrics(MetricsConn *conn);
+
+    // 连接处理完请求后调用，新阻塞的连接加入等待队列与定时器
+    void after_process(Conntion *conn);
+    // 将连接加入/移出所等待的键的队列
+    void block_register(Conntion *conn);
+    void block_unregister(Conntion *conn);
+    // 按阻塞先后顺序唤醒就绪键上的连接
+    void handle_ready_keys();
+    // 处理到期的定时器
+    void handle_timers();
+    // 距最近一个定时器到期的毫秒数，没有定时器返回-1
+    int next_timer_ms();
+    // 每隔k_cron_interval_ms执行一次的周期任务：采样瞬时速率与内存峰值
+    void cron();
+    uint64_t last_cron_ms = 0;
+    void close_conn(Conntion *conn);
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "parser.h"
 #include <string.h>
 
+uint32_t Parser::k_max_args = 1 << 20;
+
 Parser::Parser(const uint8_t *request, uint32_t n)
 {
     this->cur = request;
@@ -20,7 +22,13 @@ int32_t Parser::parser_req(std::vector<std::string> &res)
 
     if (nstr > k_max_args)
     {
-        Logger::error("parser_req() 命令长度大于k_max_args");
+        LOG_ERROR("parser_req() 命令长度大于k_max_args");
+        return -1;
+    }
+    // 每个命令字至少占4字节长度，防止伪造的nstr导致过量分配
+    if (nstr > (uint32_t)(end - cur) / 4)
+    {
+        LOG_ERROR("parser_req() 命令字个数与数据长度不符");
         return -1;
     }
 
@@ -36,7 +44,7 @@ int32_t Parser::parser_req(std::vector<std::string> &res)
 
     if (cur != end)
     {
-        Logger::error("parser_req() 解析失败");
+        LOG_ERROR("parser_req() 解析失败");
         return -1;
     }
     return 0;
@@ -46,7 +54,7 @@ bool Parser::parser_len(uint32_t &len)
 {
     if (cur + 4 > end)
     {
-        Logger::error("parser_len() 解析失败");
+        LOG_ERROR("parser_len() 解析失败");
         return false;
     }
     memcpy(&len, cur, 4);
@@ -58,7 +66,7 @@ bool Parser::parser_str(std::string &str, uint32_t len)
 {
     if (cur + len > end)
     {
-        Logger::error("parser_str() 解析失败");
+        LOG_ERROR("parser_str() 解析失败");
         return false;
     }
     str.assign(cur, cur + len);
@@ -18,10 +18,13 @@ public:
     // 0表示解析成功 -1表示失败
     int32_t parser_req(std::vector<std::string> &res);
 
+    // 设置单个请求允许的最大命令字个数
+    static void set_max_args(uint32_t n) { k_max_args = n; }
+
 private:
     const uint8_t *cur;                 // 命令头指针
     const uint8_t *end;                 // 命令尾指针
-    const uint32_t k_max_args = 1 << 5; // 最大命令数
+    static uint32_t k_max_args; // 最大命令字个数，MGET/MSET/ZADD等变长命令需要较大的值
 
     // 解析单个命令字长度
     bool parser_len(uint32_t &len);
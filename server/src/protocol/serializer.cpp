@@ -23,14 +23,22 @@ std::string Serializer::serialize_error(const std::string &error_msg)
     return "-" + error_msg + "\r\n";
 }
 
-std::string Serializer::serialize_integer(int32_t value)
+std::string Serializer::serialize_integer(int64_t value)
 {
     return ":" + std::to_string(value) + "\r\n";
 }
 
-std::string Serializer::serialize_bulk_string(const std::string &str)
+std::string Serializer::serialize_bulk_string(std::string_view str)
 {
-    return "$" + std::to_string(str.size()) + "\r\n" + str + "\r\n";
+    std::string len = std::to_string(str.size());
+    std::string res;
+    res.reserve(1 + len.size() + 2 + str.size() + 2);
+    res += '$';
+    res += len;
+    res += "\r\n";
+    res.append(str.data(), str.size());
+    res += "\r\n";
+    return res;
 }
 
 std::string Serializer::serialize_null_bulk_string()
@@ -77,6 +85,8 @@ std::string Serializer::serialize(const Response &response)
             return serialize_integer(response.integer);
 
         case ResponseType::BULK_STRING:
+            if (response.bulk_view.data())
+                return serialize_bulk_string(response.bulk_view);
             return serialize_bulk_string(response.bulk_string);
 
         case ResponseType::ARRAY:
@@ -94,7 +104,7 @@ std::string Serializer::serialize(const Response &response)
             return serialize_null_bulk_string();
         default:
         {
-            Logger::error("serialize() 响应数据类型未知");
+            LOG_ERROR("serialize() 响应数据类型未知");
             break;
         }
     }
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class ResponseType
@@ -9,17 +10,24 @@ enum class ResponseType
     INTEGER,         // :123\r\n
     BULK_STRING,     // $5\r\nhello\r\n
     ARRAY,           // *2\r\n$5\r\nhello\r\n$5\r\nworld\r\n
-    NULL_BULK_STRING // $-1\r\n
+    NULL_BULK_STRING, // $-1\r\n
+    BLOCKED,          // 阻塞命令暂时没有数据可取，不会被序列化：array为等待的键，integer为超时毫秒数(0表示一直等待)，
+                      // blocked_args非空时代替原命令在唤醒后重新执行
+    PUBSUB,           // 订阅类命令需要修改连接的状态，不会被序列化：simple_string为命令名，array为频道或模式
+    TRANSACTION       // 事务类命令，由连接处理，不会被序列化：simple_string为命令名，array为其余参数
 };
 
 struct Response
 {
     ResponseType type;
     std::string simple_string;   // 用于SIMPLE_STRING和ERROR
-    int64_t integer;             // 用于INTEGER
+    int64_t integer = 0;         // 用于INTEGER
     std::string bulk_string;     // 用于BULK_STRING
+    std::string_view bulk_view;  // 用于BULK_STRING，非空时优先于bulk_string，直接引用存储中的数据以避免拷贝，
+                                 // 只在命令执行后、数据被修改前序列化时有效
     std::vector<Response> array; // 用于ARRAY
-    bool is_null;                // 用于NULL类型
+    bool is_null = false;        // 用于NULL类型
+    std::vector<std::string> blocked_args; // 用于BLOCKED，挂起时需要固定下来的参数(如XREAD的$)已替换为具体的值
 };
 
 class Serializer
@@ -28,8 +36,8 @@ private:
     // 基础类型序列化
     static std::string serialize_simple_string(const std::string &str);
     static std::string serialize_error(const std::string &error_msg);
-    static std::string serialize_integer(int32_t value);
-    static std::string serialize_bulk_string(const std::string &str);
+    static std::string serialize_integer(int64_t value);
+    static std::string serialize_bulk_string(std::string_view str);
     static std::string serialize_null_bulk_string();
     static std::string serialize_array(const std::vector<std::string> &elements);
     static std::string serialize_array(const std::vector<int32_t> &elements);
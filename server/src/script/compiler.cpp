@@ -0,0 +1,658 @@
+#include "script.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+// 语法嵌套的最大深度，防止恶意脚本使递归下降的编译器栈溢出
+static const int k_max_depth = 200;
+
+enum class Tok : uint8_t
+{
+    END,
+    NAME,
+    NUMBER,
+    STRING,
+    LPAREN,
+    RPAREN,
+    LBRACKET,
+    RBRACKET,
+    LBRACE,
+    RBRACE,
+    COMMA,
+    SEMI,
+    ASSIGN,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    PLUS,
+    MINUS,
+    STAR,
+    SLASH,
+    PERCENT,
+    CONCAT,
+    HASH,
+    // 关键字
+    LOCAL,
+    IF,
+    THEN,
+    ELSEIF,
+    ELSE,
+    END_KW,
+    WHILE,
+    DO,
+    FOR,
+    BREAK,
+    RETURN,
+    AND,
+    OR,
+    NOT,
+    NIL,
+    TRUE,
+    FALSE
+};
+
+struct Token
+{
+    Tok type;
+    std::string text; // NAME与STRING
+    int64_t num = 0;  // NUMBER
+    int line;
+};
+
+static const std::unordered_map<std::string, Tok> k_keywords = {
+    {"local", Tok::LOCAL}, {"if", Tok::IF}, {"then", Tok::THEN}, {"elseif", Tok::ELSEIF}, {"else", Tok::ELSE},
+    {"end", Tok::END_KW}, {"while", Tok::WHILE}, {"do", Tok::DO}, {"for", Tok::FOR}, {"break", Tok::BREAK},
+    {"return", Tok::RETURN}, {"and", Tok::AND}, {"or", Tok::OR}, {"not", Tok::NOT}, {"nil", Tok::NIL},
+    {"true", Tok::TRUE}, {"false", Tok::FALSE}};
+
+static const std::unordered_map<std::string, Builtin> k_builtins = {
+    {"call", Builtin::CALL}, {"tonumber", Builtin::TONUMBER}, {"tostring", Builtin::TOSTRING}, {"error", Builtin::ERROR}};
+
+[[noreturn]] static void compile_error(int line, const std::string &msg)
+{
+    throw std::invalid_argument("脚本编译错误: 第" + std::to_string(line) + "行: " + msg);
+}
+
+// 词法分析，一次切分出全部的记号，末尾为END
+static std::vector<Token> tokenize(const std::string &src)
+{
+    std::vector<Token> toks;
+    size_t p = 0;
+    int line = 1;
+    auto sym = [&](Tok t, size_t len)
+    {
+        toks.push_back({t, "", 0, line});
+        p += len;
+    };
+    while (p < src.size())
+    {
+        char c = src[p];
+        if (c == '\n')
+        {
+            line++;
+            p++;
+        }
+        else if (isspace((unsigned char)c))
+            p++;
+        else if (c == '-' && p + 1 < src.size() && src[p + 1] == '-')
+        {
+            // 注释到行尾
+            while (p < src.size() && src[p] != '\n')
+                p++;
+        }
+        else if (isalpha((unsigned char)c) || c == '_')
+        {
+            size_t start = p;
+            while (p < src.size() && (isalnum((unsigned char)src[p]) || src[p] == '_'))
+                p++;
+            std::string word = src.substr(start, p - start);
+            auto it = k_keywords.find(word);
+            if (it != k_keywords.end())
+                toks.push_back({it->second, "", 0, line});
+            else
+                toks.push_back({Tok::NAME, word, 0, line});
+        }
+        else if (isdigit((unsigned char)c))
+        {
+            uint64_t v = 0;
+            while (p < src.size() && isdigit((unsigned char)src[p]))
+            {
+                v = v * 10 + (src[p] - '0');
+                if (v > (uint64_t)INT64_MAX)
+                    compile_error(line, "整数超出范围");
+                p++;
+            }
+            if (p < src.size() && (isalpha((unsigned char)src[p]) || src[p] == '_' || src[p] == '.'))
+                compile_error(line, "只支持十进制整数");
+            toks.push_back({Tok::NUMBER, "", (int64_t)v, line});
+        }
+        else if (c == '\'' || c == '"')
+        {
+            std::string s;
+            p++;
+            while (true)
+            {
+                if (p >= src.size() || src[p] == '\n')
+                    compile_error(line, "字符串没有结束");
+                char ch = src[p++];
+                if (ch == c)
+                    break;
+                if (ch == '\\')
+                {
+                    if (p >= src.size())
+                        compile_error(line, "字符串没有结束");
+                    char e = src[p++];
+                    switch (e)
+                    {
+                    case 'n': ch = '\n'; break;
+                    case 't': ch = '\t'; break;
+                    case 'r': ch = '\r'; break;
+                    case '0': ch = '\0'; break;
+                    case '\\': case '\'': case '"': ch = e; break;
+                    default: compile_error(line, std::string("未知的转义字符\\") + e);
+                    }
+                }
+                s += ch;
+            }
+            toks.push_back({Tok::STRING, std::move(s), 0, line});
+        }
+        else
+        {
+            char n = p + 1 < src.size() ? src[p + 1] : '\0';
+            switch (c)
+            {
+            case '(': sym(Tok::LPAREN, 1); break;
+            case ')': sym(Tok::RPAREN, 1); break;
+            case '[': sym(Tok::LBRACKET, 1); break;
+            case ']': sym(Tok::RBRACKET, 1); break;
+            case '{': sym(Tok::LBRACE, 1); break;
+            case '}': sym(Tok::RBRACE, 1); break;
+            case ',': sym(Tok::COMMA, 1); break;
+            case ';': sym(Tok::SEMI, 1); break;
+            case '+': sym(Tok::PLUS, 1); break;
+            case '-': sym(Tok::MINUS, 1); break;
+            case '*': sym(Tok::STAR, 1); break;
+            case '/': sym(Tok::SLASH, 1); break;
+            case '%': sym(Tok::PERCENT, 1); break;
+            case '#': sym(Tok::HASH, 1); break;
+            case '=': n == '=' ? sym(Tok::EQ, 2) : sym(Tok::ASSIGN, 1); break;
+            case '<': n == '=' ? sym(Tok::LE, 2) : sym(Tok::LT, 1); break;
+            case '>': n == '=' ? sym(Tok::GE, 2) : sym(Tok::GT, 1); break;
+            case '~':
+                if (n != '=')
+                    compile_error(line, "未知的符号'~'");
+                sym(Tok::NE, 2);
+                break;
+            case '.':
+                if (n != '.')
+                    compile_error(line, "未知的符号'.'");
+                sym(Tok::CONCAT, 2);
+                break;
+            default:
+                compile_error(line, std::string("未知的符号'") + c + "'");
+            }
+        }
+    }
+    toks.push_back({Tok::END, "", 0, line});
+    return toks;
+}
+
+// 递归下降的单遍编译器，直接生成字节码
+class Compiler
+{
+private:
+    std::vector<Token> toks;
+    size_t pos = 0;
+    ScriptProgram &prog;
+    std::vector<std::string> scope;          // 可见的局部变量，下标即槽位，内层的在后
+    std::vector<std::vector<size_t>> breaks; // 每层循环中待回填的break跳转
+    int depth = 0;
+
+    const Token &peek(size_t ahead = 0) const { return toks[std::min(pos + ahead, toks.size() - 1)]; }
+    const Token &next() { return toks[pos < toks.size() - 1 ? pos++ : pos]; }
+    bool accept(Tok t)
+    {
+        if (peek().type != t)
+            return false;
+        pos++;
+        return true;
+    }
+    void expect(Tok t, const char *what)
+    {
+        if (!accept(t))
+            compile_error(peek().line, std::string("缺少") + what);
+    }
+
+    size_t emit(OpCode op, int32_t arg = 0, int32_t arg2 = 0)
+    {
+        prog.code.push_back({op, arg, arg2});
+        return prog.code.size() - 1;
+    }
+    int32_t here() const { return (int32_t)prog.code.size(); }
+    void patch(size_t at) { prog.code[at].arg = here(); }
+
+    void emit_const(ScriptValue v)
+    {
+        prog.consts.push_back(std::move(v));
+        emit(OpCode::CONST, (int32_t)prog.consts.size() - 1);
+    }
+
+    // 声明局部变量，返回槽位
+    int32_t declare(const std::string &name)
+    {
+        scope.push_back(name);
+        prog.nlocals = std::max<uint32_t>(prog.nlocals, scope.size());
+        return (int32_t)scope.size() - 1;
+    }
+    // 由内向外查找局部变量
+    int32_t resolve(const std::string &name) const
+    {
+        for (size_t i = scope.size(); i-- > 0;)
+            if (scope[i] == name)
+                return (int32_t)i;
+        return -1;
+    }
+
+    void enter()
+    {
+        if (++depth > k_max_depth)
+            compile_error(peek().line, "嵌套层数过多");
+    }
+
+    static bool block_end(Tok t) { return t == Tok::END || t == Tok::END_KW || t == Tok::ELSE || t == Tok::ELSEIF; }
+
+    void block()
+    {
+        enter();
+        size_t mark = scope.size();
+        while (!block_end(peek().type))
+            statement();
+        scope.resize(mark);
+        depth--;
+    }
+
+    // 循环体，其中的break在循环结束后由loop_end回填
+    void loop_body()
+    {
+        breaks.emplace_back();
+        block();
+    }
+
+    // 在跳回循环开头的指令之后调用，break跳到这里
+    void loop_end()
+    {
+        for (size_t at : breaks.back())
+            patch(at);
+        breaks.pop_back();
+    }
+
+    void statement()
+    {
+        const Token &t = peek();
+        int line = t.line;
+        switch (t.type)
+        {
+        case Tok::SEMI:
+            next();
+            break;
+        case Tok::LOCAL:
+        {
+            next();
+            if (peek().type != Tok::NAME)
+                compile_error(line, "local之后缺少变量名");
+            std::string name = next().text;
+            if (accept(Tok::ASSIGN))
+                expr();
+            else
+                emit(OpCode::NIL);
+            // 先编译初始值再声明，local x = x 中右边引用的是外层的x
+            emit(OpCode::STORE, declare(name));
+            break;
+        }
+        case Tok::IF:
+        {
+            next();
+            std::vector<size_t> ends;
+            expr();
+            expect(Tok::THEN, "then");
+            size_t jf = emit(OpCode::JMP_FALSE);
+            block();
+            while (accept(Tok::ELSEIF))
+            {
+                ends.push_back(emit(OpCode::JMP));
+                patch(jf);
+                expr();
+                expect(Tok::THEN, "then");
+                jf = emit(OpCode::JMP_FALSE);
+                block();
+            }
+            if (accept(Tok::ELSE))
+            {
+                ends.push_back(emit(OpCode::JMP));
+                patch(jf);
+                block();
+            }
+            else
+                patch(jf);
+            expect(Tok::END_KW, "end");
+            for (size_t at : ends)
+                patch(at);
+            break;
+        }
+        case Tok::WHILE:
+        {
+            next();
+            int32_t start = here();
+            expr();
+            expect(Tok::DO, "do");
+            size_t jf = emit(OpCode::JMP_FALSE);
+            loop_body();
+            expect(Tok::END_KW, "end");
+            emit(OpCode::JMP, start);
+            patch(jf);
+            loop_end();
+            break;
+        }
+        case Tok::FOR:
+        {
+            next();
+            if (peek().type != Tok::NAME)
+                compile_error(line, "for之后缺少变量名");
+            std::string name = next().text;
+            expect(Tok::ASSIGN, "'='");
+            expr();
+            expect(Tok::COMMA, "','");
+            expr();
+            if (accept(Tok::COMMA))
+                expr();
+            else
+                emit_const(ScriptValue::make_int(1));
+            expect(Tok::DO, "do");
+            // 循环变量之后是两个不可见的局部变量：终值与步长
+            size_t mark = scope.size();
+            int32_t base = declare(name);
+            declare("(limit)");
+            declare("(step)");
+            emit(OpCode::STORE, base + 2);
+            emit(OpCode::STORE, base + 1);
+            emit(OpCode::STORE, base);
+            int32_t start = here();
+            size_t test = emit(OpCode::FOR_TEST, base);
+            loop_body();
+            expect(Tok::END_KW, "end");
+            emit(OpCode::FOR_STEP, base);
+            emit(OpCode::JMP, start);
+            prog.code[test].arg2 = here();
+            loop_end();
+            scope.resize(mark);
+            break;
+        }
+        case Tok::BREAK:
+            next();
+            if (breaks.empty())
+                compile_error(line, "break不在循环中");
+            breaks.back().push_back(emit(OpCode::JMP));
+            break;
+        case Tok::RETURN:
+            next();
+            if (block_end(peek().type) || peek().type == Tok::SEMI)
+                emit(OpCode::NIL);
+            else
+                expr();
+            emit(OpCode::RETURN);
+            break;
+        case Tok::NAME:
+        {
+            if (peek(1).type == Tok::LPAREN)
+            {
+                // 函数调用语句，丢弃返回值
+                expr();
+                emit(OpCode::POP);
+                break;
+            }
+            std::string name = next().text;
+            int32_t slot = resolve(name);
+            if (slot < 0)
+                compile_error(line, "未声明的局部变量'" + name + "'");
+            if (accept(Tok::ASSIGN))
+            {
+                expr();
+                emit(OpCode::STORE, slot);
+            }
+            else if (accept(Tok::LBRACKET))
+            {
+                expr();
+                expect(Tok::RBRACKET, "']'");
+                expect(Tok::ASSIGN, "'='");
+                expr();
+                emit(OpCode::SET_INDEX, slot);
+            }
+            else
+                compile_error(line, "语句只能是赋值或函数调用");
+            break;
+        }
+        default:
+            compile_error(line, "无法识别的语句");
+        }
+    }
+
+    void expr()
+    {
+        enter();
+        or_expr();
+        depth--;
+    }
+
+    void or_expr()
+    {
+        and_expr();
+        while (accept(Tok::OR))
+        {
+            size_t j = emit(OpCode::OR);
+            and_expr();
+            patch(j);
+        }
+    }
+
+    void and_expr()
+    {
+        compare();
+        while (accept(Tok::AND))
+        {
+            size_t j = emit(OpCode::AND);
+            compare();
+            patch(j);
+        }
+    }
+
+    void compare()
+    {
+        concat();
+        while (true)
+        {
+            OpCode op;
+            switch (peek().type)
+            {
+            case Tok::EQ: op = OpCode::EQ; break;
+            case Tok::NE: op = OpCode::NE; break;
+            case Tok::LT: op = OpCode::LT; break;
+            case Tok::LE: op = OpCode::LE; break;
+            case Tok::GT: op = OpCode::GT; break;
+            case Tok::GE: op = OpCode::GE; break;
+            default: return;
+            }
+            next();
+            concat();
+            emit(op);
+        }
+    }
+
+    // ..为右结合
+    void concat()
+    {
+        additive();
+        if (accept(Tok::CONCAT))
+        {
+            enter();
+            concat();
+            depth--;
+            emit(OpCode::CONCAT);
+        }
+    }
+
+    void additive()
+    {
+        term();
+        while (peek().type == Tok::PLUS || peek().type == Tok::MINUS)
+        {
+            OpCode op = next().type == Tok::PLUS ? OpCode::ADD : OpCode::SUB;
+            term();
+            emit(op);
+        }
+    }
+
+    void term()
+    {
+        unary();
+        while (peek().type == Tok::STAR || peek().type == Tok::SLASH || peek().type == Tok::PERCENT)
+        {
+            Tok t = next().type;
+            unary();
+            emit(t == Tok::STAR ? OpCode::MUL : t == Tok::SLASH ? OpCode::DIV : OpCode::MOD);
+        }
+    }
+
+    void unary()
+    {
+        Tok t = peek().type;
+        if (t == Tok::NOT || t == Tok::MINUS || t == Tok::HASH)
+        {
+            next();
+            enter();
+            unary();
+            depth--;
+            emit(t == Tok::NOT ? OpCode::NOT : t == Tok::MINUS ? OpCode::NEG : OpCode::LEN);
+            return;
+        }
+        postfix();
+    }
+
+    void postfix()
+    {
+        primary();
+        while (accept(Tok::LBRACKET))
+        {
+            expr();
+            expect(Tok::RBRACKET, "']'");
+            emit(OpCode::INDEX);
+        }
+    }
+
+    void primary()
+    {
+        const Token &t = next();
+        switch (t.type)
+        {
+        case Tok::NIL:
+            emit(OpCode::NIL);
+            break;
+        case Tok::TRUE:
+            emit(OpCode::TRUE);
+            break;
+        case Tok::FALSE:
+            emit(OpCode::FALSE);
+            break;
+        case Tok::NUMBER:
+            emit_const(ScriptValue::make_int(t.num));
+            break;
+        case Tok::STRING:
+            emit_const(ScriptValue::make_str(t.text));
+            break;
+        case Tok::LPAREN:
+            expr();
+            expect(Tok::RPAREN, "')'");
+            break;
+        case Tok::LBRACE:
+        {
+            int32_t n = 0;
+            while (peek().type != Tok::RBRACE)
+            {
+                expr();
+                n++;
+                if (!accept(Tok::COMMA))
+                    break;
+            }
+            expect(Tok::RBRACE, "'}'");
+            emit(OpCode::ARRAY, n);
+            break;
+        }
+        case Tok::NAME:
+        {
+            if (t.text == "KEYS")
+            {
+                emit(OpCode::KEYS);
+                break;
+            }
+            if (t.text == "ARGV")
+            {
+                emit(OpCode::ARGV);
+                break;
+            }
+            if (peek().type == Tok::LPAREN)
+            {
+                auto it = k_builtins.find(t.text);
+                if (it == k_builtins.end())
+                    compile_error(t.line, "未知的函数'" + t.text + "'");
+                next();
+                int32_t argc = 0;
+                if (peek().type != Tok::RPAREN)
+                {
+                    do
+                    {
+                        expr();
+                        argc++;
+                    } while (accept(Tok::COMMA));
+                }
+                expect(Tok::RPAREN, "')'");
+                if (it->second == Builtin::CALL ? argc < 1 : argc != 1)
+                    compile_error(t.line, "函数'" + t.text + "'的参数个数不对");
+                emit(OpCode::CALL, (int32_t)it->second, argc);
+                break;
+            }
+            int32_t slot = resolve(t.text);
+            if (slot < 0)
+                compile_error(t.line, "未声明的局部变量'" + t.text + "'");
+            emit(OpCode::LOAD, slot);
+            break;
+        }
+        default:
+            compile_error(t.line, "缺少表达式");
+        }
+    }
+
+public:
+    Compiler(const std::string &source, ScriptProgram &prog) : toks(tokenize(source)), prog(prog) {}
+
+    void compile()
+    {
+        while (peek().type != Tok::END)
+        {
+            if (block_end(peek().type))
+                compile_error(peek().line, "多余的" + std::string(peek().type == Tok::END_KW ? "end" : "else/elseif"));
+            statement();
+        }
+        // 没有return时返回nil
+        emit(OpCode::NIL);
+        emit(OpCode::RETURN);
+    }
+};
+
+std::shared_ptr<ScriptProgram> script_compile(const std::string &source)
+{
+    auto prog = std::make_shared<ScriptProgram>();
+    Compiler(source, *prog).compile();
+    return prog;
+}
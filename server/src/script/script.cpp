@@ -0,0 +1,452 @@
+#include "script.h"
+#include <stdexcept>
+#include "../data_structures/string.h"
+#include "../utils/utils.h"
+
+ScriptConfig script_config;
+
+[[noreturn]] static void run_error(const std::string &msg)
+{
+    throw std::invalid_argument("脚本运行错误: " + msg);
+}
+
+ScriptValue ScriptValue::make_int(int64_t v)
+{
+    ScriptValue r;
+    r.type = ScriptValue::Type::INT;
+    r.i = v;
+    return r;
+}
+
+ScriptValue ScriptValue::make_bool(bool v)
+{
+    ScriptValue r;
+    r.type = ScriptValue::Type::BOOL;
+    r.i = v;
+    return r;
+}
+
+ScriptValue ScriptValue::make_str(std::string s)
+{
+    ScriptValue r;
+    r.type = ScriptValue::Type::STR;
+    r.s = std::move(s);
+    return r;
+}
+
+ScriptValue ScriptValue::make_array(std::vector<ScriptValue> items)
+{
+    ScriptValue r;
+    r.type = ScriptValue::Type::ARRAY;
+    r.arr = std::make_shared<std::vector<ScriptValue>>(std::move(items));
+    return r;
+}
+
+static bool truthy(const ScriptValue &v)
+{
+    return !(v.type == ScriptValue::Type::NIL || (v.type == ScriptValue::Type::BOOL && !v.i));
+}
+
+static const char *type_name(const ScriptValue &v)
+{
+    switch (v.type)
+    {
+    case ScriptValue::Type::NIL: return "nil";
+    case ScriptValue::Type::BOOL: return "boolean";
+    case ScriptValue::Type::INT: return "integer";
+    case ScriptValue::Type::STR: return "string";
+    default: return "array";
+    }
+}
+
+// 算术运算的操作数，字符串按整数解析
+static int64_t to_int(const ScriptValue &v)
+{
+    int64_t out;
+    if (v.type == ScriptValue::Type::INT)
+        return v.i;
+    if (v.type == ScriptValue::Type::STR && str_to_int64(v.s, out))
+        return out;
+    run_error(std::string("不能对") + type_name(v) + "做算术运算");
+}
+
+// 字符串拼接与命令参数，整数转为十进制
+static std::string to_str(const ScriptValue &v)
+{
+    if (v.type == ScriptValue::Type::STR)
+        return v.s;
+    if (v.type == ScriptValue::Type::INT)
+        return int64_to_str(v.i);
+    run_error(std::string("不能将") + type_name(v) + "转为字符串");
+}
+
+static bool values_equal(const ScriptValue &a, const ScriptValue &b)
+{
+    if (a.type != b.type)
+        return false;
+    switch (a.type)
+    {
+    case ScriptValue::Type::NIL: return true;
+    case ScriptValue::Type::BOOL:
+    case ScriptValue::Type::INT: return a.i == b.i;
+    case ScriptValue::Type::STR: return a.s == b.s;
+    default: return a.arr == b.arr;
+    }
+}
+
+// 比较大小，只能在两个整数或两个字符串之间进行，返回<0、0、>0
+static int compare_values(const ScriptValue &a, const ScriptValue &b)
+{
+    if (a.type == ScriptValue::Type::INT && b.type == ScriptValue::Type::INT)
+        return a.i < b.i ? -1 : a.i > b.i;
+    if (a.type == ScriptValue::Type::STR && b.type == ScriptValue::Type::STR)
+        return a.s.compare(b.s);
+    run_error(std::string("不能比较") + type_name(a) + "与" + type_name(b));
+}
+
+// 命令的响应转为脚本中的值，数据全部拷贝出来，之后的命令修改存储不影响脚本
+static ScriptValue from_response(const Response &resp)
+{
+    switch (resp.type)
+    {
+    case ResponseType::INTEGER:
+        return ScriptValue::make_int(resp.integer);
+    case ResponseType::SIMPLE_STRING:
+    case ResponseType::ERROR:
+        return ScriptValue::make_str(resp.simple_string);
+    case ResponseType::BULK_STRING:
+        return ScriptValue::make_str(resp.bulk_view.empty() ? resp.bulk_string : std::string(resp.bulk_view));
+    case ResponseType::ARRAY:
+    {
+        std::vector<ScriptValue> items;
+        items.reserve(resp.array.size());
+        for (const Response &item : resp.array)
+            items.push_back(from_response(item));
+        return ScriptValue::make_array(std::move(items));
+    }
+    default:
+        return ScriptValue();
+    }
+}
+
+// 脚本的返回值转为响应：nil与false为空值，true为整数1
+static Response to_response(const ScriptValue &v)
+{
+    Response resp;
+    switch (v.type)
+    {
+    case ScriptValue::Type::NIL:
+        resp.type = ResponseType::NULL_BULK_STRING;
+        break;
+    case ScriptValue::Type::BOOL:
+        if (v.i)
+        {
+            resp.type = ResponseType::INTEGER;
+            resp.integer = 1;
+        }
+        else
+            resp.type = ResponseType::NULL_BULK_STRING;
+        break;
+    case ScriptValue::Type::INT:
+        resp.type = ResponseType::INTEGER;
+        resp.integer = v.i;
+        break;
+    case ScriptValue::Type::STR:
+        resp.type = ResponseType::BULK_STRING;
+        resp.bulk_string = v.s;
+        break;
+    case ScriptValue::Type::ARRAY:
+        resp.type = ResponseType::ARRAY;
+        resp.array.reserve(v.arr->size());
+        for (const ScriptValue &item : *v.arr)
+            resp.array.push_back(to_response(item));
+        break;
+    }
+    return resp;
+}
+
+static ScriptValue call_builtin(Builtin fn, ScriptValue *args, int32_t argc, const ScriptCaller &caller)
+{
+    switch (fn)
+    {
+    case Builtin::CALL:
+    {
+        std::vector<std::string> cmd;
+        cmd.reserve(argc);
+        for (int32_t i = 0; i < argc; i++)
+            cmd.push_back(to_str(args[i]));
+        return from_response(caller(cmd));
+    }
+    case Builtin::TONUMBER:
+    {
+        int64_t out;
+        if (args[0].type == ScriptValue::Type::INT)
+            return args[0];
+        if (args[0].type == ScriptValue::Type::STR && str_to_int64(args[0].s, out))
+            return ScriptValue::make_int(out);
+        return ScriptValue();
+    }
+    case Builtin::TOSTRING:
+        if (args[0].type == ScriptValue::Type::NIL)
+            return ScriptValue::make_str("nil");
+        if (args[0].type == ScriptValue::Type::BOOL)
+            return ScriptValue::make_str(args[0].i ? "true" : "false");
+        if (args[0].type == ScriptValue::Type::ARRAY)
+            return ScriptValue::make_str("array");
+        return ScriptValue::make_str(to_str(args[0]));
+    case Builtin::ERROR:
+        throw std::invalid_argument(to_str(args[0]));
+    }
+    return ScriptValue();
+}
+
+/// @brief 栈式解释器，每条指令消耗一个预算，预算用完时中止脚本；
+///        脚本只能访问自己的局部变量、KEYS/ARGV与内置函数，命令通过caller直接调用处理函数
+Response script_run(const ScriptProgram &prog, const std::vector<std::string> &keys, const std::vector<std::string> &argv,
+                    const ScriptCaller &caller, uint64_t budget)
+{
+    auto to_array = [](const std::vector<std::string> &strs)
+    {
+        std::vector<ScriptValue> items;
+        items.reserve(strs.size());
+        for (const std::string &s : strs)
+            items.push_back(ScriptValue::make_str(s));
+        return ScriptValue::make_array(std::move(items));
+    };
+    ScriptValue keys_v = to_array(keys), argv_v = to_array(argv);
+
+    std::vector<ScriptValue> locals(prog.nlocals);
+    std::vector<ScriptValue> stack;
+    stack.reserve(32);
+    const Instr *code = prog.code.data();
+    size_t pc = 0;
+    while (true)
+    {
+        if (budget-- == 0)
+            run_error("超出指令预算(" + std::to_string(script_config.max_instructions) + ")");
+        const Instr &in = code[pc++];
+        switch (in.op)
+        {
+        case OpCode::NIL:
+            stack.emplace_back();
+            break;
+        case OpCode::TRUE:
+        case OpCode::FALSE:
+            stack.push_back(ScriptValue::make_bool(in.op == OpCode::TRUE));
+            break;
+        case OpCode::CONST:
+            stack.push_back(prog.consts[in.arg]);
+            break;
+        case OpCode::LOAD:
+            stack.push_back(locals[in.arg]);
+            break;
+        case OpCode::STORE:
+            locals[in.arg] = std::move(stack.back());
+            stack.pop_back();
+            break;
+        case OpCode::KEYS:
+            stack.push_back(keys_v);
+            break;
+        case OpCode::ARGV:
+            stack.push_back(argv_v);
+            break;
+        case OpCode::INDEX:
+        {
+            ScriptValue idx = std::move(stack.back());
+            stack.pop_back();
+            ScriptValue &obj = stack.back();
+            if (obj.type != ScriptValue::Type::ARRAY)
+                run_error(std::string("不能对") + type_name(obj) + "取下标");
+            int64_t i = to_int(idx);
+            // 越界返回nil
+            ScriptValue elem = i >= 1 && (uint64_t)i <= obj.arr->size() ? (*obj.arr)[i - 1] : ScriptValue();
+            obj = std::move(elem);
+            break;
+        }
+        case OpCode::SET_INDEX:
+        {
+            ScriptValue val = std::move(stack.back());
+            stack.pop_back();
+            int64_t i = to_int(stack.back());
+            stack.pop_back();
+            ScriptValue &obj = locals[in.arg];
+            if (obj.type != ScriptValue::Type::ARRAY)
+                run_error(std::string("不能对") + type_name(obj) + "的下标赋值");
+            std::vector<ScriptValue> &arr = *obj.arr;
+            if (i >= 1 && (uint64_t)i <= arr.size())
+                arr[i - 1] = std::move(val);
+            else if ((uint64_t)i == arr.size() + 1 && arr.size() < script_config.max_array_len)
+                arr.push_back(std::move(val));
+            else
+                run_error("数组下标越界");
+            break;
+        }
+        case OpCode::ARRAY:
+        {
+            std::vector<ScriptValue> items(std::make_move_iterator(stack.end() - in.arg), std::make_move_iterator(stack.end()));
+            stack.resize(stack.size() - in.arg);
+            stack.push_back(ScriptValue::make_array(std::move(items)));
+            break;
+        }
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+        case OpCode::MOD:
+        {
+            int64_t b = to_int(stack.back());
+            stack.pop_back();
+            int64_t a = to_int(stack.back());
+            int64_t r = 0;
+            bool overflow = false;
+            if (in.op == OpCode::ADD)
+                overflow = __builtin_add_overflow(a, b, &r);
+            else if (in.op == OpCode::SUB)
+                overflow = __builtin_sub_overflow(a, b, &r);
+            else if (in.op == OpCode::MUL)
+                overflow = __builtin_mul_overflow(a, b, &r);
+            else
+            {
+                if (b == 0)
+                    run_error("除数为0");
+                overflow = a == INT64_MIN && b == -1;
+                if (!overflow)
+                    r = in.op == OpCode::DIV ? a / b : a % b;
+            }
+            if (overflow)
+                run_error("整数溢出");
+            stack.back() = ScriptValue::make_int(r);
+            break;
+        }
+        case OpCode::NEG:
+        {
+            int64_t a = to_int(stack.back());
+            if (a == INT64_MIN)
+                run_error("整数溢出");
+            stack.back() = ScriptValue::make_int(-a);
+            break;
+        }
+        case OpCode::CONCAT:
+        {
+            std::string b = to_str(stack.back());
+            stack.pop_back();
+            std::string a = to_str(stack.back());
+            if (a.size() + b.size() > script_config.max_string_bytes)
+                run_error("字符串过长");
+            stack.back() = ScriptValue::make_str(a + b);
+            break;
+        }
+        case OpCode::EQ:
+        case OpCode::NE:
+        {
+            bool eq = values_equal(stack[stack.size() - 2], stack.back());
+            stack.pop_back();
+            stack.back() = ScriptValue::make_bool(in.op == OpCode::EQ ? eq : !eq);
+            break;
+        }
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE:
+        {
+            int c = compare_values(stack[stack.size() - 2], stack.back());
+            stack.pop_back();
+            bool r = in.op == OpCode::LT ? c < 0 : in.op == OpCode::LE ? c <= 0 : in.op == OpCode::GT ? c > 0 : c >= 0;
+            stack.back() = ScriptValue::make_bool(r);
+            break;
+        }
+        case OpCode::NOT:
+            stack.back() = ScriptValue::make_bool(!truthy(stack.back()));
+            break;
+        case OpCode::LEN:
+        {
+            ScriptValue &v = stack.back();
+            if (v.type == ScriptValue::Type::STR)
+                v = ScriptValue::make_int(v.s.size());
+            else if (v.type == ScriptValue::Type::ARRAY)
+                v = ScriptValue::make_int(v.arr->size());
+            else
+                run_error(std::string("不能对") + type_name(v) + "取长度");
+            break;
+        }
+        case OpCode::JMP:
+            pc = in.arg;
+            break;
+        case OpCode::JMP_FALSE:
+        {
+            bool t = truthy(stack.back());
+            stack.pop_back();
+            if (!t)
+                pc = in.arg;
+            break;
+        }
+        case OpCode::AND:
+        case OpCode::OR:
+            if (truthy(stack.back()) == (in.op == OpCode::OR))
+                pc = in.arg;
+            else
+                stack.pop_back();
+            break;
+        case OpCode::FOR_TEST:
+        {
+            const ScriptValue &var = locals[in.arg], &limit = locals[in.arg + 1], &step = locals[in.arg + 2];
+            if (var.type != ScriptValue::Type::INT || limit.type != ScriptValue::Type::INT || step.type != ScriptValue::Type::INT)
+                run_error("for循环的初值、终值与步长必须为整数");
+            if (step.i == 0)
+                run_error("for循环的步长不能为0");
+            if (step.i > 0 ? var.i > limit.i : var.i < limit.i)
+                pc = in.arg2;
+            break;
+        }
+        case OpCode::FOR_STEP:
+        {
+            ScriptValue &var = locals[in.arg];
+            if (var.type != ScriptValue::Type::INT)
+                run_error("for循环变量必须为整数");
+            // 越过整数范围时循环结束
+            if (__builtin_add_overflow(var.i, locals[in.arg + 2].i, &var.i))
+                pc = code[code[pc].arg].arg2; // 下一条是跳回FOR_TEST的JMP，取FOR_TEST的出口
+            break;
+        }
+        case OpCode::CALL:
+        {
+            ScriptValue r = call_builtin((Builtin)in.arg, stack.data() + stack.size() - in.arg2, in.arg2, caller);
+            stack.resize(stack.size() - in.arg2);
+            stack.push_back(std::move(r));
+            break;
+        }
+        case OpCode::POP:
+            stack.pop_back();
+            break;
+        case OpCode::RETURN:
+            return to_response(stack.back());
+        }
+    }
+}
+
+std::string ScriptCache::load(const std::string &source, std::shared_ptr<ScriptProgram> *prog)
+{
+    std::string sha = sha1_hex(source.data(), source.size());
+    std::shared_ptr<ScriptProgram> &slot = scripts[sha];
+    if (!slot)
+    {
+        try
+        {
+            slot = script_compile(source);
+        }
+        catch (...)
+        {
+            scripts.erase(sha);
+            throw;
+        }
+    }
+    if (prog)
+        *prog = slot;
+    return sha;
+}
+
+std::shared_ptr<ScriptProgram> ScriptCache::find(const std::string &sha) const
+{
+    auto it = scripts.find(sha);
+    return it == scripts.end() ? nullptr : it->second;
+}
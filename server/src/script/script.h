@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../protocol/serializer.h"
+
+/*嵌入式脚本引擎：Lua风格的小语言，编译为栈式字节码后由解释器执行*/
+// 语句:
+//   local x [= e]                    声明局部变量，只有局部变量，没有全局变量
+//   x = e      x[i] = e              赋值，下标从1开始，x[#x + 1] = e 追加元素
+//   if e then ... elseif e then ... else ... end
+//   while e do ... end
+//   for i = a, b [, step] do ... end
+//   break      return [e]
+// 表达式(优先级从低到高):
+//   or  and  == ~= < <= > >=  ..(右结合)  + -  * / %  not # -(一元)  a[i] f(...)
+//   nil true false 整数 '字符串' "字符串" {e, ...} KEYS ARGV
+// 内置函数:
+//   call(name, ...)  执行命令，直接调用命令处理函数，不经过序列化
+//   tonumber(x)  tostring(x)  error(msg)
+// 只有整数，/与%为向零取整的整数除法与取余；字符串参与算术运算时按整数解析；nil与false为假
+
+struct ScriptConfig
+{
+    uint64_t max_instructions = 10000000; // 每次执行的指令预算，超出后中止脚本，避免长时间阻塞事件循环
+    size_t max_string_bytes = 64 << 20;   // 脚本中单个字符串的最大长度
+    size_t max_array_len = 1 << 20;       // 脚本中单个数组的最大长度
+};
+
+extern ScriptConfig script_config;
+
+// 脚本中的值，数组按引用共享
+struct ScriptValue
+{
+    enum class Type : uint8_t
+    {
+        NIL,
+        BOOL,
+        INT,
+        STR,
+        ARRAY
+    };
+    Type type = Type::NIL;
+    int64_t i = 0; // BOOL与INT
+    std::string s;
+    std::shared_ptr<std::vector<ScriptValue>> arr;
+
+    static ScriptValue make_int(int64_t v);
+    static ScriptValue make_bool(bool v);
+    static ScriptValue make_str(std::string s);
+    static ScriptValue make_array(std::vector<ScriptValue> items);
+};
+
+enum class OpCode : uint8_t
+{
+    NIL,
+    TRUE,
+    FALSE,
+    CONST,     // 压入常量arg
+    LOAD,      // 压入局部变量arg
+    STORE,     // 弹出栈顶存入局部变量arg
+    KEYS,      // 压入KEYS数组
+    ARGV,      // 压入ARGV数组
+    INDEX,     // 弹出下标与数组，压入元素
+    SET_INDEX, // 弹出值与下标，写入局部变量arg中的数组
+    ARRAY,     // 弹出arg个值组成数组
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    NEG,
+    CONCAT,
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    NOT,
+    LEN,
+    JMP,       // 跳转到arg
+    JMP_FALSE, // 弹出栈顶，为假时跳转到arg
+    AND,       // 栈顶为假时保留并跳转到arg，否则弹出
+    OR,        // 栈顶为真时保留并跳转到arg，否则弹出
+    FOR_TEST,  // 局部变量arg起依次为循环变量、终值、步长，循环结束时跳转到arg2
+    FOR_STEP,  // 循环变量加上步长
+    CALL,      // 调用内置函数arg，参数个数arg2
+    POP,
+    RETURN     // 弹出栈顶作为返回值
+};
+
+// 内置函数
+enum class Builtin : uint8_t
+{
+    CALL,
+    TONUMBER,
+    TOSTRING,
+    ERROR
+};
+
+struct Instr
+{
+    OpCode op;
+    int32_t arg = 0;
+    int32_t arg2 = 0;
+};
+
+// 编译后的脚本
+struct ScriptProgram
+{
+    std::vector<Instr> code;
+    std::vector<ScriptValue> consts;
+    uint32_t nlocals = 0; // 局部变量槽位数
+};
+
+// 执行命令的回调，命令出错时抛出异常
+using ScriptCaller = std::function<Response(const std::vector<std::string> &)>;
+
+// 编译脚本，语法错误时抛出std::invalid_argument
+std::shared_ptr<ScriptProgram> script_compile(const std::string &source);
+
+// 执行脚本，返回值转换为响应；运行出错或超出指令预算时抛出std::invalid_argument
+Response script_run(const ScriptProgram &prog, const std::vector<std::string> &keys, const std::vector<std::string> &argv,
+                    const ScriptCaller &caller, uint64_t budget);
+
+// 按SHA-1缓存编译好的脚本，EVALSHA直接执行缓存中的字节码
+class ScriptCache
+{
+private:
+    std::unordered_map<std::string, std::shared_ptr<ScriptProgram>> scripts;
+
+public:
+    // 编译并缓存脚本(已缓存时不重复编译)，返回脚本的SHA-1，通过prog带回编译结果
+    std::string load(const std::string &source, std::shared_ptr<ScriptProgram> *prog = nullptr);
+
+    // 按SHA-1查找，不存在返回nullptr
+    std::shared_ptr<ScriptProgram> find(const std::string &sha) const;
+
+    void flush() { scripts.clear(); }
+};
@@ -0,0 +1,82 @@
+#include "histogram.h"
+#include <cmath>
+
+uint64_t LatencyHistogram::bucket_upper(uint32_t b)
+{
+    if (b < 2 * k_sub_count)
+        return b;
+    uint32_t shift = b / k_sub_count - 1;
+    uint64_t mantissa = b % k_sub_count + k_sub_count;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (total == 0)
+        return 0;
+    uint64_t rank = (uint64_t)std::ceil(p / 100.0 * total);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < k_bucket_count; b++)
+    {
+        seen += counts[b];
+        if (seen >= rank)
+        {
+            uint64_t upper = bucket_upper(b);
+            return upper < max_value ? upper : max_value;
+        }
+    }
+    return max_value;
+}
+
+/// @brief 先把值换算到输出单位，再归入以2的幂为上界的区间；为了不因换算拆分细桶，细桶整体按其上界归类
+std::vector<std::pair<uint64_t, uint64_t>> LatencyHistogram::cumulative(double scale) const
+{
+    std::vector<std::pair<uint64_t, uint64_t>> out;
+    if (total == 0)
+        return out;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < k_bucket_count; b++)
+    {
+        if (counts[b] == 0)
+            continue;
+        seen += counts[b];
+        uint64_t v = (uint64_t)(bucket_upper(b) * scale);
+        uint64_t bound = 1;
+        while (bound < v && bound < (1ULL << 63))
+            bound <<= 1;
+        if (!out.empty() && out.back().first == bound)
+            out.back().second = seen;
+        else
+            out.emplace_back(bound, seen);
+    }
+    return out;
+}
+
+std::vector<uint64_t> LatencyHistogram::counts_at(const std::vector<uint64_t> &bounds) const
+{
+    std::vector<uint64_t> out(bounds.size(), 0);
+    if (total == 0)
+        return out;
+    uint64_t seen = 0;
+    size_t i = 0;
+    for (uint32_t b = 0; b < k_bucket_count && i < bounds.size(); b++)
+    {
+        uint64_t upper = bucket_upper(b);
+        while (i < bounds.size() && bounds[i] < upper)
+            out[i++] = seen;
+        seen += counts[b];
+    }
+    while (i < bounds.size())
+        out[i++] = seen;
+    return out;
+}
+
+void LatencyHistogram::reset()
+{
+    counts.clear();
+    counts.shrink_to_fit();
+    total = 0;
+    max_value = 0;
+}
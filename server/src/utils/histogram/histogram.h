@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// HDR风格的对数线性直方图：小于64的值每个值一个桶，之后每个2的幂区间[2^k, 2^(k+1))等分为32个桶，
+// 记录的值与所在桶的上界相对误差不超过1/32；覆盖全部64位整数只需1920个桶，首次记录时才分配
+class LatencyHistogram
+{
+private:
+    static const int k_sub_bits = 5;
+    static const uint32_t k_sub_count = 1u << k_sub_bits;
+    static const uint32_t k_bucket_count = (64 - k_sub_bits) * k_sub_count;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t max_value = 0;
+
+    static uint32_t bucket_of(uint64_t v)
+    {
+        if (v < 2 * k_sub_count)
+            return (uint32_t)v;
+        int shift = 63 - __builtin_clzll(v) - k_sub_bits;
+        return (shift + 1) * k_sub_count + (uint32_t)(v >> shift) - k_sub_count;
+    }
+
+    // 桶中最大的值
+    static uint64_t bucket_upper(uint32_t b);
+
+public:
+    void record(uint64_t v)
+    {
+        if (counts.empty())
+            counts.resize(k_bucket_count);
+        counts[bucket_of(v)]++;
+        total++;
+        if (v > max_value)
+            max_value = v;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+
+    // 第p百分位(0~100)的值，按所在桶的上界返回(不超过记录过的最大值)，没有记录时返回0
+    uint64_t percentile(double p) const;
+
+    // 按2的幂区间汇总的累计分布：依次返回(上界, 不超过该上界的记录数)，上界按scale缩放后取整
+    // 用于LATENCY HISTOGRAM输出，与Redis一样按2的幂微秒分桶
+    std::vector<std::pair<uint64_t, uint64_t>> cumulative(double scale) const;
+
+    // 对升序的每个上界给出不超过它的记录数(按所在桶的上界判断)，只遍历一次桶，用于导出Prometheus直方图
+    std::vector<uint64_t> counts_at(const std::vector<uint64_t> &bounds) const;
+
+    void reset();
+};
@@ -0,0 +1,111 @@
+#include "latency.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyConfig latency_config;
+LatencyMonitor latency_monitor;
+
+std::vector<LatencySample> LatencySeries::history() const
+{
+    std::vector<LatencySample> out;
+    for (size_t k = 0; k < k_samples; k++)
+    {
+        const LatencySample &s = samples[(idx + k) % k_samples];
+        if (s.time != 0)
+            out.push_back(s);
+    }
+    return out;
+}
+
+void LatencyMonitor::add_sample(const char *event, uint32_t latency_ms)
+{
+    LatencySeries &ts = events[event];
+    uint64_t now = get_realtime_ms() / 1000;
+    if (latency_ms > ts.max)
+        ts.max = latency_ms;
+
+    LatencySample &prev = ts.samples[(ts.idx + LatencySeries::k_samples - 1) % LatencySeries::k_samples];
+    if (prev.time == now)
+    {
+        prev.latency = std::max(prev.latency, latency_ms);
+        return;
+    }
+    ts.samples[ts.idx] = {now, latency_ms};
+    ts.idx = (ts.idx + 1) % LatencySeries::k_samples;
+}
+
+const LatencySeries *LatencyMonitor::find(const std::string &event) const
+{
+    auto it = events.find(event);
+    return it == events.end() ? nullptr : &it->second;
+}
+
+size_t LatencyMonitor::reset(const std::vector<std::string> &names)
+{
+    if (names.empty())
+    {
+        size_t n = events.size();
+        events.clear();
+        return n;
+    }
+    size_t n = 0;
+    for (const std::string &name : names)
+        n += events.erase(name);
+    return n;
+}
+
+// 每类事件的处理建议
+static const char *advice(const std::string &event)
+{
+    if (event == "command")
+        return "有命令执行过慢，用SLOWLOG GET查看具体的命令，避免对大集合执行ZALL/SMEMBERS/HGETALL等O(N)命令，改用带范围或游标的命令";
+    if (event == "rehash")
+        return "主哈希表或大集合扩容时分配新表与迁移耗时过长，键数量很大时可以预先分散到更多的键上";
+    if (event == "obj-free")
+        return "删除包含大量元素的对象时逐个释放元素，耗时与元素个数成正比，可以先分批删除元素再删除键";
+    if (event == "write")
+        return "向客户端写出响应过慢，检查是否有客户端一次读取过大的结果或网络拥塞";
+    return "";
+}
+
+/// @brief 对每类事件统计采样数、平均值、平均绝对偏差与采样的时间跨度，再附上对应的建议
+std::string LatencyMonitor::doctor() const
+{
+    if (latency_config.monitor_threshold_ms <= 0)
+        return "延迟监控已关闭，将latency_config.monitor_threshold_ms设为大于0的毫秒数后开启\n";
+    if (events.empty())
+        return "没有超过" + std::to_string(latency_config.monitor_threshold_ms) + "毫秒的事件，一切正常\n";
+
+    std::vector<std::string> names;
+    for (const auto &kv : events)
+        names.push_back(kv.first);
+    std::sort(names.begin(), names.end());
+
+    std::string out;
+    int n = 0;
+    for (const std::string &name : names)
+    {
+        const LatencySeries &ts = events.at(name);
+        std::vector<LatencySample> hist = ts.history();
+        if (hist.empty())
+            continue;
+        double sum = 0;
+        for (const LatencySample &s : hist)
+            sum += s.latency;
+        double avg = sum / hist.size();
+        double mad = 0;
+        for (const LatencySample &s : hist)
+            mad += std::fabs(s.latency - avg);
+        mad /= hist.size();
+        uint64_t period = hist.size() > 1 ? (hist.back().time - hist.front().time) / (hist.size() - 1) : 0;
+
+        char line[512];
+        snprintf(line, sizeof(line), "%d. %s: %zu次超过阈值，平均%.0f毫秒，平均偏差%.0f毫秒，最大%u毫秒，平均间隔%lu秒\n",
+                 ++n, name.c_str(), hist.size(), avg, mad, ts.max, (unsigned long)period);
+        out += line;
+        const char *tip = advice(name);
+        if (*tip)
+            out += std::string("   建议: ") + tip + "\n";
+    }
+    return out;
+}
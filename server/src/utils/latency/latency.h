@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../utils.h"
+
+struct LatencyConfig
+{
+    int64_t monitor_threshold_ms = 10; // 耗时达到该值(毫秒)的事件记入延迟监控，0关闭
+};
+
+extern LatencyConfig latency_config;
+
+// 一个事件的采样，同一秒内的多次采样只保留最大值
+struct LatencySample
+{
+    uint64_t time = 0;    // unix时间(秒)
+    uint32_t latency = 0; // 毫秒
+};
+
+// 一类事件的时间序列：最近k_samples个采样的环形缓冲区，以及有记录以来的最大值
+struct LatencySeries
+{
+    static const size_t k_samples = 160;
+    LatencySample samples[k_samples];
+    size_t idx = 0; // 下一个写入位置
+    uint32_t max = 0;
+
+    // 从旧到新的有效采样
+    std::vector<LatencySample> history() const;
+    const LatencySample &latest() const { return samples[(idx + k_samples - 1) % k_samples]; }
+};
+
+/*延迟监控：记录阻塞事件循环超过阈值的事件，按事件名分别保存时间序列*/
+// 事件名:
+//   command   命令处理函数
+//   rehash    哈希表的重哈希(分配新表与迁移)
+//   obj-free  释放对象(删除大集合等)
+//   write     向套接字写出响应
+class LatencyMonitor
+{
+private:
+    std::unordered_map<std::string, LatencySeries> events;
+
+public:
+    void add_sample(const char *event, uint32_t latency_ms);
+
+    const std::unordered_map<std::string, LatencySeries> &all() const { return events; }
+    const LatencySeries *find(const std::string &event) const;
+
+    // 清空指定事件，events为空时清空全部，返回清空的事件数
+    size_t reset(const std::vector<std::string> &names);
+
+    // 分析每类事件的采样，给出可读的诊断报告
+    std::string doctor() const;
+};
+
+extern LatencyMonitor latency_monitor;
+
+// 事件耗时(cycles_now()的计数)达到阈值时记录，未达到时只做一次比较
+static inline void latency_sample(const char *event, uint64_t elapsed)
+{
+    int64_t threshold = latency_config.monitor_threshold_ms;
+    if (threshold > 0 && elapsed >= threshold * 1000 * cycles_per_us())
+        latency_monitor.add_sample(event, (uint32_t)(elapsed / cycles_per_us() / 1000));
+}
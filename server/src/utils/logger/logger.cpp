@@ -1,7 +1,13 @@
 #include "logger.h"
-#include <iomanip>
+#include "ring_buffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
-#include <sstream>
+#include <mutex>
+#include <thread>
 
 LogConfig CFG;
 
@@ -9,26 +15,54 @@ std::fstream Logger::out;
 LogConfig Logger::config;
 std::string Logger::current_filename;
 
+struct LogRecord
+{
+    LogLevel level = LogLevel::DEBUG;
+    time_t time = 0;
+    std::string message;
+};
+
+static const size_t k_queue_size = 8192;       // 队列容量(条)
+static const size_t k_max_batch = 1 << 20;     // 一批写出的最大字节数
+static const auto k_idle_wait = std::chrono::milliseconds(10); // 队列为空时后台线程的等待时间
+
+static MpscRing<LogRecord> queue(k_queue_size);
+static std::atomic<bool> running{false};
+static std::atomic<uint64_t> dropped{0}; // 队列满时丢弃的记录数
+static std::thread writer;
+static std::mutex wake_mutex;
+static std::condition_variable wake;
+
+// 按秒缓存格式化好的时间戳，按天缓存日志文件名，只由写出的一方访问
+static time_t cached_sec = -1;
+static int cached_day = -1;
+static char cached_stamp[32];
+
 void Logger::init(const LogConfig &cfg)
 {
     config = cfg;
-    ensureFileOpen();
+    if (running.exchange(true))
+        return;
+    writer = std::thread(&Logger::writer_loop);
+    // 进程直接exit时也写出队列中剩余的记录并回收后台线程
+    std::atexit(&Logger::shutdown);
 }
 
 void Logger::shutdown()
 {
+    if (running.exchange(false))
+    {
+        wake.notify_one();
+        writer.join();
+        drain();
+    }
     if (out.is_open())
     {
         out.close();
     }
 }
 
-bool Logger::shouldLog(LogLevel level)
-{
-    return static_cast<int>(level) >= static_cast<int>(config.level);
-}
-
-std::string Logger::levelToString(LogLevel level)
+const char *Logger::levelToString(LogLevel level)
 {
     switch (level)
     {
@@ -47,21 +81,17 @@ std::string Logger::levelToString(LogLevel level)
     }
 }
 
-std::string Logger::getFileName()
+std::string Logger::getFileName(const tm &timeinfo)
 {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    tm *timeinfo = std::localtime(&time_t);
-
     char buffer[100];
-    std::strftime(buffer, sizeof(buffer), "redis_%Y_%m_%d.log", timeinfo);
+    std::strftime(buffer, sizeof(buffer), "redis_%Y_%m_%d.log", &timeinfo);
     //这里使用的相对路径 根据可执行文件的路径
     return "../src/utils/log/" + std::string(buffer);
 }
 
-void Logger::ensureFileOpen()
+void Logger::ensureFileOpen(const tm &timeinfo)
 {
-    std::string new_filename = getFileName();
+    std::string new_filename = getFileName(timeinfo);
     if (new_filename != current_filename)
     {
         if (out.is_open())
@@ -78,39 +108,100 @@ void Logger::ensureFileOpen()
     }
 }
 
-void Logger::log(LogLevel level, const std::string &message)
+/// @brief 调用方只取一次秒级时间并把消息移入队列，格式化与IO都留给后台线程
+void Logger::log(LogLevel level, std::string message)
 {
-    if (!shouldLog(level))
+    time_t now = time(nullptr);
+    if (!running.load(std::memory_order_acquire))
     {
+        std::string line;
+        format(line, level, now, message);
+        write_batch(line);
         return;
     }
+    LogRecord rec{level, now, std::move(message)};
+    if (!queue.push(std::move(rec)))
+        dropped.fetch_add(1, std::memory_order_relaxed);
+}
 
-    ensureFileOpen();
-
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-
-    std::string level_str = levelToString(level);
-    std::stringstream oss;
-    oss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    std::string timestamp = oss.str();
-
-    std::string log_entry = "[" + timestamp + "] [" + level_str + "]: " + message + "\n";
+/// @brief 时间戳只在秒数变化时重新格式化，日期变化时才重新生成文件名并切换文件
+void Logger::format(std::string &batch, LogLevel level, time_t time, const std::string &message)
+{
+    if (time != cached_sec)
+    {
+        tm timeinfo;
+        localtime_r(&time, &timeinfo);
+        std::strftime(cached_stamp, sizeof(cached_stamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        cached_sec = time;
+        int day = timeinfo.tm_year * 400 + timeinfo.tm_yday;
+        if (day != cached_day)
+        {
+            cached_day = day;
+            ensureFileOpen(timeinfo);
+        }
+    }
+    batch += '[';
+    batch += cached_stamp;
+    batch += "] [";
+    batch += levelToString(level);
+    batch += "]: ";
+    batch += message;
+    batch += '\n';
+}
 
+void Logger::write_batch(const std::string &batch)
+{
     if (config.output_to_console)
     {
-        std::cout << log_entry;
+        std::cout << batch;
+        std::cout.flush();
     }
 
     if (out.is_open())
     {
-        out << log_entry;
-        out.flush(); // 确保日志及时写入文件
+        out << batch;
+        out.flush(); // 每批只刷新一次
+    }
+}
+
+size_t Logger::drain()
+{
+    std::string batch;
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+        format(batch, LogLevel::WARNING, time(nullptr), "日志队列已满，丢弃了" + std::to_string(lost) + "条日志");
+
+    size_t n = 0;
+    LogRecord rec;
+    while (queue.pop(rec))
+    {
+        format(batch, rec.level, rec.time, rec.message);
+        n++;
+        if (batch.size() >= k_max_batch)
+        {
+            write_batch(batch);
+            batch.clear();
+        }
+    }
+    if (!batch.empty())
+        write_batch(batch);
+    return n;
+}
+
+void Logger::writer_loop()
+{
+    while (running.load(std::memory_order_acquire))
+    {
+        if (drain() == 0)
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait_for(lock, k_idle_wait);
+        }
     }
 }
 
-void Logger::debug(const std::string &message) { log(LogLevel::DEBUG, message); }
-void Logger::info(const std::string &message) { log(LogLevel::INFO, message); }
-void Logger::warning(const std::string &message) { log(LogLevel::WARNING, message); }
-void Logger::error(const std::string &message) { log(LogLevel::ERROR, message); }
-void Logger::fatal(const std::string &message) { log(LogLevel::FATAL, message); }
\ No newline at end of file
+void Logger::debug(const std::string &message) { LOG_DEBUG(message); }
+void Logger::info(const std::string &message) { LOG_INFO(message); }
+void Logger::warning(const std::string &message) { LOG_WARNING(message); }
+void Logger::error(const std::string &message) { LOG_ERROR(message); }
+void Logger::fatal(const std::string &message) { LOG_FATAL(message); }
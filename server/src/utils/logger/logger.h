@@ -12,6 +12,11 @@ enum class LogLevel
     FATAL    // 严重错误
 };
 
+// 编译期的最低日志级别(LogLevel的数值)，低于该级别的LOG_XXX调用在编译时被整个去掉，由CMake的LOG_MIN_LEVEL设置
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
 struct LogConfig
 {
     LogLevel level = LogLevel::DEBUG;
@@ -19,7 +24,8 @@ struct LogConfig
     size_t max_file_size = 10 * 1024 * 1024;
 };
 
-
+/*异步日志：调用方只把日志记录放入无锁的环形队列，由后台线程批量格式化并写出*/
+// 队列满时丢弃新的记录并计数，不阻塞事件循环；init之前与shutdown之后同步写出
 class Logger
 {
 private:
@@ -28,11 +34,21 @@ private:
     static std::string current_filename;
 
 public:
-    // 初始化配置
+    // 初始化配置并启动后台写线程
     static void init(const LogConfig &cfg);
+    // 写出队列中剩余的记录并停止后台写线程
     static void shutdown();
 
-    // 不同级别的日志方法
+    // 级别是否需要记录，编译期被过滤的级别恒为false
+    static bool enabled(LogLevel level)
+    {
+        return static_cast<int>(level) >= LOG_MIN_LEVEL && static_cast<int>(level) >= static_cast<int>(config.level);
+    }
+
+    // 记录一条日志，不检查级别
+    static void log(LogLevel level, std::string message);
+
+    // 不同级别的日志方法，消息在调用前已构造好，热路径上应使用LOG_XXX宏
     static void debug(const std::string &message);
     static void info(const std::string &message);
     static void warning(const std::string &message);
@@ -40,11 +56,31 @@ public:
     static void fatal(const std::string &message);
 
 private:
-    static void log(LogLevel level, const std::string &message);
-    static bool shouldLog(LogLevel level);
-    static std::string levelToString(LogLevel level);
+    static const char *levelToString(LogLevel level);
+
+    // 后台写线程
+    static void writer_loop();
+    // 取出队列中的全部记录，格式化后一次写出，返回取出的条数
+    static size_t drain();
+    // 把一条记录格式化后追加到batch
+    static void format(std::string &batch, LogLevel level, time_t time, const std::string &message);
+    static void write_batch(const std::string &batch);
 
     // 工具方法
-    static std::string getFileName();
-    static void ensureFileOpen();
-};
\ No newline at end of file
+    static std::string getFileName(const tm &timeinfo);
+    static void ensureFileOpen(const tm &timeinfo);
+};
+
+// 先判断级别再构造消息，级别被过滤时不会对消息表达式(字符串拼接、std::to_string等)求值
+#define LOG_AT(level, ...)              \
+    do                                  \
+    {                                   \
+        if (Logger::enabled(level))     \
+            Logger::log(level, __VA_ARGS__); \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+#define LOG_FATAL(...) LOG_AT(LogLevel::FATAL, __VA_ARGS__)
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*有界的多生产者单消费者无锁环形队列(Vyukov)*/
+// 每个槽位带一个序号：序号等于写位置时可写，等于写位置+1时可读，读出后加上容量留给下一轮写入
+// 生产者之间通过CAS争抢写位置，消费者只有一个，读位置不需要原子操作
+template <typename T>
+class MpscRing
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    const uint64_t mask;
+    alignas(64) std::atomic<uint64_t> tail{0}; // 下一个写位置
+    alignas(64) uint64_t head = 0;             // 下一个读位置，只由消费者访问
+
+public:
+    // 容量必须是2的幂
+    explicit MpscRing(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1)
+    {
+        for (size_t i = 0; i < capacity; i++)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // 队列满时返回false，此时value没有被移走
+    bool push(T &&value)
+    {
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &slots[pos & mask];
+            uint64_t seq = slot->seq.load(std::memory_order_acquire);
+            int64_t diff = (int64_t)seq - (int64_t)pos;
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false;
+            else
+                pos = tail.load(std::memory_order_relaxed);
+        }
+        slot->value = std::move(value);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由消费者线程调用，队列空时返回false
+    bool pop(T &value)
+    {
+        Slot *slot = &slots[head & mask];
+        if (slot->seq.load(std::memory_order_acquire) != head + 1)
+            return false;
+        value = std::move(slot->value);
+        slot->seq.store(head + mask + 1, std::memory_order_release);
+        head++;
+        return true;
+    }
+};
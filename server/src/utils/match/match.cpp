@@ -0,0 +1,202 @@
+#include "match.h"
+#include <utility>
+
+// 匹配一个字符类[...]，p指向'['之后，返回是否匹配，并通过p带回']'之后的位置
+static bool match_class(std::string_view pattern, size_t &p, char ch)
+{
+    bool negate = false;
+    bool matched = false;
+    if (p < pattern.size() && pattern[p] == '^')
+    {
+        negate = true;
+        p++;
+    }
+    while (p < pattern.size() && pattern[p] != ']')
+    {
+        if (pattern[p] == '\\' && p + 1 < pattern.size())
+        {
+            p++;
+            if (pattern[p] == ch)
+                matched = true;
+        }
+        else if (p + 2 < pattern.size() && pattern[p + 1] == '-' && pattern[p + 2] != ']')
+        {
+            char lo = pattern[p], hi = pattern[p + 2];
+            if (lo > hi)
+                std::swap(lo, hi);
+            if (ch >= lo && ch <= hi)
+                matched = true;
+            p += 2;
+        }
+        else if (pattern[p] == ch)
+            matched = true;
+        p++;
+    }
+    // 跳过']'，没有闭合时按到末尾处理
+    if (p < pattern.size())
+        p++;
+    return negate ? !matched : matched;
+}
+
+/// @brief 迭代实现，遇到'*'时记录回溯点，失配时让最近的'*'多吞一个字符，避免递归导致的指数回溯
+bool glob_match(std::string_view pattern, std::string_view str)
+{
+    size_t p = 0, s = 0;
+    size_t star_p = std::string_view::npos, star_s = 0;
+    while (s < str.size())
+    {
+        if (p < pattern.size())
+        {
+            char c = pattern[p];
+            if (c == '*')
+            {
+                star_p = ++p;
+                star_s = s;
+                continue;
+            }
+            if (c == '?')
+            {
+                p++;
+                s++;
+                continue;
+            }
+            if (c == '[')
+            {
+                size_t next = p + 1;
+                if (match_class(pattern, next, str[s]))
+                {
+                    p = next;
+                    s++;
+                    continue;
+                }
+            }
+            else
+            {
+                if (c == '\\' && p + 1 < pattern.size())
+                    c = pattern[++p];
+                if (c == str[s])
+                {
+                    p++;
+                    s++;
+                    continue;
+                }
+            }
+        }
+        // 失配：回溯到最近的'*'
+        if (star_p == std::string_view::npos)
+            return false;
+        p = star_p;
+        s = ++star_s;
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+        p++;
+    return p == pattern.size();
+}
+
+void GlobPattern::add_literal(char c)
+{
+    if (tokens.empty() || tokens.back().op != Op::LITERAL)
+        tokens.push_back({Op::LITERAL, (uint32_t)literals.size(), 0});
+    literals.push_back(c);
+    tokens.back().len++;
+}
+
+/// @brief 逐个解析与glob_match相同的语法，未闭合的'['一直取到模式末尾，末尾单独的'\'按字面字符处理
+GlobPattern::GlobPattern(std::string_view pattern)
+{
+    size_t p = 0;
+    while (p < pattern.size())
+    {
+        char c = pattern[p];
+        if (c == '*')
+        {
+            if (tokens.empty() || tokens.back().op != Op::STAR)
+                tokens.push_back({Op::STAR});
+            p++;
+        }
+        else if (c == '?')
+        {
+            tokens.push_back({Op::ANY});
+            p++;
+        }
+        else if (c == '[')
+        {
+            // 对每个字符复用match_class得到位图，保证与glob_match的解析完全一致
+            CharClass cls;
+            size_t next = p + 1;
+            for (int ch = 0; ch < 256; ch++)
+            {
+                next = p + 1;
+                if (match_class(pattern, next, (char)ch))
+                    cls.set((unsigned char)ch);
+            }
+            tokens.push_back({Op::CLASS, (uint32_t)classes.size()});
+            classes.push_back(cls);
+            p = next;
+        }
+        else
+        {
+            if (c == '\\' && p + 1 < pattern.size())
+                c = pattern[++p];
+            add_literal(c);
+            p++;
+        }
+    }
+    if (!tokens.empty() && tokens[0].op == Op::LITERAL)
+        prefix_ = literals.substr(0, tokens[0].len);
+}
+
+/// @brief 与glob_match相同的回溯策略：失配时让最近的'*'多吞一个字符，
+///        '*'后面是字面字符段时直接查找该段的下一次出现位置，跳过不可能匹配的起点
+bool GlobPattern::match(std::string_view str) const
+{
+    size_t t = 0, s = 0;
+    size_t star_t = std::string_view::npos, star_s = 0;
+    while (true)
+    {
+        if (t == tokens.size())
+        {
+            if (s == str.size())
+                return true;
+        }
+        else
+        {
+            const Token &tk = tokens[t];
+            if (tk.op == Op::STAR)
+            {
+                if (t + 1 == tokens.size())
+                    return true;
+                if (tokens[t + 1].op == Op::LITERAL)
+                {
+                    std::string_view lit(literals.data() + tokens[t + 1].arg, tokens[t + 1].len);
+                    s = str.find(lit, s);
+                    if (s == std::string_view::npos)
+                        return false;
+                }
+                star_t = ++t;
+                star_s = s;
+                continue;
+            }
+            if (s < str.size())
+            {
+                if (tk.op == Op::ANY || (tk.op == Op::CLASS && classes[tk.arg].test(str[s])))
+                {
+                    t++;
+                    s++;
+                    continue;
+                }
+                if (tk.op == Op::LITERAL && str.compare(s, tk.len, literals.data() + tk.arg, tk.len) == 0)
+                {
+                    t++;
+                    s += tk.len;
+                    continue;
+                }
+            }
+        }
+        // 失配：回到最近的'*'，从下一个起点重试
+        if (star_t == std::string_view::npos || star_s >= str.size())
+            return false;
+        t = star_t - 1;
+        s = star_s + 1;
+    }
+}
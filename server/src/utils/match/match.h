@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// glob风格的模式匹配，支持 * ? [abc] [^abc] [a-z] 以及 \ 转义
+bool glob_match(std::string_view pattern, std::string_view str);
+
+// 预编译的glob模式，与glob_match语义相同
+// 编译时合并连续的字面字符、把字符类展开为256位的位图、合并连续的'*'，
+// 同一个模式要匹配大量字符串时(如频道订阅、带MATCH的扫描)避免每次重新解析模式
+class GlobPattern
+{
+private:
+    enum class Op : uint8_t
+    {
+        LITERAL, // 一段字面字符，arg与len为在literals中的范围
+        ANY,     // ?
+        CLASS,   // [...]，arg为classes的下标
+        STAR     // 一个或多个连续的*
+    };
+    struct Token
+    {
+        Op op;
+        uint32_t arg = 0;
+        uint32_t len = 0;
+    };
+    struct CharClass
+    {
+        uint64_t bits[4] = {};
+        bool test(unsigned char c) const { return bits[c >> 6] >> (c & 63) & 1; }
+        void set(unsigned char c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    };
+
+    std::vector<Token> tokens;
+    std::vector<CharClass> classes;
+    std::string literals;
+    std::string prefix_; // 第一个通配符之前的字面前缀(已去掉转义)
+
+    void add_literal(char c);
+
+public:
+    explicit GlobPattern(std::string_view pattern);
+
+    bool match(std::string_view str) const;
+
+    // 所有匹配的字符串都以该前缀开头，可用于按前缀建立索引
+    const std::string &prefix() const { return prefix_; }
+};
@@ -0,0 +1,57 @@
+#include "threadPool.h"
+
+threadPool::threadPool(size_t n)
+{
+    if (n == 0)
+        n = 1;
+    for (size_t i = 0; i < n; i++)
+        workers.emplace_back(&threadPool::worker_loop, this);
+}
+
+threadPool::~threadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    cv.notify_all();
+    for (auto &t : workers)
+        t.join();
+}
+
+void threadPool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]
+                    { return stop || !tasks.empty(); });
+            if (stop && tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+std::future<void> threadPool::submit(std::function<void()> task)
+{
+    auto pt = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> fut = pt->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        tasks.emplace([pt]
+                      { (*pt)(); });
+    }
+    cv.notify_one();
+    return fut;
+}
+
+threadPool &threadPool::instance()
+{
+    static threadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
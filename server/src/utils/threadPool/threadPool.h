@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+
+// 固定大小的工作线程池
+// 事件循环是单线程的，线程池只用于对已拷贝出来的只读数据做大批量计算，任务中不能访问顶级哈希表
+class threadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop = false;
+
+    void worker_loop();
+
+public:
+    threadPool(size_t n);
+    ~threadPool();
+
+    threadPool(const threadPool &) = delete;
+    threadPool &operator=(const threadPool &) = delete;
+
+    // 提交任务，通过返回的future等待任务完成
+    std::future<void> submit(std::function<void()> task);
+
+    size_t size() { return workers.size(); }
+
+    // 全局线程池，第一次使用时按CPU核数创建
+    static threadPool &instance();
+};
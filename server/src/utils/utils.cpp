@@ -1,6 +1,13 @@
 #include "utils.h"
 #include<errno.h>
 #include<fcntl.h>
+#include<time.h>
+#include<string.h>
+#include<stdio.h>
+#include<unistd.h>
+#if defined(__GLIBC__)
+#include<malloc.h>
+#endif
 #include"../utils/logger/logger.h"
 
 void fd_set_nonblock(int fd)
@@ -9,7 +16,7 @@ void fd_set_nonblock(int fd)
     int flags = fcntl(fd, F_GETFL, 0);
     if(errno)
     {
-        Logger::fatal("fd_set_nonblock() 设置fd为非阻塞模式失败");
+        LOG_FATAL("fd_set_nonblock() 设置fd为非阻塞模式失败");
         return;
     }
 
@@ -19,6 +26,166 @@ void fd_set_nonblock(int fd)
     fcntl(fd, F_SETFL, flags);
     if(errno)
     {
-        Logger::fatal("fd_set_nonblock() 设置fd为非阻塞模式失败");
+        LOG_FATAL("fd_set_nonblock() 设置fd为非阻塞模式失败");
     }
-}
\ No newline at end of file
+}
+
+uint64_t get_monotonic_ms()
+{
+    struct timespec tv = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &tv);
+    return uint64_t(tv.tv_sec) * 1000 + tv.tv_nsec / 1000 / 1000;
+}
+
+uint64_t get_realtime_ms()
+{
+    struct timespec tv = {0, 0};
+    clock_gettime(CLOCK_REALTIME, &tv);
+    return uint64_t(tv.tv_sec) * 1000 + tv.tv_nsec / 1000 / 1000;
+}
+
+/// @brief 在约10毫秒内同时读取单调时钟与时间戳计数器，两者增量之比即为每微秒的计数
+double cycles_per_us()
+{
+    static const double rate = []
+    {
+        struct timespec t0, t1, pause = {0, 10 * 1000 * 1000};
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        uint64_t c0 = cycles_now();
+        nanosleep(&pause, nullptr);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        uint64_t c1 = cycles_now();
+        double us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+        return us > 0 && c1 > c0 ? (c1 - c0) / us : 1000.0;
+    }();
+    return rate;
+}
+
+size_t used_memory()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+size_t rss_memory()
+{
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (!fp)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return n == 2 ? resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    uint64_t h = seed ^ (len * m);
+
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + (len & ~(size_t)7);
+    for (; p != end; p += 8)
+    {
+        uint64_t k;
+        memcpy(&k, p, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    switch (len & 7)
+    {
+    case 7: h ^= (uint64_t)p[6] << 48; /* fall through */
+    case 6: h ^= (uint64_t)p[5] << 40; /* fall through */
+    case 5: h ^= (uint64_t)p[4] << 32; /* fall through */
+    case 4: h ^= (uint64_t)p[3] << 24; /* fall through */
+    case 3: h ^= (uint64_t)p[2] << 16; /* fall through */
+    case 2: h ^= (uint64_t)p[1] << 8; /* fall through */
+    case 1: h ^= (uint64_t)p[0];
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+static inline uint32_t rotl32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+// 处理一个64字节的分组
+static void sha1_block(uint32_t h[5], const uint8_t *p)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++)
+        w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 | uint32_t(p[4 * i + 2]) << 8 | p[4 * i + 3];
+    for (int i = 16; i < 80; i++)
+        w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++)
+    {
+        uint32_t f, k;
+        if (i < 20)
+            f = (b & c) | (~b & d), k = 0x5a827999;
+        else if (i < 40)
+            f = b ^ c ^ d, k = 0x6ed9eba1;
+        else if (i < 60)
+            f = (b & c) | (b & d) | (c & d), k = 0x8f1bbcdc;
+        else
+            f = b ^ c ^ d, k = 0xca62c1d6;
+        uint32_t t = rotl32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl32(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+std::string sha1_hex(const void *data, size_t len)
+{
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    const uint8_t *p = (const uint8_t *)data;
+    size_t full = len & ~(size_t)63;
+    for (size_t off = 0; off < full; off += 64)
+        sha1_block(h, p + off);
+
+    // 末尾补一个0x80、若干0，最后8字节为消息的位数(大端)
+    uint8_t tail[128] = {};
+    size_t rest = len - full;
+    memcpy(tail, p + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = uint64_t(len) * 8;
+    for (int i = 0; i < 8; i++)
+        tail[tail_len - 1 - i] = uint8_t(bits >> (8 * i));
+    for (size_t off = 0; off < tail_len; off += 64)
+        sha1_block(h, tail + off);
+
+    static const char hex[] = "0123456789abcdef";
+    std::string out(40, '0');
+    for (int i = 0; i < 20; i++)
+    {
+        uint8_t byte = uint8_t(h[i / 4] >> (24 - 8 * (i % 4)));
+        out[2 * i] = hex[byte >> 4];
+        out[2 * i + 1] = hex[byte & 15];
+    }
+    return out;
+}
@@ -1,3 +1,42 @@
 #pragma once
 //设置为非阻塞类型
-void fd_set_nonblock(int fd);
\ No newline at end of file
+void fd_set_nonblock(int fd);
+
+#include <stdint.h>
+//单调时钟，单位毫秒
+uint64_t get_monotonic_ms();
+//系统时钟，UNIX时间戳，单位毫秒
+uint64_t get_realtime_ms();
+
+#include <stddef.h>
+//64位哈希(MurmurHash64A)，用于需要分布均匀的哈希值的概率数据结构
+uint64_t hash64(const void *data, size_t len, uint64_t seed = 0);
+
+#include <string>
+//SHA-1摘要的40位小写十六进制表示，用作脚本缓存的键
+std::string sha1_hex(const void *data, size_t len);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+//时间戳计数器：x86上为RDTSC(只需几纳秒)，其他平台退化为单调时钟的纳秒数，用于命令耗时统计
+static inline uint64_t cycles_now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+//cycles_now()每微秒的计数，首次调用时对照单调时钟校准
+double cycles_per_us();
+
+//分配器中正在使用的堆内存字节数(glibc为mallinfo2，其他平台返回0)
+size_t used_memory();
+//进程的常驻内存字节数(/proc/self/statm)，读取失败返回0
+size_t rss_memory();